@@ -838,7 +838,38 @@ namespace chaiscript
             std::make_unique<parser::ChaiScript_Parser<eval::Noop_Tracer, optimizer::Optimizer_Default>>(),
             t_modulepaths, t_usepaths, t_opts)
         {
+          json_wrap::streaming_library(*this);
         }
+
+      /// \brief Constructs an engine from a Boot_Snapshot, skipping the standard library bootstrap
+      /// \sa ChaiScript::standard_boot_snapshot
+      explicit ChaiScript(const Boot_Snapshot &t_snapshot,
+          std::vector<std::string> t_modulepaths = {},
+          std::vector<std::string> t_usepaths = {},
+          const std::vector<Options> &t_opts = {})
+        : ChaiScript_Basic(
+            t_snapshot,
+            std::make_unique<parser::ChaiScript_Parser<eval::Noop_Tracer, optimizer::Optimizer_Default>>(),
+            t_modulepaths, t_usepaths, t_opts)
+        {
+          json_wrap::streaming_library(*this);
+        }
+
+      /// \brief Returns the process wide snapshot of an engine bootstrapped with Std_Lib::library(),
+      ///        building it on first use
+      ///
+      /// \b Example:
+      /// \code
+      /// chaiscript::ChaiScript chai(chaiscript::ChaiScript::standard_boot_snapshot());
+      /// \endcode
+      static const Boot_Snapshot &standard_boot_snapshot()
+      {
+        static const Boot_Snapshot snapshot = [](){
+          parser::ChaiScript_Parser<eval::Noop_Tracer, optimizer::Optimizer_Default> parser;
+          return build_boot_snapshot(chaiscript::Std_Lib::library(), parser);
+        }();
+        return snapshot;
+      }
   };
 }
 
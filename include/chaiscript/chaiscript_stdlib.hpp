@@ -7,7 +7,9 @@
 #ifndef CHAISCRIPT_STDLIB_HPP_
 #define CHAISCRIPT_STDLIB_HPP_
 
+#include <cstdint>
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -26,6 +28,7 @@
 #include "language/chaiscript_prelude.hpp"
 #include "dispatchkit/register_function.hpp"
 #include "utility/json_wrap.hpp"
+#include "utility/binary_wrap.hpp"
 
 #ifndef CHAISCRIPT_NO_THREADS
 #include <future>
@@ -49,15 +52,23 @@ namespace chaiscript
 
         bootstrap::standard_library::vector_type<std::vector<Boxed_Value> >("Vector", *lib);
         bootstrap::standard_library::string_type<std::string>("string", *lib);
+        bootstrap::standard_library::string_view_type("string_view", *lib);
         bootstrap::standard_library::map_type<std::map<std::string, Boxed_Value> >("Map", *lib);
+        bootstrap::standard_library::hash_map_type<std::unordered_map<std::string, Boxed_Value> >("Hash_Map", *lib);
         bootstrap::standard_library::pair_type<std::pair<Boxed_Value, Boxed_Value > >("Pair", *lib);
+        bootstrap::standard_library::typed_array_type<Typed_Array<std::int32_t> >("Int32_Array", *lib);
+        bootstrap::standard_library::typed_array_type<Typed_Array<std::int64_t> >("Int64_Array", *lib);
+        bootstrap::standard_library::typed_array_type<Typed_Array<float> >("Float_Array", *lib);
+        bootstrap::standard_library::typed_array_type<Typed_Array<double> >("Double_Array", *lib);
+        bootstrap::standard_library::array_mask_type("Array_Mask", *lib);
+        bootstrap::standard_library::lazy_range_type("Lazy_Range", *lib);
 
 #ifndef CHAISCRIPT_NO_THREADS
         bootstrap::standard_library::future_type<std::future<chaiscript::Boxed_Value>>("future", *lib);
-        lib->add(chaiscript::fun([](const std::function<chaiscript::Boxed_Value ()> &t_func){ return std::async(std::launch::async, t_func);}), "async");
 #endif
 
         json_wrap::library(*lib);
+        binary_wrap::library(*lib);
 
         lib->eval(ChaiScript_Prelude::chaiscript_prelude() /*, "standard prelude"*/ );
 
@@ -12,11 +12,16 @@
 #define CHAISCRIPT_THREADING_HPP_
 
 
-#include <unordered_map>
-
 #ifndef CHAISCRIPT_NO_THREADS
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
+#include <vector>
 #else
 #ifndef CHAISCRIPT_NO_THREADS_WARNING
 #pragma message ("ChaiScript is compiling without thread safety.")
@@ -57,12 +62,22 @@ namespace chaiscript
 
       using shared_mutex = std::mutex;
 
+      /// Lets readers share the lock, for the few tables read on hot paths by many threads and
+      /// seldom written; shared_mutex is a plain mutex, which is cheaper when uncontended
+      using read_write_mutex = std::shared_timed_mutex;
+
+      template<typename T>
+        using read_lock = std::shared_lock<T>;
+
       using std::mutex;
 
       using std::recursive_mutex;
 
-      /// Typesafe thread specific storage. If threading is enabled, this class uses a mutex protected map. If
-      /// threading is not enabled, the class always returns the same data, regardless of which thread it is called from.
+      /// Typesafe thread specific storage. If threading is enabled, each Thread_Storage owns a slot
+      /// index into a per thread table of its T, so a lookup is an index and a null check. The tables
+      /// are kept in a registry: destroying a Thread_Storage destroys the entries of every thread,
+      /// and a thread that exits destroys its own. If threading is not enabled, the class always
+      /// returns the same data, regardless of which thread it is called from.
       template<typename T>
         class Thread_Storage
         {
@@ -75,55 +90,128 @@ namespace chaiscript
 
             ~Thread_Storage()
             {
-              if (!destroyed) {
-                t().erase(this);
+              // taken out under the lock, but destroyed once it is released, in case their
+              // destructors use a Thread_Storage<T> of their own
+              std::vector<std::unique_ptr<T>> values;
+              {
+                auto &r = registry();
+                std::lock_guard<std::mutex> l(r.mutex);
+                for (auto *table : r.tables) {
+                  if (m_index < table->slots.size() && table->slots[m_index]) {
+                    values.push_back(std::move(table->slots[m_index]));
+                  }
+                }
+                r.free.push_back(m_index);
               }
             }
 
             inline const T *operator->() const
             {
-              return &(t()[const_cast<Thread_Storage *>(this)]);
+              return &get();
             }
 
             inline const T &operator*() const
             {
-              return t()[const_cast<Thread_Storage *>(this)];
+              return get();
             }
 
             inline T *operator->()
             {
-              return &(t()[this]);
+              return &get();
             }
 
             inline T &operator*()
             {
-              return t()[this];
+              return get();
             }
 
           private:
-            struct Map_Holder {
-              std::unordered_map<Thread_Storage<T> *, T> map;
-
-              Map_Holder() = default;
-              Map_Holder(const Map_Holder &) = delete;
-              Map_Holder(Map_Holder &&) = delete;
-              Map_Holder& operator=(Map_Holder &&) = delete;
-              Map_Holder& operator=(const Map_Holder &&) = delete;
-              ~Map_Holder() {
-                // here is the theory:
-                //   * If the Map_Holder is destroyed before the Thread_Storage, a flag will get set
-                //   * If destroyed after the Thread_Storage, the * will have been removed from `map` and nothing will happen
-                for(auto &elem : map) { elem.first->destroyed = true; }
+            struct Table {
+              std::vector<std::unique_ptr<T>> slots;
+
+              Table()
+              {
+                auto &r = registry();
+                std::lock_guard<std::mutex> l(r.mutex);
+                r.tables.push_back(this);
+              }
+
+              Table(const Table &) = delete;
+              Table(Table &&) = delete;
+              Table& operator=(Table &&) = delete;
+              Table& operator=(const Table &) = delete;
+
+              ~Table()
+              {
+                std::vector<std::unique_ptr<T>> values;
+                {
+                  auto &r = registry();
+                  std::lock_guard<std::mutex> l(r.mutex);
+                  r.tables.erase(std::find(r.tables.begin(), r.tables.end(), this));
+                  values.swap(slots);
+                }
               }
             };
 
-            static std::unordered_map<Thread_Storage<T> *, T> &t()
+            /// Every thread's table and the slot indexes not in use. The lock is held whenever
+            /// a table is resized or an entry is destroyed by another thread than its own.
+            struct Registry {
+              std::mutex mutex;
+              std::vector<Table *> tables;
+              std::vector<std::size_t> free;
+              std::size_t next = 0;
+            };
+
+            T &get() const
+            {
+              auto &slots = t().slots;
+              if (m_index < slots.size() && slots[m_index]) {
+                return *slots[m_index];
+              }
+              return create();
+            }
+
+            T &create() const
+            {
+              auto &table = t();
+
+              // made before the lock is taken, in case T's constructor uses thread storage of its own
+              auto value = std::make_unique<T>();
+              T &result = *value;
+
+              std::lock_guard<std::mutex> l(registry().mutex);
+              if (m_index >= table.slots.size()) {
+                table.slots.resize(m_index + 1);
+              }
+              table.slots[m_index] = std::move(value);
+              return result;
+            }
+
+            static Table &t()
+            {
+              thread_local Table my_table;
+              return my_table;
+            }
+
+            static Registry &registry()
+            {
+              static Registry r;
+              return r;
+            }
+
+            static std::size_t acquire_index()
             {
-              thread_local Map_Holder my_map;
-              return my_map.map;
+              auto &r = registry();
+              std::lock_guard<std::mutex> l(r.mutex);
+              if (r.free.empty()) {
+                return r.next++;
+              }
+              const auto index = r.free.back();
+              r.free.pop_back();
+              return index;
             }
 
-            bool destroyed{false};
+            const std::size_t m_index{acquire_index()};
         };
 
 #else // threading disabled
@@ -154,6 +242,15 @@ namespace chaiscript
 
       class shared_mutex { };
 
+      class read_write_mutex { };
+
+      template<typename T>
+      class read_lock
+      {
+        public:
+          explicit read_lock(T &) {}
+      };
+
       class recursive_mutex {};
 
 
@@ -161,9 +258,11 @@ namespace chaiscript
         class Thread_Storage
         {
           public:
-            explicit Thread_Storage(void *)
-            {
-            }
+            Thread_Storage() = default;
+            Thread_Storage(const Thread_Storage &) = delete;
+            Thread_Storage(Thread_Storage &&) = delete;
+            Thread_Storage &operator=(const Thread_Storage &) = delete;
+            Thread_Storage &operator=(Thread_Storage &&) = delete;
 
             inline T *operator->() const
             {
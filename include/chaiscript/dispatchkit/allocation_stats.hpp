@@ -0,0 +1,607 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_ALLOCATION_STATS_HPP_
+#define CHAISCRIPT_ALLOCATION_STATS_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../chaiscript_threading.hpp"
+#include "type_info.hpp"
+
+namespace chaiscript
+{
+  /// \brief Opt-in counts and byte totals of what an engine allocates, by kind and by Type_Info
+  ///
+  /// While enabled, the values boxed, the objects made for them, the parse tree nodes made and
+  /// the functions registered on behalf of the engine are counted against their type, by the
+  /// number of allocations and their bytes. Values, objects and nodes are made with an
+  /// allocator that counts them again when they are freed, which can be after the statistics
+  /// were disabled or the engine was destroyed; the bytes include the shared_ptr control block.
+  /// Functions are counted as they are added to the engine, which holds them from then on;
+  /// their size is not known there and is not counted.
+  ///
+  /// Strings and containers boxed by value also count the heap memory they hold, see Heap_Size.
+  /// It is measured when they are boxed and again after each native call that could have changed
+  /// them, so `s += s` counts what the string grew by.
+  ///
+  /// What is allocated is attributed to the engine whose code is running on the thread, so
+  /// values made by a host function called from a script count against that script's engine.
+  ///
+  /// \sa ChaiScript_Basic::allocation_stats
+  class Allocation_Stats
+  {
+    public:
+      enum class Kind
+      {
+        /// the state of a Boxed_Value, one per value however it is copied
+        value,
+        /// an object made to be boxed, such as a Dynamic_Object or the result of a constructor
+        object,
+        /// a parse tree node
+        node,
+        /// a function added to the engine
+        function
+      };
+
+      /// Counts of one kind and type, as reported
+      struct Entry
+      {
+        Kind kind = Kind::value;
+        Type_Info type;
+        std::uint64_t live_count = 0;
+        std::uint64_t peak_count = 0;
+        std::uint64_t total_count = 0;
+        std::uint64_t live_bytes = 0;
+        std::uint64_t peak_bytes = 0;
+        std::uint64_t total_bytes = 0;
+      };
+
+      /// Live count and bytes of all kinds and types together
+      struct Totals
+      {
+        std::atomic<std::uint64_t> live_count{0};
+        std::atomic<std::uint64_t> live_bytes{0};
+      };
+
+      /// Live counters of one kind and type, shared with the allocations made against them
+      struct Counters
+      {
+        explicit Counters(std::shared_ptr<Totals> t_engine_totals)
+          : engine_totals(std::move(t_engine_totals))
+        {
+        }
+
+        void allocated(const std::size_t t_bytes)
+        {
+          engine_totals->live_count.fetch_add(1, std::memory_order_relaxed);
+          engine_totals->live_bytes.fetch_add(t_bytes, std::memory_order_relaxed);
+          raise(peak_count, live_count.fetch_add(1, std::memory_order_relaxed) + 1);
+          raise(peak_bytes, live_bytes.fetch_add(t_bytes, std::memory_order_relaxed) + t_bytes);
+          total_count.fetch_add(1, std::memory_order_relaxed);
+          total_bytes.fetch_add(t_bytes, std::memory_order_relaxed);
+        }
+
+        /// Something already counted now holds t_to bytes of heap memory rather than t_from
+        void resized(const std::size_t t_from, const std::size_t t_to)
+        {
+          if (t_to > t_from) {
+            const auto grown = t_to - t_from;
+            engine_totals->live_bytes.fetch_add(grown, std::memory_order_relaxed);
+            raise(peak_bytes, live_bytes.fetch_add(grown, std::memory_order_relaxed) + grown);
+            total_bytes.fetch_add(grown, std::memory_order_relaxed);
+          } else if (t_to < t_from) {
+            const auto shrunk = t_from - t_to;
+            engine_totals->live_bytes.fetch_sub(shrunk, std::memory_order_relaxed);
+            live_bytes.fetch_sub(shrunk, std::memory_order_relaxed);
+          }
+        }
+
+        void freed(const std::size_t t_bytes)
+        {
+          engine_totals->live_count.fetch_sub(1, std::memory_order_relaxed);
+          engine_totals->live_bytes.fetch_sub(t_bytes, std::memory_order_relaxed);
+          live_count.fetch_sub(1, std::memory_order_relaxed);
+          live_bytes.fetch_sub(t_bytes, std::memory_order_relaxed);
+        }
+
+        std::atomic<std::uint64_t> live_count{0};
+        std::atomic<std::uint64_t> peak_count{0};
+        std::atomic<std::uint64_t> total_count{0};
+        std::atomic<std::uint64_t> live_bytes{0};
+        std::atomic<std::uint64_t> peak_bytes{0};
+        std::atomic<std::uint64_t> total_bytes{0};
+        std::shared_ptr<Totals> engine_totals;
+
+        private:
+          static void raise(std::atomic<std::uint64_t> &t_peak, const std::uint64_t t_value)
+          {
+            auto peak = t_peak.load(std::memory_order_relaxed);
+            while (t_value > peak && !t_peak.compare_exchange_weak(peak, t_value, std::memory_order_relaxed)) {}
+          }
+      };
+
+      /// The heap bytes a boxed T holds beyond its own size, for the types that grow in place.
+      /// Measuring is shallow and constant time: a container counts its own buffer or nodes,
+      /// not what its elements hold.
+      template<typename T>
+        struct Heap_Size
+        {
+          static constexpr bool tracked = false;
+        };
+
+      template<typename Char, typename Traits, typename Alloc>
+        struct Heap_Size<std::basic_string<Char, Traits, Alloc>>
+        {
+          static constexpr bool tracked = true;
+          static std::size_t of(const std::basic_string<Char, Traits, Alloc> &t_s)
+          {
+            // a short string is kept inside the object itself
+            const auto *data = reinterpret_cast<const char *>(t_s.data());
+            const auto *self = reinterpret_cast<const char *>(&t_s);
+            if (data >= self && data < self + sizeof(t_s)) {
+              return 0;
+            }
+            return (t_s.capacity() + 1) * sizeof(Char);
+          }
+        };
+
+      template<typename T, typename Alloc>
+        struct Heap_Size<std::vector<T, Alloc>>
+        {
+          static constexpr bool tracked = true;
+          static std::size_t of(const std::vector<T, Alloc> &t_v)
+          {
+            return t_v.capacity() * sizeof(T);
+          }
+        };
+
+      template<typename Key, typename T, typename Compare, typename Alloc>
+        struct Heap_Size<std::map<Key, T, Compare, Alloc>>
+        {
+          static constexpr bool tracked = true;
+          static std::size_t of(const std::map<Key, T, Compare, Alloc> &t_m)
+          {
+            // a tree node has three links and a color besides the element
+            return t_m.size() * (sizeof(typename std::map<Key, T, Compare, Alloc>::value_type) + 4 * sizeof(void *));
+          }
+        };
+
+      template<typename Key, typename T, typename Hash, typename Equal, typename Alloc>
+        struct Heap_Size<std::unordered_map<Key, T, Hash, Equal, Alloc>>
+        {
+          static constexpr bool tracked = true;
+          static std::size_t of(const std::unordered_map<Key, T, Hash, Equal, Alloc> &t_m)
+          {
+            // a node has a link and a cached hash besides the element, and each bucket is a pointer
+            return t_m.size() * (sizeof(typename std::unordered_map<Key, T, Hash, Equal, Alloc>::value_type) + 2 * sizeof(void *))
+              + t_m.bucket_count() * sizeof(void *);
+          }
+        };
+
+      /// Keeps the heap bytes of one boxed object counted, for a type with a Heap_Size
+      class Heap_Tracker
+      {
+        public:
+          Heap_Tracker(std::shared_ptr<Counters> t_counters, const void *t_obj, std::size_t (*t_measure)(const void *))
+            : m_counters(std::move(t_counters)), m_obj(t_obj), m_measure(t_measure)
+          {
+            update();
+          }
+
+          ~Heap_Tracker()
+          {
+            m_counters->resized(m_bytes.exchange(0), 0);
+          }
+
+          Heap_Tracker(const Heap_Tracker &) = delete;
+          Heap_Tracker &operator=(const Heap_Tracker &) = delete;
+
+          /// Measures the object again, counting what it grew or shrank by
+          void update()
+          {
+            const auto bytes = m_measure(m_obj);
+            const auto previous = m_bytes.exchange(bytes, std::memory_order_relaxed);
+            if (previous != bytes) {
+              m_counters->resized(previous, bytes);
+            }
+          }
+
+        private:
+          std::shared_ptr<Counters> m_counters;
+          const void *m_obj;
+          std::size_t (*m_measure)(const void *);
+          std::atomic<std::size_t> m_bytes{0};
+      };
+
+      /// Allocator counting what it allocates and frees on one Counters
+      template<typename T>
+        class Allocator
+        {
+          public:
+            typedef T value_type;
+
+            explicit Allocator(std::shared_ptr<Counters> t_counters)
+              : m_counters(std::move(t_counters))
+            {
+            }
+
+            template<typename U>
+              Allocator(const Allocator<U> &t_other)
+                : m_counters(t_other.m_counters)
+              {
+              }
+
+            T *allocate(const std::size_t t_n)
+            {
+              auto *p = std::allocator<T>().allocate(t_n);
+              m_counters->allocated(t_n * sizeof(T));
+              return p;
+            }
+
+            void deallocate(T *t_p, const std::size_t t_n)
+            {
+              m_counters->freed(t_n * sizeof(T));
+              std::allocator<T>().deallocate(t_p, t_n);
+            }
+
+            template<typename U>
+              bool operator==(const Allocator<U> &t_other) const { return m_counters == t_other.m_counters; }
+            template<typename U>
+              bool operator!=(const Allocator<U> &t_other) const { return m_counters != t_other.m_counters; }
+
+          private:
+            template<typename U> friend class Allocator;
+            std::shared_ptr<Counters> m_counters;
+        };
+
+      /// Makes the statistics of an engine the ones allocations on this thread are counted on, until destroyed
+      class Scope
+      {
+        public:
+          explicit Scope(Allocation_Stats &t_stats)
+            : m_previous(current())
+          {
+            auto *stats = t_stats.counting() ? &t_stats : nullptr;
+            m_active = stats || m_previous;
+            if (m_active) { current() = stats; }
+          }
+
+          ~Scope()
+          {
+            if (m_active) { current() = m_previous; }
+          }
+
+          Scope(const Scope &) = delete;
+          Scope &operator=(const Scope &) = delete;
+
+        private:
+          Allocation_Stats *m_previous;
+          bool m_active = false;
+      };
+
+      Allocation_Stats() = default;
+      Allocation_Stats(const Allocation_Stats &) = delete;
+      Allocation_Stats &operator=(const Allocation_Stats &) = delete;
+
+      void enable(const bool t_enabled = true)
+      {
+        m_enabled = t_enabled;
+      }
+
+      bool enabled() const
+      {
+        return m_enabled.load(std::memory_order_relaxed);
+      }
+
+      /// Keeps counting while disabled, as long as something such as a box limit needs the counts
+      void keep_counting(const bool t_keep)
+      {
+        m_keep_counting = t_keep;
+      }
+
+      bool counting() const
+      {
+        return enabled() || m_keep_counting.load(std::memory_order_relaxed);
+      }
+
+      /// \returns the number of everything counted that is still live
+      std::uint64_t live_count() const
+      {
+        return m_totals->live_count.load(std::memory_order_relaxed);
+      }
+
+      /// \returns the bytes of everything counted that is still live
+      std::uint64_t live_bytes() const
+      {
+        return m_totals->live_bytes.load(std::memory_order_relaxed);
+      }
+
+      /// \returns the statistics allocations on this thread are counted on, if any
+      static Allocation_Stats *active()
+      {
+        return current();
+      }
+
+      /// Drops the counts of everything that is no longer live, and the peaks and totals of the rest
+      void reset()
+      {
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+        m_epoch = next_epoch();
+        for (auto itr = m_counters.begin(); itr != m_counters.end();)
+        {
+          auto &counters = *itr->second.second;
+          if (counters.live_count == 0) {
+            itr = m_counters.erase(itr);
+          } else {
+            counters.peak_count = counters.live_count.load();
+            counters.total_count = counters.live_count.load();
+            counters.peak_bytes = counters.live_bytes.load();
+            counters.total_bytes = counters.live_bytes.load();
+            ++itr;
+          }
+        }
+      }
+
+      /// Counts of each kind and type, most live bytes first
+      std::vector<Entry> entries() const
+      {
+        std::vector<Entry> result;
+        {
+          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          for (const auto &counted : m_counters)
+          {
+            const auto &counters = *counted.second.second;
+            Entry entry;
+            entry.kind = counted.first.first;
+            entry.type = counted.second.first;
+            entry.live_count = counters.live_count;
+            entry.peak_count = counters.peak_count;
+            entry.total_count = counters.total_count;
+            entry.live_bytes = counters.live_bytes;
+            entry.peak_bytes = counters.peak_bytes;
+            entry.total_bytes = counters.total_bytes;
+            result.push_back(entry);
+          }
+        }
+
+        std::stable_sort(result.begin(), result.end(),
+            [](const Entry &lhs, const Entry &rhs) {
+              return lhs.live_bytes > rhs.live_bytes
+                  || (lhs.live_bytes == rhs.live_bytes && lhs.total_count > rhs.total_count);
+            });
+        return result;
+      }
+
+      /// \returns entries() as a table, one line per kind and type, types named by t_type_name
+      std::string report(const std::function<std::string (const Type_Info &)> &t_type_name
+                            = [](const Type_Info &t_ti) { return t_ti.bare_name(); }) const
+      {
+        std::string result = "live_count peak_count total_count live_bytes peak_bytes total_bytes kind type\n";
+        for (const auto &entry : entries())
+        {
+          result += std::to_string(entry.live_count) + ' ' + std::to_string(entry.peak_count) + ' '
+            + std::to_string(entry.total_count) + ' ' + std::to_string(entry.live_bytes) + ' '
+            + std::to_string(entry.peak_bytes) + ' ' + std::to_string(entry.total_bytes) + ' '
+            + kind_name(entry.kind) + ' ' + (entry.type.is_undef() ? std::string("undefined") : t_type_name(entry.type)) + '\n';
+        }
+        return result;
+      }
+
+      static const char *kind_name(const Kind t_kind)
+      {
+        switch (t_kind) {
+          case Kind::value: return "value";
+          case Kind::object: return "object";
+          case Kind::node: return "node";
+          case Kind::function: return "function";
+        }
+        return "";
+      }
+
+      /// \returns the counters of t_kind allocations of t_type
+      ///
+      /// While only counting for a limit, everything shares one set of counters and nothing is
+      /// looked up. While enabled, each thread keeps the counters it has used, so the shared
+      /// table is only locked the first time a thread makes something of a kind and type.
+      std::shared_ptr<Counters> counters(const Kind t_kind, const Type_Info &t_type)
+      {
+        if (!enabled()) {
+          return m_untyped;
+        }
+
+        const auto key = std::make_pair(t_kind, std::type_index(*t_type.bare_type_info()));
+        auto &cache = thread_cache();
+        const auto cache_key = std::make_tuple(m_epoch.load(std::memory_order_relaxed), t_kind, key.second);
+        const auto cached = cache.find(cache_key);
+        if (cached != cache.end()) {
+          return cached->second;
+        }
+
+        std::shared_ptr<Counters> result;
+        {
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          auto &counted = m_counters[key];
+          if (!counted.second) {
+            counted = std::make_pair(t_type, std::make_shared<Counters>(m_totals));
+          }
+          result = counted.second;
+        }
+
+        if (cache.size() >= max_cached) {
+          cache.clear();
+        }
+        cache.emplace(cache_key, result);
+        return result;
+      }
+
+      /// Makes a T counted as a t_kind allocation of t_type
+      template<typename T, typename ... Arg>
+        std::shared_ptr<T> make_shared(const Kind t_kind, const Type_Info &t_type, Arg && ... arg)
+        {
+          return std::allocate_shared<T>(Allocator<T>(counters(t_kind, t_type)), std::forward<Arg>(arg)...);
+        }
+
+      /// Makes a T from t_arg, counted as an object of t_type by the statistics active on this thread if any.
+      /// If T has a Heap_Size, its heap bytes are kept counted too, see heap_tracker().
+      template<typename T, typename ... Arg>
+        static std::shared_ptr<T> make_object(const Type_Info &t_type, Arg && ... t_arg)
+        {
+          return make_object<T>(std::integral_constant<bool, Heap_Size<T>::tracked>(), t_type, std::forward<Arg>(t_arg)...);
+        }
+
+      /// \returns what keeps the heap bytes of t_obj counted, if it was made by make_object() while counting
+      template<typename T>
+        static Heap_Tracker *heap_tracker(const std::shared_ptr<T> &t_obj)
+        {
+          return heap_tracker(t_obj, std::integral_constant<bool, Heap_Size<typename std::remove_const<T>::type>::tracked>());
+        }
+
+      /// Makes a T, counted as a t_kind allocation of t_type by the statistics active on this thread if any
+      template<typename T, typename ... Arg>
+        static std::shared_ptr<T> make_counted(const Kind t_kind, const Type_Info &t_type, Arg && ... arg)
+        {
+          if (auto *stats = active()) {
+            return stats->make_shared<T>(t_kind, t_type, std::forward<Arg>(arg)...);
+          }
+          return std::make_shared<T>(std::forward<Arg>(arg)...);
+        }
+
+      /// Counts something of t_type that the engine holds from now on as a t_kind allocation
+      void add(const Kind t_kind, const Type_Info &t_type, const std::size_t t_bytes = 0)
+      {
+        counters(t_kind, t_type)->allocated(t_bytes);
+      }
+
+    private:
+      template<typename T>
+        struct Tracked
+        {
+          template<typename ... Arg>
+            Tracked(std::shared_ptr<Counters> t_counters, Arg && ... t_arg)
+              : value(std::forward<Arg>(t_arg)...),
+                tracker(std::move(t_counters), &value, [](const void *t_obj) { return Heap_Size<T>::of(*static_cast<const T *>(t_obj)); })
+            {
+            }
+
+          T value;
+          Heap_Tracker tracker;
+        };
+
+      /// Destroys a Tracked<T>, and lets heap_tracker() find it again from any shared_ptr to it
+      template<typename T>
+        struct Tracked_Deleter
+        {
+          void operator()(Tracked<T> *t_tracked) const
+          {
+            Allocator<Tracked<T>> alloc(counters);
+            t_tracked->~Tracked<T>();
+            alloc.deallocate(t_tracked, 1);
+          }
+
+          std::shared_ptr<Counters> counters;
+          Tracked<T> *tracked;
+        };
+
+      template<typename T, typename ... Arg>
+        static std::shared_ptr<T> make_object(std::false_type, const Type_Info &t_type, Arg && ... t_arg)
+        {
+          return make_counted<T>(Kind::object, t_type, std::forward<Arg>(t_arg)...);
+        }
+
+      template<typename T, typename ... Arg>
+        static std::shared_ptr<T> make_object(std::true_type, const Type_Info &t_type, Arg && ... t_arg)
+        {
+          auto *stats = active();
+          if (!stats) {
+            return std::make_shared<T>(std::forward<Arg>(t_arg)...);
+          }
+          auto counters = stats->counters(Kind::object, t_type);
+          Allocator<Tracked<T>> alloc(counters);
+          auto *tracked = alloc.allocate(1);
+          try {
+            new (tracked) Tracked<T>(counters, std::forward<Arg>(t_arg)...);
+          } catch (...) {
+            alloc.deallocate(tracked, 1);
+            throw;
+          }
+          std::shared_ptr<Tracked<T>> owner(tracked, Tracked_Deleter<T>{counters, tracked}, alloc);
+          return std::shared_ptr<T>(owner, &tracked->value);
+        }
+
+      template<typename T>
+        static Heap_Tracker *heap_tracker(const std::shared_ptr<T> &, std::false_type)
+        {
+          return nullptr;
+        }
+
+      template<typename T>
+        static Heap_Tracker *heap_tracker(const std::shared_ptr<T> &t_obj, std::true_type)
+        {
+          const auto *deleter = std::get_deleter<Tracked_Deleter<typename std::remove_const<T>::type>>(t_obj);
+          return deleter ? &deleter->tracked->tracker : nullptr;
+        }
+
+      typedef std::map<std::tuple<std::uint64_t, Kind, std::type_index>, std::shared_ptr<Counters>> Thread_Cache;
+      static constexpr std::size_t max_cached = 256;
+
+      static Thread_Cache &thread_cache()
+      {
+#ifndef CHAISCRIPT_NO_THREADS
+        thread_local Thread_Cache cache;
+#else
+        static Thread_Cache cache;
+#endif
+        return cache;
+      }
+
+      /// A process wide unique number, so thread caches never mix up statistics or outlive a reset()
+      static std::uint64_t next_epoch()
+      {
+        static std::atomic<std::uint64_t> epoch{0};
+        return ++epoch;
+      }
+
+      static Allocation_Stats *&current()
+      {
+#ifndef CHAISCRIPT_NO_THREADS
+        thread_local Allocation_Stats *stats = nullptr;
+#else
+        static Allocation_Stats *stats = nullptr;
+#endif
+        return stats;
+      }
+
+      std::atomic_bool m_enabled{false};
+      std::atomic_bool m_keep_counting{false};
+      std::shared_ptr<Totals> m_totals = std::make_shared<Totals>();
+      std::shared_ptr<Counters> m_untyped = std::make_shared<Counters>(m_totals);
+      std::atomic<std::uint64_t> m_epoch{next_epoch()};
+
+      mutable chaiscript::detail::threading::shared_mutex m_mutex;
+      std::map<std::pair<Kind, std::type_index>, std::pair<Type_Info, std::shared_ptr<Counters>>> m_counters;
+  };
+}
+
+#endif
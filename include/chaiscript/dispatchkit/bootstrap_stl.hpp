@@ -17,7 +17,10 @@
 #ifndef CHAISCRIPT_BOOTSTRAP_STL_HPP_
 #define CHAISCRIPT_BOOTSTRAP_STL_HPP_
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
+#include <map>
 #include <memory>
 #include <stdexcept>
 #include <typeinfo>
@@ -26,10 +29,14 @@
 #include "bootstrap.hpp"
 #include "boxed_value.hpp"
 #include "dispatchkit.hpp"
+#include "lazy_range.hpp"
 #include "operators.hpp"
 #include "proxy_constructors.hpp"
 #include "register_function.hpp"
 #include "type_info.hpp"
+#include "../utility/thread_pool.hpp"
+#include "../utility/typed_array.hpp"
+#include "../utility/view.hpp"
 
 namespace chaiscript 
 {
@@ -120,6 +127,19 @@ namespace chaiscript
 
 
 
+        template<typename Bidir_Type>
+          void range_back_access(Module& m, std::bidirectional_iterator_tag)
+          {
+            m.add(fun(&Bidir_Type::pop_back), "pop_back");
+            m.add(fun(&Bidir_Type::back), "back");
+          }
+
+        /// Ranges over forward only containers, such as hashed ones, can only be walked from the front
+        template<typename Bidir_Type>
+          void range_back_access(Module&, std::forward_iterator_tag)
+          {
+          }
+
         /// Add Bidir_Range support for the given ContainerType
         template<typename Bidir_Type>
           void input_range_type_impl(const std::string &type, Module& m)
@@ -133,8 +153,7 @@ namespace chaiscript
             m.add(fun(&Bidir_Type::empty), "empty");
             m.add(fun(&Bidir_Type::pop_front), "pop_front");
             m.add(fun(&Bidir_Type::front), "front");
-            m.add(fun(&Bidir_Type::pop_back), "pop_back");
-            m.add(fun(&Bidir_Type::back), "back");
+            range_back_access<Bidir_Type>(m, typename std::iterator_traits<decltype(Bidir_Type::m_begin)>::iterator_category());
           }
 
 
@@ -546,6 +565,60 @@ namespace chaiscript
         }
 
 
+      /// Add a hashed MapType container, such as std::unordered_map. It gets what map_type provides,
+      /// except for the pair type: that is the same as the matching std::map's, which registers it.
+      template<typename MapType>
+        void hash_map_type(const std::string &type, Module& m)
+        {
+          m.add(user_type<MapType>(), type);
+
+          typedef typename MapType::mapped_type &(MapType::*elem_access)(const typename MapType::key_type &);
+          typedef const typename MapType::mapped_type &(MapType::*const_elem_access)(const typename MapType::key_type &) const;
+
+          m.add(fun(static_cast<elem_access>(&MapType::operator[])), "[]");
+
+          m.add(fun(static_cast<elem_access>(&MapType::at)), "at");
+          m.add(fun(static_cast<const_elem_access>(&MapType::at)), "at");
+
+          m.add(fun([](MapType *a, typename MapType::size_type n) { a->reserve(n); } ), "reserve");
+          m.add(fun([](const MapType *a) { return a->bucket_count(); } ), "bucket_count");
+          m.add(fun([](const MapType *a) { return a->load_factor(); } ), "load_factor");
+
+          typedef std::map<typename MapType::key_type, typename MapType::mapped_type> Ordered_Type;
+          m.add(fun([](const Ordered_Type &t_other) { return MapType(t_other.begin(), t_other.end()); }), type);
+
+          if (typeid(typename MapType::mapped_type) == typeid(Boxed_Value))
+          {
+            m.eval("def " + type + R"(::`==`()" + type + R"( rhs) {
+                       if ( rhs.size() != this.size() ) {
+                         return false;
+                       } else {
+                         for (x : this) {
+                           if (rhs.count(x.first) == 0 || !eq(x.second, rhs[x.first])) {
+                             return false;
+                           }
+                         }
+                         true;
+                       }
+                   } )"
+                 );
+          }
+
+          container_type<MapType>(type, m);
+          default_constructible_type<MapType>(type, m);
+          assignable_type<MapType>(type, m);
+          unique_associative_container_type<MapType>(type, m);
+          input_range_type<MapType>(type, m);
+        }
+      template<typename MapType>
+        ModulePtr hash_map_type(const std::string &type)
+        {
+          auto m = std::make_shared<Module>();
+          hash_map_type<MapType>(type, *m);
+          return m;
+        }
+
+
       /// http://www.sgi.com/tech/stl/List.html
       template<typename ListType>
         void list_type(const std::string &type, Module& m)
@@ -626,6 +699,298 @@ namespace chaiscript
           return m;
         }
 
+      namespace detail {
+        /// Element wise t_oper between two arrays, or an array and a scalar, plus the matching compound assignment
+        template<typename ArrayType, typename Op>
+          void typed_array_arithmetic(const std::string &t_oper, Op t_op, Module& m)
+          {
+            typedef typename ArrayType::value_type T;
+
+            m.add(fun([t_op](const ArrayType &lhs, const ArrayType &rhs) { return typed_array::combine(lhs, rhs, t_op); }), t_oper);
+            m.add(fun([t_op](const ArrayType &lhs, const T rhs) { return typed_array::combine(lhs, rhs, t_op); }), t_oper);
+            m.add(fun([t_op](const T lhs, const ArrayType &rhs) { return typed_array::combine(lhs, rhs, t_op); }), t_oper);
+            m.add(fun([t_op](ArrayType &lhs, const ArrayType &rhs) -> ArrayType & { return typed_array::update(lhs, rhs, t_op); }), t_oper + "=");
+            m.add(fun([t_op](ArrayType &lhs, const T rhs) -> ArrayType & { return typed_array::update(lhs, rhs, t_op); }), t_oper + "=");
+          }
+
+        /// Element wise t_oper between two arrays, or an array and a scalar, giving an Array_Mask
+        template<typename ArrayType, typename Op>
+          void typed_array_comparison(const std::string &t_oper, Op t_op, Module& m)
+          {
+            typedef typename ArrayType::value_type T;
+
+            m.add(fun([t_op](const ArrayType &lhs, const ArrayType &rhs) { return typed_array::compare(lhs, rhs, t_op); }), t_oper);
+            m.add(fun([t_op](const ArrayType &lhs, const T rhs) { return typed_array::compare(lhs, rhs, t_op); }), t_oper);
+          }
+      }
+
+      /// Add an Array_Mask, the result of comparing typed arrays
+      inline void array_mask_type(const std::string &type, Module& m)
+      {
+        m.add(user_type<Array_Mask>(), type);
+
+        m.add(fun([](const Array_Mask &t_mask, int index) { return t_mask.at(static_cast<Array_Mask::size_type>(index)); }), "[]");
+        m.add(fun(&Array_Mask::size), "size");
+        m.add(fun(&Array_Mask::empty), "empty");
+        m.add(fun(&Array_Mask::count), "count");
+        m.add(fun(&Array_Mask::any), "any");
+        m.add(fun(&Array_Mask::all), "all");
+
+        m.add(fun([](const Array_Mask &lhs, const Array_Mask &rhs) { return typed_array::combine(lhs, rhs, [](const std::uint8_t l, const std::uint8_t r) { return l & r; }); }), "&");
+        m.add(fun([](const Array_Mask &lhs, const Array_Mask &rhs) { return typed_array::combine(lhs, rhs, [](const std::uint8_t l, const std::uint8_t r) { return l | r; }); }), "|");
+        m.add(fun(&typed_array::invert), "!");
+
+        m.add(fun([](const Array_Mask &t_mask) {
+              std::vector<Boxed_Value> result;
+              result.reserve(t_mask.size());
+              for (Array_Mask::size_type i = 0; i < t_mask.size(); ++i) {
+                result.push_back(Boxed_Value(t_mask.at(i)));
+              }
+              return result;
+            }), "to_vector");
+
+        m.add(fun([](const Array_Mask &t_mask) {
+              std::string result = "[";
+              for (Array_Mask::size_type i = 0; i < t_mask.size(); ++i) {
+                result += (i == 0 ? "" : ", ");
+                result += (t_mask.at(i) ? "true" : "false");
+              }
+              return result + "]";
+            }), "to_string");
+
+        default_constructible_type<Array_Mask>(type, m);
+        assignable_type<Array_Mask>(type, m);
+      }
+      inline ModulePtr array_mask_type(const std::string &type)
+      {
+        auto m = std::make_shared<Module>();
+        array_mask_type(type, *m);
+        return m;
+      }
+
+
+      /// Add a Lazy_Range, the range returned by generator functions and lazy adapters. It is its
+      /// own range, and copies of it share their position.
+      inline void lazy_range_type(const std::string &type, Module& m)
+      {
+        m.add(user_type<Lazy_Range>(), type);
+
+        m.add(fun(&Lazy_Range::empty), "empty");
+        m.add(fun(&Lazy_Range::front), "front");
+        m.add(fun(&Lazy_Range::pop_front), "pop_front");
+        m.add(fun([](Lazy_Range &t_range) -> Lazy_Range & { return t_range; }), "range");
+        m.add(fun(&Lazy_Range::generate_range), "lazy_generate_range");
+
+        assignable_type<Lazy_Range>(type, m);
+      }
+      inline ModulePtr lazy_range_type(const std::string &type)
+      {
+        auto m = std::make_shared<Module>();
+        lazy_range_type(type, *m);
+        return m;
+      }
+
+
+      /// Add a Typed_Array, a contiguous array of one arithmetic type with element wise
+      /// arithmetic, comparisons, reductions and conversion to and from Vector
+      template<typename ArrayType>
+        void typed_array_type(const std::string &type, Module& m)
+        {
+          typedef typename ArrayType::value_type T;
+          typedef typename ArrayType::size_type size_type;
+
+          m.add(user_type<ArrayType>(), type);
+
+          m.add(constructor<ArrayType (size_type)>(), type);
+          m.add(constructor<ArrayType (size_type, T)>(), type);
+          m.add(fun([](const std::vector<Boxed_Value> &t_values) {
+                ArrayType result;
+                result.reserve(t_values.size());
+                for (const auto &v : t_values) {
+                  result.push_back(Boxed_Number(v).get_as<T>());
+                }
+                return result;
+              }), type);
+
+          m.add(fun([](const ArrayType &t_array) {
+                std::vector<Boxed_Value> result;
+                result.reserve(t_array.size());
+                for (const auto v : t_array) {
+                  result.push_back(Boxed_Value(v));
+                }
+                return result;
+              }), "to_vector");
+
+          typedef typename ArrayType::reference (ArrayType::*frontptr)();
+          typedef typename ArrayType::const_reference (ArrayType::*constfrontptr)() const;
+          m.add(fun(static_cast<frontptr>(&ArrayType::front)), "front");
+          m.add(fun(static_cast<constfrontptr>(&ArrayType::front)), "front");
+
+          back_insertion_sequence_type<ArrayType>(type, m);
+          random_access_container_type<ArrayType>(type, m);
+          resizable_type<ArrayType>(type, m);
+          reservable_type<ArrayType>(type, m);
+          container_type<ArrayType>(type, m);
+          default_constructible_type<ArrayType>(type, m);
+          assignable_type<ArrayType>(type, m);
+          input_range_type<ArrayType>(type, m);
+
+          detail::typed_array_arithmetic<ArrayType>("+", std::plus<T>(), m);
+          detail::typed_array_arithmetic<ArrayType>("-", std::minus<T>(), m);
+          detail::typed_array_arithmetic<ArrayType>("*", std::multiplies<T>(), m);
+
+          // division is registered by hand: integral division checks for zero divisors and overflow
+          m.add(fun([](const ArrayType &lhs, const ArrayType &rhs) { return typed_array::divide<T>(lhs, rhs); }), "/");
+          m.add(fun([](const ArrayType &lhs, const T rhs) { return typed_array::divide<T>(lhs, rhs); }), "/");
+          m.add(fun([](const T lhs, const ArrayType &rhs) { return typed_array::divide<T>(lhs, rhs); }), "/");
+          m.add(fun([](ArrayType &lhs, const ArrayType &rhs) -> ArrayType & { return typed_array::divide_assign<T>(lhs, rhs); }), "/=");
+          m.add(fun([](ArrayType &lhs, const T rhs) -> ArrayType & { return typed_array::divide_assign<T>(lhs, rhs); }), "/=");
+
+          m.add(fun([](const ArrayType &t_array) { return typed_array::combine(T(), t_array, std::minus<T>()); }), "-");
+
+          // named rather than operators, which are expected to give a bool
+          detail::typed_array_comparison<ArrayType>("less", std::less<T>(), m);
+          detail::typed_array_comparison<ArrayType>("less_equal", std::less_equal<T>(), m);
+          detail::typed_array_comparison<ArrayType>("greater", std::greater<T>(), m);
+          detail::typed_array_comparison<ArrayType>("greater_equal", std::greater_equal<T>(), m);
+          detail::typed_array_comparison<ArrayType>("equal", std::equal_to<T>(), m);
+          detail::typed_array_comparison<ArrayType>("not_equal", std::not_equal_to<T>(), m);
+          m.add(fun([](const ArrayType &lhs, const ArrayType &rhs) { return lhs.values() == rhs.values(); }), "==");
+
+          m.add(fun(&typed_array::select<T>), "select");
+          m.add(fun(&typed_array::where<T>), "where");
+
+          m.add(fun(&typed_array::sum<T>), "sum");
+          m.add(fun(&typed_array::dot<T>), "dot");
+          m.add(fun(&typed_array::min<T>), "min");
+          m.add(fun(&typed_array::max<T>), "max");
+        }
+      template<typename ArrayType>
+        ModulePtr typed_array_type(const std::string &type)
+        {
+          auto m = std::make_shared<Module>();
+          typed_array_type<ArrayType>(type, *m);
+          return m;
+        }
+
+
+      namespace detail {
+        /// \returns the part of t_view from t_pos, t_len long, taking size_t like string's substr
+        template<typename View>
+          View slice(const View &t_view, const size_t t_pos, const size_t t_len)
+          {
+            const auto part = view_detail::slice(t_view.size(), t_pos, t_len);
+            return View(t_view.data() + part.first, part.second);
+          }
+
+        /// Add take and drop, which give views rather than the copies the prelude versions make
+        template<typename View>
+          void view_slicing(Module& m)
+          {
+            m.add(fun([](const View &t_view, const int t_num) {
+                  return slice(t_view, 0, static_cast<size_t>(std::max(t_num, 0)));
+                }), "take");
+            m.add(fun([](const View &t_view, const int t_num) {
+                  const auto num = std::min(t_view.size(), static_cast<size_t>(std::max(t_num, 0)));
+                  return View(t_view.data() + num, t_view.size() - num);
+                }), "drop");
+          }
+      }
+
+      /// Add a Span, a view of elements owned by the host. Indexing, iteration, take, drop
+      /// and subspan all refer to the host memory, only to_vector copies.
+      ///
+      /// Spans are created on the C++ side, with make_span, and must not outlive what they view.
+      template<typename SpanType>
+        void span_type(const std::string &type, Module& m)
+        {
+          m.add(user_type<SpanType>(), type);
+
+          m.add(fun([](const SpanType *s) { return s->size(); } ), "size");
+          m.add(fun([](const SpanType *s) { return s->empty(); } ), "empty");
+
+          typedef typename SpanType::reference (SpanType::*frontptr)();
+          typedef typename SpanType::const_reference (SpanType::*constfrontptr)() const;
+          m.add(fun(static_cast<frontptr>(&SpanType::front)), "front");
+          m.add(fun(static_cast<constfrontptr>(&SpanType::front)), "front");
+          m.add(fun(static_cast<frontptr>(&SpanType::back)), "back");
+          m.add(fun(static_cast<constfrontptr>(&SpanType::back)), "back");
+
+          random_access_container_type<SpanType>(type, m);
+          default_constructible_type<SpanType>(type, m);
+          assignable_type<SpanType>(type, m);
+          input_range_type<SpanType>(type, m);
+
+          m.add(fun(&detail::slice<SpanType>), "subspan");
+          detail::view_slicing<SpanType>(m);
+
+          m.add(fun([](const SpanType &t_span) {
+                std::vector<Boxed_Value> result;
+                result.reserve(t_span.size());
+                for (const auto &v : t_span) {
+                  result.push_back(Boxed_Value(v));
+                }
+                return result;
+              }), "to_vector");
+        }
+      template<typename SpanType>
+        ModulePtr span_type(const std::string &type)
+        {
+          auto m = std::make_shared<Module>();
+          span_type<SpanType>(type, *m);
+          return m;
+        }
+
+
+      /// Add a String_View, a read only view of characters owned by the host. Slices are views
+      /// of the same characters and searches run over them in place, only to_string copies.
+      ///
+      /// Views are created on the C++ side and must not outlive the characters they view.
+      inline void string_view_type(const std::string &type, Module& m)
+      {
+        m.add(user_type<String_View>(), type);
+
+        m.add(fun(&String_View::size), "size");
+        m.add(fun(&String_View::empty), "empty");
+        m.add(fun(&String_View::front), "front");
+        m.add(fun(&String_View::back), "back");
+
+        random_access_container_type<String_View>(type, m);
+        default_constructible_type<String_View>(type, m);
+        assignable_type<String_View>(type, m);
+        input_range_type<String_View>(type, m);
+
+        m.add(fun(&detail::slice<String_View>), "substr");
+        m.add(fun([](const String_View &t_view, const size_t t_pos) { return t_view.substr(t_pos); }), "substr");
+        detail::view_slicing<String_View>(m);
+
+        m.add(fun([](const String_View *s, const String_View &f, size_t pos) { return s->find(f, pos); } ), "find");
+        m.add(fun([](const String_View *s, const std::string &f, size_t pos) { return s->find(f, pos); } ), "find");
+        m.add(fun([](const String_View *s, const String_View &f, size_t pos) { return s->rfind(f, pos); } ), "rfind");
+        m.add(fun([](const String_View *s, const std::string &f, size_t pos) { return s->rfind(f, pos); } ), "rfind");
+        m.add(fun([](const String_View *s, const String_View &f) { return s->starts_with(f); } ), "starts_with");
+        m.add(fun([](const String_View *s, const std::string &f) { return s->starts_with(f); } ), "starts_with");
+        m.add(fun([](const String_View *s, const String_View &f) { return s->ends_with(f); } ), "ends_with");
+        m.add(fun([](const String_View *s, const std::string &f) { return s->ends_with(f); } ), "ends_with");
+        m.add(fun(&String_View::count), "count");
+
+        m.add(fun([](const String_View &lhs, const String_View &rhs) { return lhs == rhs; }), "==");
+        m.add(fun([](const String_View &lhs, const std::string &rhs) { return lhs == rhs; }), "==");
+        m.add(fun([](const std::string &lhs, const String_View &rhs) { return rhs == lhs; }), "==");
+        m.add(fun([](const String_View &lhs, const String_View &rhs) { return lhs != rhs; }), "!=");
+        m.add(fun([](const String_View &lhs, const std::string &rhs) { return lhs != rhs; }), "!=");
+        m.add(fun([](const std::string &lhs, const String_View &rhs) { return rhs != lhs; }), "!=");
+
+        m.add(fun(&String_View::to_string), "to_string");
+      }
+      inline ModulePtr string_view_type(const std::string &type)
+      {
+        auto m = std::make_shared<Module>();
+        string_view_type(type, *m);
+        return m;
+      }
+
+
       /// Add a String container
       /// http://www.sgi.com/tech/stl/basic_string.html
       template<typename String>
@@ -678,6 +1043,7 @@ namespace chaiscript
 
 
 
+#ifndef CHAISCRIPT_NO_THREADS
       /// Add a MapType container
       /// http://www.sgi.com/tech/stl/Map.html
       template<typename FutureType>
@@ -686,8 +1052,9 @@ namespace chaiscript
           m.add(user_type<FutureType>(), type);
 
           m.add(fun([](const FutureType &t) { return t.valid(); }), "valid");
-          m.add(fun(&FutureType::get), "get");
-          m.add(fun(&FutureType::wait), "wait");
+          // a pooled task waiting on another pooled task runs its own subtasks instead of blocking a worker
+          m.add(fun([](FutureType &t) { utility::Thread_Pool::shared().wait_ready(t); return t.get(); }), "get");
+          m.add(fun([](const FutureType &t) { utility::Thread_Pool::shared().wait_ready(t); }), "wait");
         }
       template<typename FutureType>
         ModulePtr future_type(const std::string &type)
@@ -696,6 +1063,7 @@ namespace chaiscript
           future_type<FutureType>(type, *m);
           return m;
         }
+#endif
     }
   }
 }
@@ -11,8 +11,10 @@
 #define CHAISCRIPT_BOXED_NUMERIC_HPP_
 
 #include <cstdint>
+#include <limits>
 #include <sstream>
 #include <string>
+#include <type_traits>
 
 #include "../language/chaiscript_algebraic.hpp"
 #include "any.hpp"
@@ -36,6 +38,84 @@ namespace chaiscript
       ~arithmetic_error() noexcept override = default;
     };
   }
+
+  namespace detail
+  {
+    /// Signed integer arithmetic that reports overflow, which for the quotient is the most
+    /// negative value divided by -1, rather than invoking undefined behavior. Each returns true
+    /// if the result does not fit, leaving t_out unset, and the divisor must not be 0.
+    struct Checked_Arithmetic
+    {
+      template<typename T>
+        static bool sum(const T t_lhs, const T t_rhs, T &t_out)
+        {
+#ifdef __GNUC__
+          return __builtin_add_overflow(t_lhs, t_rhs, &t_out);
+#else
+          if ((t_rhs > 0 && t_lhs > std::numeric_limits<T>::max() - t_rhs)
+              || (t_rhs < 0 && t_lhs < std::numeric_limits<T>::min() - t_rhs)) {
+            return true;
+          }
+          t_out = t_lhs + t_rhs;
+          return false;
+#endif
+        }
+
+      template<typename T>
+        static bool difference(const T t_lhs, const T t_rhs, T &t_out)
+        {
+#ifdef __GNUC__
+          return __builtin_sub_overflow(t_lhs, t_rhs, &t_out);
+#else
+          if ((t_rhs < 0 && t_lhs > std::numeric_limits<T>::max() + t_rhs)
+              || (t_rhs > 0 && t_lhs < std::numeric_limits<T>::min() + t_rhs)) {
+            return true;
+          }
+          t_out = t_lhs - t_rhs;
+          return false;
+#endif
+        }
+
+      template<typename T>
+        static bool product(const T t_lhs, const T t_rhs, T &t_out)
+        {
+#ifdef __GNUC__
+          return __builtin_mul_overflow(t_lhs, t_rhs, &t_out);
+#else
+          const T max = std::numeric_limits<T>::max();
+          const T min = std::numeric_limits<T>::min();
+          if (t_lhs > 0 ? (t_rhs > 0 ? t_lhs > max / t_rhs : t_rhs < min / t_lhs)
+                        : (t_rhs > 0 ? t_lhs < min / t_rhs : (t_lhs != 0 && t_rhs < max / t_lhs))) {
+            return true;
+          }
+          t_out = t_lhs * t_rhs;
+          return false;
+#endif
+        }
+
+      template<typename T>
+        static bool quotient(const T t_lhs, const T t_rhs, T &t_out)
+        {
+          if (std::is_signed<T>::value && t_rhs == T(-1) && t_lhs == std::numeric_limits<T>::min()) {
+            return true;
+          }
+          t_out = t_lhs / t_rhs;
+          return false;
+        }
+
+      /// never overflows: a remainder by -1 is 0, found without the division that would overflow
+      template<typename T>
+        static bool remainder(const T t_lhs, const T t_rhs, T &t_out)
+        {
+          if (std::is_signed<T>::value && t_rhs == T(-1)) {
+            t_out = 0;
+            return false;
+          }
+          t_out = t_lhs % t_rhs;
+          return false;
+        }
+    };
+  }
 }
 
 namespace chaiscript 
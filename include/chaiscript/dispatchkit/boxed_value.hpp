@@ -16,6 +16,7 @@
 #include <type_traits>
 
 #include "../chaiscript_defines.hpp"
+#include "allocation_stats.hpp"
 #include "any.hpp"
 #include "type_info.hpp"
 
@@ -55,6 +56,7 @@ namespace chaiscript
           m_data_ptr = rhs.m_data_ptr;
           m_const_data_ptr = rhs.m_const_data_ptr;
           m_return_value = rhs.m_return_value;
+          m_heap_tracker = rhs.m_heap_tracker;
 
           if (rhs.m_attrs)
           {
@@ -77,13 +79,15 @@ namespace chaiscript
         std::unique_ptr<std::map<std::string, std::shared_ptr<Data>>> m_attrs;
         bool m_is_ref;
         bool m_return_value;
+        /// counts the heap bytes of m_obj, if it is a string or container boxed by value while counting
+        Allocation_Stats::Heap_Tracker *m_heap_tracker = nullptr;
       };
 
       struct Object_Data
       {
         static auto get(Boxed_Value::Void_Type, bool t_return_value)
         {
-          return std::make_shared<Data>(
+          return Allocation_Stats::make_counted<Data>(Allocation_Stats::Kind::value, detail::Get_Type_Info<void>::get(),
                 detail::Get_Type_Info<void>::get(),
                 chaiscript::detail::Any(), 
                 false,
@@ -101,26 +105,31 @@ namespace chaiscript
         template<typename T>
           static auto get(const std::shared_ptr<T> &obj, bool t_return_value)
           {
-            return std::make_shared<Data>(
+            auto data = Allocation_Stats::make_counted<Data>(Allocation_Stats::Kind::value, detail::Get_Type_Info<T>::get(),
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(obj), 
                   false,
                   obj.get(),
                   t_return_value
                 );
+            data->m_heap_tracker = Allocation_Stats::heap_tracker(obj);
+            return data;
           }
 
         template<typename T>
           static auto get(std::shared_ptr<T> &&obj, bool t_return_value)
           {
             auto ptr = obj.get();
-            return std::make_shared<Data>(
+            auto *tracker = Allocation_Stats::heap_tracker(obj);
+            auto data = Allocation_Stats::make_counted<Data>(Allocation_Stats::Kind::value, detail::Get_Type_Info<T>::get(),
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::move(obj)), 
                   false,
                   ptr,
                   t_return_value
                 );
+            data->m_heap_tracker = tracker;
+            return data;
           }
 
 
@@ -142,7 +151,7 @@ namespace chaiscript
           static auto get(std::reference_wrapper<T> obj, bool t_return_value)
           {
             auto p = &obj.get();
-            return std::make_shared<Data>(
+            return Allocation_Stats::make_counted<Data>(Allocation_Stats::Kind::value, detail::Get_Type_Info<T>::get(),
                   detail::Get_Type_Info<T>::get(),
                   chaiscript::detail::Any(std::move(obj)),
                   true,
@@ -155,7 +164,7 @@ namespace chaiscript
           static auto get(std::unique_ptr<T> &&obj, bool t_return_value)
           {
             auto ptr = obj.get();
-            return std::make_shared<Data>(
+            return Allocation_Stats::make_counted<Data>(Allocation_Stats::Kind::value, detail::Get_Type_Info<T>::get(),
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::make_shared<std::unique_ptr<T>>(std::move(obj))), 
                   true,
@@ -167,20 +176,12 @@ namespace chaiscript
         template<typename T>
           static auto get(T t, bool t_return_value)
           {
-            auto p = std::make_shared<T>(std::move(t));
-            auto ptr = p.get();
-            return std::make_shared<Data>(
-                  detail::Get_Type_Info<T>::get(), 
-                  chaiscript::detail::Any(std::move(p)),
-                  false,
-                  ptr,
-                  t_return_value
-                );
+            return get(Allocation_Stats::make_object<T>(detail::Get_Type_Info<T>::get(), std::move(t)), t_return_value);
           }
 
         static std::shared_ptr<Data> get()
         {
-          return std::make_shared<Data>(
+          return Allocation_Stats::make_counted<Data>(Allocation_Stats::Kind::value, Type_Info(),
                 Type_Info(),
                 chaiscript::detail::Any(),
                 false,
@@ -303,6 +304,14 @@ namespace chaiscript
         m_data->m_return_value = false;
       }
 
+      /// Counts what the boxed string or container grew or shrank by since it was last measured, if it is counted
+      void update_heap_size() const
+      {
+        if (m_data->m_heap_tracker) {
+          m_data->m_heap_tracker->update();
+        }
+      }
+
       bool is_pointer() const noexcept
       {
         return !is_ref();
@@ -9,6 +9,8 @@
 
 #include <memory>
 
+#include "allocation_stats.hpp"
+
 namespace chaiscript {
   namespace dispatch {
     namespace detail {
@@ -18,7 +20,7 @@ namespace chaiscript {
       {
         template<typename ... Inner>
         std::shared_ptr<Class> operator()(Inner&& ... inner) const {
-          return std::make_shared<Class>(std::forward<Inner>(inner)...);
+          return Allocation_Stats::make_object<Class>(user_type<Class>(), std::forward<Inner>(inner)...);
         }
       };
 
@@ -0,0 +1,126 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_CONTINUATION_HPP_
+#define CHAISCRIPT_CONTINUATION_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "boxed_value.hpp"
+#include "eval_limits.hpp"
+
+namespace chaiscript
+{
+  /// \brief An evaluation run a slice at a time, for a host to interleave with other work
+  ///
+  /// Each resume() runs the evaluation on the calling thread until it has taken the steps or the
+  /// time of a slice, as counted by Eval_Limits, and returns with the evaluation stopped where it
+  /// was. The script's own blocks, loops and ifs keep their place between slices, so a slice ends
+  /// between two of their statements or loop iterations; a function the script calls runs to its
+  /// end in the slice that calls it. The limits of the engine apply to the evaluation as a whole,
+  /// not counting the time it spends stopped.
+  ///
+  /// Destroying a Continuation that has not finished abandons its evaluation: nothing more of it
+  /// runs, and what it holds is let go.
+  ///
+  /// \sa ChaiScript_Basic::start
+  class Continuation
+  {
+    public:
+      /// Runs the evaluation until it is done, setting t_result and returning true, or until
+      /// t_slice_over() returns true between two of its steps, returning false
+      typedef std::function<bool (const std::function<bool ()> &t_slice_over, Boxed_Value &t_result)> Step;
+
+      /// Runs t_step, under t_limits, in slices of t_slice_steps steps or t_slice_time, 0 for no such limit
+      Continuation(const Eval_Limits &t_limits, Step t_step, const std::uint64_t t_slice_steps,
+          const std::chrono::microseconds t_slice_time = std::chrono::microseconds(0))
+        : m_limits(t_limits), m_step(std::move(t_step)), m_slice_steps(t_slice_steps), m_slice_time(t_slice_time)
+      {
+      }
+
+      Continuation(const Continuation &) = delete;
+      Continuation &operator=(const Continuation &) = delete;
+
+      /// Runs the evaluation until the end of its next slice
+      /// \returns true once the evaluation is done
+      /// \throws std::logic_error if called from the evaluation itself
+      bool resume()
+      {
+        if (m_done) { return true; }
+        if (m_running) {
+          throw std::logic_error("Continuation resumed from its own evaluation");
+        }
+
+        if (m_budget) {
+          m_budget->extend(Eval_Limits::Clock::now() - m_stopped);
+        }
+
+        m_running = true;
+        try {
+          Eval_Limits::Scope scope(m_limits, m_budget, m_slice_steps, m_slice_time);
+          m_done = m_step([&scope](){ return scope.slice_over(); }, m_result);
+        } catch (...) {
+          m_error = std::current_exception();
+          m_done = true;
+        }
+        m_running = false;
+
+        if (m_done) {
+          // lets go of what the evaluation holds
+          m_step = nullptr;
+        } else {
+          m_stopped = Eval_Limits::Clock::now();
+        }
+        return m_done;
+      }
+
+      bool done() const
+      {
+        return m_done;
+      }
+
+      /// \returns the value the evaluation ended with
+      /// \throws the exception the evaluation ended with, if any
+      /// \throws std::logic_error if the evaluation is not done
+      Boxed_Value result() const
+      {
+        if (!done()) {
+          throw std::logic_error("Continuation::result() called before the evaluation is done");
+        }
+        if (m_error) {
+          std::rethrow_exception(m_error);
+        }
+        return m_result;
+      }
+
+    private:
+      const Eval_Limits &m_limits;
+      Step m_step;
+      const std::uint64_t m_slice_steps;
+      const std::chrono::microseconds m_slice_time;
+
+      /// what the evaluation has used of the engine's limits, from its first slice on
+      std::shared_ptr<Eval_Limits::Budget> m_budget;
+      Eval_Limits::Clock::time_point m_stopped;
+
+      Boxed_Value m_result;
+      std::exception_ptr m_error;
+      bool m_running = false;
+      bool m_done = false;
+  };
+}
+
+#endif
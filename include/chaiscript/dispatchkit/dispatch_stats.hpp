@@ -0,0 +1,306 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_DISPATCH_STATS_HPP_
+#define CHAISCRIPT_DISPATCH_STATS_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../chaiscript_threading.hpp"
+
+namespace chaiscript
+{
+  /// \brief Opt-in counts of the work done to resolve each call site in a script
+  ///
+  /// While enabled, function calls, method calls and operator calls count against their
+  /// call site what it took to find and run the function: overloads tried, exceptions thrown
+  /// while matching, misses of the cached name lookup, argument conversions and guard calls.
+  /// Work done inside the called script function is counted against the call sites it contains,
+  /// and work done by another engine called from the site, against that engine's own call sites.
+  ///
+  /// Call sites are kept by the address of their node. Sites whose node was replaced, and all of
+  /// them once there are more than max_sites, are folded into totals by name, of which at most
+  /// max_retired are kept apart.
+  ///
+  /// When disabled, each counted event costs a thread local pointer test.
+  ///
+  /// \sa ChaiScript_Basic::dispatch_stats
+  class Dispatch_Stats
+  {
+    public:
+      /// Live counters of one call site
+      struct Counters
+      {
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> candidates{0};
+        std::atomic<std::uint64_t> match_exceptions{0};
+        std::atomic<std::uint64_t> hint_misses{0};
+        std::atomic<std::uint64_t> conversions{0};
+        std::atomic<std::uint64_t> guard_calls{0};
+      };
+
+    private:
+      /// The call site counted against on a thread, and the statistics of the engine it is in
+      struct Current
+      {
+        const Dispatch_Stats *owner;
+        Counters *counters;
+      };
+
+    public:
+      /// Counts of one call site, as reported
+      struct Site
+      {
+        /// "kind name at file:line:column"
+        std::string name;
+        std::uint64_t calls = 0;
+        std::uint64_t candidates = 0;
+        std::uint64_t match_exceptions = 0;
+        std::uint64_t hint_misses = 0;
+        std::uint64_t conversions = 0;
+        std::uint64_t guard_calls = 0;
+      };
+
+      /// Call sites kept by node before they are all folded into the totals by name
+      static constexpr std::size_t max_sites = 1 << 16;
+      /// Names kept apart in the totals of folded call sites; the rest are reported together
+      static constexpr std::size_t max_retired = 4096;
+
+      /// Makes t_counters, of the engine with statistics t_owner, the call site counted against on
+      /// this thread until destroyed, or with no counters, no call site
+      class Site_Guard
+      {
+        public:
+          explicit Site_Guard(std::shared_ptr<Counters> t_counters, const Dispatch_Stats *t_owner = nullptr)
+            : m_counters(std::move(t_counters)), m_previous(current()), m_active(m_counters || m_previous.counters)
+          {
+            if (m_active) { current() = Current{t_owner, m_counters.get()}; }
+          }
+
+          ~Site_Guard()
+          {
+            if (m_active) { current() = m_previous; }
+          }
+
+          Site_Guard(const Site_Guard &) = delete;
+          Site_Guard &operator=(const Site_Guard &) = delete;
+
+        private:
+          /// kept alive while counted against, even if the site is folded meanwhile
+          std::shared_ptr<Counters> m_counters;
+          Current m_previous;
+          bool m_active;
+      };
+
+      Dispatch_Stats() = default;
+      Dispatch_Stats(const Dispatch_Stats &) = delete;
+      Dispatch_Stats &operator=(const Dispatch_Stats &) = delete;
+
+      void enable(const bool t_enabled = true)
+      {
+        m_enabled = t_enabled;
+      }
+
+      bool enabled() const
+      {
+        return m_enabled.load(std::memory_order_relaxed);
+      }
+
+      /// Drops all counts
+      void reset()
+      {
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+        m_retired.clear();
+        m_other = Site();
+        for (auto &site : m_sites) {
+          auto &counters = *site.second.counters;
+          counters.calls = 0;
+          counters.candidates = 0;
+          counters.match_exceptions = 0;
+          counters.hint_misses = 0;
+          counters.conversions = 0;
+          counters.guard_calls = 0;
+        }
+      }
+
+      /// Call sites that were called, most overloads tried first
+      std::vector<Site> sites() const
+      {
+        std::map<std::string, Site> merged;
+
+        {
+          // sites parsed more than once, such as a line evaluated in a loop, share their name
+          const auto add = [&merged](const Site &t_site) {
+            if (t_site.calls != 0) { merge(merged[t_site.name], t_site); }
+          };
+
+          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          for (const auto &entry : m_sites) { add(snapshot(entry.second)); }
+          for (const auto &site : m_retired) { add(site.second); }
+          add(m_other);
+        }
+
+        std::vector<Site> result;
+        for (auto &site : merged) {
+          result.push_back(std::move(site.second));
+        }
+        std::stable_sort(result.begin(), result.end(),
+            [](const Site &lhs, const Site &rhs) { return lhs.candidates > rhs.candidates; });
+        return result;
+      }
+
+      /// \returns sites() as a table, one line per call site
+      std::string report() const
+      {
+        std::string result = "calls candidates match_exceptions hint_misses conversions guard_calls site\n";
+        for (const auto &site : sites())
+        {
+          result += std::to_string(site.calls) + ' ' + std::to_string(site.candidates) + ' '
+            + std::to_string(site.match_exceptions) + ' ' + std::to_string(site.hint_misses) + ' '
+            + std::to_string(site.conversions) + ' ' + std::to_string(site.guard_calls) + ' ' + site.name + '\n';
+        }
+        return result;
+      }
+
+      /// \returns the counters of the call site t_key, a node of the script, after counting a call to it
+      std::shared_ptr<Counters> site(const void *t_key, const char *t_kind, const std::string &t_name,
+          const std::string &t_file, const int t_line, const int t_col)
+      {
+        const auto matches = [&](const Site_Entry &t_entry) {
+          return t_entry.line == t_line && t_entry.col == t_col && t_entry.kind == t_kind && t_entry.called == t_name;
+        };
+
+        std::shared_ptr<Counters> counters;
+        {
+          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          const auto itr = m_sites.find(t_key);
+          if (itr != m_sites.end() && matches(itr->second)) {
+            counters = itr->second.counters;
+          }
+        }
+
+        if (!counters) {
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          if (m_sites.size() >= max_sites && m_sites.count(t_key) == 0) {
+            // the nodes of most of them may be long gone, with nothing to tell which
+            for (const auto &entry : m_sites) { retire(entry.second); }
+            m_sites.clear();
+          }
+
+          auto &entry = m_sites[t_key];
+          if (!entry.counters || !matches(entry)) {
+            // first call, or the node was freed and another one was made at the same address,
+            // whose counts are kept for the report
+            if (entry.counters) { retire(entry); }
+            entry.name = std::string(t_kind) + ' ' + t_name + " at " + t_file + ':' + std::to_string(t_line) + ':' + std::to_string(t_col);
+            entry.called = t_name;
+            entry.kind = t_kind;
+            entry.line = t_line;
+            entry.col = t_col;
+            entry.counters = std::make_shared<Counters>();
+          }
+          counters = entry.counters;
+        }
+
+        counters->calls.fetch_add(1, std::memory_order_relaxed);
+        return counters;
+      }
+
+      /// Adds one to t_counter of the call site being resolved on this thread, if it belongs to
+      /// the engine with statistics t_owner
+      static void count(const Dispatch_Stats *t_owner, std::atomic<std::uint64_t> Counters::*t_counter)
+      {
+        const auto &c = current();
+        if (c.counters && c.owner == t_owner) {
+          (c.counters->*t_counter).fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+
+    private:
+      struct Site_Entry
+      {
+        std::string name;
+        std::string called;
+        const char *kind = nullptr;
+        int line = 0;
+        int col = 0;
+        std::shared_ptr<Counters> counters;
+      };
+
+      static Current &current()
+      {
+#ifndef CHAISCRIPT_NO_THREADS
+        thread_local Current c{nullptr, nullptr};
+#else
+        static Current c{nullptr, nullptr};
+#endif
+        return c;
+      }
+
+      static Site snapshot(const Site_Entry &t_entry)
+      {
+        const auto &counters = *t_entry.counters;
+        Site site;
+        site.name = t_entry.name;
+        site.calls = counters.calls;
+        site.candidates = counters.candidates;
+        site.match_exceptions = counters.match_exceptions;
+        site.hint_misses = counters.hint_misses;
+        site.conversions = counters.conversions;
+        site.guard_calls = counters.guard_calls;
+        return site;
+      }
+
+      static void merge(Site &t_into, const Site &t_from)
+      {
+        t_into.name = t_from.name;
+        t_into.calls += t_from.calls;
+        t_into.candidates += t_from.candidates;
+        t_into.match_exceptions += t_from.match_exceptions;
+        t_into.hint_misses += t_from.hint_misses;
+        t_into.conversions += t_from.conversions;
+        t_into.guard_calls += t_from.guard_calls;
+      }
+
+      /// Folds the counts of t_entry into the totals by name; called with m_mutex held
+      void retire(const Site_Entry &t_entry)
+      {
+        const auto site = snapshot(t_entry);
+        if (site.calls == 0) { return; }
+
+        const auto itr = m_retired.find(site.name);
+        if (itr != m_retired.end()) {
+          merge(itr->second, site);
+        } else if (m_retired.size() < max_retired) {
+          m_retired.emplace(site.name, site);
+        } else {
+          merge(m_other, site);
+          m_other.name = "other retired call sites";
+        }
+      }
+
+      std::atomic_bool m_enabled{false};
+
+      mutable chaiscript::detail::threading::shared_mutex m_mutex;
+      std::unordered_map<const void *, Site_Entry> m_sites;
+      std::map<std::string, Site> m_retired;
+      Site m_other;
+  };
+}
+
+#endif
@@ -20,17 +20,22 @@
 #include <stdexcept>
 #include <string>
 #include <typeinfo>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "../chaiscript_defines.hpp"
 #include "../chaiscript_threading.hpp"
+#include "allocation_stats.hpp"
 #include "bad_boxed_cast.hpp"
 #include "boxed_cast.hpp"
 #include "boxed_cast_helper.hpp"
 #include "boxed_value.hpp"
 #include "type_conversions.hpp"
 #include "dynamic_object.hpp"
+#include "dispatch_stats.hpp"
+#include "eval_limits.hpp"
+#include "profiler.hpp"
 #include "proxy_constructors.hpp"
 #include "proxy_functions.hpp"
 #include "type_info.hpp"
@@ -432,6 +437,87 @@ namespace chaiscript
       int call_depth = 0;
     };
 
+    /// A function or object name paired with a process wide integer id.
+    ///
+    /// Every distinct name is assigned a small id while some Function_Name holds it. Parse trees
+    /// hold Function_Names rather than lookup hints into a particular engine, and each
+    /// Dispatch_Engine maps ids to its own function table, holding the names in it, so a parse tree
+    /// can be shared by any number of engines. Once no Function_Name holds a name its id is reused.
+    class Function_Name
+    {
+      public:
+        explicit Function_Name(const std::string &t_name)
+          : m_entry(intern(t_name))
+        {
+        }
+
+        const std::string &name() const noexcept
+        {
+          return m_entry->name;
+        }
+
+        uint_fast32_t id() const noexcept
+        {
+          return m_entry->id;
+        }
+
+      private:
+        struct Entry
+        {
+          std::string name;
+          uint_fast32_t id;
+        };
+
+        struct Registry
+        {
+          chaiscript::detail::threading::shared_mutex mutex;
+          std::unordered_map<std::string, std::weak_ptr<const Entry>> entries;
+          std::vector<uint_fast32_t> free_ids;
+          uint_fast32_t next_id = 0;
+        };
+
+        /// \returns the entry for t_name, assigning it an id if no Function_Name holds it
+        static std::shared_ptr<const Entry> intern(const std::string &t_name)
+        {
+          // held by the entries as well, so it outlives the last of them
+          static const auto shared_registry = std::make_shared<Registry>();
+          auto &registry = shared_registry;
+
+          chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::shared_mutex> l(registry->mutex);
+          auto &held = registry->entries[t_name];
+          if (auto entry = held.lock()) {
+            return entry;
+          }
+
+          uint_fast32_t id = registry->next_id;
+          if (registry->free_ids.empty()) {
+            ++registry->next_id;
+          } else {
+            id = registry->free_ids.back();
+            registry->free_ids.pop_back();
+          }
+
+          const auto released = [registry = shared_registry](const Entry *t_entry) {
+            {
+              chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::shared_mutex> l2(registry->mutex);
+              // the name may have been given a new entry since this one was let go
+              const auto itr = registry->entries.find(t_entry->name);
+              if (itr != registry->entries.end() && itr->second.expired()) {
+                registry->entries.erase(itr);
+              }
+              registry->free_ids.push_back(t_entry->id);
+            }
+            delete t_entry;
+          };
+
+          std::shared_ptr<const Entry> entry(new Entry{t_name, id}, released);
+          held = entry;
+          return entry;
+        }
+
+        std::shared_ptr<const Entry> m_entry;
+    };
+
     /// Main class for the dispatchkit. Handles management
     /// of the object stack, functions and registered types.
     class Dispatch_Engine
@@ -455,6 +541,7 @@ namespace chaiscript
           : m_stack_holder(),
             m_parser(parser)
         {
+          m_conversions.set_dispatch_stats(&m_dispatch_stats);
         }
 
         /// \brief casts an object while applying any Dynamic_Conversion available
@@ -654,7 +741,10 @@ namespace chaiscript
         /// Searches the current stack for an object of the given name
         /// includes a special overload for the _ place holder object to
         /// ensure that it is always in scope.
-        Boxed_Value get_object(const std::string &name, std::atomic_uint_fast32_t &t_loc, Stack_Holder &t_holder) const
+        ///
+        /// t_loc caches where the name was last found in the stack. The cache only depends on the
+        /// shape of the stack, not on this engine, and is verified before it is used.
+        Boxed_Value get_object(const Function_Name &t_name, std::atomic_uint_fast32_t &t_loc, Stack_Holder &t_holder) const
         {
           enum class Loc : uint_fast32_t {
             located    = 0x80000000,
@@ -663,10 +753,10 @@ namespace chaiscript
             loc_mask   = 0x0000FFFF
           };
 
+          const auto &name = t_name.name();
           uint_fast32_t loc = t_loc;
 
-          if (loc == 0)
-          {
+          const auto find_local = [&]() -> const Boxed_Value * {
             auto &stack = get_stack_data(t_holder);
 
             // Is it in the stack?
@@ -679,33 +769,66 @@ namespace chaiscript
                               | static_cast<uint_fast32_t>(std::distance(stack_elem->begin(), s))
                               | static_cast<uint_fast32_t>(Loc::located)
                               | static_cast<uint_fast32_t>(Loc::is_local);
-                  return s->second;
+                  return &s->second;
                 }
               }
             }
 
-            t_loc = static_cast<uint_fast32_t>(Loc::located);
-          } else if ((loc & static_cast<uint_fast32_t>(Loc::is_local)) != 0u) {
+            return nullptr;
+          };
+
+          if ((loc & static_cast<uint_fast32_t>(Loc::is_local)) != 0u) {
             auto &stack = get_stack_data(t_holder);
+            const auto stack_offset = (loc & static_cast<uint_fast32_t>(Loc::stack_mask)) >> 16;
+            const auto scope_offset = loc & static_cast<uint_fast32_t>(Loc::loc_mask);
 
-            return stack[stack.size() - 1 - ((loc & static_cast<uint_fast32_t>(Loc::stack_mask)) >> 16)][loc & static_cast<uint_fast32_t>(Loc::loc_mask)].second;
-          }
+            if (stack_offset < stack.size()) {
+              const auto &scope = stack[stack.size() - 1 - stack_offset];
+              if (scope_offset < scope.size() && scope[scope_offset].first == name) {
+                return scope[scope_offset].second;
+              }
+            }
 
-          // Is the value we are looking for a global or function?
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+            // the hint was made for a differently shaped stack
+            loc = 0;
+          }
 
-          const auto itr = m_state.m_global_objects.find(name);
-          if (itr != m_state.m_global_objects.end())
+          if (loc == 0)
           {
-            return itr->second;
+            Dispatch_Stats::count(&m_dispatch_stats, &Dispatch_Stats::Counters::hint_misses);
+            if (const auto local = find_local()) {
+              return *local;
+            }
+
+            t_loc = static_cast<uint_fast32_t>(Loc::located);
           }
 
-          // no? is it a function object?
-          auto obj = get_function_object_int(name, loc);
-          if (obj.first != loc) { t_loc = uint_fast32_t(obj.first); }
+          {
+            // Is the value we are looking for a global or function?
+            chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          return obj.second;
+            const auto itr = m_state.m_global_objects.find(name);
+            if (itr != m_state.m_global_objects.end())
+            {
+              return itr->second;
+            }
+
+            // no? is it a function object?
+            const auto slot = function_slot(t_name);
+            if (slot != 0) {
+              return get_boxed_functions_int()[slot - 1].second;
+            }
+          }
 
+          // the cached "not a local" may have come from another stack
+          if (loc != 0) {
+            if (const auto local = find_local()) {
+              Dispatch_Stats::count(&m_dispatch_stats, &Dispatch_Stats::Counters::hint_misses);
+              return *local;
+            }
+          }
+
+          throw std::range_error("Object not found: " + name);
         }
 
         /// Registers a new named type
@@ -765,54 +888,70 @@ namespace chaiscript
 
         std::shared_ptr<std::vector<Proxy_Function>> get_method_missing_functions() const
         {
-          uint_fast32_t method_missing_loc = m_method_missing_loc;
-          auto method_missing_funs = get_function("method_missing", method_missing_loc);
-          if (method_missing_funs.first != method_missing_loc) { 
-            m_method_missing_loc = uint_fast32_t(method_missing_funs.first); 
-          }
-
-          return std::move(method_missing_funs.second);
+          static const Function_Name method_missing("method_missing");
+          return get_function(method_missing);
         }
 
 
         /// Return a function by name
-        std::pair<size_t, std::shared_ptr<std::vector< Proxy_Function>>> get_function(const std::string &t_name, const size_t t_hint) const
+        std::shared_ptr<std::vector<Proxy_Function>> get_function(const Function_Name &t_name) const
         {
           chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          const auto &funs = get_functions_int();
-
-          auto itr = find_keyed_value(funs, t_name, t_hint);
+          const auto slot = function_slot(t_name);
 
-          if (itr != funs.end())
+          if (slot != 0)
           {
-            return std::make_pair(std::distance(funs.begin(), itr), itr->second);
+            return get_functions_int()[slot - 1].second;
           } else {
-            return std::make_pair(size_t(0), std::make_shared<std::vector<Proxy_Function>>());
+            return std::make_shared<std::vector<Proxy_Function>>();
           }
         }
 
-        /// \returns a function object (Boxed_Value wrapper) if it exists
-        /// \throws std::range_error if it does not
-        Boxed_Value get_function_object(const std::string &t_name) const
+        /// \returns a counter that changes whenever a function is added or the state is restored,
+        ///          for callers caching the result of get_function
+        uint_fast32_t function_generation() const noexcept
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          return m_function_generation;
+        }
 
-          return get_function_object_int(t_name, 0).second;
+        /// The sampling profiler for scripts run by this engine, stopped until started
+        Profiler &profiler()
+        {
+          return m_profiler;
+        }
+
+        /// The per call site dispatch statistics for scripts run by this engine, disabled until enabled
+        Dispatch_Stats &dispatch_stats()
+        {
+          return m_dispatch_stats;
+        }
+
+        /// The allocation statistics for scripts run by this engine, disabled until enabled
+        Allocation_Stats &allocation_stats()
+        {
+          return m_allocation_stats;
+        }
+
+        /// The limits on evaluations by this engine, none until set
+        Eval_Limits &limits()
+        {
+          return m_limits;
         }
 
         /// \returns a function object (Boxed_Value wrapper) if it exists
         /// \throws std::range_error if it does not
-        /// \warn does not obtain a mutex lock. \sa get_function_object for public version
-        std::pair<size_t, Boxed_Value> get_function_object_int(const std::string &t_name, const size_t t_hint) const
+        Boxed_Value get_function_object(const std::string &t_name) const
         {
+          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+
           const auto &funs = get_boxed_functions_int();
 
-          auto itr = find_keyed_value(funs, t_name, t_hint);
+          auto itr = find_keyed_value(funs, t_name);
 
           if (itr != funs.end())
           {
-            return std::make_pair(std::distance(funs.begin(), itr), itr->second);
+            return itr->second;
           } else {
             throw std::range_error("Object not found: " + t_name);
           }
@@ -956,12 +1095,10 @@ namespace chaiscript
 #pragma warning(push)
 #pragma warning(disable : 4715)
 #endif
-        Boxed_Value call_member(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const std::vector<Boxed_Value> &params, bool t_has_params,
+        Boxed_Value call_member(const Function_Name &t_name, const std::vector<Boxed_Value> &params, bool t_has_params,
                                 const Type_Conversions_State &t_conversions)
         {
-          uint_fast32_t loc = t_loc;
-          const auto funs = get_function(t_name, loc);
-          if (funs.first != loc) { t_loc = uint_fast32_t(funs.first); }
+          const auto funs = get_function(t_name);
 
           const auto do_attribute_call = 
             [this](int l_num_params, const std::vector<Boxed_Value> &l_params, const std::vector<Proxy_Function> &l_funs, const Type_Conversions_State &l_conversions)->Boxed_Value
@@ -1004,14 +1141,14 @@ namespace chaiscript
               }
             };
 
-          if (is_attribute_call(*funs.second, params, t_has_params, t_conversions)) {
-            return do_attribute_call(1, params, *funs.second, t_conversions);
+          if (is_attribute_call(*funs, params, t_has_params, t_conversions)) {
+            return do_attribute_call(1, params, *funs, t_conversions);
           } else {
             std::exception_ptr except;
 
-            if (!funs.second->empty()) {
+            if (!funs->empty()) {
               try {
-                return dispatch::dispatch(*funs.second, params, t_conversions);
+                return dispatch::dispatch(*funs, params, t_conversions);
               } catch(chaiscript::exception::dispatch_error&) {
                 except = std::current_exception();
               }
@@ -1050,13 +1187,13 @@ namespace chaiscript
               try {
                 if (is_no_param) {
                   std::vector<Boxed_Value> tmp_params(params);
-                  tmp_params.insert(tmp_params.begin() + 1, var(t_name));
+                  tmp_params.insert(tmp_params.begin() + 1, var(t_name.name()));
                   return do_attribute_call(2, tmp_params, functions, t_conversions);
                 } else {
-                  return dispatch::dispatch(functions, {params[0], var(t_name), var(std::vector<Boxed_Value>(params.begin()+1, params.end()))}, t_conversions);
+                  return dispatch::dispatch(functions, {params[0], var(t_name.name()), var(std::vector<Boxed_Value>(params.begin()+1, params.end()))}, t_conversions);
                 }
               } catch (const dispatch::option_explicit_set &e) {
-                throw chaiscript::exception::dispatch_error(params, std::vector<Const_Proxy_Function>(funs.second->begin(), funs.second->end()), 
+                throw chaiscript::exception::dispatch_error(params, std::vector<Const_Proxy_Function>(funs->begin(), funs->end()), 
                     e.what());
               }
             }
@@ -1066,7 +1203,7 @@ namespace chaiscript
             if (except) {
               std::rethrow_exception(except);
             } else {
-              throw chaiscript::exception::dispatch_error(params, std::vector<Const_Proxy_Function>(funs.second->begin(), funs.second->end()));
+              throw chaiscript::exception::dispatch_error(params, std::vector<Const_Proxy_Function>(funs->begin(), funs->end()));
             }
           }
         }
@@ -1076,14 +1213,11 @@ namespace chaiscript
 
 
 
-        Boxed_Value call_function(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const std::vector<Boxed_Value> &params,
+        Boxed_Value call_function(const Function_Name &t_name, const std::vector<Boxed_Value> &params,
             const Type_Conversions_State &t_conversions) const
         {
-          uint_fast32_t loc = t_loc;
-          const auto funs = get_function(t_name, loc);
-          if (funs.first != loc) { t_loc = uint_fast32_t(funs.first);
-}
-          return dispatch::dispatch(*funs.second, params, t_conversions);
+          const auto funs = get_function(t_name);
+          return dispatch::dispatch(*funs, params, t_conversions);
         }
 
 
@@ -1202,6 +1336,58 @@ namespace chaiscript
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
           m_state = t_state;
+
+          m_function_slots.clear();
+          m_sparse_function_slots.clear();
+          m_function_names.clear();
+          for (size_t i = 0; i < m_state.m_functions.size(); ++i)
+          {
+            set_function_slot(m_state.m_functions[i].first, i);
+          }
+          ++m_function_generation;
+        }
+
+        /// Binds to this engine the script functions in a state that set_state copied from another
+        /// engine, see Proxy_Function_Base::rebind. Overload lists keep their order, and only the
+        /// lists that hold script functions are copied.
+        void rebind_functions()
+        {
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+
+          // the tables list names in the same order, so the entry at the same position is tried first
+          const auto replace = [](auto &t_table, const size_t t_pos, const std::string &t_name, auto t_value) {
+            if (t_pos < t_table.size() && t_table[t_pos].first == t_name) {
+              t_table[t_pos].second = std::move(t_value);
+            } else {
+              add_keyed_value(t_table, t_name, std::move(t_value));
+            }
+          };
+
+          auto &funcs = get_functions_int();
+          for (size_t pos = 0; pos < funcs.size(); ++pos)
+          {
+            auto &entry = funcs[pos];
+            std::shared_ptr<std::vector<Proxy_Function>> rebound;
+            const auto &overloads = *entry.second;
+            for (size_t i = 0; i < overloads.size(); ++i)
+            {
+              if (auto f = overloads[i]->rebind(*this)) {
+                if (!rebound) { rebound = std::make_shared<std::vector<Proxy_Function>>(overloads); }
+                (*rebound)[i] = std::move(f);
+              }
+            }
+
+            if (rebound) {
+              entry.second = rebound;
+              // as add_function would have made it
+              Proxy_Function object = (rebound->size() == 1 && !rebound->front()->has_arithmetic_param())
+                ? rebound->front()
+                : std::make_shared<Dispatch_Function>(*rebound);
+              replace(get_boxed_functions_int(), pos, entry.first, const_var(object));
+              replace(get_function_objects_int(), pos, entry.first, std::move(object));
+            }
+          }
+          ++m_function_generation;
         }
 
         static void save_function_params(Stack_Holder &t_s, std::initializer_list<Boxed_Value> t_params)
@@ -1331,6 +1517,46 @@ namespace chaiscript
           return m_state.m_functions;
         }
 
+        /// \returns 1 + the position of t_name in the function tables, or 0 if there is no such function
+        /// \warn does not obtain a mutex lock
+        size_t function_slot(const Function_Name &t_name) const
+        {
+          const auto id = t_name.id();
+          if (id < m_function_slots.size()) {
+            return m_function_slots[id];
+          }
+
+          if (m_sparse_function_slots.empty()) {
+            return 0;
+          }
+          const auto itr = m_sparse_function_slots.find(id);
+          return itr != m_sparse_function_slots.end() ? itr->second : 0;
+        }
+
+        /// Records that t_name is found at t_pos in the function tables, which is the end of them
+        /// for a name not seen before
+        void set_function_slot(const std::string &t_name, const size_t t_pos)
+        {
+          Function_Name name(t_name);
+          const auto id = name.id();
+
+          // ids are shared by the whole process, the dense table is kept within a few times the
+          // size of this engine's function table
+          if (id >= m_function_slots.size() && id < 2 * get_functions_int().size() + 64) {
+            m_function_slots.resize(id + 1, 0);
+          }
+
+          if (id < m_function_slots.size()) {
+            m_function_slots[id] = t_pos + 1;
+          } else {
+            m_sparse_function_slots[id] = t_pos + 1;
+          }
+
+          if (t_pos == m_function_names.size()) {
+            m_function_names.push_back(std::move(name));
+          }
+        }
+
         static bool function_less_than(const Proxy_Function &lhs, const Proxy_Function &rhs)
         {
 
@@ -1449,17 +1675,6 @@ namespace chaiscript
                 });
           }
 
-        template<typename Container, typename Key>
-        static typename Container::const_iterator find_keyed_value(const Container &t_c, const Key &t_key, const size_t t_hint)
-          {
-            if (t_c.size() > t_hint && t_c[t_hint].first == t_key) {
-              return std::next(t_c.begin(), static_cast<typename std::iterator_traits<typename Container::const_iterator>::difference_type>(t_hint));
-            } else {
-              return find_keyed_value(t_c, t_key);
-            }
-          }
-
-
         /// Implementation detail for adding a function. 
         /// \throws exception::name_conflict_error if there's a function matching the given one being added
         void add_function(const Proxy_Function &t_f, const std::string &t_name)
@@ -1494,15 +1709,23 @@ namespace chaiscript
                 // to allow for automatic arithmetic type conversions
                 std::vector<Proxy_Function> vec({t_f});
                 funcs.emplace_back(t_name, std::make_shared<std::vector<Proxy_Function>>(vec));
+                set_function_slot(t_name, funcs.size() - 1);
                 return std::make_shared<Dispatch_Function>(std::move(vec));
               } else {
                 funcs.emplace_back(t_name, std::make_shared<std::vector<Proxy_Function>>(std::initializer_list<Proxy_Function>({t_f})));
+                set_function_slot(t_name, funcs.size() - 1);
                 return t_f;
               }
             }();
 
           add_keyed_value(get_boxed_functions_int(), t_name, const_var(new_func));
           add_keyed_value(get_function_objects_int(), t_name, std::move(new_func));
+          ++m_function_generation;
+
+          if (m_allocation_stats.counting()) {
+            const auto &type = typeid(*t_f);
+            m_allocation_stats.add(Allocation_Stats::Kind::function, Type_Info(false, false, false, false, false, &type, &type));
+          }
         }
 
         mutable chaiscript::detail::threading::shared_mutex m_mutex;
@@ -1512,9 +1735,21 @@ namespace chaiscript
         chaiscript::detail::threading::Thread_Storage<Stack_Holder> m_stack_holder;
         std::reference_wrapper<parser::ChaiScript_Parser_Base> m_parser;
 
-        mutable std::atomic_uint_fast32_t m_method_missing_loc = {0};
-
         State m_state;
+
+        /// Function_Name id to 1 + position in the m_functions and m_boxed_functions tables,
+        /// which always list names in the same order, for the ids in the dense range and the rest
+        std::vector<size_t> m_function_slots;
+        std::unordered_map<uint_fast32_t, size_t> m_sparse_function_slots;
+        /// the names of m_functions, which keep their ids from being reused
+        std::vector<Function_Name> m_function_names;
+
+        std::atomic_uint_fast32_t m_function_generation{0};
+
+        Profiler m_profiler;
+        Dispatch_Stats m_dispatch_stats;
+        Allocation_Stats m_allocation_stats;
+        Eval_Limits m_limits{m_allocation_stats};
     };
 
     class Dispatch_State
@@ -1523,7 +1758,19 @@ namespace chaiscript
         explicit Dispatch_State(Dispatch_Engine &t_engine)
           : m_engine(t_engine),
             m_stack_holder(t_engine.get_stack_holder()),
-            m_conversions(t_engine.conversions(), t_engine.conversions().conversion_saves())
+            m_conversions(t_engine.conversions(), t_engine.conversions().conversion_saves()),
+            m_allocation_scope(t_engine.allocation_stats()),
+            m_limits_scope(t_engine.limits())
+        {
+        }
+
+        /// Evaluates on t_stack_holder rather than the thread's own, for a generator call that keeps its stack between values
+        Dispatch_State(Dispatch_Engine &t_engine, Stack_Holder &t_stack_holder)
+          : m_engine(t_engine),
+            m_stack_holder(t_stack_holder),
+            m_conversions(t_engine.conversions(), t_engine.conversions().conversion_saves()),
+            m_allocation_scope(t_engine.allocation_stats()),
+            m_limits_scope(t_engine.limits())
         {
         }
 
@@ -1555,7 +1802,7 @@ namespace chaiscript
           return m_engine.get().add_object(t_name, std::move(obj), m_stack_holder.get());
         }
 
-        Boxed_Value get_object(const std::string &t_name, std::atomic_uint_fast32_t &t_loc) const {
+        Boxed_Value get_object(const Function_Name &t_name, std::atomic_uint_fast32_t &t_loc) const {
           return m_engine.get().get_object(t_name, t_loc, m_stack_holder.get());
         }
 
@@ -1563,6 +1810,8 @@ namespace chaiscript
         std::reference_wrapper<Dispatch_Engine> m_engine;
         std::reference_wrapper<Stack_Holder> m_stack_holder;
         Type_Conversions_State m_conversions;
+        Allocation_Stats::Scope m_allocation_scope;
+        Eval_Limits::Scope m_limits_scope;
     };
   }
 }
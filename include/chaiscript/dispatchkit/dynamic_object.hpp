@@ -11,10 +11,13 @@
 #ifndef CHAISCRIPT_DYNAMIC_OBJECT_HPP_
 #define CHAISCRIPT_DYNAMIC_OBJECT_HPP_
 
+#include <cstdint>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
+#include "../chaiscript_threading.hpp"
 #include "boxed_value.hpp"
 
 namespace chaiscript {
@@ -43,8 +46,52 @@ namespace chaiscript
     class Dynamic_Object
     {
       public:
+        /// Process wide number for a script class name, so that matching an object against a
+        /// class compares integers. Equal names always get equal ids. Ids are never released, so
+        /// only names from the program itself, its classes and parameter types, are given one.
+        typedef std::uint_fast32_t Type_Id;
+
+        enum : Type_Id {
+          /// The id of the empty name, which default constructed objects have
+          unnamed_type_id = 0,
+          /// The id of "Dynamic_Object", which matches every object
+          any_type_id = 1,
+          /// The id of an object whose type name had no id when it was made, see find_type_id
+          unregistered_type_id = ~Type_Id(0)
+        };
+
+        /// \returns the id for t_type_name, giving it the next free id if it has none yet
+        static Type_Id type_id(const std::string &t_type_name)
+        {
+          const auto id = find_type_id(t_type_name);
+          if (id != unregistered_type_id) {
+            return id;
+          }
+
+          auto &r = registry();
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::read_write_mutex> l(r.mutex);
+          return r.ids.emplace(t_type_name, static_cast<Type_Id>(r.ids.size())).first->second;
+        }
+
+        /// \returns the id of t_type_name, or unregistered_type_id if it has none, without giving it one;
+        ///          for names from outside the program, such as those read back by binary_wrap
+        static Type_Id find_type_id(const std::string &t_type_name)
+        {
+          auto &r = registry();
+          // every object construction looks its class up, so readers must not wait on each other
+          chaiscript::detail::threading::read_lock<chaiscript::detail::threading::read_write_mutex> l(r.mutex);
+          const auto itr = r.ids.find(t_type_name);
+          return itr != r.ids.end() ? itr->second : Type_Id(unregistered_type_id);
+        }
+
         explicit Dynamic_Object(std::string t_type_name)
-          : m_type_name(std::move(t_type_name)), m_option_explicit(false)
+          : m_type_name(std::move(t_type_name)), m_type_id(type_id(m_type_name)), m_option_explicit(false)
+        {
+        }
+
+        /// For callers that already looked up the id of t_type_name
+        Dynamic_Object(std::string t_type_name, const Type_Id t_type_id)
+          : m_type_name(std::move(t_type_name)), m_type_id(t_type_id), m_option_explicit(false)
         {
         }
 
@@ -65,6 +112,21 @@ namespace chaiscript
           return m_type_name;
         }
 
+        Type_Id get_type_id() const
+        {
+          return m_type_id;
+        }
+
+        /// \returns true if this object is of the class with id t_type_id, or t_type_id is any_type_id
+        bool is_type(const Type_Id t_type_id) const
+        {
+          if (t_type_id == any_type_id || t_type_id == m_type_id) {
+            return true;
+          }
+          // the class may have been defined after this object was made
+          return m_type_id == unregistered_type_id && find_type_id(m_type_name) == t_type_id;
+        }
+
         const Boxed_Value &operator[](const std::string &t_attr_name) const
         {
           return get_attr(t_attr_name);
@@ -119,7 +181,19 @@ namespace chaiscript
         }
 
       private:
+        struct Registry {
+          chaiscript::detail::threading::read_write_mutex mutex;
+          std::unordered_map<std::string, Type_Id> ids{{"", Type_Id(unnamed_type_id)}, {"Dynamic_Object", Type_Id(any_type_id)}};
+        };
+
+        static Registry &registry()
+        {
+          static Registry r;
+          return r;
+        }
+
         const std::string m_type_name = "";
+        const Type_Id m_type_id = unnamed_type_id;
         bool m_option_explicit = false;
 
         std::map<std::string, Boxed_Value> m_attrs;
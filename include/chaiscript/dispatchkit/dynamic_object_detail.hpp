@@ -47,7 +47,7 @@ namespace chaiscript
               const Proxy_Function &t_func,
               bool t_is_attribute = false)
             : Proxy_Function_Base(t_func->get_param_types(), t_func->get_arity()),
-              m_type_name(std::move(t_type_name)), m_func(t_func), m_doti(user_type<Dynamic_Object>()),
+              m_type_name(std::move(t_type_name)), m_type_id(Dynamic_Object::type_id(m_type_name)), m_func(t_func), m_doti(user_type<Dynamic_Object>()),
               m_is_attribute(t_is_attribute)
           {
             assert( (t_func->get_arity() > 0 || t_func->get_arity() < 0)
@@ -60,7 +60,7 @@ namespace chaiscript
               const Type_Info &t_ti,
               bool t_is_attribute = false)
             : Proxy_Function_Base(build_param_types(t_func->get_param_types(), t_ti), t_func->get_arity()),
-              m_type_name(std::move(t_type_name)), m_func(t_func), m_ti(t_ti.is_undef()?nullptr:new Type_Info(t_ti)), m_doti(user_type<Dynamic_Object>()),
+              m_type_name(std::move(t_type_name)), m_type_id(Dynamic_Object::type_id(m_type_name)), m_func(t_func), m_ti(t_ti.is_undef()?nullptr:new Type_Info(t_ti)), m_doti(user_type<Dynamic_Object>()),
               m_is_attribute(t_is_attribute)
           {
             assert( (t_func->get_arity() > 0 || t_func->get_arity() < 0)
@@ -68,6 +68,15 @@ namespace chaiscript
           }
 
 
+          /// t_other calling t_func instead, see rebind
+          Dynamic_Object_Function(const Dynamic_Object_Function &t_other, Proxy_Function t_func)
+            : Proxy_Function_Base(t_other.get_param_types(), t_other.get_arity()),
+              m_type_name(t_other.m_type_name), m_type_id(t_other.m_type_id), m_func(std::move(t_func)),
+              m_ti(t_other.m_ti ? new Type_Info(*t_other.m_ti) : nullptr), m_doti(t_other.m_doti),
+              m_is_attribute(t_other.m_is_attribute)
+          {
+          }
+
           Dynamic_Object_Function &operator=(const Dynamic_Object_Function) = delete;
           Dynamic_Object_Function(Dynamic_Object_Function &) = delete;
 
@@ -85,7 +94,7 @@ namespace chaiscript
 
           bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
           {
-            if (dynamic_object_typename_match(vals, m_type_name, m_ti, t_conversions))
+            if (dynamic_object_typename_match(vals, m_type_id, m_ti, t_conversions))
             {
               return m_func->call_match(vals, t_conversions);
             } else {
@@ -98,10 +107,16 @@ namespace chaiscript
             return {m_func};
           }
 
+          std::shared_ptr<Proxy_Function_Base> rebind(chaiscript::detail::Dispatch_Engine &t_engine) const override
+          {
+            auto func = m_func->rebind(t_engine);
+            return func ? std::make_shared<Dynamic_Object_Function>(*this, std::move(func)) : nullptr;
+          }
+
         protected:
           Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
           {
-            if (dynamic_object_typename_match(params, m_type_name, m_ti, t_conversions))
+            if (dynamic_object_typename_match(params, m_type_id, m_ti, t_conversions))
             {
               return (*m_func)(params, t_conversions);
             } else {
@@ -111,7 +126,7 @@ namespace chaiscript
 
           bool compare_first_type(const Boxed_Value &bv, const Type_Conversions_State &t_conversions) const override
           {
-            return dynamic_object_typename_match(bv, m_type_name, m_ti, t_conversions);
+            return dynamic_object_typename_match(bv, m_type_id, m_ti, t_conversions);
           }
 
         private:
@@ -126,14 +141,14 @@ namespace chaiscript
             return types;
           }
 
-          bool dynamic_object_typename_match(const Boxed_Value &bv, const std::string &name,
+          bool dynamic_object_typename_match(const Boxed_Value &bv, const Dynamic_Object::Type_Id type_id,
               const std::unique_ptr<Type_Info> &ti, const Type_Conversions_State &t_conversions) const
           {
             if (bv.get_type_info().bare_equal(m_doti))
             {
               try {
                 const Dynamic_Object &d = boxed_cast<const Dynamic_Object &>(bv, &t_conversions);
-                return name == "Dynamic_Object" || d.get_type_name() == name;
+                return d.is_type(type_id);
               } catch (const std::bad_cast &) {
                 return false;
               } 
@@ -148,18 +163,19 @@ namespace chaiscript
 
           }
 
-          bool dynamic_object_typename_match(const std::vector<Boxed_Value> &bvs, const std::string &name,
+          bool dynamic_object_typename_match(const std::vector<Boxed_Value> &bvs, const Dynamic_Object::Type_Id type_id,
               const std::unique_ptr<Type_Info> &ti, const Type_Conversions_State &t_conversions) const
           {
             if (!bvs.empty())
             {
-              return dynamic_object_typename_match(bvs[0], name, ti, t_conversions);
+              return dynamic_object_typename_match(bvs[0], type_id, ti, t_conversions);
             } else {
               return false;
             }
           }
 
           std::string m_type_name;
+          Dynamic_Object::Type_Id m_type_id;
           Proxy_Function m_func;
           std::unique_ptr<Type_Info> m_ti;
           const Type_Info m_doti;
@@ -180,7 +196,7 @@ namespace chaiscript
               std::string t_type_name,
               const Proxy_Function &t_func)
             : Proxy_Function_Base(build_type_list(t_func->get_param_types()), t_func->get_arity() - 1),
-              m_type_name(std::move(t_type_name)), m_func(t_func)
+              m_type_name(std::move(t_type_name)), m_type_id(Dynamic_Object::type_id(m_type_name)), m_func(t_func)
           {
             assert( (t_func->get_arity() > 0 || t_func->get_arity() < 0)
                 && "Programming error, Dynamic_Object_Function must have at least one parameter (this)");
@@ -207,16 +223,22 @@ namespace chaiscript
 
           bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
           {
-            std::vector<Boxed_Value> new_vals{Boxed_Value(Dynamic_Object(m_type_name))};
+            std::vector<Boxed_Value> new_vals{Boxed_Value(Dynamic_Object(m_type_name, m_type_id))};
             new_vals.insert(new_vals.end(), vals.begin(), vals.end());
 
             return m_func->call_match(new_vals, t_conversions);
           }
 
+          std::shared_ptr<Proxy_Function_Base> rebind(chaiscript::detail::Dispatch_Engine &t_engine) const override
+          {
+            auto func = m_func->rebind(t_engine);
+            return func ? std::make_shared<Dynamic_Object_Constructor>(m_type_name, std::move(func)) : nullptr;
+          }
+
         protected:
           Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
           {
-            auto bv = Boxed_Value(Dynamic_Object(m_type_name), true);
+            auto bv = Boxed_Value(Dynamic_Object(m_type_name, m_type_id), true);
             std::vector<Boxed_Value> new_params{bv};
             new_params.insert(new_params.end(), params.begin(), params.end());
 
@@ -227,6 +249,7 @@ namespace chaiscript
 
         private:
           const std::string m_type_name;
+          const Dynamic_Object::Type_Id m_type_id;
           const Proxy_Function m_func;
 
       };
@@ -0,0 +1,280 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_EVAL_LIMITS_HPP_
+#define CHAISCRIPT_EVAL_LIMITS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "allocation_stats.hpp"
+
+namespace chaiscript
+{
+  namespace exception
+  {
+    /// Thrown when an evaluation goes over a limit set on its engine
+    class eval_limit_error : public std::runtime_error
+    {
+      public:
+        explicit eval_limit_error(const std::string &t_what)
+          : std::runtime_error(t_what)
+        {
+        }
+
+        eval_limit_error(const eval_limit_error &) = default;
+        ~eval_limit_error() noexcept override = default;
+    };
+  }
+
+  /// \brief Limits on the steps, time and memory an engine's evaluations may take
+  ///
+  /// A step is a loop iteration or a script function call. Limits are checked at each step,
+  /// which throws exception::eval_limit_error once one is exceeded, and keeps throwing at every
+  /// later step of the same evaluation, so a script catching the error cannot carry on looping.
+  ///
+  /// The limits apply to each evaluation: an eval from C++, or a call of a script function from
+  /// C++, with everything it calls. Tasks it starts with async or parallel_map and friends share
+  /// its budget. An evaluation of another engine nested in it is held to the limits of both.
+  ///
+  /// The memory limit is on how much the bytes the engine holds, as counted by its
+  /// Allocation_Stats, grew since the evaluation started. That covers values, objects, parse tree
+  /// nodes and the heap memory of strings and containers boxed by value, but not what host
+  /// objects allocate for themselves. Other evaluations of the same engine running at the same
+  /// time count towards it too.
+  ///
+  /// An evaluation can also be split into slices with other work run between them, see Continuation.
+  ///
+  /// Without limits, a step costs a thread local pointer test.
+  ///
+  /// \sa ChaiScript_Basic::limits
+  class Eval_Limits
+  {
+    public:
+      typedef std::chrono::steady_clock Clock;
+
+      /// What an evaluation has used of its limits, shared by the threads working on it
+      class Budget
+      {
+        public:
+          /// t_outer is the budget of an evaluation this one is nested in, which it also takes its steps from
+          Budget(const Eval_Limits &t_limits, std::shared_ptr<Budget> t_outer)
+            : m_limits(t_limits),
+              m_outer(std::move(t_outer)),
+              m_max_steps(t_limits.max_steps()),
+              m_timed(t_limits.max_time().count() != 0),
+              m_deadline((Clock::now() + t_limits.max_time()).time_since_epoch().count()),
+              m_max_memory(t_limits.max_memory()),
+              m_start_bytes(t_limits.m_allocation_stats.live_bytes())
+          {
+          }
+
+          Budget(const Budget &) = delete;
+          Budget &operator=(const Budget &) = delete;
+
+          void step()
+          {
+            if (m_max_steps != 0 && m_steps.fetch_add(1, std::memory_order_relaxed) + 1 > m_max_steps) {
+              throw exception::eval_limit_error("Evaluation exceeded its limit of " + std::to_string(m_max_steps) + " steps");
+            }
+            if (m_timed && Clock::now().time_since_epoch().count() > m_deadline.load(std::memory_order_relaxed)) {
+              throw exception::eval_limit_error("Evaluation exceeded its time limit");
+            }
+            if (m_max_memory != 0 && m_limits.m_allocation_stats.live_bytes() > m_start_bytes + m_max_memory) {
+              throw exception::eval_limit_error("Evaluation exceeded its limit of " + std::to_string(m_max_memory) + " bytes");
+            }
+            if (m_outer) {
+              m_outer->step();
+            }
+          }
+
+          const Eval_Limits &limits() const
+          {
+            return m_limits;
+          }
+
+          /// Moves the deadline back by t_time, which did not count against the time limit
+          void extend(const Clock::duration t_time)
+          {
+            m_deadline.fetch_add(t_time.count(), std::memory_order_relaxed);
+          }
+
+        private:
+          const Eval_Limits &m_limits;
+          const std::shared_ptr<Budget> m_outer;
+          std::atomic<std::uint64_t> m_steps{0};
+          const std::uint64_t m_max_steps;
+          const bool m_timed;
+          std::atomic<Clock::rep> m_deadline;
+          const std::uint64_t m_max_memory;
+          const std::uint64_t m_start_bytes;
+      };
+
+      /// The limits of one evaluation running on this thread, for as long as it runs
+      class Scope
+      {
+        public:
+          explicit Scope(const Eval_Limits &t_limits)
+            : m_previous(current())
+          {
+            if (!t_limits.limited()) { return; }
+            // an evaluation nested in one of the same engine is part of it
+            if (m_previous && &m_previous->m_budget->limits() == &t_limits) { return; }
+
+            m_budget = std::make_shared<Budget>(t_limits, m_previous ? m_previous->m_budget : nullptr);
+            current() = this;
+          }
+
+          /// Runs one slice of an evaluation split into slices of t_slice_steps steps or t_slice_time, 0 for
+          /// no such limit, see slice_over(). t_budget is the budget of the evaluation as a whole, made by
+          /// the first slice.
+          Scope(const Eval_Limits &t_limits, std::shared_ptr<Budget> &t_budget, const std::uint64_t t_slice_steps,
+              const std::chrono::microseconds t_slice_time)
+            : m_previous(current()),
+              m_slice_steps(t_slice_steps),
+              m_slice_time(t_slice_time),
+              m_slice_end(Clock::now() + t_slice_time)
+          {
+            if (!t_budget) {
+              t_budget = std::make_shared<Budget>(t_limits, m_previous ? m_previous->m_budget : nullptr);
+            }
+            m_budget = t_budget;
+            current() = this;
+          }
+
+          /// Counts the steps on this thread against t_budget, an evaluation started elsewhere, see shared_budget()
+          explicit Scope(std::shared_ptr<Budget> t_budget)
+            : m_previous(current())
+          {
+            if (m_previous || !t_budget) { return; }
+
+            m_budget = std::move(t_budget);
+            current() = this;
+          }
+
+          ~Scope()
+          {
+            if (m_budget) { current() = m_previous; }
+          }
+
+          Scope(const Scope &) = delete;
+          Scope &operator=(const Scope &) = delete;
+
+          void step()
+          {
+            m_budget->step();
+            ++m_slice_count;
+          }
+
+          /// \returns true once the slice this Scope runs has taken its steps or its time
+          bool slice_over() const
+          {
+            return (m_slice_steps != 0 && m_slice_count >= m_slice_steps)
+              || (m_slice_time.count() != 0 && Clock::now() > m_slice_end);
+          }
+
+        private:
+          friend class Eval_Limits;
+
+          Scope *m_previous;
+          std::shared_ptr<Budget> m_budget;
+
+          const std::uint64_t m_slice_steps = 0;
+          std::uint64_t m_slice_count = 0;
+          const std::chrono::microseconds m_slice_time{0};
+          const Clock::time_point m_slice_end;
+      };
+
+      explicit Eval_Limits(Allocation_Stats &t_allocation_stats)
+        : m_allocation_stats(t_allocation_stats)
+      {
+      }
+
+      Eval_Limits(const Eval_Limits &) = delete;
+      Eval_Limits &operator=(const Eval_Limits &) = delete;
+
+      /// Limits each evaluation to t_steps loop iterations and function calls, 0 for no limit
+      void set_max_steps(const std::uint64_t t_steps)
+      {
+        m_max_steps = t_steps;
+        update();
+      }
+
+      /// Limits each evaluation to t_time, 0 for no limit
+      void set_max_time(const std::chrono::microseconds t_time)
+      {
+        m_max_time = t_time.count();
+        update();
+      }
+
+      /// Limits the bytes each evaluation may add to what the engine holds to t_bytes, 0 for no limit.
+      /// Only what is made while a limit is set is counted.
+      void set_max_memory(const std::uint64_t t_bytes)
+      {
+        m_max_memory = t_bytes;
+        m_allocation_stats.keep_counting(t_bytes != 0);
+        update();
+      }
+
+      std::uint64_t max_steps() const { return m_max_steps.load(std::memory_order_relaxed); }
+      std::chrono::microseconds max_time() const { return std::chrono::microseconds(m_max_time.load(std::memory_order_relaxed)); }
+      std::uint64_t max_memory() const { return m_max_memory.load(std::memory_order_relaxed); }
+
+      bool limited() const
+      {
+        return m_limited.load(std::memory_order_relaxed);
+      }
+
+      /// Counts a step of the evaluation running on this thread
+      /// \throws exception::eval_limit_error if the evaluation is over one of its limits
+      static void step()
+      {
+        if (auto *scope = current()) {
+          scope->step();
+        }
+      }
+
+      /// \returns the budget of the evaluation running on this thread, for a Scope on another
+      ///          thread to take its steps from, or null if the evaluation is not limited
+      static std::shared_ptr<Budget> shared_budget()
+      {
+        auto *scope = current();
+        return scope ? scope->m_budget : nullptr;
+      }
+
+    private:
+      void update()
+      {
+        m_limited = m_max_steps != 0 || m_max_time != 0 || m_max_memory != 0;
+      }
+
+      static Scope *&current()
+      {
+#ifndef CHAISCRIPT_NO_THREADS
+        thread_local Scope *scope = nullptr;
+#else
+        static Scope *scope = nullptr;
+#endif
+        return scope;
+      }
+
+      Allocation_Stats &m_allocation_stats;
+      std::atomic<std::uint64_t> m_max_steps{0};
+      std::atomic<std::chrono::microseconds::rep> m_max_time{0};
+      std::atomic<std::uint64_t> m_max_memory{0};
+      std::atomic_bool m_limited{false};
+  };
+}
+
+#endif
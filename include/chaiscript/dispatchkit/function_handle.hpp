@@ -0,0 +1,359 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_FUNCTION_HANDLE_HPP_
+#define CHAISCRIPT_FUNCTION_HANDLE_HPP_
+
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "boxed_cast.hpp"
+#include "boxed_number.hpp"
+#include "boxed_value.hpp"
+#include "dispatchkit.hpp"
+#include "function_call_detail.hpp"
+#include "proxy_functions.hpp"
+#include "type_conversions.hpp"
+
+namespace chaiscript
+{
+  namespace dispatch
+  {
+    namespace detail
+    {
+      /// Converts the value returned to a Function_Handle to the declared return type,
+      /// with the same rules as Function_Caller_Ret
+      template<typename Ret, bool is_arithmetic>
+        struct Function_Handle_Ret
+        {
+          static Ret get(const Boxed_Value &t_bv, const Type_Conversions_State &t_conversions)
+          {
+            return boxed_cast<Ret>(t_bv, &t_conversions);
+          }
+        };
+
+      template<typename Ret>
+        struct Function_Handle_Ret<Ret, true>
+        {
+          static Ret get(const Boxed_Value &t_bv, const Type_Conversions_State &)
+          {
+            return Boxed_Number(t_bv).get_as<Ret>();
+          }
+        };
+
+      template<>
+        struct Function_Handle_Ret<void, false>
+        {
+          static void get(const Boxed_Value &, const Type_Conversions_State &)
+          {
+          }
+        };
+    }
+  }
+
+  template<typename Signature>
+    class Function_Handle;
+
+  /// \brief A script function called from C++ with a fixed signature
+  ///
+  /// std::function objects returned by boxed_cast run a full dispatch over every overload
+  /// on each call. A Function_Handle instead finds, on its first call, the overload that
+  /// dispatch would try first for the argument types of Signature, and calls it directly
+  /// from then on. The set of overloads is looked up again only after a function has been
+  /// added to the engine.
+  ///
+  /// Overloads whose choice depends on the argument values (script functions with guards,
+  /// or Boxed_Value parameters in Signature) are never pinned: such handles dispatch on
+  /// every call, as a std::function would. If the pinned overload rejects its arguments
+  /// the call falls back to a normal dispatch, so the result is always the one dispatch
+  /// would give.
+  ///
+  /// A handle keeps a parameter buffer between calls and must not be shared between
+  /// threads; copy it instead.
+  ///
+  /// \sa ChaiScript_Basic::function_handle
+  template<typename Ret, typename ... Param>
+    class Function_Handle<Ret (Param...)>
+    {
+      public:
+        /// Calls the function named t_name, as currently defined in t_engine
+        Function_Handle(chaiscript::detail::Dispatch_Engine &t_engine, const std::string &t_name)
+          : m_engine(t_engine),
+            m_name(std::make_shared<chaiscript::detail::Function_Name>(t_name)),
+            m_funcs(functions(*t_engine.get_function(*m_name))),
+            m_generation(t_engine.function_generation())
+        {
+        }
+
+        /// Calls t_func, and if it is an overload set, the functions it contains
+        Function_Handle(chaiscript::detail::Dispatch_Engine &t_engine, const Const_Proxy_Function &t_func)
+          : m_engine(t_engine),
+            m_funcs(contained_functions(t_func)),
+            m_generation(t_engine.function_generation())
+        {
+        }
+
+        Ret operator()(Param ... param)
+        {
+          Type_Conversions_State state(m_engine.get().conversions(), m_engine.get().conversions().conversion_saves());
+          refresh();
+
+          if (m_in_call) {
+            // reentrant call, the shared parameter buffer is still in use
+            const std::vector<Boxed_Value> params{box<Param>(std::forward<Param>(param))...};
+            return ret(call(params, state), state);
+          }
+
+          struct Call_Guard
+          {
+            explicit Call_Guard(Function_Handle &t_handle) : m_handle(t_handle) { m_handle.m_in_call = true; }
+            ~Call_Guard() { m_handle.m_params.clear(); m_handle.m_in_call = false; }
+            Call_Guard(const Call_Guard &) = delete;
+            Call_Guard &operator=(const Call_Guard &) = delete;
+            Function_Handle &m_handle;
+          } guard(*this);
+
+          m_params.reserve(sizeof...(Param));
+          (void)std::initializer_list<int>{(m_params.push_back(box<Param>(std::forward<Param>(param))), 0)...};
+          return ret(call(m_params, state), state);
+        }
+
+        /// \brief Calls the function once for each argument tuple in [t_begin, t_end), in order
+        ///
+        /// Elements are std::tuple<Param...>, or anything else std::get reads the arguments from.
+        /// The overload is chosen once for the whole batch, and a script function sets up its
+        /// scope once, only replacing the parameter values between calls.
+        ///
+        /// \returns t_out, advanced past the results written, one per call
+        template<typename InItr, typename OutItr>
+          OutItr call_batch(InItr t_begin, const InItr t_end, OutItr t_out)
+          {
+            batch(t_begin, t_end, [&t_out](const Boxed_Value &t_bv, const Type_Conversions_State &t_conversions) {
+                  *t_out = ret(t_bv, t_conversions);
+                  ++t_out;
+                });
+            return t_out;
+          }
+
+        /// Calls the function once for each argument tuple in [t_begin, t_end), ignoring the results
+        template<typename InItr>
+          void call_batch(InItr t_begin, const InItr t_end)
+          {
+            batch(t_begin, t_end, [](const Boxed_Value &, const Type_Conversions_State &) {});
+          }
+
+        /// \returns true if calls go straight to a single overload
+        bool is_resolved() const noexcept
+        {
+          return m_resolved && m_func != nullptr;
+        }
+
+      private:
+        void refresh()
+        {
+          if (m_name && m_generation != m_engine.get().function_generation()) {
+            m_generation = m_engine.get().function_generation();
+            m_funcs = functions(*m_engine.get().get_function(*m_name));
+            m_resolved = false;
+          }
+        }
+
+        template<typename InItr, typename Store>
+          void batch(InItr t_begin, const InItr t_end, const Store &t_store)
+          {
+            Type_Conversions_State state(m_engine.get().conversions(), m_engine.get().conversions().conversion_saves());
+            refresh();
+
+            std::vector<Boxed_Value> params;
+            params.reserve(sizeof...(Param));
+
+            if (!m_resolved && t_begin != t_end) {
+              box_arguments(*t_begin, params);
+              m_func = resolve(params, state);
+              m_resolved = true;
+            }
+
+            // kept alive here in case a call made by the batch causes the handle to look again
+            const auto func = m_func;
+            auto itr = t_begin;
+
+            while (itr != t_end)
+            {
+              auto row = itr;
+
+              if (func) {
+                bool storing = false;
+
+                try {
+                  func->call_batch(static_cast<size_t>(std::distance(itr, t_end)),
+                      [&](const size_t, std::vector<Boxed_Value> &t_params) {
+                        row = itr;
+                        box_arguments(*itr, t_params);
+                        ++itr;
+                      },
+                      [&](const size_t, const Boxed_Value &t_bv) {
+                        storing = true;
+                        t_store(t_bv, state);
+                        storing = false;
+                      },
+                      state);
+                  continue;
+                } catch (const exception::bad_boxed_cast &) {
+                  // the pinned overload did not accept the values of this call, let dispatch decide,
+                  // unless it was the result that failed to convert
+                  if (storing) { throw; }
+                } catch (const exception::arity_error &) {
+                  if (storing) { throw; }
+                } catch (const exception::guard_error &) {
+                  if (storing) { throw; }
+                }
+              }
+
+              params.clear();
+              box_arguments(*row, params);
+              itr = std::next(row);
+              t_store(dispatch::dispatch(m_funcs, params, state), state);
+            }
+          }
+
+        Boxed_Value call(const std::vector<Boxed_Value> &t_params, const Type_Conversions_State &t_conversions)
+        {
+          if (!m_resolved) {
+            m_func = resolve(t_params, t_conversions);
+            m_resolved = true;
+          }
+
+          if (m_func) {
+            try {
+              return (*m_func)(t_params, t_conversions);
+            } catch (const exception::bad_boxed_cast &) {
+              // the pinned overload did not accept these values, let dispatch decide
+            } catch (const exception::arity_error &) {
+            } catch (const exception::guard_error &) {
+            }
+          }
+
+          return dispatch::dispatch(m_funcs, t_params, t_conversions);
+        }
+
+        /// \returns the overload dispatch::dispatch would try first for t_params, if that
+        ///          choice holds for any values of the same types
+        Const_Proxy_Function resolve(const std::vector<Boxed_Value> &t_params, const Type_Conversions_State &t_conversions) const
+        {
+          if (any_boxed_value()) {
+            return nullptr;
+          }
+
+          for (size_t i = 0; i <= t_params.size(); ++i)
+          {
+            for (const auto &func : m_funcs)
+            {
+              if (type_differences(*func, t_params) == i && (i == 0 || func->filter(t_params, t_conversions)))
+              {
+                return is_value_independent(*func) ? func : nullptr;
+              }
+            }
+          }
+
+          return nullptr;
+        }
+
+        /// Same ranking as dispatch::dispatch, with functions of the wrong arity never chosen
+        static size_t type_differences(const dispatch::Proxy_Function_Base &t_func, const std::vector<Boxed_Value> &t_params)
+        {
+          const auto arity = t_func.get_arity();
+
+          if (arity == -1) {
+            return t_params.size();
+          } else if (arity != static_cast<int>(t_params.size())) {
+            return t_params.size() + 1;
+          }
+
+          size_t numdiffs = 0;
+          for (size_t i = 0; i < t_params.size(); ++i)
+          {
+            if (!t_func.get_param_types()[i+1].bare_equal(t_params[i].get_type_info()))
+            {
+              ++numdiffs;
+            }
+          }
+          return numdiffs;
+        }
+
+        static bool is_value_independent(const dispatch::Proxy_Function_Base &t_func)
+        {
+          if (const auto *dynamic_func = dynamic_cast<const dispatch::Dynamic_Proxy_Function *>(&t_func)) {
+            return !dynamic_func->get_guard();
+          }
+          return dynamic_cast<const dispatch::Proxy_Function_Impl_Base *>(&t_func) != nullptr;
+        }
+
+        static bool any_boxed_value()
+        {
+          bool result = false;
+          (void)std::initializer_list<bool>{(result = result || std::is_same<Boxed_Value, std::decay_t<Param>>::value)...};
+          return result;
+        }
+
+        static std::vector<Const_Proxy_Function> contained_functions(const Const_Proxy_Function &t_func)
+        {
+          if (dynamic_cast<const chaiscript::detail::Dispatch_Function *>(t_func.get()) != nullptr) {
+            return t_func->get_contained_functions();
+          }
+          return {t_func};
+        }
+
+        static std::vector<Const_Proxy_Function> functions(const std::vector<Proxy_Function> &t_funcs)
+        {
+          return std::vector<Const_Proxy_Function>(t_funcs.begin(), t_funcs.end());
+        }
+
+        template<typename Tuple>
+          static void box_arguments(const Tuple &t_args, std::vector<Boxed_Value> &t_params)
+          {
+            box_arguments(t_args, t_params, std::index_sequence_for<Param...>());
+          }
+
+        template<typename Tuple, size_t ... I>
+          static void box_arguments(const Tuple &t_args, std::vector<Boxed_Value> &t_params, std::index_sequence<I...>)
+          {
+            (void)t_args;
+            (void)std::initializer_list<int>{(t_params.push_back(box<Param>(std::get<I>(t_args))), 0)...};
+          }
+
+        template<typename P, typename Q>
+          static Boxed_Value box(Q &&q)
+          {
+            return dispatch::detail::Build_Function_Caller_Helper<Ret, Param...>::template box<P>(std::forward<Q>(q));
+          }
+
+        static Ret ret(const Boxed_Value &t_bv, const Type_Conversions_State &t_conversions)
+        {
+          return dispatch::detail::Function_Handle_Ret<Ret, std::is_arithmetic<Ret>::value && !std::is_same<Ret, bool>::value>::get(t_bv, t_conversions);
+        }
+
+        std::reference_wrapper<chaiscript::detail::Dispatch_Engine> m_engine;
+        std::shared_ptr<const chaiscript::detail::Function_Name> m_name;
+        std::vector<Const_Proxy_Function> m_funcs;
+        uint_fast32_t m_generation = 0;
+        Const_Proxy_Function m_func;
+        bool m_resolved = false;
+        bool m_in_call = false;
+        std::vector<Boxed_Value> m_params;
+    };
+}
+
+#endif
+
@@ -0,0 +1,266 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_LAZY_RANGE_HPP_
+#define CHAISCRIPT_LAZY_RANGE_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "boxed_number.hpp"
+#include "boxed_value.hpp"
+
+namespace chaiscript
+{
+  /// \brief A range whose elements are made as they are read, by a generator function or a lazy adapter
+  ///
+  /// A Lazy_Range has the empty, front and pop_front of a range. Each element is made the first
+  /// time empty() or front() needs it, so adapters composed over a large or endless range only
+  /// touch the elements that are read. Copies share their position: reading one reads them all.
+  class Lazy_Range
+  {
+    public:
+      typedef std::function<bool ()> Empty_Func;
+      typedef std::function<Boxed_Value ()> Front_Func;
+      typedef std::function<void ()> Pop_Front_Func;
+      typedef std::function<Boxed_Value (const Boxed_Value &)> Transform;
+      typedef std::function<bool (const Boxed_Value &)> Predicate;
+      typedef std::function<bool (Boxed_Value &)> Next_Func;
+
+      /// t_front and t_pop_front are only called while t_empty returns false
+      Lazy_Range(Empty_Func t_empty, Front_Func t_front, Pop_Front_Func t_pop_front)
+        : m_empty(std::move(t_empty)), m_front(std::move(t_front)), m_pop_front(std::move(t_pop_front))
+      {
+      }
+
+      bool empty() const
+      {
+        return m_empty();
+      }
+
+      Boxed_Value front() const
+      {
+        if (empty()) {
+          throw std::range_error("Range empty");
+        }
+        return m_front();
+      }
+
+      void pop_front()
+      {
+        if (empty()) {
+          throw std::range_error("Range empty");
+        }
+        m_pop_front();
+      }
+
+      /// The elements of t_range passed through t_f, each once
+      static Lazy_Range map(Lazy_Range t_range, Transform t_f)
+      {
+        struct State {
+          Lazy_Range range;
+          Transform f;
+          std::unique_ptr<Boxed_Value> front;
+        };
+        auto state = std::make_shared<State>(State{std::move(t_range), std::move(t_f), nullptr});
+
+        return Lazy_Range(
+            [state](){ return state->range.empty(); },
+            [state](){
+              if (!state->front) {
+                state->front = std::make_unique<Boxed_Value>(state->f(state->range.front()));
+              }
+              return *state->front;
+            },
+            [state](){
+              state->front.reset();
+              state->range.pop_front();
+            });
+      }
+
+      /// The elements of t_range for which t_f is true
+      static Lazy_Range filter(Lazy_Range t_range, Predicate t_f)
+      {
+        struct State {
+          Lazy_Range range;
+          Predicate f;
+          bool found;
+
+          bool empty() {
+            if (!found) {
+              while (!range.empty() && !f(range.front())) {
+                range.pop_front();
+              }
+              found = true;
+            }
+            return range.empty();
+          }
+        };
+        auto state = std::make_shared<State>(State{std::move(t_range), std::move(t_f), false});
+
+        return Lazy_Range(
+            [state](){ return state->empty(); },
+            [state](){ return state->range.front(); },
+            [state](){
+              state->range.pop_front();
+              state->found = false;
+            });
+      }
+
+      /// The first t_count elements of t_range, reading no further
+      static Lazy_Range take(Lazy_Range t_range, const size_t t_count)
+      {
+        struct State {
+          Lazy_Range range;
+          size_t count;
+        };
+        auto state = std::make_shared<State>(State{std::move(t_range), t_count});
+
+        return Lazy_Range(
+            [state](){ return state->count == 0 || state->range.empty(); },
+            [state](){ return state->range.front(); },
+            [state](){
+              state->range.pop_front();
+              --state->count;
+            });
+      }
+
+      /// The elements of t_range up to the first for which t_f is false, reading no further
+      static Lazy_Range take_while(Lazy_Range t_range, Predicate t_f)
+      {
+        struct State {
+          Lazy_Range range;
+          Predicate f;
+          bool checked;
+          bool done;
+
+          bool empty() {
+            if (!done && !checked) {
+              done = range.empty() || !f(range.front());
+              checked = true;
+            }
+            return done;
+          }
+        };
+        auto state = std::make_shared<State>(State{std::move(t_range), std::move(t_f), false, false});
+
+        return Lazy_Range(
+            [state](){ return state->empty(); },
+            [state](){ return state->range.front(); },
+            [state](){
+              state->range.pop_front();
+              state->checked = false;
+            });
+      }
+
+      /// The elements of t_range after its first t_count
+      static Lazy_Range drop(Lazy_Range t_range, const size_t t_count)
+      {
+        struct State {
+          Lazy_Range range;
+          size_t count;
+
+          bool empty() {
+            while (count > 0 && !range.empty()) {
+              range.pop_front();
+              --count;
+            }
+            return range.empty();
+          }
+        };
+        auto state = std::make_shared<State>(State{std::move(t_range), t_count});
+
+        return Lazy_Range(
+            [state](){ return state->empty(); },
+            [state](){ return state->range.front(); },
+            [state](){ state->range.pop_front(); });
+      }
+
+      /// The elements of t_range from the first for which t_f is false
+      static Lazy_Range drop_while(Lazy_Range t_range, Predicate t_f)
+      {
+        struct State {
+          Lazy_Range range;
+          Predicate f;
+          bool dropped;
+
+          bool empty() {
+            if (!dropped) {
+              while (!range.empty() && f(range.front())) {
+                range.pop_front();
+              }
+              dropped = true;
+            }
+            return range.empty();
+          }
+        };
+        auto state = std::make_shared<State>(State{std::move(t_range), std::move(t_f), false});
+
+        return Lazy_Range(
+            [state](){ return state->empty(); },
+            [state](){ return state->range.front(); },
+            [state](){ state->range.pop_front(); });
+      }
+
+      /// The numbers from t_first to t_last, counting up by one
+      static Lazy_Range generate_range(const Boxed_Number &t_first, Boxed_Number t_last)
+      {
+        // each number is a new value, so changing one read from the range does not change the range
+        auto next = std::make_shared<Boxed_Value>(Boxed_Number::sum(t_first, Boxed_Number(0)).bv);
+
+        return Lazy_Range(
+            [next, t_last](){ return !Boxed_Number::less_than_equal(Boxed_Number(*next), t_last); },
+            [next](){ return Boxed_Number::sum(Boxed_Number(*next), Boxed_Number(0)).bv; },
+            [next](){ *next = Boxed_Number::sum(Boxed_Number(*next), Boxed_Number(1)).bv; });
+      }
+
+      /// The values t_next produces, each made when it is first read. t_next sets its argument to
+      /// the next value and returns true, or returns false once there are no more; it is not
+      /// called again after that.
+      static Lazy_Range generator(Next_Func t_next)
+      {
+        struct State {
+          Next_Func next;
+          std::unique_ptr<Boxed_Value> front;
+          bool done;
+
+          bool empty() {
+            if (!front && !done) {
+              Boxed_Value value;
+              if (next(value)) {
+                front = std::make_unique<Boxed_Value>(std::move(value));
+              } else {
+                done = true;
+                // lets go of whatever t_next holds
+                next = nullptr;
+              }
+            }
+            return done;
+          }
+        };
+        auto state = std::make_shared<State>(State{std::move(t_next), nullptr, false});
+
+        return Lazy_Range(
+            [state](){ return state->empty(); },
+            [state](){ return *state->front; },
+            [state](){ state->front.reset(); });
+      }
+
+    private:
+      Empty_Func m_empty;
+      Front_Func m_front;
+      Pop_Front_Func m_pop_front;
+  };
+}
+
+#endif
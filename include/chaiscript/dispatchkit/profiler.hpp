@@ -0,0 +1,269 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_PROFILER_HPP_
+#define CHAISCRIPT_PROFILER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../chaiscript_threading.hpp"
+
+namespace chaiscript
+{
+  /// \brief Sampling profiler for the script functions an engine runs
+  ///
+  /// While started, every script call made through a function call or method call expression
+  /// keeps a frame with the called name and the call site, and a script function body adds its
+  /// own location to the frame it runs in. Once per interval the stack of frames is taken as a
+  /// sample. The stack only changes when a frame is entered or left, so the check is made there:
+  /// the samples due since the last check all belong to the stack that was active until then.
+  ///
+  /// When stopped, a call costs one relaxed atomic load.
+  ///
+  /// \sa ChaiScript_Basic::profiler
+  class Profiler
+  {
+    public:
+      typedef std::chrono::steady_clock Clock;
+
+      /// Samples attributed to a function or to a call site
+      struct Entry
+      {
+        std::string name;
+        /// samples in which this was the innermost frame
+        std::uint64_t self_samples = 0;
+        /// samples in which this appeared anywhere on the stack
+        std::uint64_t total_samples = 0;
+        std::chrono::microseconds self_time{0};
+        std::chrono::microseconds total_time{0};
+      };
+
+      Profiler() = default;
+      Profiler(const Profiler &) = delete;
+      Profiler &operator=(const Profiler &) = delete;
+
+      /// Starts sampling every t_interval, keeping the samples already taken
+      void start(const std::chrono::microseconds t_interval = std::chrono::microseconds(1000))
+      {
+        m_interval = std::chrono::duration_cast<Clock::duration>(std::max(t_interval, std::chrono::microseconds(1))).count();
+        ++m_session;
+        m_enabled = true;
+      }
+
+      void stop()
+      {
+        m_enabled = false;
+      }
+
+      bool enabled() const
+      {
+        return m_enabled.load(std::memory_order_relaxed);
+      }
+
+      /// Drops all samples taken so far
+      void reset()
+      {
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+        m_samples = 0;
+        m_folded.clear();
+        m_functions.clear();
+        m_lines.clear();
+      }
+
+      std::chrono::microseconds interval() const
+      {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::duration(m_interval));
+      }
+
+      std::uint64_t samples() const
+      {
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+        return m_samples;
+      }
+
+      /// Time per function, named with the location of its definition when that is known,
+      /// most self time first
+      std::vector<Entry> functions() const
+      {
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+        return entries(m_functions);
+      }
+
+      /// Time per call site, as "file:line", most self time first
+      std::vector<Entry> lines() const
+      {
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+        return entries(m_lines);
+      }
+
+      /// \returns one line per distinct stack, outermost frame first, frames separated by ';'
+      ///          and followed by the sample count, as read by flamegraph.pl
+      std::string folded() const
+      {
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+        std::string result;
+        for (const auto &stack : m_folded) {
+          result += stack.first + ' ' + std::to_string(stack.second) + '\n';
+        }
+        return result;
+      }
+
+      /// Called before a script call to t_name, made at t_file:t_line. The strings must outlive the call.
+      void enter(const std::string &t_name, const std::string &t_file, const int t_line)
+      {
+        auto &thread = *m_thread;
+        check(thread);
+        thread.frames.push_back(Frame{&t_name, &t_file, t_line, nullptr, 0});
+      }
+
+      /// Called after the call matching the last enter on this thread
+      void leave()
+      {
+        auto &thread = *m_thread;
+        check(thread);
+        if (!thread.frames.empty()) {
+          thread.frames.pop_back();
+        }
+      }
+
+      /// Called as a script function defined at t_file:t_line starts running, to name the frame it runs in
+      void define(const std::string &t_file, const int t_line)
+      {
+        auto &thread = *m_thread;
+        // no check here: the time spent finding the function belongs to the same frame
+        if (!thread.frames.empty() && thread.frames.back().def_file == nullptr) {
+          thread.frames.back().def_file = &t_file;
+          thread.frames.back().def_line = t_line;
+        }
+      }
+
+    private:
+      struct Frame
+      {
+        const std::string *name;
+        const std::string *file;
+        int line;
+        const std::string *def_file;
+        int def_line;
+      };
+
+      struct Thread_State
+      {
+        std::vector<Frame> frames;
+        Clock::time_point next_sample;
+        std::uint_fast32_t session = 0;
+      };
+
+      struct Counts
+      {
+        std::uint64_t self_samples = 0;
+        std::uint64_t total_samples = 0;
+      };
+
+      void check(Thread_State &t_thread)
+      {
+        const auto now = Clock::now();
+        const Clock::duration interval(m_interval);
+
+        if (t_thread.session != m_session) {
+          // first check since start(): sampling begins now
+          t_thread.session = m_session;
+          t_thread.next_sample = now + interval;
+        } else if (now >= t_thread.next_sample) {
+          const auto due = 1 + static_cast<std::uint64_t>((now - t_thread.next_sample) / interval);
+          t_thread.next_sample += interval * static_cast<Clock::rep>(due);
+          record(t_thread.frames, due);
+        }
+      }
+
+      void record(const std::vector<Frame> &t_frames, const std::uint64_t t_count)
+      {
+        std::string stack;
+        std::set<std::string> functions;
+        std::set<std::string> lines;
+
+        std::string function;
+        std::string line;
+
+        if (t_frames.empty()) {
+          function = "(top level)";
+          stack = function;
+          functions.insert(function);
+        }
+
+        for (const auto &frame : t_frames)
+        {
+          function = *frame.name;
+          if (frame.def_file) {
+            function += " (" + *frame.def_file + ':' + std::to_string(frame.def_line) + ')';
+          }
+          line = *frame.file + ':' + std::to_string(frame.line);
+
+          if (!stack.empty()) { stack += ';'; }
+          stack += function;
+          functions.insert(function);
+          lines.insert(line);
+        }
+
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+        m_samples += t_count;
+        m_folded[stack] += t_count;
+
+        // a recursive function is counted once per sample in its total
+        for (const auto &name : functions) { m_functions[name].total_samples += t_count; }
+        for (const auto &name : lines) { m_lines[name].total_samples += t_count; }
+        m_functions[function].self_samples += t_count;
+        if (!t_frames.empty()) { m_lines[line].self_samples += t_count; }
+      }
+
+      std::vector<Entry> entries(const std::map<std::string, Counts> &t_counts) const
+      {
+        std::vector<Entry> result;
+        for (const auto &count : t_counts)
+        {
+          Entry entry;
+          entry.name = count.first;
+          entry.self_samples = count.second.self_samples;
+          entry.total_samples = count.second.total_samples;
+          entry.self_time = interval() * static_cast<std::chrono::microseconds::rep>(entry.self_samples);
+          entry.total_time = interval() * static_cast<std::chrono::microseconds::rep>(entry.total_samples);
+          result.push_back(std::move(entry));
+        }
+
+        std::stable_sort(result.begin(), result.end(),
+            [](const Entry &lhs, const Entry &rhs) {
+              return lhs.self_samples > rhs.self_samples
+                  || (lhs.self_samples == rhs.self_samples && lhs.total_samples > rhs.total_samples);
+            });
+        return result;
+      }
+
+      std::atomic_bool m_enabled{false};
+      std::atomic_uint_fast32_t m_session{0};
+      std::atomic<Clock::rep> m_interval{std::chrono::duration_cast<Clock::duration>(std::chrono::milliseconds(1)).count()};
+
+      chaiscript::detail::threading::Thread_Storage<Thread_State> m_thread;
+
+      mutable chaiscript::detail::threading::shared_mutex m_mutex;
+      std::uint64_t m_samples = 0;
+      std::map<std::string, std::uint64_t> m_folded;
+      std::map<std::string, Counts> m_functions;
+      std::map<std::string, Counts> m_lines;
+  };
+}
+
+#endif
@@ -24,12 +24,16 @@
 #include "../chaiscript_defines.hpp"
 #include "boxed_cast.hpp"
 #include "boxed_value.hpp"
+#include "dispatch_stats.hpp"
 #include "proxy_functions_detail.hpp"
 #include "type_info.hpp"
 #include "dynamic_object.hpp"
 
 namespace chaiscript {
 class Type_Conversions;
+namespace detail {
+class Dispatch_Engine;
+}  // namespace detail
 namespace exception {
 class bad_boxed_cast;
 struct arity_error;
@@ -131,7 +135,7 @@ namespace chaiscript
               {
                 try {
                   const Dynamic_Object &d = boxed_cast<const Dynamic_Object &>(bv, &t_conversions);
-                  if (!(name == "Dynamic_Object" || d.get_type_name() == name)) {
+                  if (!d.is_type(m_type_ids[i])) {
                     return std::make_pair(false, false);
                   }
                 } catch (const std::bad_cast &) {
@@ -166,19 +170,24 @@ namespace chaiscript
       private:
         void update_has_types()
         {
+          m_has_types = false;
+          m_type_ids.clear();
+
           for (const auto &type : m_types)
           {
             if (!type.first.empty())
             {
               m_has_types = true;
-              return;
+              m_type_ids.push_back(Dynamic_Object::type_id(type.first));
+            } else {
+              m_type_ids.push_back(Dynamic_Object::unnamed_type_id);
             }
           }
-
-          m_has_types = false;
         }
 
         std::vector<std::pair<std::string, Type_Info>> m_types;
+        /// Dynamic_Object type ids of the names in m_types, for matching script class parameters
+        std::vector<Dynamic_Object::Type_Id> m_type_ids;
         bool m_has_types;
         Type_Info m_doti;
 
@@ -206,6 +215,26 @@ namespace chaiscript
           }
         }
 
+        /// Fills the parameters of call number i of a batch
+        typedef std::function<void (size_t, std::vector<Boxed_Value> &)> Batch_Arguments;
+        /// Receives the result of call number i of a batch, in call order
+        typedef std::function<void (size_t, const Boxed_Value &)> Batch_Results;
+
+        /// Calls the function t_count times, with the parameters filled in by t_args,
+        /// handing each return value to t_results. Implementations may set up state shared
+        /// by all of the calls once, instead of once per call.
+        virtual void call_batch(const size_t t_count, const Batch_Arguments &t_args, const Batch_Results &t_results,
+            const chaiscript::Type_Conversions_State &t_conversions) const
+        {
+          std::vector<Boxed_Value> params;
+          for (size_t i = 0; i < t_count; ++i)
+          {
+            params.clear();
+            t_args(i, params);
+            t_results(i, (*this)(params, t_conversions));
+          }
+        }
+
         /// Returns a vector containing all of the types of the parameters the function returns/takes
         /// if the function is variadic or takes no arguments (arity of 0 or -1), the returned
         /// value contains exactly 1 Type_Info object: the return type
@@ -227,6 +256,13 @@ namespace chaiscript
           return std::vector<std::shared_ptr<const Proxy_Function_Base> >();
         }
 
+        /// \returns a copy of this function bound to t_engine, for a script function defined by
+        ///          another engine or a function holding one; nullptr if any engine can share it as it is
+        virtual std::shared_ptr<Proxy_Function_Base> rebind(chaiscript::detail::Dispatch_Engine &) const
+        {
+          return nullptr;
+        }
+
         //! Return true if the function is a possible match
         //! to the passed in values
         bool filter(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const
@@ -237,9 +273,9 @@ namespace chaiscript
           {
             return true;
           } else if (m_arity > 1) {
-            return compare_type_to_param(m_types[1], vals[0], t_conversions) && compare_type_to_param(m_types[2], vals[1], t_conversions);
+            return compare_first_type(vals[0], t_conversions) && compare_type_to_param(m_types[2], vals[1], t_conversions);
           } else {
-            return compare_type_to_param(m_types[1], vals[0], t_conversions);
+            return compare_first_type(vals[0], t_conversions);
           }
         }
 
@@ -390,11 +426,14 @@ namespace chaiscript
         {
           if (m_guard)
           {
+            Dispatch_Stats::count(t_conversions->dispatch_stats(), &Dispatch_Stats::Counters::guard_calls);
             try {
               return boxed_cast<bool>((*m_guard)(params, t_conversions));
             } catch (const exception::arity_error &) {
+              Dispatch_Stats::count(t_conversions->dispatch_stats(), &Dispatch_Stats::Counters::match_exceptions);
               return false;
             } catch (const exception::bad_boxed_cast &) {
+              Dispatch_Stats::count(t_conversions->dispatch_stats(), &Dispatch_Stats::Counters::match_exceptions);
               return false;
             }
           } else {
@@ -471,6 +510,17 @@ namespace chaiscript
         }
 
 
+        void call_batch(const size_t t_count, const Batch_Arguments &t_args, const Batch_Results &t_results,
+            const Type_Conversions_State &t_conversions) const override
+        {
+          call_batch_impl(m_f, t_count, t_args, t_results, t_conversions, 0);
+        }
+
+        std::shared_ptr<Proxy_Function_Base> rebind(chaiscript::detail::Dispatch_Engine &t_engine) const override
+        {
+          return rebind_impl(m_f, t_engine, 0);
+        }
+
       protected:
         Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
         {
@@ -488,6 +538,55 @@ namespace chaiscript
         }
 
       private:
+        /// Callables with a call_batch of their own are given each call's parameters
+        /// after the same checks and conversions do_call applies
+        template<typename Func>
+        auto call_batch_impl(const Func &t_f, const size_t t_count, const Batch_Arguments &t_args, const Batch_Results &t_results,
+            const Type_Conversions_State &t_conversions, int) const -> decltype(t_f.call_batch(t_count, t_args, t_results), void())
+        {
+          t_f.call_batch(t_count,
+              [&](const size_t t_call, std::vector<Boxed_Value> &t_params) {
+                t_args(t_call, t_params);
+                if (m_arity >= 0 && size_t(m_arity) != t_params.size()) {
+                  throw exception::arity_error(static_cast<int>(t_params.size()), m_arity);
+                }
+
+                const auto match_results = call_match_internal(t_params, t_conversions);
+                if (!match_results.first) {
+                  throw exception::guard_error();
+                } else if (match_results.second) {
+                  t_params = m_param_types.convert(t_params, t_conversions);
+                }
+              },
+              t_results);
+        }
+
+        template<typename Func>
+        void call_batch_impl(const Func &, const size_t t_count, const Batch_Arguments &t_args, const Batch_Results &t_results,
+            const Type_Conversions_State &t_conversions, long) const
+        {
+          Proxy_Function_Base::call_batch(t_count, t_args, t_results, t_conversions);
+        }
+
+        /// Callables with a rebind of their own, as script functions have, are bound to an engine
+        template<typename Func>
+        auto rebind_impl(const Func &t_f, chaiscript::detail::Dispatch_Engine &t_engine, int) const
+          -> decltype(t_f.rebind(t_engine), std::shared_ptr<Proxy_Function_Base>())
+        {
+          auto guard = get_guard();
+          if (guard) {
+            if (auto rebound = guard->rebind(t_engine)) { guard = std::move(rebound); }
+          }
+          return chaiscript::make_shared<Proxy_Function_Base, Dynamic_Proxy_Function_Impl<Callable>>(
+              t_f.rebind(t_engine), m_arity, get_parse_tree(), m_param_types, std::move(guard));
+        }
+
+        template<typename Func>
+        std::shared_ptr<Proxy_Function_Base> rebind_impl(const Func &, chaiscript::detail::Dispatch_Engine &, long) const
+        {
+          return nullptr;
+        }
+
         Callable m_f;
     };
 
@@ -857,6 +956,7 @@ namespace chaiscript
 
           while (begin != end)
           {
+            Dispatch_Stats::count(t_conversions->dispatch_stats(), &Dispatch_Stats::Counters::candidates);
             if (types_match_except_for_arithmetic(begin->second, plist, t_conversions))
             {
               if (matching_func == end)
@@ -892,12 +992,14 @@ namespace chaiscript
           newplist.reserve(plist.size());
 
           const std::vector<Type_Info> &tis = matching_func->second->get_param_types();
+          const auto *stats = t_conversions->dispatch_stats();
           std::transform(tis.begin() + 1, tis.end(),
                          plist.begin(),
                          std::back_inserter(newplist),
-                         [](const Type_Info &ti, const Boxed_Value &param) -> Boxed_Value {
+                         [stats](const Type_Info &ti, const Boxed_Value &param) -> Boxed_Value {
                            if (ti.is_arithmetic() && param.get_type_info().is_arithmetic()
                                && param.get_type_info() != ti) {
+                             Dispatch_Stats::count(stats, &Dispatch_Stats::Counters::conversions);
                              return Boxed_Number(param).get_as(ti).bv;
                            } else {
                              return param;
@@ -915,6 +1017,8 @@ namespace chaiscript
             //guard failed to allow the function to execute
           }
 
+          Dispatch_Stats::count(t_conversions->dispatch_stats(), &Dispatch_Stats::Counters::match_exceptions);
+
           throw exception::dispatch_error(plist, std::vector<Const_Proxy_Function>(t_funcs.begin(), t_funcs.end()));
 
         }
@@ -955,18 +1059,27 @@ namespace chaiscript
         {
           for (const auto &func : ordered_funcs )
           {
+            if (func.first != i) { continue; }
+
+            Dispatch_Stats::count(t_conversions->dispatch_stats(), &Dispatch_Stats::Counters::candidates);
             try {
-              if (func.first == i && (i == 0 || func.second->filter(plist, t_conversions)))
+              // an exact match can still be refused by its first parameter, as a method of
+              // another script class is: check that up front rather than by guard_error
+              if (i == 0 ? plist.empty() || func.second->compare_first_type(plist[0], t_conversions)
+                         : func.second->filter(plist, t_conversions))
               {
                 return (*(func.second))(plist, t_conversions);
               }
             } catch (const exception::bad_boxed_cast &) {
               //parameter failed to cast, try again
+              Dispatch_Stats::count(t_conversions->dispatch_stats(), &Dispatch_Stats::Counters::match_exceptions);
             } catch (const exception::arity_error &) {
               //invalid num params, try again
+              Dispatch_Stats::count(t_conversions->dispatch_stats(), &Dispatch_Stats::Counters::match_exceptions);
             } catch (const exception::guard_error &) {
               //guard failed to allow the function to execute,
               //try again
+              Dispatch_Stats::count(t_conversions->dispatch_stats(), &Dispatch_Stats::Counters::match_exceptions);
             }
           }
         }
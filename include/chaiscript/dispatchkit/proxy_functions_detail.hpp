@@ -12,7 +12,10 @@
 #define CHAISCRIPT_PROXY_FUNCTIONS_DETAIL_HPP_
 
 #include <functional>
+#include <initializer_list>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <array>
 
@@ -93,12 +96,39 @@ namespace chaiscript
         }
 
 
+      /// A parameter type through which a native function can change what it is passed
+      template<typename P>
+        struct Mutable_Param : std::integral_constant<bool,
+            (std::is_lvalue_reference<P>::value && !std::is_const<std::remove_reference_t<P>>::value)
+            || (std::is_pointer<P>::value && !std::is_const<std::remove_pointer_t<P>>::value)>
+        {
+        };
+
+      /// Once a native call returns, measures the strings and containers it could have grown, see Boxed_Value::update_heap_size
+      template<typename ... Params>
+        struct Heap_Size_Update
+        {
+          template<size_t ... I>
+            void update(std::index_sequence<I...>) const
+            {
+              (void)std::initializer_list<int>{(Mutable_Param<Params>::value ? (params[I].update_heap_size(), 0) : 0)...};
+            }
+
+          ~Heap_Size_Update()
+          {
+            update(std::index_sequence_for<Params...>{});
+          }
+
+          const std::vector<Boxed_Value> &params;
+        };
+
       template<typename Callable, typename Ret, typename ... Params, size_t ... I>
         Ret call_func(const chaiscript::dispatch::detail::Function_Signature<Ret (Params...)> &, 
                       std::index_sequence<I...>, const Callable &f,
                       const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions)
         {
           (void)params; (void)t_conversions;
+          const Heap_Size_Update<Params...> heap_size_update{params};
           return f(boxed_cast<Params>(params[I], &t_conversions)...);
         }
 
@@ -12,16 +12,23 @@
 #define CHAISCRIPT_DYNAMIC_CAST_CONVERSION_HPP_
 
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <typeindex>
 #include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "../chaiscript_threading.hpp"
 #include "bad_boxed_cast.hpp"
 #include "boxed_cast_helper.hpp"
+#include "dispatch_stats.hpp"
 #include "boxed_value.hpp"
 #include "type_info.hpp"
 
@@ -101,6 +108,13 @@ namespace chaiscript
           return true;
         }
 
+        /// \returns true if this converts a derived class to one of its bases, which
+        ///          can be chained with other such conversions
+        virtual bool upcast() const
+        {
+          return false;
+        }
+
         virtual ~Type_Conversion_Base() = default;
 
       protected:
@@ -255,6 +269,11 @@ namespace chaiscript
         {
           return Static_Caster<Derived, Base>::cast(t_derived);
         }
+
+        bool upcast() const override
+        {
+          return true;
+        }
     };
 
     template<typename Base, typename Derived>
@@ -277,12 +296,63 @@ namespace chaiscript
           return false;
         }
 
+        bool upcast() const override
+        {
+          return true;
+        }
+
         Boxed_Value convert(const Boxed_Value &t_derived) const override
         {
           return Static_Caster<Derived, Base>::cast(t_derived);
         }
     };
 
+    /// A conversion across several base class registrations, from the most derived class
+    /// up to the last base, and back down if every step allows it
+    class Chained_Conversion_Impl : public Type_Conversion_Base
+    {
+      public:
+        explicit Chained_Conversion_Impl(std::vector<std::shared_ptr<const Type_Conversion_Base>> t_steps)
+          : Type_Conversion_Base(t_steps.back()->to(), t_steps.front()->from()),
+            m_steps(std::move(t_steps))
+        {
+        }
+
+        Boxed_Value convert_down(const Boxed_Value &t_base) const override
+        {
+          Boxed_Value bv = t_base;
+          for (auto itr = m_steps.rbegin(); itr != m_steps.rend(); ++itr) {
+            bv = (*itr)->convert_down(bv);
+          }
+          return bv;
+        }
+
+        Boxed_Value convert(const Boxed_Value &t_derived) const override
+        {
+          Boxed_Value bv = t_derived;
+          for (const auto &step : m_steps) {
+            bv = step->convert(bv);
+          }
+          return bv;
+        }
+
+        bool bidir() const override
+        {
+          for (const auto &step : m_steps) {
+            if (!step->bidir()) { return false; }
+          }
+          return true;
+        }
+
+        bool upcast() const override
+        {
+          return true;
+        }
+
+      private:
+        std::vector<std::shared_ptr<const Type_Conversion_Base>> m_steps;
+    };
+
 
 
     template<typename Callable>
@@ -338,7 +408,9 @@ namespace chaiscript
         : m_mutex(),
           m_conversions(),
           m_convertableTypes(),
-          m_num_types(0)
+          m_num_types(0),
+          m_table(std::make_shared<const Conversion_Table>()),
+          m_table_generation(1)
       {
       }
 
@@ -348,6 +420,17 @@ namespace chaiscript
       Type_Conversions &operator=(const Type_Conversions &) = delete;
       Type_Conversions &operator=(Type_Conversions &&) = default;
 
+      /// The dispatch statistics of the engine these conversions belong to, which count the conversions made
+      void set_dispatch_stats(const Dispatch_Stats *t_stats)
+      {
+        m_dispatch_stats = t_stats;
+      }
+
+      const Dispatch_Stats *dispatch_stats() const
+      {
+        return m_dispatch_stats;
+      }
+
       const std::set<const std::type_info *, Less_Than> &thread_cache() const
       {
         auto &cache = *m_thread_cache;
@@ -367,6 +450,9 @@ namespace chaiscript
         m_conversions.insert(conversion);
         m_convertableTypes.insert({conversion->to().bare_type_info(), conversion->from().bare_type_info()});
         m_num_types = m_convertableTypes.size();
+        // rebuilt by the next lookup, so registering many conversions in a row builds it once
+        m_table.reset();
+        ++m_table_generation;
       }
 
       template<typename T>
@@ -407,12 +493,16 @@ namespace chaiscript
 
         Boxed_Value boxed_type_conversion(const Type_Info &to, Conversion_Saves &t_saves, const Boxed_Value &from) const
         {
+          const auto conversion = find_conversion(to, from.get_type_info());
+          if (!conversion) {
+            throw exception::bad_boxed_dynamic_cast(from.get_type_info(), *to.bare_type_info(), "No known conversion");
+          }
+
+          Dispatch_Stats::count(m_dispatch_stats, &Dispatch_Stats::Counters::conversions);
           try {
-            Boxed_Value ret = get_conversion(to, from.get_type_info())->convert(from);
+            Boxed_Value ret = conversion->convert(from);
             if (t_saves.enabled) { t_saves.saves.push_back(ret); }
             return ret;
-          } catch (const std::out_of_range &) {
-            throw exception::bad_boxed_dynamic_cast(from.get_type_info(), *to.bare_type_info(), "No known conversion");
           } catch (const std::bad_cast &) {
             throw exception::bad_boxed_dynamic_cast(from.get_type_info(), *to.bare_type_info(), "Unable to perform dynamic_cast operation");
           }
@@ -420,12 +510,16 @@ namespace chaiscript
 
         Boxed_Value boxed_type_down_conversion(const Type_Info &from, Conversion_Saves &t_saves, const Boxed_Value &to) const
         {
+          const auto conversion = find_conversion(to.get_type_info(), from);
+          if (!conversion) {
+            throw exception::bad_boxed_dynamic_cast(to.get_type_info(), *from.bare_type_info(), "No known conversion");
+          }
+
+          Dispatch_Stats::count(m_dispatch_stats, &Dispatch_Stats::Counters::conversions);
           try {
-            Boxed_Value ret = get_conversion(to.get_type_info(), from)->convert_down(to);
+            Boxed_Value ret = conversion->convert_down(to);
             if (t_saves.enabled) { t_saves.saves.push_back(ret); }
             return ret;
-          } catch (const std::out_of_range &) {
-            throw exception::bad_boxed_dynamic_cast(to.get_type_info(), *from.bare_type_info(), "No known conversion");
           } catch (const std::bad_cast &) {
             throw exception::bad_boxed_dynamic_cast(to.get_type_info(), *from.bare_type_info(), "Unable to perform dynamic_cast operation");
           }
@@ -445,19 +539,29 @@ namespace chaiscript
 
       bool has_conversion(const Type_Info &to, const Type_Info &from) const
       {
-        chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-        return find_bidir(to, from) != m_conversions.end();
+        const auto &table = conversion_table();
+        if (table.count(key(to, from)) != 0) {
+          return true;
+        }
+
+        const auto reverse = table.find(key(from, to));
+        return reverse != table.end() && reverse->second->bidir();
       }
 
-      std::shared_ptr<detail::Type_Conversion_Base> get_conversion(const Type_Info &to, const Type_Info &from) const
+      /// \returns the conversion from \p from to \p to, following base class registrations
+      ///          through any number of levels, or nullptr if there is none
+      std::shared_ptr<detail::Type_Conversion_Base> find_conversion(const Type_Info &to, const Type_Info &from) const
       {
-        chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-        const auto itr = find(to, from);
+        const auto &table = conversion_table();
+        const auto itr = table.find(key(to, from));
+        return itr != table.end() ? itr->second : nullptr;
+      }
 
-        if (itr != m_conversions.end())
+      std::shared_ptr<detail::Type_Conversion_Base> get_conversion(const Type_Info &to, const Type_Info &from) const
+      {
+        if (auto conversion = find_conversion(to, from))
         {
-          return *itr;
+          return conversion;
         } else {
           throw std::out_of_range("No such conversion exists from " + from.bare_name() + " to " + to.bare_name());
         }
@@ -468,27 +572,102 @@ namespace chaiscript
       }
 
     private:
-      std::set<std::shared_ptr<detail::Type_Conversion_Base> >::const_iterator find_bidir(
-          const Type_Info &to, const Type_Info &from) const
+      typedef std::pair<std::type_index, std::type_index> Conversion_Key;
+
+      struct Conversion_Key_Hash
       {
-        return std::find_if(m_conversions.begin(), m_conversions.end(),
-              [&to, &from](const std::shared_ptr<detail::Type_Conversion_Base> &conversion) -> bool
-              {
-                return  (conversion->to().bare_equal(to) && conversion->from().bare_equal(from))
-                     || (conversion->bidir() && conversion->from().bare_equal(to) && conversion->to().bare_equal(from));
-              }
-        );
+        size_t operator()(const Conversion_Key &t_key) const noexcept
+        {
+          return t_key.first.hash_code() * 31 + t_key.second.hash_code();
+        }
+      };
+
+      /// (to, from) -> the conversion, direct or chained, to use for that pair
+      typedef std::unordered_map<Conversion_Key, std::shared_ptr<detail::Type_Conversion_Base>, Conversion_Key_Hash> Conversion_Table;
+
+      struct Table_Cache
+      {
+        std::shared_ptr<const Conversion_Table> table;
+        size_t generation = 0;
+      };
+
+      static Conversion_Key key(const Type_Info &to, const Type_Info &from)
+      {
+        return Conversion_Key(*to.bare_type_info(), *from.bare_type_info());
       }
 
-      std::set<std::shared_ptr<detail::Type_Conversion_Base> >::const_iterator find(
-          const Type_Info &to, const Type_Info &from) const
+      /// \returns this thread's copy of the current table, taking the lock only if a
+      ///          conversion was added since it was last fetched, and building the table
+      ///          if no other thread has since
+      const Conversion_Table &conversion_table() const
       {
-        return std::find_if(m_conversions.begin(), m_conversions.end(),
-              [&to, &from](const std::shared_ptr<detail::Type_Conversion_Base> &conversion)
-              {
-                return conversion->to().bare_equal(to) && conversion->from().bare_equal(from);
+        auto &cache = *m_table_cache;
+        if (cache.generation != m_table_generation)
+        {
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          if (!m_table) {
+            m_table = build_table(m_conversions);
+          }
+          cache.table = m_table;
+          cache.generation = m_table_generation;
+        }
+
+        return *cache.table;
+      }
+
+      /// Registered conversions answer for their own pair. Base class registrations are also
+      /// joined into chains, so that a class converts to every class above it in the hierarchy.
+      static std::shared_ptr<const Conversion_Table> build_table(const std::set<std::shared_ptr<detail::Type_Conversion_Base>> &t_conversions)
+      {
+        auto table = std::make_shared<Conversion_Table>();
+        std::unordered_map<std::type_index, std::vector<std::shared_ptr<const detail::Type_Conversion_Base>>> bases;
+
+        for (const auto &conversion : t_conversions)
+        {
+          table->emplace(key(conversion->to(), conversion->from()), conversion);
+          if (conversion->upcast()) {
+            bases[*conversion->from().bare_type_info()].push_back(conversion);
+          }
+        }
+
+        typedef std::vector<std::shared_ptr<const detail::Type_Conversion_Base>> Chain;
+
+        for (const auto &derived : bases)
+        {
+          // breadth first, so each base is reached by its shortest chain
+          std::unordered_set<std::type_index> visited{derived.first};
+          std::deque<Chain> pending;
+          for (const auto &step : derived.second) {
+            pending.push_back(Chain{step});
+          }
+
+          while (!pending.empty())
+          {
+            Chain chain = std::move(pending.front());
+            pending.pop_front();
+
+            const std::type_index reached(*chain.back()->to().bare_type_info());
+            if (!visited.insert(reached).second) {
+              continue;
+            }
+
+            if (chain.size() > 1) {
+              table->emplace(key(chain.back()->to(), chain.front()->from()),
+                  std::make_shared<detail::Chained_Conversion_Impl>(chain));
+            }
+
+            const auto next = bases.find(reached);
+            if (next != bases.end()) {
+              for (const auto &step : next->second) {
+                Chain longer(chain);
+                longer.push_back(step);
+                pending.push_back(std::move(longer));
               }
-        );
+            }
+          }
+        }
+
+        return table;
       }
 
       std::set<std::shared_ptr<detail::Type_Conversion_Base>> get_conversions() const
@@ -504,7 +683,11 @@ namespace chaiscript
       std::set<std::shared_ptr<detail::Type_Conversion_Base>> m_conversions;
       std::set<const std::type_info *, Less_Than> m_convertableTypes;
       std::atomic_size_t m_num_types;
+      mutable std::shared_ptr<const Conversion_Table> m_table;
+      std::atomic_size_t m_table_generation;
+      const Dispatch_Stats *m_dispatch_stats = nullptr;
       mutable chaiscript::detail::threading::Thread_Storage<std::set<const std::type_info *, Less_Than>> m_thread_cache;
+      mutable chaiscript::detail::threading::Thread_Storage<Table_Cache> m_table_cache;
       mutable chaiscript::detail::threading::Thread_Storage<Conversion_Saves> m_conversion_saves;
   };
 
@@ -0,0 +1,672 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_COLUMNS_HPP_
+#define CHAISCRIPT_COLUMNS_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../dispatchkit/boxed_number.hpp"
+#include "../dispatchkit/boxed_value.hpp"
+#include "../dispatchkit/dispatchkit.hpp"
+#include "chaiscript_algebraic.hpp"
+#include "chaiscript_common.hpp"
+
+namespace chaiscript
+{
+  namespace eval
+  {
+    namespace detail
+    {
+      /// Evaluates an expression over columns of inputs, see Compiled_Expression::eval_columns.
+      ///
+      /// Arithmetic and comparison operators on int, int64_t and double columns, comparisons of
+      /// string columns, and the logical operators on bool columns are carried out as loops over
+      /// whole columns, with Boxed_Number's rules for the result types, so that each value has the
+      /// type row by row evaluation would give it. Integer arithmetic that overflows in any row
+      /// throws exception::arithmetic_error. Any other subtree, a function call for instance, is
+      /// evaluated row by row with the row's values bound to the inputs, and what it returns is
+      /// gathered back into a column.
+      class Column_Evaluator
+      {
+        public:
+          /// t_ss must be evaluating in a stack whose first scope holds t_names, in order
+          Column_Evaluator(const chaiscript::detail::Dispatch_State &t_ss, const std::vector<std::string> &t_names,
+              const std::vector<Boxed_Value> &t_columns)
+            : m_ss(t_ss), m_names(t_names)
+          {
+            bool sized = false;
+            for (const auto &c : t_columns) {
+              m_inputs.push_back(input(c));
+              if (!m_inputs.back().scalar) {
+                if (sized && m_inputs.back().size != m_rows) {
+                  throw std::range_error("Column sizes do not match");
+                }
+                m_rows = m_inputs.back().size;
+                sized = true;
+              }
+            }
+          }
+
+          /// \returns a std::vector<int>, std::vector<std::int64_t>, std::vector<double>, std::vector<bool>,
+          /// std::vector<std::string>, or, for results of mixed or other types, std::vector<Boxed_Value>
+          Boxed_Value eval(const AST_Node &t_node)
+          {
+            return result(eval_node(t_node));
+          }
+
+        private:
+          struct Column
+          {
+            enum class Type { Int, Integer, Floating, Boolean, String, Boxed };
+
+            Column() = default;
+            Column(Column &&) = default;
+            Column &operator=(Column &&) = default;
+            Column(const Column &) = delete;
+            Column &operator=(const Column &) = delete;
+
+            explicit Column(std::vector<int> t_data) : type(Type::Int), size(t_data.size()), int_data(std::move(t_data)) { ints = int_data.data(); }
+            explicit Column(std::vector<std::int64_t> t_data) : type(Type::Integer), size(t_data.size()), integer_data(std::move(t_data)) { integers = integer_data.data(); }
+            explicit Column(std::vector<double> t_data) : type(Type::Floating), size(t_data.size()), float_data(std::move(t_data)) { floats = float_data.data(); }
+            explicit Column(std::vector<std::uint8_t> t_data) : type(Type::Boolean), size(t_data.size()), flag_data(std::move(t_data)) { flags = flag_data.data(); }
+            explicit Column(std::vector<std::string> t_data) : type(Type::String), size(t_data.size()), string_data(std::move(t_data)) { strings = string_data.data(); }
+            explicit Column(std::vector<Boxed_Value> t_data) : type(Type::Boxed), size(t_data.size()), boxed_data(std::move(t_data)) { boxed = boxed_data.data(); }
+
+            /// A column with the same values as this one, not owning them
+            Column view() const
+            {
+              Column c;
+              c.type = type;
+              c.scalar = scalar;
+              c.size = size;
+              c.ints = ints;
+              c.integers = integers;
+              c.floats = floats;
+              c.flags = flags;
+              c.strings = strings;
+              c.boxed = boxed;
+              c.original = original;
+              return c;
+            }
+
+            /// The value at t_row, boxed for the script
+            Boxed_Value get(const size_t t_row) const
+            {
+              if (scalar && !original.is_undef()) {
+                return original;
+              }
+
+              const auto i = scalar ? 0 : t_row;
+              switch (type) {
+                case Type::Int: return Boxed_Value(ints[i]);
+                case Type::Integer: return Boxed_Value(integers[i]);
+                case Type::Floating: return Boxed_Value(floats[i]);
+                case Type::Boolean: return Boxed_Value(flags[i] != 0);
+                case Type::String: return Boxed_Value(strings[i]);
+                case Type::Boxed: break;
+              }
+              return boxed[i];
+            }
+
+            Type type = Type::Boxed;
+            /// a single value, standing for every row
+            bool scalar = false;
+            size_t size = 0;
+
+            const int *ints = nullptr;
+            const std::int64_t *integers = nullptr;
+            const double *floats = nullptr;
+            const std::uint8_t *flags = nullptr;
+            const std::string *strings = nullptr;
+            const Boxed_Value *boxed = nullptr;
+
+            std::vector<int> int_data;
+            std::vector<std::int64_t> integer_data;
+            std::vector<double> float_data;
+            std::vector<std::uint8_t> flag_data;
+            std::vector<std::string> string_data;
+            std::vector<Boxed_Value> boxed_data;
+
+            /// for scalars, the value they were made from, which row evaluation binds unchanged
+            Boxed_Value original;
+          };
+
+          static const int *values(const Column &t_c, const int *) { return t_c.ints; }
+          static const std::int64_t *values(const Column &t_c, const std::int64_t *) { return t_c.integers; }
+          static const double *values(const Column &t_c, const double *) { return t_c.floats; }
+          static const std::string *values(const Column &t_c, const std::string *) { return t_c.strings; }
+
+          static Column input(const Boxed_Value &t_bv)
+          {
+            const auto &ti = t_bv.get_type_info();
+            Column c;
+
+            if (ti.bare_equal(user_type<std::vector<double>>())) {
+              const auto &v = boxed_cast<const std::vector<double> &>(t_bv);
+              c.type = Column::Type::Floating;
+              c.floats = v.data();
+              c.size = v.size();
+            } else if (ti.bare_equal(user_type<std::vector<int>>())) {
+              const auto &v = boxed_cast<const std::vector<int> &>(t_bv);
+              c.type = Column::Type::Int;
+              c.ints = v.data();
+              c.size = v.size();
+            } else if (ti.bare_equal(user_type<std::vector<std::int64_t>>())) {
+              const auto &v = boxed_cast<const std::vector<std::int64_t> &>(t_bv);
+              c.type = Column::Type::Integer;
+              c.integers = v.data();
+              c.size = v.size();
+            } else if (ti.bare_equal(user_type<std::vector<std::string>>())) {
+              const auto &v = boxed_cast<const std::vector<std::string> &>(t_bv);
+              c.type = Column::Type::String;
+              c.strings = v.data();
+              c.size = v.size();
+            } else if (ti.bare_equal(user_type<std::vector<Boxed_Value>>())) {
+              const auto &v = boxed_cast<const std::vector<Boxed_Value> &>(t_bv);
+              c.boxed = v.data();
+              c.size = v.size();
+            } else {
+              return scalar(t_bv);
+            }
+
+            return c;
+          }
+
+          /// A single value for every row; numbers of other types than these keep their own
+          /// promotion rules by staying boxed
+          static Column scalar(const Boxed_Value &t_bv)
+          {
+            const auto &ti = t_bv.get_type_info();
+            Column c;
+
+            if (ti.bare_equal(user_type<int>())) {
+              c = Column(std::vector<int>{boxed_cast<int>(t_bv)});
+            } else if (ti.bare_equal(user_type<std::int64_t>())) {
+              c = Column(std::vector<std::int64_t>{boxed_cast<std::int64_t>(t_bv)});
+            } else if (ti.bare_equal(user_type<double>())) {
+              c = Column(std::vector<double>{boxed_cast<double>(t_bv)});
+            } else if (ti.bare_equal(user_type<bool>())) {
+              c = Column(std::vector<std::uint8_t>{boxed_cast<bool>(t_bv) ? std::uint8_t(1) : std::uint8_t(0)});
+            } else if (ti.bare_equal(user_type<std::string>())) {
+              c = Column(std::vector<std::string>{boxed_cast<const std::string &>(t_bv)});
+            } else {
+              c = Column(std::vector<Boxed_Value>{t_bv});
+            }
+
+            c.scalar = true;
+            c.original = t_bv;
+            return c;
+          }
+
+          /// Gathers the results of row by row evaluation, typed if they all share one of the column types
+          static Column gather(std::vector<Boxed_Value> t_values)
+          {
+            if (t_values.empty()) {
+              return Column(std::move(t_values));
+            }
+
+            const auto all = [&](const Type_Info &t_ti) {
+              return std::all_of(t_values.begin(), t_values.end(), [&](const Boxed_Value &t_bv) { return t_bv.get_type_info().bare_equal(t_ti); });
+            };
+
+            if (all(user_type<double>())) {
+              std::vector<double> data;
+              data.reserve(t_values.size());
+              for (const auto &v : t_values) { data.push_back(boxed_cast<double>(v)); }
+              return Column(std::move(data));
+            } else if (all(user_type<int>())) {
+              std::vector<int> data;
+              data.reserve(t_values.size());
+              for (const auto &v : t_values) { data.push_back(boxed_cast<int>(v)); }
+              return Column(std::move(data));
+            } else if (all(user_type<std::int64_t>())) {
+              std::vector<std::int64_t> data;
+              data.reserve(t_values.size());
+              for (const auto &v : t_values) { data.push_back(boxed_cast<std::int64_t>(v)); }
+              return Column(std::move(data));
+            } else if (all(user_type<bool>())) {
+              std::vector<std::uint8_t> data;
+              data.reserve(t_values.size());
+              for (const auto &v : t_values) { data.push_back(boxed_cast<bool>(v) ? 1 : 0); }
+              return Column(std::move(data));
+            } else if (all(user_type<std::string>())) {
+              std::vector<std::string> data;
+              data.reserve(t_values.size());
+              for (const auto &v : t_values) { data.push_back(boxed_cast<const std::string &>(v)); }
+              return Column(std::move(data));
+            }
+
+            return Column(std::move(t_values));
+          }
+
+          Boxed_Value result(const Column &t_c) const
+          {
+            const auto index = [&](const size_t t_row) { return t_c.scalar ? 0 : t_row; };
+
+            switch (t_c.type) {
+              case Column::Type::Int: {
+                std::vector<int> out(m_rows);
+                for (size_t i = 0; i < m_rows; ++i) { out[i] = t_c.ints[index(i)]; }
+                return Boxed_Value(std::move(out));
+              }
+              case Column::Type::Integer: {
+                std::vector<std::int64_t> out(m_rows);
+                for (size_t i = 0; i < m_rows; ++i) { out[i] = t_c.integers[index(i)]; }
+                return Boxed_Value(std::move(out));
+              }
+              case Column::Type::Floating: {
+                std::vector<double> out(m_rows);
+                for (size_t i = 0; i < m_rows; ++i) { out[i] = t_c.floats[index(i)]; }
+                return Boxed_Value(std::move(out));
+              }
+              case Column::Type::Boolean: {
+                std::vector<bool> out(m_rows);
+                for (size_t i = 0; i < m_rows; ++i) { out[i] = t_c.flags[index(i)] != 0; }
+                return Boxed_Value(std::move(out));
+              }
+              case Column::Type::String: {
+                std::vector<std::string> out;
+                out.reserve(m_rows);
+                for (size_t i = 0; i < m_rows; ++i) { out.push_back(t_c.strings[index(i)]); }
+                return Boxed_Value(std::move(out));
+              }
+              case Column::Type::Boxed:
+                break;
+            }
+
+            std::vector<Boxed_Value> out;
+            out.reserve(m_rows);
+            for (size_t i = 0; i < m_rows; ++i) { out.push_back(t_c.get(i)); }
+            return Boxed_Value(std::move(out));
+          }
+
+          Column eval_node(const AST_Node &t_node)
+          {
+            const auto children = t_node.get_children();
+
+            switch (t_node.identifier) {
+              case AST_Node_Type::File:
+                if (children.size() == 1) {
+                  return eval_node(*children[0]);
+                }
+                break;
+              case AST_Node_Type::Id:
+                for (size_t i = 0; i < m_names.size(); ++i) {
+                  if (m_names[i] == t_node.text) {
+                    return m_inputs[i].view();
+                  }
+                }
+                // a global or a function, the same for every row
+                return scalar(t_node.eval(m_ss));
+              case AST_Node_Type::Constant:
+                return scalar(t_node.eval(m_ss));
+              case AST_Node_Type::Binary:
+                return binary(t_node, *children[0], *children[1]);
+              case AST_Node_Type::Prefix:
+                return prefix(t_node, *children[0]);
+              case AST_Node_Type::Logical_And:
+              case AST_Node_Type::Logical_Or:
+                // evaluating the right hand side for every row is only safe if it has no side effects
+                // and cannot throw
+                if (is_pure(*children[0]) && is_pure(*children[1])) {
+                  return logical(t_node, *children[0], *children[1]);
+                }
+                break;
+              default:
+                break;
+            }
+
+            return rows(t_node);
+          }
+
+          /// True if t_node is evaluated a column at a time all the way down
+          bool is_pure(const AST_Node &t_node) const
+          {
+            switch (t_node.identifier) {
+              case AST_Node_Type::Id:
+              case AST_Node_Type::Constant:
+                return true;
+              case AST_Node_Type::Binary:
+                // a row the other side of && or || rules out, such as x == 0 in x != 0 && 10 / x > 1,
+                // must not make the whole column throw
+                if (can_throw(Operators::to_operator(t_node.text))) {
+                  return false;
+                }
+                for (const auto &c : t_node.get_children()) {
+                  if (!is_pure(*c)) {
+                    return false;
+                  }
+                }
+                return true;
+              case AST_Node_Type::Prefix:
+              case AST_Node_Type::Logical_And:
+              case AST_Node_Type::Logical_Or:
+                for (const auto &c : t_node.get_children()) {
+                  if (!is_pure(*c)) {
+                    return false;
+                  }
+                }
+                return true;
+              default:
+                return false;
+            }
+          }
+
+          static bool can_throw(const Operators::Opers t_oper)
+          {
+            return t_oper == Operators::Opers::quotient || t_oper == Operators::Opers::remainder;
+          }
+
+          /// Evaluates t_node once per row
+          Column rows(const AST_Node &t_node)
+          {
+            std::vector<Boxed_Value> values;
+            values.reserve(m_rows);
+
+            for (size_t row = 0; row < m_rows; ++row) {
+              auto &scope = m_ss.stack_holder().stacks.back().front();
+              for (size_t i = 0; i < m_inputs.size(); ++i) {
+                scope[i].second = m_inputs[i].get(row);
+              }
+
+              // declarations made by one row must not be seen by the next
+              Scope_Push_Pop spp(m_ss);
+              try {
+                values.push_back(t_node.eval(m_ss));
+              } catch (Return_Value &rv) {
+                values.push_back(std::move(rv.retval));
+              }
+            }
+
+            return gather(std::move(values));
+          }
+
+          /// Applies t_op to every row of two columns, either of which may be a scalar
+          template<typename R, typename A, typename B, typename Op>
+            Column apply(const Column &t_lhs, const Column &t_rhs, Op t_op) const
+            {
+              const A *a = values(t_lhs, static_cast<const A *>(nullptr));
+              const B *b = values(t_rhs, static_cast<const B *>(nullptr));
+              const bool scalar = t_lhs.scalar && t_rhs.scalar;
+              std::vector<R> out(scalar ? 1 : m_rows);
+
+              if (scalar) {
+                out[0] = static_cast<R>(t_op(a[0], b[0]));
+              } else if (t_lhs.scalar) {
+                const A lhs = a[0];
+                for (size_t i = 0; i < out.size(); ++i) { out[i] = static_cast<R>(t_op(lhs, b[i])); }
+              } else if (t_rhs.scalar) {
+                const B rhs = b[0];
+                for (size_t i = 0; i < out.size(); ++i) { out[i] = static_cast<R>(t_op(a[i], rhs)); }
+              } else {
+                for (size_t i = 0; i < out.size(); ++i) { out[i] = static_cast<R>(t_op(a[i], b[i])); }
+              }
+
+              Column c(std::move(out));
+              c.scalar = scalar;
+              return c;
+            }
+
+          template<typename T>
+            Column compare(const Operators::Opers t_oper, const Column &t_lhs, const Column &t_rhs, bool &t_done) const
+            {
+              t_done = true;
+              switch (t_oper) {
+                case Operators::Opers::equals: return apply<std::uint8_t, T, T>(t_lhs, t_rhs, std::equal_to<T>());
+                case Operators::Opers::not_equal: return apply<std::uint8_t, T, T>(t_lhs, t_rhs, std::not_equal_to<T>());
+                case Operators::Opers::less_than: return apply<std::uint8_t, T, T>(t_lhs, t_rhs, std::less<T>());
+                case Operators::Opers::less_than_equal: return apply<std::uint8_t, T, T>(t_lhs, t_rhs, std::less_equal<T>());
+                case Operators::Opers::greater_than: return apply<std::uint8_t, T, T>(t_lhs, t_rhs, std::greater<T>());
+                case Operators::Opers::greater_than_equal: return apply<std::uint8_t, T, T>(t_lhs, t_rhs, std::greater_equal<T>());
+                default:
+                  t_done = false;
+                  return Column();
+              }
+            }
+
+          /// Applies t_op to every row, or for integers t_checked, which reports a row that overflows
+          template<typename T, typename Checked, typename Op>
+            Column calculate(const Column &t_lhs, const Column &t_rhs, const Checked &t_checked, Op, std::true_type) const
+            {
+              bool overflow = false;
+              auto c = apply<T, T, T>(t_lhs, t_rhs, [&overflow, &t_checked](const T t_l, const T t_r) {
+                    T out = 0;
+                    overflow |= t_checked(t_l, t_r, out);
+                    return out;
+                  });
+              if (overflow) {
+                throw chaiscript::exception::arithmetic_error("integer overflow");
+              }
+              return c;
+            }
+
+          template<typename T, typename Checked, typename Op>
+            Column calculate(const Column &t_lhs, const Column &t_rhs, const Checked &, Op t_op, std::false_type) const
+            {
+              return apply<T, T, T>(t_lhs, t_rhs, t_op);
+            }
+
+          template<typename T>
+            Column arithmetic(const Operators::Opers t_oper, const Column &t_lhs, const Column &t_rhs, bool &t_done) const
+            {
+              using chaiscript::detail::Checked_Arithmetic;
+              const auto integral = std::is_integral<T>{};
+
+              t_done = true;
+              switch (t_oper) {
+                case Operators::Opers::sum:
+                  return calculate<T>(t_lhs, t_rhs, [](const auto t_l, const auto t_r, auto &t_out) { return Checked_Arithmetic::sum(t_l, t_r, t_out); },
+                      std::plus<T>(), integral);
+                case Operators::Opers::difference:
+                  return calculate<T>(t_lhs, t_rhs, [](const auto t_l, const auto t_r, auto &t_out) { return Checked_Arithmetic::difference(t_l, t_r, t_out); },
+                      std::minus<T>(), integral);
+                case Operators::Opers::product:
+                  return calculate<T>(t_lhs, t_rhs, [](const auto t_l, const auto t_r, auto &t_out) { return Checked_Arithmetic::product(t_l, t_r, t_out); },
+                      std::multiplies<T>(), integral);
+                case Operators::Opers::quotient:
+                  check_divisor<T>(t_rhs);
+                  return calculate<T>(t_lhs, t_rhs, [](const auto t_l, const auto t_r, auto &t_out) { return Checked_Arithmetic::quotient(t_l, t_r, t_out); },
+                      std::divides<T>(), integral);
+                case Operators::Opers::remainder:
+                  if (std::is_integral<T>::value) {
+                    check_divisor<T>(t_rhs);
+                    return calculate<T>(t_lhs, t_rhs, [](const auto t_l, const auto t_r, auto &t_out) { return Checked_Arithmetic::remainder(t_l, t_r, t_out); },
+                        std::divides<T>(), integral);
+                  }
+                  break;
+                default:
+                  break;
+              }
+              return compare<T>(t_oper, t_lhs, t_rhs, t_done);
+            }
+
+          template<typename T>
+            void check_divisor(const Column &t_divisor) const
+            {
+#ifndef CHAISCRIPT_NO_PROTECT_DIVIDEBYZERO
+              if (std::is_integral<T>::value) {
+                const T *d = values(t_divisor, static_cast<const T *>(nullptr));
+                if (std::find(d, d + (t_divisor.scalar ? 1 : m_rows), T(0)) != d + (t_divisor.scalar ? 1 : m_rows)) {
+                  throw chaiscript::exception::arithmetic_error("divide by zero");
+                }
+              }
+#else
+              (void)t_divisor;
+#endif
+            }
+
+          Column to_floating(const Column &t_c) const
+          {
+            if (t_c.type == Column::Type::Floating) {
+              return t_c.view();
+            }
+
+            std::vector<double> out(t_c.scalar ? 1 : m_rows);
+            if (t_c.type == Column::Type::Int) {
+              for (size_t i = 0; i < out.size(); ++i) { out[i] = static_cast<double>(t_c.ints[i]); }
+            } else {
+              for (size_t i = 0; i < out.size(); ++i) { out[i] = static_cast<double>(t_c.integers[i]); }
+            }
+            Column c(std::move(out));
+            c.scalar = t_c.scalar;
+            return c;
+          }
+
+          Column to_int64(const Column &t_c) const
+          {
+            if (t_c.type == Column::Type::Integer) {
+              return t_c.view();
+            }
+
+            std::vector<std::int64_t> out(t_c.scalar ? 1 : m_rows);
+            for (size_t i = 0; i < out.size(); ++i) { out[i] = t_c.ints[i]; }
+            Column c(std::move(out));
+            c.scalar = t_c.scalar;
+            return c;
+          }
+
+          Column binary(const AST_Node &t_node, const AST_Node &t_lhs, const AST_Node &t_rhs)
+          {
+            const auto oper = Operators::to_operator(t_node.text);
+            const Column lhs = eval_node(t_lhs);
+            const Column rhs = eval_node(t_rhs);
+
+            const auto integral = [](const Column &t_c) {
+              return t_c.type == Column::Type::Int || t_c.type == Column::Type::Integer;
+            };
+            const auto numeric = [&integral](const Column &t_c) {
+              return integral(t_c) || t_c.type == Column::Type::Floating;
+            };
+
+            bool done = false;
+            Column result;
+            if (lhs.type == Column::Type::Int && rhs.type == Column::Type::Int) {
+              result = arithmetic<int>(oper, lhs, rhs, done);
+            } else if (integral(lhs) && integral(rhs)) {
+              result = arithmetic<std::int64_t>(oper, to_int64(lhs), to_int64(rhs), done);
+            } else if (numeric(lhs) && numeric(rhs)) {
+              result = arithmetic<double>(oper, to_floating(lhs), to_floating(rhs), done);
+            } else if (lhs.type == Column::Type::String && rhs.type == Column::Type::String) {
+              result = compare<std::string>(oper, lhs, rhs, done);
+            }
+
+            if (done) {
+              return result;
+            }
+
+            // as Binary_Operator_AST_Node would for each row
+            const chaiscript::detail::Function_Name name(t_node.text);
+            std::vector<Boxed_Value> values;
+            values.reserve(m_rows);
+            for (size_t row = 0; row < m_rows; ++row) {
+              const auto l = lhs.get(row);
+              const auto r = rhs.get(row);
+              try {
+                if (oper != Operators::Opers::invalid && l.get_type_info().is_arithmetic() && r.get_type_info().is_arithmetic()) {
+                  values.push_back(Boxed_Number::do_oper(oper, l, r));
+                } else {
+                  Function_Push_Pop fpp(m_ss);
+                  fpp.save_params({l, r});
+                  values.push_back(m_ss->call_function(name, {l, r}, m_ss.conversions()));
+                }
+              } catch (const exception::dispatch_error &e) {
+                throw exception::eval_error("Can not find appropriate '" + t_node.text + "' operator.", e.parameters, e.functions, false, *m_ss);
+              }
+            }
+            return gather(std::move(values));
+          }
+
+          Column prefix(const AST_Node &t_node, const AST_Node &t_operand)
+          {
+            const auto oper = Operators::to_operator(t_node.text, true);
+            const Column operand = eval_node(t_operand);
+
+            bool done = false;
+            if (oper == Operators::Opers::unary_minus && operand.type == Column::Type::Int) {
+              return arithmetic<int>(Operators::Opers::difference, scalar(Boxed_Value(0)), operand, done);
+            } else if (oper == Operators::Opers::unary_minus && operand.type == Column::Type::Integer) {
+              return arithmetic<std::int64_t>(Operators::Opers::difference, scalar(Boxed_Value(std::int64_t(0))), operand, done);
+            } else if (oper == Operators::Opers::unary_minus && operand.type == Column::Type::Floating) {
+              return apply<double, double, double>(scalar(Boxed_Value(0.0)), operand, std::minus<double>());
+            } else if (t_node.text == "!" && operand.type == Column::Type::Boolean) {
+              std::vector<std::uint8_t> out(operand.scalar ? 1 : m_rows);
+              for (size_t i = 0; i < out.size(); ++i) { out[i] = static_cast<std::uint8_t>(operand.flags[i] ^ 1); }
+              Column c(std::move(out));
+              c.scalar = operand.scalar;
+              return c;
+            }
+
+            // as Prefix_AST_Node would for each row
+            const chaiscript::detail::Function_Name name(t_node.text);
+            std::vector<Boxed_Value> values;
+            values.reserve(m_rows);
+            for (size_t row = 0; row < m_rows; ++row) {
+              const auto v = operand.get(row);
+              try {
+                if (oper != Operators::Opers::invalid && oper != Operators::Opers::bitwise_and && v.get_type_info().is_arithmetic()) {
+                  values.push_back(Boxed_Number::do_oper(oper, v));
+                } else {
+                  Function_Push_Pop fpp(m_ss);
+                  fpp.save_params({v});
+                  values.push_back(m_ss->call_function(name, {v}, m_ss.conversions()));
+                }
+              } catch (const exception::dispatch_error &e) {
+                throw exception::eval_error("Error with prefix operator evaluation: '" + t_node.text + "'", e.parameters, e.functions, false, *m_ss);
+              }
+            }
+            return gather(std::move(values));
+          }
+
+          Column logical(const AST_Node &t_node, const AST_Node &t_lhs, const AST_Node &t_rhs)
+          {
+            const bool is_and = t_node.identifier == AST_Node_Type::Logical_And;
+            const Column lhs = eval_node(t_lhs);
+            const Column rhs = eval_node(t_rhs);
+
+            if (lhs.type == Column::Type::Boolean && rhs.type == Column::Type::Boolean) {
+              const std::uint8_t *a = lhs.flags;
+              const std::uint8_t *b = rhs.flags;
+              const bool scalar = lhs.scalar && rhs.scalar;
+              std::vector<std::uint8_t> out(scalar ? 1 : m_rows);
+              for (size_t i = 0; i < out.size(); ++i) {
+                const auto l = a[lhs.scalar ? 0 : i];
+                const auto r = b[rhs.scalar ? 0 : i];
+                out[i] = static_cast<std::uint8_t>(is_and ? (l & r) : (l | r));
+              }
+              Column c(std::move(out));
+              c.scalar = scalar;
+              return c;
+            }
+
+            std::vector<std::uint8_t> out(m_rows);
+            for (size_t row = 0; row < m_rows; ++row) {
+              const bool l = AST_Node::get_bool_condition(lhs.get(row), m_ss);
+              out[row] = (is_and ? (l && AST_Node::get_bool_condition(rhs.get(row), m_ss))
+                                 : (l || AST_Node::get_bool_condition(rhs.get(row), m_ss))) ? 1 : 0;
+            }
+            return Column(std::move(out));
+          }
+
+          const chaiscript::detail::Dispatch_State &m_ss;
+          const std::vector<std::string> &m_names;
+          std::vector<Column> m_inputs;
+          size_t m_rows = 1;
+      };
+    }
+  }
+}
+
+#endif
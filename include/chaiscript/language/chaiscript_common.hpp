@@ -20,6 +20,7 @@
 
 #include "../chaiscript_defines.hpp"
 #include "../dispatchkit/boxed_value.hpp"
+#include "../dispatchkit/continuation.hpp"
 #include "../dispatchkit/dispatchkit.hpp"
 #include "../dispatchkit/proxy_functions.hpp"
 #include "../dispatchkit/type_info.hpp"
@@ -66,7 +67,7 @@ namespace chaiscript
     Array_Call, Dot_Access,
     Lambda, Block, Scopeless_Block, Def, While, If, For, Ranged_For, Inline_Array, Inline_Map, Return, File, Prefix, Break, Continue, Map_Pair, Value_Range,
     Inline_Range, Try, Catch, Finally, Method, Attr_Decl,  
-    Logical_And, Logical_Or, Reference, Switch, Case, Default, Noop, Class, Binary, Arg, Global_Decl, Constant, Compiled
+    Logical_And, Logical_Or, Reference, Switch, Case, Default, Noop, Class, Binary, Arg, Global_Decl, Constant, Compiled, Yield
   };
 
   enum class Operator_Precidence { Ternary_Cond, Logical_Or, 
@@ -81,7 +82,7 @@ namespace chaiscript
                                     "Array_Call", "Dot_Access", 
                                     "Lambda", "Block", "Scopeless_Block", "Def", "While", "If", "For", "Ranged_For", "Inline_Array", "Inline_Map", "Return", "File", "Prefix", "Break", "Continue", "Map_Pair", "Value_Range",
                                     "Inline_Range", "Try", "Catch", "Finally", "Method", "Attr_Decl",
-                                    "Logical_And", "Logical_Or", "Reference", "Switch", "Case", "Default", "Noop", "Class", "Binary", "Arg", "Global_Decl", "Constant", "Compiled"};
+                                    "Logical_And", "Logical_Or", "Reference", "Switch", "Case", "Default", "Noop", "Class", "Binary", "Arg", "Global_Decl", "Constant", "Compiled", "Yield"};
 
       return ast_node_types[static_cast<int>(ast_node_type)];
     }
@@ -525,6 +526,8 @@ namespace chaiscript
 
       virtual std::vector<AST_NodePtr> get_children() const = 0;
       virtual Boxed_Value eval(const chaiscript::detail::Dispatch_State &t_e) const = 0;
+      /// Runs this node as a script on t_engine a step at a time, for a Continuation
+      virtual Continuation::Step steps(chaiscript::detail::Dispatch_Engine &t_engine) const = 0;
 
 
       /// Prints the contents of an AST node, including its children, recursively
@@ -675,6 +678,49 @@ namespace chaiscript
           const chaiscript::detail::Dispatch_State &m_ds;
       };
 
+      /// Keeps a frame for a script call on the engine's profiler while it is started
+      struct Profile_Push_Pop
+      {
+        Profile_Push_Pop(const Profile_Push_Pop &) = delete;
+        Profile_Push_Pop& operator=(const Profile_Push_Pop &) = delete;
+
+        Profile_Push_Pop(const chaiscript::detail::Dispatch_State &t_ds, const std::string &t_name, const Parse_Location &t_loc)
+          : m_profiler(t_ds->profiler().enabled() ? &t_ds->profiler() : nullptr)
+        {
+          if (m_profiler) {
+            m_profiler->enter(t_name, *t_loc.filename, t_loc.start.line);
+          }
+        }
+
+        ~Profile_Push_Pop()
+        {
+          if (m_profiler) {
+            m_profiler->leave();
+          }
+        }
+
+        private:
+          Profiler *m_profiler;
+      };
+
+      /// Counts the work of resolving a call against its call site while the engine's dispatch statistics are enabled
+      struct Dispatch_Site
+      {
+        Dispatch_Site(const Dispatch_Site &) = delete;
+        Dispatch_Site& operator=(const Dispatch_Site &) = delete;
+
+        Dispatch_Site(const chaiscript::detail::Dispatch_State &t_ds, const void *t_node, const char *t_kind,
+            const std::string &t_name, const Parse_Location &t_loc)
+          : m_guard(t_ds->dispatch_stats().enabled()
+              ? t_ds->dispatch_stats().site(t_node, t_kind, t_name, *t_loc.filename, t_loc.start.line, t_loc.start.column)
+              : nullptr, &t_ds->dispatch_stats())
+        {
+        }
+
+        private:
+          Dispatch_Stats::Site_Guard m_guard;
+      };
+
       /// Creates a new scope then pops it on destruction
       struct Stack_Push_Pop
       {
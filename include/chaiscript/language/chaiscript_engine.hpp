@@ -11,6 +11,7 @@
 #ifndef CHAISCRIPT_ENGINE_HPP_
 #define CHAISCRIPT_ENGINE_HPP_
 
+#include <algorithm>
 #include <cassert>
 #include <exception>
 #include <fstream>
@@ -26,11 +27,17 @@
 #include "../chaiscript_defines.hpp"
 #include "../chaiscript_threading.hpp"
 #include "../dispatchkit/boxed_cast_helper.hpp"
+#include "../dispatchkit/boxed_number.hpp"
 #include "../dispatchkit/boxed_value.hpp"
+#include "../dispatchkit/continuation.hpp"
 #include "../dispatchkit/dispatchkit.hpp"
+#include "../dispatchkit/function_handle.hpp"
+#include "../dispatchkit/lazy_range.hpp"
 #include "../dispatchkit/type_conversions.hpp"
 #include "../dispatchkit/proxy_functions.hpp"
+#include "../utility/thread_pool.hpp"
 #include "chaiscript_common.hpp"
+#include "chaiscript_columns.hpp"
 
 #if defined(__linux__) || defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
 #include <unistd.h>
@@ -62,6 +69,101 @@ namespace chaiscript
   }
 
 
+  /// \brief An expression parsed once by ChaiScript_Basic::compile, to be evaluated many times
+  ///
+  /// The inputs named at compile time are given positionally on each evaluation. They are placed
+  /// in the single scope of a fresh stack, in declaration order, so every evaluation has the same
+  /// stack shape and each identifier's cached location (see Dispatch_Engine::get_object) resolves
+  /// it without a search. The expression sees the engine's globals and functions, but not the
+  /// caller's locals.
+  ///
+  /// \warning A Compiled_Expression refers to the engine that compiled it and must not outlive it
+  class Compiled_Expression
+  {
+    public:
+      Compiled_Expression(chaiscript::detail::Dispatch_Engine &t_engine, AST_NodePtr t_ast, std::vector<std::string> t_inputs)
+        : m_engine(t_engine), m_ast(std::move(t_ast)), m_inputs(std::move(t_inputs))
+      {
+      }
+
+      /// \returns the result of the expression with t_args bound to the inputs, in order
+      /// \throw exception::arity_error if the number of arguments does not match the inputs
+      /// \throw exception::eval_error if evaluation fails
+      Boxed_Value operator()(const std::vector<Boxed_Value> &t_args) const
+      {
+        if (t_args.size() != m_inputs.size()) {
+          throw exception::arity_error(static_cast<int>(t_args.size()), static_cast<int>(m_inputs.size()));
+        }
+
+        chaiscript::detail::Dispatch_State state(m_engine.get());
+        eval::detail::Stack_Push_Pop spp(state);
+
+        auto &scope = state.stack_holder().stacks.back().back();
+        scope.reserve(m_inputs.size());
+        for (size_t i = 0; i < m_inputs.size(); ++i) {
+          scope.emplace_back(m_inputs[i], t_args[i]);
+        }
+
+        try {
+          return m_ast->eval(state);
+        } catch (eval::detail::Return_Value &rv) {
+          return rv.retval;
+        }
+      }
+
+      /// \brief Evaluates the expression for every row of t_columns at once
+      ///
+      /// Each argument is a column, a std::vector<int>, std::vector<std::int64_t>, std::vector<double>,
+      /// std::vector<std::string> or std::vector<Boxed_Value>, with one value per row; any other
+      /// argument is used for every row. Operators over the numeric, string and bool columns run
+      /// a column at a time, and other parts of the expression, such as function calls, run row by
+      /// row (see eval::detail::Column_Evaluator). Each result has the type evaluating its row
+      /// alone would give it.
+      ///
+      /// \returns the result column: a std::vector<int>, std::vector<std::int64_t>, std::vector<double>,
+      ///          std::vector<bool>, std::vector<std::string>, or std::vector<Boxed_Value> for anything else
+      /// \throw exception::arity_error if the number of arguments does not match the inputs
+      /// \throw exception::arithmetic_error if integer arithmetic divides by zero or overflows in any row
+      /// \throw std::range_error if the columns are not all the same size
+      Boxed_Value eval_columns(const std::vector<Boxed_Value> &t_columns) const
+      {
+        if (t_columns.size() != m_inputs.size()) {
+          throw exception::arity_error(static_cast<int>(t_columns.size()), static_cast<int>(m_inputs.size()));
+        }
+
+        chaiscript::detail::Dispatch_State state(m_engine.get());
+        eval::detail::Stack_Push_Pop spp(state);
+
+        auto &scope = state.stack_holder().stacks.back().back();
+        scope.reserve(m_inputs.size());
+        for (const auto &name : m_inputs) {
+          scope.emplace_back(name, Boxed_Value());
+        }
+
+        eval::detail::Column_Evaluator evaluator(state, m_inputs, t_columns);
+        return evaluator.eval(*m_ast);
+      }
+
+      /// \returns the result of the expression, converted to T
+      template<typename T>
+        T eval(const std::vector<Boxed_Value> &t_args) const
+        {
+          return m_engine.get().boxed_cast<T>((*this)(t_args));
+        }
+
+      const std::vector<std::string> &inputs() const
+      {
+        return m_inputs;
+      }
+
+    private:
+      std::reference_wrapper<chaiscript::detail::Dispatch_Engine> m_engine;
+      AST_NodePtr m_ast;
+      std::vector<std::string> m_inputs;
+  };
+
+
+
   /// \brief The main object that the ChaiScript user will use.
   class ChaiScript_Basic {
 
@@ -78,11 +180,255 @@ namespace chaiscript
     std::unique_ptr<parser::ChaiScript_Parser_Base> m_parser;
 
     chaiscript::detail::Dispatch_Engine m_engine;
+    /// m_engine for the lazy ranges it makes to hold weakly; it owns nothing
+    const std::shared_ptr<chaiscript::detail::Dispatch_Engine> m_lazy_engine{&m_engine, [](chaiscript::detail::Dispatch_Engine *){}};
+
+#ifndef CHAISCRIPT_NO_THREADS
+    /// Tasks queued by eval_async() and the script async() that have not finished yet
+    size_t m_async_pending = 0;
+    std::mutex m_async_mutex;
+    std::condition_variable m_async_done;
+
+    /// Runs t_func on the shared executor, counted against the limits of the evaluation queueing it
+    /// if any. The engine is kept alive until it finishes.
+    template<typename Func>
+    std::future<Boxed_Value> queue_async(Func t_func)
+    {
+      {
+        std::lock_guard<std::mutex> l(m_async_mutex);
+        ++m_async_pending;
+      }
+
+      return utility::Thread_Pool::shared().submit([this, t_func, budget = Eval_Limits::shared_budget()]() -> Boxed_Value {
+            Eval_Limits::Scope limits_scope(budget);
+            const auto finished = [this]() {
+              std::lock_guard<std::mutex> l(m_async_mutex);
+              if (--m_async_pending == 0) {
+                m_async_done.notify_all();
+              }
+            };
+
+            try {
+              auto result = run_async(t_func);
+              finished();
+              return result;
+            } catch (...) {
+              finished();
+              throw;
+            }
+          });
+    }
+
+    /// Runs t_func in a stack of its own, so that the locals and saved parameters it leaves are
+    /// released when it finishes rather than kept by the worker thread, possibly past the engine
+    template<typename Func>
+    Boxed_Value run_async(const Func &t_func)
+    {
+      const chaiscript::detail::Dispatch_State state(m_engine);
+      eval::detail::Stack_Push_Pop ssp(state);
+      eval::detail::Scope_Push_Pop spp(state);
+      return t_func();
+    }
+
+    void wait_for_async()
+    {
+      auto &pool = utility::Thread_Pool::shared();
+      if (pool.current_worker() != pool.size()) {
+        // destroyed from inside a pooled task, which must not block the worker outright
+        pool.wait_until([this]() {
+              std::lock_guard<std::mutex> l(m_async_mutex);
+              return m_async_pending == 0;
+            });
+        return;
+      }
+
+      std::unique_lock<std::mutex> l(m_async_mutex);
+      m_async_done.wait(l, [this]() { return m_async_pending == 0; });
+    }
+#endif
+
+    /// Number of ranges parallel_ranges() splits t_size elements into
+    static size_t parallel_chunks(const size_t t_size)
+    {
+#ifndef CHAISCRIPT_NO_THREADS
+      // several ranges per thread, so that uneven callbacks still balance out
+      return std::min(t_size, (utility::Thread_Pool::shared().size() + 1) * 4);
+#else
+      return std::min(t_size, size_t(1));
+#endif
+    }
+
+    /// Calls t_func(chunk, begin, end, state) for t_num_chunks consecutive ranges covering
+    /// [0, t_size). The first range runs on the calling thread, the others on the shared executor,
+    /// each with a Dispatch_State for that thread's own stack and conversion state, and all counted against the limits
+    /// of the calling evaluation. Once every range has finished, the first exception thrown by any of them is rethrown.
+    template<typename Func>
+    void parallel_ranges(const size_t t_size, const size_t t_num_chunks, const Func &t_func)
+    {
+      const auto budget = Eval_Limits::shared_budget();
+      const auto begin = [&](const size_t t_chunk) { return t_size * t_chunk / t_num_chunks; };
+      const auto run = [&](const size_t t_chunk) {
+        Eval_Limits::Scope limits_scope(budget);
+        const chaiscript::detail::Dispatch_State state(m_engine);
+        t_func(t_chunk, begin(t_chunk), begin(t_chunk + 1), state);
+      };
+
+      if (t_num_chunks == 0) {
+        return;
+      }
+
+#ifndef CHAISCRIPT_NO_THREADS
+      auto &pool = utility::Thread_Pool::shared();
+      std::vector<std::future<void>> results;
+      results.reserve(t_num_chunks - 1);
+      for (size_t chunk = 1; chunk < t_num_chunks; ++chunk) {
+        results.push_back(pool.submit([&run, chunk]() { run(chunk); }));
+      }
+
+      std::exception_ptr error;
+      try {
+        run(0);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      for (auto &result : results) {
+        try {
+          pool.wait(result);
+        } catch (...) {
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+      }
+
+      if (error) {
+        std::rethrow_exception(error);
+      }
+#else
+      for (size_t chunk = 0; chunk < t_num_chunks; ++chunk) {
+        run(chunk);
+      }
+#endif
+    }
+
+    /// \returns the elements of t_container, which is either a Vector or provides size() and [].
+    ///          A Vector is returned directly, anything else is gathered into t_storage.
+    const std::vector<Boxed_Value> &parallel_input(const Boxed_Value &t_container, std::vector<Boxed_Value> &t_storage)
+    {
+      if (t_container.get_type_info().bare_equal(user_type<std::vector<Boxed_Value>>())) {
+        return chaiscript::boxed_cast<const std::vector<Boxed_Value> &>(t_container);
+      }
+
+      static const chaiscript::detail::Function_Name size_name("size");
+      static const chaiscript::detail::Function_Name index_name("[]");
+
+      Type_Conversions_State s(m_engine.conversions(), m_engine.conversions().conversion_saves());
+      const auto size = Boxed_Number(m_engine.call_function(size_name, {t_container}, s)).get_as<size_t>();
+      t_storage.reserve(size);
+      for (size_t i = 0; i < size; ++i) {
+        t_storage.push_back(m_engine.call_function(index_name, {t_container, const_var(i)}, s));
+      }
+      return t_storage;
+    }
+
+  public:
+    /// Calls t_func with t_params in a scope of its own, for native code that calls a script function
+    /// many times from a single builtin. Without the scope, the parameters and conversions saved for
+    /// every call would pile up in the enclosing call until the builtin itself returns.
+    static Boxed_Value scoped_call(const chaiscript::detail::Dispatch_State &t_state,
+        const dispatch::Proxy_Function_Base &t_func, const std::vector<Boxed_Value> &t_params)
+    {
+      eval::detail::Scope_Push_Pop spp(t_state);
+      return t_func(t_params, t_state.conversions());
+    }
+
+    /// Wraps t_func as a native callback that goes through scoped_call()
+    template<typename ... Param>
+    std::function<void (Param...)> scoped_callback(Const_Proxy_Function t_func)
+    {
+      return [this, t_func](Param ... t_param) {
+        scoped_call(chaiscript::detail::Dispatch_State(m_engine), *t_func, {Boxed_Value(t_param)...});
+      };
+    }
+
+  private:
+    /// scoped_call() for parallel_map and friends. If t_copy_result is set the result is kept the way
+    /// push_back keeps values: a returned temporary as is, anything else cloned.
+    static Boxed_Value parallel_call(const chaiscript::detail::Dispatch_State &t_state,
+        const dispatch::Proxy_Function_Base &t_func, const std::vector<Boxed_Value> &t_params, const bool t_copy_result)
+    {
+      static const chaiscript::detail::Function_Name clone_name("clone");
+
+      auto result = scoped_call(t_state, t_func, t_params);
+
+      if (!t_copy_result || result.is_undef()) {
+        return result;
+      } else if (result.is_return_value()) {
+        result.reset_return_value();
+        return result;
+      } else {
+        return t_state->call_function(clone_name, {result}, t_state.conversions());
+      }
+    }
+
+    /// \returns the engine t_engine refers to
+    /// \throws std::runtime_error if it is gone, for a Lazy_Range read after the engine that made it
+    static chaiscript::detail::Dispatch_Engine &lazy_engine(const std::weak_ptr<chaiscript::detail::Dispatch_Engine> &t_engine)
+    {
+      const auto engine = t_engine.lock();
+      if (!engine) {
+        throw std::runtime_error("Lazy range read after its engine was destroyed");
+      }
+      return *engine;
+    }
+
+    /// \returns t_range if it is a Lazy_Range, else a Lazy_Range reading range(t_range) with empty, front and pop_front
+    static Lazy_Range lazy_range(const std::weak_ptr<chaiscript::detail::Dispatch_Engine> &t_engine, const Boxed_Value &t_range)
+    {
+      if (t_range.get_type_info().bare_equal(user_type<Lazy_Range>())) {
+        return chaiscript::boxed_cast<const Lazy_Range &>(t_range);
+      }
+
+      static const chaiscript::detail::Function_Name range("range");
+      static const chaiscript::detail::Function_Name empty("empty");
+      static const chaiscript::detail::Function_Name front("front");
+      static const chaiscript::detail::Function_Name pop_front("pop_front");
+
+      const auto call = [t_engine](const chaiscript::detail::Function_Name &t_name, const Boxed_Value &t_param) {
+        const chaiscript::detail::Dispatch_State state(lazy_engine(t_engine));
+        eval::detail::Scope_Push_Pop spp(state);
+        return state->call_function(t_name, {t_param}, state.conversions());
+      };
+
+      const auto range_obj = call(range, t_range);
+      // the range can point into t_range, so that is kept alive with it
+      return Lazy_Range(
+          [call, t_range, range_obj](){ return chaiscript::boxed_cast<bool>(call(empty, range_obj)); },
+          [call, range_obj](){ return call(front, range_obj); },
+          [call, range_obj](){ call(pop_front, range_obj); });
+    }
+
+    static Lazy_Range::Transform lazy_transform(const std::weak_ptr<chaiscript::detail::Dispatch_Engine> &t_engine, Const_Proxy_Function t_func)
+    {
+      return [t_engine, t_func](const Boxed_Value &t_value) {
+        return scoped_call(chaiscript::detail::Dispatch_State(lazy_engine(t_engine)), *t_func, {t_value});
+      };
+    }
+
+    static Lazy_Range::Predicate lazy_predicate(const std::weak_ptr<chaiscript::detail::Dispatch_Engine> &t_engine, Const_Proxy_Function t_func)
+    {
+      const auto transform = lazy_transform(t_engine, std::move(t_func));
+      return [transform](const Boxed_Value &t_value) {
+        return chaiscript::boxed_cast<bool>(transform(t_value));
+      };
+    }
 
     /// Evaluates the given string in by parsing it and running the results through the evaluator
     Boxed_Value do_eval(const std::string &t_input, const std::string &t_filename = "__EVAL__", bool /* t_internal*/  = false) 
     {
       try {
+        Allocation_Stats::Scope scope(m_engine.allocation_stats());
         const auto p = m_parser->parse(t_input, t_filename);
         return p->eval(chaiscript::detail::Dispatch_State(m_engine));
       }
@@ -160,6 +506,14 @@ namespace chaiscript
 
       m_engine.add(fun([this](const Type_Info &t_ti){ return m_engine.get_type_name(t_ti); }), "name");
 
+      m_engine.add(fun([this](){ return m_engine.dispatch_stats().report(); }), "dispatch_stats");
+      m_engine.add(fun([this](const bool t_enabled){ m_engine.dispatch_stats().enable(t_enabled); }), "enable_dispatch_stats");
+      m_engine.add(fun([this](){ m_engine.dispatch_stats().reset(); }), "reset_dispatch_stats");
+
+      m_engine.add(fun([this](){ return m_engine.allocation_stats().report([this](const Type_Info &t_ti) { return m_engine.get_type_name(t_ti); }); }), "allocation_stats");
+      m_engine.add(fun([this](const bool t_enabled){ m_engine.allocation_stats().enable(t_enabled); }), "enable_allocation_stats");
+      m_engine.add(fun([this](){ m_engine.allocation_stats().reset(); }), "reset_allocation_stats");
+
       m_engine.add(fun([this](const std::string &t_type_name, bool t_throw){ return m_engine.get_type(t_type_name, t_throw); }), "type");
       m_engine.add(fun([this](const std::string &t_type_name){ return m_engine.get_type(t_type_name, true); }), "type");
 
@@ -185,6 +539,92 @@ namespace chaiscript
         m_engine.add(fun([this](const std::string &t_file){ return internal_eval_file(t_file); }), "eval_file");
       }
 
+#ifndef CHAISCRIPT_NO_THREADS
+      // the shared executor is created before this engine is, so that it is destroyed after an engine
+      // with static storage duration, whose destructor waits for its asynchronous tasks
+      utility::Thread_Pool::shared();
+      m_engine.add(fun([this](const std::function<chaiscript::Boxed_Value ()> &t_func){ return queue_async(t_func); }), "async");
+#endif
+
+      m_engine.add(fun(
+            [this](const Boxed_Value &t_container, const dispatch::Proxy_Function_Base &t_func) {
+              std::vector<Boxed_Value> storage;
+              const auto &elements = parallel_input(t_container, storage);
+              std::vector<Boxed_Value> results(elements.size());
+              parallel_ranges(elements.size(), parallel_chunks(elements.size()),
+                  [&](size_t, const size_t t_begin, const size_t t_end, const chaiscript::detail::Dispatch_State &t_state) {
+                    for (auto i = t_begin; i < t_end; ++i) {
+                      results[i] = parallel_call(t_state, t_func, {elements[i]}, true);
+                    }
+                  });
+              return results;
+            }), "parallel_map");
+
+      m_engine.add(fun(
+            [this](const Boxed_Value &t_container, const dispatch::Proxy_Function_Base &t_func) {
+              std::vector<Boxed_Value> storage;
+              const auto &elements = parallel_input(t_container, storage);
+              parallel_ranges(elements.size(), parallel_chunks(elements.size()),
+                  [&](size_t, const size_t t_begin, const size_t t_end, const chaiscript::detail::Dispatch_State &t_state) {
+                    for (auto i = t_begin; i < t_end; ++i) {
+                      parallel_call(t_state, t_func, {elements[i]}, false);
+                    }
+                  });
+            }), "parallel_for_each");
+
+      // each range is folded on its own, then the partial results are folded into t_initial, so
+      // t_func must be associative and commutative. It is called as foldl calls it: func(element, accumulated)
+      m_engine.add(fun(
+            [this](const Boxed_Value &t_container, const dispatch::Proxy_Function_Base &t_func, const Boxed_Value &t_initial) {
+              std::vector<Boxed_Value> storage;
+              const auto &elements = parallel_input(t_container, storage);
+              std::vector<Boxed_Value> partials(parallel_chunks(elements.size()));
+              parallel_ranges(elements.size(), partials.size(),
+                  [&](const size_t t_chunk, const size_t t_begin, const size_t t_end, const chaiscript::detail::Dispatch_State &t_state) {
+                    auto accumulated = elements[t_begin];
+                    for (auto i = t_begin + 1; i < t_end; ++i) {
+                      accumulated = parallel_call(t_state, t_func, {elements[i], accumulated}, true);
+                    }
+                    partials[t_chunk] = std::move(accumulated);
+                  });
+
+              const chaiscript::detail::Dispatch_State state(m_engine);
+              auto accumulated = t_initial;
+              for (const auto &partial : partials) {
+                accumulated = parallel_call(state, t_func, {partial, accumulated}, true);
+              }
+              return accumulated;
+            }), "parallel_reduce");
+
+      // lazy adapters live here rather than with Lazy_Range in the standard library because they call back
+      // into the engine. The ranges they make can outlive it, so they hold it weakly.
+      const std::weak_ptr<chaiscript::detail::Dispatch_Engine> engine = m_lazy_engine;
+      m_engine.add(fun([engine](const Boxed_Value &t_range){ return lazy_range(engine, t_range); }), "lazy");
+      m_engine.add(fun(
+            [engine](const Boxed_Value &t_range, const Const_Proxy_Function &t_func) {
+              return Lazy_Range::map(lazy_range(engine, t_range), lazy_transform(engine, t_func));
+            }), "lazy_map");
+      m_engine.add(fun(
+            [engine](const Boxed_Value &t_range, const Const_Proxy_Function &t_func) {
+              return Lazy_Range::filter(lazy_range(engine, t_range), lazy_predicate(engine, t_func));
+            }), "lazy_filter");
+      m_engine.add(fun(
+            [engine](const Boxed_Value &t_range, const size_t t_count) {
+              return Lazy_Range::take(lazy_range(engine, t_range), t_count);
+            }), "lazy_take");
+      m_engine.add(fun(
+            [engine](const Boxed_Value &t_range, const Const_Proxy_Function &t_func) {
+              return Lazy_Range::take_while(lazy_range(engine, t_range), lazy_predicate(engine, t_func));
+            }), "lazy_take_while");
+      m_engine.add(fun(
+            [engine](const Boxed_Value &t_range, const size_t t_count) {
+              return Lazy_Range::drop(lazy_range(engine, t_range), t_count);
+            }), "lazy_drop");
+      m_engine.add(fun(
+            [engine](const Boxed_Value &t_range, const Const_Proxy_Function &t_func) {
+              return Lazy_Range::drop_while(lazy_range(engine, t_range), lazy_predicate(engine, t_func));
+            }), "lazy_drop_while");
+
       m_engine.add(fun([this](const std::string &t_str){ return internal_eval(t_str); }), "eval");
       m_engine.add(fun([this](const AST_NodePtr &t_ast){ return eval(t_ast); }), "eval");
 
@@ -221,32 +661,11 @@ namespace chaiscript
       }
     }
 
-    std::vector<std::string> ensure_minimum_path_vec(std::vector<std::string> paths)
-    {
-      if (paths.empty()) { return {""}; }
-      else { return paths; }
-    }
-
-  public:
-
-    /// \brief Constructor for ChaiScript
-    /// \param[in] t_lib Standard library to apply to this ChaiScript instance
-    /// \param[in] t_modulepaths Vector of paths to search when attempting to load a binary module
-    /// \param[in] t_usepaths Vector of paths to search when attempting to "use" an included ChaiScript file
-    ChaiScript_Basic(const ModulePtr &t_lib,
-                     std::unique_ptr<parser::ChaiScript_Parser_Base> &&parser,
-                     std::vector<std::string> t_module_paths = {},
-                     std::vector<std::string> t_use_paths = {},
-                     const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options())
-      : m_module_paths(ensure_minimum_path_vec(std::move(t_module_paths))),
-        m_use_paths(ensure_minimum_path_vec(std::move(t_use_paths))),
-        m_parser(std::move(parser)),
-        m_engine(*m_parser)
+    /// If on Unix, add the path of the current executable to the module search path
+    /// as windows would do
+    void prepend_executable_module_path()
     {
 #if !defined(CHAISCRIPT_NO_DYNLOAD) && defined(_POSIX_VERSION) && !defined(__CYGWIN__)
-      // If on Unix, add the path of the current executable to the module search path
-      // as windows would do
-
       union cast_union
       {
         Boxed_Value (ChaiScript_Basic::*in_ptr)(const std::string&);
@@ -276,9 +695,182 @@ namespace chaiscript
         m_module_paths.insert(m_module_paths.begin(), dllpath+"/");
       }
 #endif
+    }
+
+    std::vector<std::string> ensure_minimum_path_vec(std::vector<std::string> paths)
+    {
+      if (paths.empty()) { return {""}; }
+      else { return paths; }
+    }
+
+  public:
+
+    /// \brief A reusable image of a fully bootstrapped engine
+    ///
+    /// Holds the function, type and global tables that result from applying a library Module,
+    /// the Module's type conversions and the pre-parsed scripts (such as the prelude) that the
+    /// Module evaluates. Constructing a ChaiScript_Basic from a Boot_Snapshot copies the tables,
+    /// whose per-name overload lists are shared until modified, instead of re-registering and
+    /// re-sorting every function and re-parsing the prelude.
+    ///
+    /// Scripts that only define functions, as the prelude does, are evaluated once when the
+    /// snapshot is built, and each new engine binds the script functions to itself (see
+    /// Proxy_Function_Base::rebind); other scripts are kept in evals and evaluated again by each
+    /// new engine. A Boot_Snapshot is immutable once built and may be shared by any number of
+    /// threads. It must be used with the parser type it was built with.
+    ///
+    /// \sa ChaiScript_Basic::build_boot_snapshot
+    struct Boot_Snapshot
+    {
+      chaiscript::detail::Dispatch_Engine::State engine_state;
+      std::vector<Type_Conversion> conversions;
+      std::vector<AST_NodePtr> evals;
+    };
+
+  private:
+    /// Stands in for both the evaluator and the engine while a Module is applied
+    /// by build_boot_snapshot, recording what cannot be captured in the engine state
+    struct Boot_Snapshot_Builder
+    {
+      Boot_Snapshot_Builder(chaiscript::detail::Dispatch_Engine &t_engine, parser::ChaiScript_Parser_Base &t_parser, Boot_Snapshot &t_snapshot)
+        : m_engine(t_engine), m_parser(t_parser), m_snapshot(t_snapshot)
+      {
+      }
+
+      template<typename T>
+      void add(const T &t_t, const std::string &t_name)
+      {
+        m_engine.add(t_t, t_name);
+      }
+
+      void add(const Type_Conversion &d)
+      {
+        m_snapshot.conversions.push_back(d);
+      }
+
+      void add_global_const(const Boxed_Value &t_bv, const std::string &t_name)
+      {
+        m_engine.add_global_const(t_bv, t_name);
+      }
+
+      void eval(const std::string &t_input)
+      {
+        Allocation_Stats::Scope scope(m_engine.allocation_stats());
+        m_snapshot.evals.push_back(m_parser.parse(t_input, "__EVAL__"));
+      }
+
+      chaiscript::detail::Dispatch_Engine &m_engine;
+      parser::ChaiScript_Parser_Base &m_parser;
+      Boot_Snapshot &m_snapshot;
+    };
+
+    /// Builds the evaluator from a snapshot rather than a library Module
+    void build_eval_system(const Boot_Snapshot &t_snapshot, const std::vector<Options> &t_opts) {
+      m_engine.set_state(t_snapshot.engine_state);
+      m_engine.rebind_functions();
+
+      for (const auto &conversion : t_snapshot.conversions)
+      {
+        m_engine.add(conversion);
+      }
+
+      build_eval_system(ModulePtr(), t_opts);
+
+      for (const auto &ast : t_snapshot.evals)
+      {
+        try {
+          ast->eval(chaiscript::detail::Dispatch_State(m_engine));
+        } catch (chaiscript::eval::detail::Return_Value &) {
+          // top level return from a module script, nothing to do
+        }
+      }
+    }
+
+  public:
+
+    /// \brief Applies t_lib to a scratch engine and captures the result as a Boot_Snapshot
+    /// \param[in] t_lib Standard library to capture
+    /// \param[in] t_parser Parser used for the scripts t_lib evaluates. Engines constructed from the
+    ///                     snapshot must use the same parser type.
+    ///
+    /// \b Example:
+    /// \code
+    /// static const auto snapshot = chaiscript::ChaiScript_Basic::build_boot_snapshot(create_chaiscript_stdlib(), parser);
+    /// chaiscript::ChaiScript_Basic chai(snapshot, create_chaiscript_parser());
+    /// \endcode
+    static Boot_Snapshot build_boot_snapshot(const ModulePtr &t_lib, parser::ChaiScript_Parser_Base &t_parser)
+    {
+      Boot_Snapshot snapshot;
+      chaiscript::detail::Dispatch_Engine engine(t_parser);
+      Boot_Snapshot_Builder builder(engine, t_parser, snapshot);
+      t_lib->apply(builder, builder);
+      snapshot.engine_state = engine.get_state();
+
+      // the scripts are evaluated here once, unless they do more than define functions and
+      // types, which each engine does instead with all of its own functions at hand
+      chaiscript::detail::Dispatch_Engine evaluated(t_parser);
+      evaluated.set_state(snapshot.engine_state);
+      for (const auto &conversion : snapshot.conversions)
+      {
+        evaluated.add(conversion);
+      }
+
+      try {
+        for (const auto &ast : snapshot.evals)
+        {
+          ast->eval(chaiscript::detail::Dispatch_State(evaluated));
+        }
+      } catch (const std::exception &) {
+        return snapshot;
+      } catch (const chaiscript::eval::detail::Return_Value &) {
+        return snapshot;
+      }
+
+      auto state = evaluated.get_state();
+      if (state.m_global_objects.size() == snapshot.engine_state.m_global_objects.size()) {
+        // the functions defined are bound to evaluated, and are rebound by each engine
+        snapshot.engine_state = std::move(state);
+        snapshot.evals.clear();
+      }
+      return snapshot;
+    }
+
+    /// \brief Constructor for ChaiScript
+    /// \param[in] t_lib Standard library to apply to this ChaiScript instance
+    /// \param[in] t_modulepaths Vector of paths to search when attempting to load a binary module
+    /// \param[in] t_usepaths Vector of paths to search when attempting to "use" an included ChaiScript file
+    ChaiScript_Basic(const ModulePtr &t_lib,
+                     std::unique_ptr<parser::ChaiScript_Parser_Base> &&parser,
+                     std::vector<std::string> t_module_paths = {},
+                     std::vector<std::string> t_use_paths = {},
+                     const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options())
+      : m_module_paths(ensure_minimum_path_vec(std::move(t_module_paths))),
+        m_use_paths(ensure_minimum_path_vec(std::move(t_use_paths))),
+        m_parser(std::move(parser)),
+        m_engine(*m_parser)
+    {
+      prepend_executable_module_path();
       build_eval_system(t_lib, t_opts);
     }
 
+    /// \brief Constructor for ChaiScript from a previously built Boot_Snapshot
+    /// \param[in] t_snapshot Bootstrapped state to start from, see build_boot_snapshot
+    /// \param[in] t_modulepaths Vector of paths to search when attempting to load a binary module
+    /// \param[in] t_usepaths Vector of paths to search when attempting to "use" an included ChaiScript file
+    ChaiScript_Basic(const Boot_Snapshot &t_snapshot,
+                     std::unique_ptr<parser::ChaiScript_Parser_Base> &&parser,
+                     std::vector<std::string> t_module_paths = {},
+                     std::vector<std::string> t_use_paths = {},
+                     const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options())
+      : m_module_paths(ensure_minimum_path_vec(std::move(t_module_paths))),
+        m_use_paths(ensure_minimum_path_vec(std::move(t_use_paths))),
+        m_parser(std::move(parser)),
+        m_engine(*m_parser)
+    {
+      prepend_executable_module_path();
+      build_eval_system(t_snapshot, t_opts);
+    }
+
 #ifndef CHAISCRIPT_NO_DYNLOAD
     /// \brief Constructor for ChaiScript.
     /// 
@@ -291,7 +883,7 @@ namespace chaiscript
                      std::vector<std::string> t_module_paths = {},
                      std::vector<std::string> t_use_paths = {},
                      const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options())
-      : ChaiScript_Basic({}, std::move(parser), t_module_paths, t_use_paths, t_opts)
+      : ChaiScript_Basic(ModulePtr(), std::move(parser), t_module_paths, t_use_paths, t_opts)
     {
       try {
         // attempt to load the stdlib
@@ -316,6 +908,13 @@ explicit ChaiScript_Basic(std::unique_ptr<parser::ChaiScript_Parser_Base> &&pars
                           const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options()) = delete;
 #endif
 
+#ifndef CHAISCRIPT_NO_THREADS
+    ~ChaiScript_Basic()
+    {
+      wait_for_async();
+    }
+#endif
+
     parser::ChaiScript_Parser_Base &get_parser()
     {
       return *m_parser;
@@ -330,8 +929,130 @@ explicit ChaiScript_Basic(std::unique_ptr<parser::ChaiScript_Parser_Base> &&pars
       }
     }
 
+    /// \brief Parses t_expression once, for evaluation against different inputs
+    ///
+    /// \param[in] t_expression Script to compile
+    /// \param[in] t_inputs Names the script uses for the values given to each evaluation, in order
+    /// \return a handle evaluating the script with positional arguments, without parsing it again
+    ///
+    /// \b Example:
+    /// \code
+    /// auto price = chai.compile("base * (1.0 - discount)", {"base", "discount"});
+    /// double p = price.eval<double>({chaiscript::const_var(100.0), chaiscript::const_var(0.25)});
+    /// \endcode
+    ///
+    /// \throw exception::eval_error if the expression does not parse
+    /// \throw exception::reserved_word_error if an input is named by a reserved word
+    /// \throw exception::name_conflict_error if an input is named twice
+    Compiled_Expression compile(const std::string &t_expression, std::vector<std::string> t_inputs, const std::string &t_filename = "__EVAL__")
+    {
+      for (auto itr = t_inputs.begin(); itr != t_inputs.end(); ++itr) {
+        Name_Validator::validate_object_name(*itr);
+        if (std::find(t_inputs.begin(), itr, *itr) != itr) {
+          throw exception::name_conflict_error(*itr);
+        }
+      }
+
+      Allocation_Stats::Scope scope(m_engine.allocation_stats());
+      return Compiled_Expression(m_engine, m_parser->parse(t_expression, t_filename), std::move(t_inputs));
+    }
+
+    /// \brief Creates a handle calling the script function t_name with a fixed C++ signature
+    ///
+    /// Unlike eval<std::function<Signature>>(t_name), the handle picks the overload to call once
+    /// and reuses that choice until another function is added.
+    ///
+    /// \b Example:
+    /// \code
+    /// chai.eval("def scale(x, y) { x * y }");
+    /// auto scale = chai.function_handle<double (double, double)>("scale");
+    /// double d = scale(2.0, 1.5);
+    /// \endcode
+    template<typename Signature>
+    Function_Handle<Signature> function_handle(const std::string &t_name)
+    {
+      return Function_Handle<Signature>(m_engine, t_name);
+    }
+
+    /// \brief Creates a handle calling the function object t_func, such as a lambda returned by eval
+    /// \throw exception::bad_boxed_cast if t_func is not a function
+    template<typename Signature>
+    Function_Handle<Signature> function_handle(const Boxed_Value &t_func)
+    {
+      return Function_Handle<Signature>(m_engine, m_engine.boxed_cast<Const_Proxy_Function>(t_func));
+    }
+
+    /// \brief The sampling profiler of this engine, which can be started and stopped at any time
+    ///
+    /// \b Example:
+    /// \code
+    /// chai.profiler().start(std::chrono::microseconds(500));
+    /// chai.eval_file("game.chai");
+    /// chai.profiler().stop();
+    /// std::ofstream("game.folded") << chai.profiler().folded();
+    /// \endcode
+    Profiler &profiler()
+    {
+      return m_engine.profiler();
+    }
+
+    /// \brief Per call site counts of overloads tried, exceptions thrown while matching, missed
+    ///        name lookup hints, argument conversions and guard calls, disabled until enabled
+    ///
+    /// Scripts can read and control the same statistics with dispatch_stats(), enable_dispatch_stats(bool)
+    /// and reset_dispatch_stats().
+    ///
+    /// \b Example:
+    /// \code
+    /// chai.dispatch_stats().enable();
+    /// chai.eval_file("game.chai");
+    /// std::cout << chai.dispatch_stats().report();
+    /// \endcode
+    Dispatch_Stats &dispatch_stats()
+    {
+      return m_engine.dispatch_stats();
+    }
+
+    /// \brief Live, peak and total counts and bytes of the values, objects, parse tree nodes and
+    ///        functions made on behalf of this engine, by type, disabled until enabled
+    ///
+    /// Scripts can read and control the same statistics with allocation_stats(), enable_allocation_stats(bool)
+    /// and reset_allocation_stats().
+    ///
+    /// \b Example:
+    /// \code
+    /// chai.allocation_stats().enable();
+    /// chai.eval_file("tenant.chai");
+    /// std::cout << chai.allocation_stats().report([&](const chaiscript::Type_Info &t) { return chai.get_type_name(t); });
+    /// \endcode
+    Allocation_Stats &allocation_stats()
+    {
+      return m_engine.allocation_stats();
+    }
+
+    /// \brief Limits on the loop iterations and function calls, time and memory of evaluations by this engine
+    ///
+    /// An evaluation over a limit throws exception::eval_limit_error from the loop iteration or
+    /// function call that went over it. The limits are not visible to scripts.
+    ///
+    /// \b Example:
+    /// \code
+    /// chai.limits().set_max_time(std::chrono::milliseconds(50));
+    /// chai.limits().set_max_memory(16 * 1024 * 1024);
+    /// try {
+    ///   chai.eval(tenant_script);
+    /// } catch (const chaiscript::exception::eval_limit_error &e) {
+    ///   std::cerr << "tenant script stopped: " << e.what() << '\n';
+    /// }
+    /// \endcode
+    Eval_Limits &limits()
+    {
+      return m_engine.limits();
+    }
+
     AST_NodePtr parse(const std::string &t_input, const bool t_debug_print = false)
     {
+      Allocation_Stats::Scope scope(m_engine.allocation_stats());
       const auto ast = m_parser->parse(t_input, "PARSE");
       if (t_debug_print) {
         m_parser->debug_print(ast);
@@ -691,6 +1412,41 @@ explicit ChaiScript_Basic(std::unique_ptr<parser::ChaiScript_Parser_Base> &&pars
       return eval(load_file(t_filename), t_handler, t_filename);
     }
 
+    /// \brief Starts evaluating a string a slice at a time, for the host to resume when it chooses.
+    ///
+    /// \param[in] t_input Script to execute
+    /// \param[in] t_slice_steps Loop iterations and function calls the evaluation takes per resume, 0 for no such limit
+    /// \param[in] t_slice_time Time the evaluation takes per resume, 0 for no such limit
+    /// \param[in] t_filename Optional filename to report to the user for where the error occurred
+    ///
+    /// \return the evaluation, which does not run until resumed; its result() is the result of the script.
+    ///         It runs on whichever thread resumes it, and must not outlive this engine.
+    ///
+    /// \b Example:
+    /// \code
+    /// auto batch = chai.start(batch_script, 10000);
+    /// while (!batch->resume()) {
+    ///   serve_pending_requests();
+    /// }
+    /// chaiscript::Boxed_Value result = batch->result();
+    /// \endcode
+    ///
+    /// \sa Continuation
+    std::unique_ptr<Continuation> start(const std::string &t_input, const std::uint64_t t_slice_steps,
+        const std::chrono::microseconds t_slice_time = std::chrono::microseconds(0), const std::string &t_filename="__EVAL__")
+    {
+      Continuation::Step steps;
+      return std::make_unique<Continuation>(m_engine.limits(),
+          [this, t_input, t_filename, steps](const std::function<bool ()> &t_slice_over, Boxed_Value &t_result) mutable {
+            if (!steps) {
+              Allocation_Stats::Scope scope(m_engine.allocation_stats());
+              steps = m_parser->parse(t_input, t_filename)->steps(m_engine);
+            }
+            return steps(t_slice_over, t_result);
+          },
+          t_slice_steps, t_slice_time);
+    }
+
     /// \brief Loads the file specified by filename, evaluates it, and returns the type safe result.
     /// \tparam T Type to extract from the result value of the script execution
     /// \param[in] t_filename File to load and parse.
@@ -703,6 +1459,45 @@ explicit ChaiScript_Basic(std::unique_ptr<parser::ChaiScript_Parser_Base> &&pars
     T eval_file(const std::string &t_filename, const Exception_Handler &t_handler = Exception_Handler()) {
       return m_engine.boxed_cast<T>(eval_file(t_filename, t_handler));
     }
+
+#ifndef CHAISCRIPT_NO_THREADS
+    /// \brief Evaluates a string on a thread of the shared executor, utility::Thread_Pool::shared().
+    ///
+    /// The script runs as if eval() had been called from that thread, so it sees the engine's globals
+    /// and functions but not the locals of the calling thread. The engine waits for outstanding
+    /// asynchronous evaluations when it is destroyed.
+    ///
+    /// \param[in] t_input Script to execute
+    /// \param[in] t_filename Optional filename to report to the user for where the error occurred
+    /// \return a future holding the result of the script execution, or the exception it threw
+    std::future<Boxed_Value> eval_async(std::string t_input, std::string t_filename = "__EVAL__")
+    {
+      return queue_async([this, input = std::move(t_input), filename = std::move(t_filename)]() {
+            return eval(input, Exception_Handler(), filename);
+          });
+    }
+
+    /// \brief Loads and evaluates the file specified by filename on a thread of the shared executor
+    /// \sa eval_async
+    std::future<Boxed_Value> eval_file_async(std::string t_filename)
+    {
+      return queue_async([this, filename = std::move(t_filename)]() {
+            return eval_file(filename);
+          });
+    }
+#endif
+
+    /// \brief Calls the function named t_name, choosing the overload exactly as a script call would
+    /// \param[in] t_name Name of the function to call
+    /// \param[in] t_params Parameters to pass to the function
+    /// \return result of the call
+    /// \throw chaiscript::exception::dispatch_error If no function named t_name accepts t_params
+    Boxed_Value call_function(const std::string &t_name, const std::vector<Boxed_Value> &t_params)
+    {
+      const chaiscript::detail::Function_Name name(t_name);
+      Type_Conversions_State s(m_engine.conversions(), m_engine.conversions().conversion_saves());
+      return m_engine.call_function(name, t_params, s);
+    }
   };
 
 }
@@ -17,8 +17,10 @@
 #include <map>
 #include <memory>
 #include <ostream>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "../chaiscript_defines.hpp"
@@ -27,6 +29,7 @@
 #include "../dispatchkit/boxed_value.hpp"
 #include "../dispatchkit/dispatchkit.hpp"
 #include "../dispatchkit/dynamic_object_detail.hpp"
+#include "../dispatchkit/lazy_range.hpp"
 #include "../dispatchkit/proxy_functions.hpp"
 #include "../dispatchkit/proxy_functions_detail.hpp"
 #include "../dispatchkit/register_function.hpp"
@@ -46,9 +49,20 @@ namespace chaiscript
   namespace eval
   {
     template<typename T> struct AST_Node_Impl;
+    template<typename T> struct Compiled_AST_Node;
 
     template<typename T> using AST_Node_Impl_Ptr = typename std::shared_ptr<AST_Node_Impl<T>>;
 
+    /// Makes a parse tree node, counted by the allocation statistics of the engine parsing it if they are enabled
+    template<typename B, typename D, typename ... Arg>
+      std::shared_ptr<B> make_ast_node(Arg && ... arg)
+      {
+        if (auto *stats = Allocation_Stats::active()) {
+          return stats->make_shared<D>(Allocation_Stats::Kind::node, user_type<D>(), std::forward<Arg>(arg)...);
+        }
+        return chaiscript::make_shared<B, D>(std::forward<Arg>(arg)...);
+      }
+
     namespace detail
     {
       /// Helper function that will set up the scope around a function call, including handling the named function parameters
@@ -67,7 +81,11 @@ namespace chaiscript
           }
         }();
 
+        Eval_Limits::step();
         chaiscript::eval::detail::Stack_Push_Pop tpp(state);
+        if (t_ss.profiler().enabled()) { t_ss.profiler().define(*t_node->location.filename, t_node->location.start.line); }
+        // the body counts against its own call sites, not the one that called it
+        Dispatch_Stats::Site_Guard no_site(nullptr);
         if (thisobj && !has_this_capture) { state.add_object("this", *thisobj); }
 
         if (t_locals) {
@@ -88,6 +106,271 @@ namespace chaiscript
           return std::move(rv.retval);
         } 
       }
+
+      /// Same as eval_function, called once for each of t_count parameter lists. The function scope
+      /// is set up by the first call and kept for the others, which only replace the parameter values.
+      template<typename T>
+      static void eval_function_batch(chaiscript::detail::Dispatch_Engine &t_ss, const AST_Node_Impl_Ptr<T> &t_node, const std::vector<std::string> &t_param_names,
+          const size_t t_count, const dispatch::Proxy_Function_Base::Batch_Arguments &t_args, const dispatch::Proxy_Function_Base::Batch_Results &t_results,
+          const std::map<std::string, Boxed_Value> *t_locals=nullptr, bool has_this_capture = false) {
+        chaiscript::detail::Dispatch_State state(t_ss);
+
+        const Boxed_Value *caller_this = [&]() -> const Boxed_Value *{
+          auto &stack = t_ss.get_stack_data(state.stack_holder()).back();
+          if (!stack.empty() && stack.back().first == "__this") {
+            return &stack.back().second;
+          } else {
+            return nullptr;
+          }
+        }();
+
+        chaiscript::eval::detail::Stack_Push_Pop tpp(state);
+        if (t_ss.profiler().enabled()) { t_ss.profiler().define(*t_node->location.filename, t_node->location.start.line); }
+        // the body counts against its own call sites, not the one that called it
+        Dispatch_Stats::Site_Guard no_site(nullptr);
+
+        std::vector<Boxed_Value> vals;
+        vals.reserve(t_param_names.size());
+        size_t this_slot = 0;
+        std::vector<std::pair<size_t, size_t>> param_slots; // (position in the scope, parameter index)
+        size_t scope_size = 0;
+
+        for (size_t call = 0; call < t_count; ++call) {
+          Eval_Limits::step();
+          vals.clear();
+          t_args(call, vals);
+          const Boxed_Value *thisobj = caller_this ? caller_this : (vals.empty() ? nullptr : &vals[0]);
+          // looked up on each call, scopes pushed by the previous call may have moved it
+          auto &scope = t_ss.get_stack_data(state.stack_holder()).back();
+
+          if (call == 0) {
+            if (thisobj && !has_this_capture) {
+              this_slot = scope.size();
+              state.add_object("this", *thisobj);
+            }
+
+            if (t_locals) {
+              for (const auto &local : *t_locals) {
+                state.add_object(local.first, local.second);
+              }
+            }
+
+            for (size_t i = 0; i < t_param_names.size(); ++i) {
+              if (t_param_names[i] != "this") {
+                param_slots.emplace_back(scope.size(), i);
+                state.add_object(t_param_names[i], vals[i]);
+              }
+            }
+            scope_size = scope.size();
+          } else {
+            scope.erase(scope.begin() + static_cast<std::ptrdiff_t>(scope_size), scope.end());
+
+            if (thisobj && !has_this_capture) {
+              scope[this_slot].second = *thisobj;
+            }
+
+            for (const auto &slot : param_slots) {
+              scope[slot.first].second = vals[slot.second];
+            }
+          }
+
+          try {
+            t_results(call, t_node->eval(state));
+          } catch (detail::Return_Value &rv) {
+            t_results(call, rv.retval);
+          }
+        }
+      }
+
+      /// The nodes of a body that a Stepped_Body steps into rather than evaluating whole
+      template<typename T>
+        using Step_Path = std::set<const AST_Node_Impl<T> *>;
+
+      template<typename T> class Generator_Call;
+      template<typename T> class Stepped_Body;
+
+      /// The callable of a script defined function or lambda
+      template<typename T>
+      struct Script_Function
+      {
+        Boxed_Value operator()(const std::vector<Boxed_Value> &t_params) const
+        {
+          if (generator) {
+            // the body runs as the values are read, see Generator_Call
+            auto call = std::make_shared<Generator_Call<T>>(*this, t_params);
+            return Boxed_Value(Lazy_Range::generator([call](Boxed_Value &t_value) { return call->next(t_value); }));
+          }
+          return eval_function(engine, node, param_names, t_params, &captures, this_capture);
+        }
+
+        void call_batch(const size_t t_count, const dispatch::Proxy_Function_Base::Batch_Arguments &t_args,
+            const dispatch::Proxy_Function_Base::Batch_Results &t_results) const
+        {
+          if (generator) {
+            std::vector<Boxed_Value> params;
+            for (size_t call = 0; call < t_count; ++call) {
+              params.clear();
+              t_args(call, params);
+              t_results(call, (*this)(params));
+            }
+            return;
+          }
+          eval_function_batch(engine, node, param_names, t_count, t_args, t_results, &captures, this_capture);
+        }
+
+        /// \returns this function bound to t_engine instead, see Proxy_Function_Base::rebind
+        Script_Function rebind(chaiscript::detail::Dispatch_Engine &t_engine) const
+        {
+          auto f = *this;
+          f.engine = t_engine;
+          return f;
+        }
+
+        std::reference_wrapper<chaiscript::detail::Dispatch_Engine> engine;
+        AST_Node_Impl_Ptr<T> node;
+        std::vector<std::string> param_names;
+        std::map<std::string, Boxed_Value> captures;
+        bool this_capture;
+        /// set if the body yields, so a call returns a Lazy_Range of what it yields
+        std::shared_ptr<const Step_Path<T>> generator;
+      };
+
+      template<typename T>
+      static bool is_function(const AST_Node_Impl<T> &t_node)
+      {
+        return t_node.identifier == AST_Node_Type::Def
+            || t_node.identifier == AST_Node_Type::Lambda
+            || t_node.identifier == AST_Node_Type::Method
+            || t_node.identifier == AST_Node_Type::Class;
+      }
+
+      /// \returns true if t_node is the body of a generator function: it has a yield that is not in a nested function
+      template<typename T>
+      static bool has_yield(const AST_Node_Impl<T> &t_node)
+      {
+        if (t_node.identifier == AST_Node_Type::Yield) {
+          return true;
+        }
+
+        return std::any_of(t_node.children.begin(), t_node.children.end(),
+            [](const AST_Node_Impl_Ptr<T> &t_child) {
+              return !is_function(*t_child) && has_yield(*t_child);
+            });
+      }
+
+      /// \returns true if a Stepped_Body can stop inside child t_child of t_node and carry on from there
+      template<typename T>
+      static bool resumable(const AST_Node_Impl<T> &t_node, const size_t t_child)
+      {
+        switch (t_node.identifier) {
+          case AST_Node_Type::File:
+          case AST_Node_Type::Block:
+          case AST_Node_Type::Scopeless_Block:
+            return true;
+          case AST_Node_Type::While:
+            return t_child == 1;
+          case AST_Node_Type::For:
+            return t_child == 3;
+          case AST_Node_Type::Ranged_For:
+            return t_child == 2;
+          case AST_Node_Type::If:
+            return t_child != 0;
+          default:
+            return false;
+        }
+      }
+
+      /// Adds t_node to t_path if it has a yield under it
+      /// \returns true if it was added
+      /// \throws exception::eval_error if the yield is somewhere a Generator_Call can not resume from
+      template<typename T>
+      static bool add_yield_path(const AST_Node_Impl<T> &t_node, Step_Path<T> &t_path)
+      {
+        if (t_node.identifier == AST_Node_Type::Yield) {
+          t_path.insert(&t_node);
+          return true;
+        }
+
+        bool found = false;
+        for (size_t i = 0; i < t_node.children.size(); ++i) {
+          const auto &child = *t_node.children[i];
+          if (!is_function(child) && add_yield_path(child, t_path)) {
+            if (!resumable(t_node, i)) {
+              throw exception::eval_error("'yield' can only be used in the blocks, loops and if statements of a function body",
+                  child.location.start, *child.location.filename);
+            }
+            found = true;
+          }
+        }
+
+        if (found) {
+          t_path.insert(&t_node);
+        }
+        return found;
+      }
+
+      /// \returns the Step_Path of t_body, or null if it has no yield and is not a generator
+      template<typename T>
+      static std::shared_ptr<const Step_Path<T>> yield_path(const AST_Node_Impl<T> &t_body)
+      {
+        auto path = std::make_shared<Step_Path<T>>();
+        if (!add_yield_path(t_body, *path)) {
+          return nullptr;
+        }
+        return path;
+      }
+
+      /// \returns the for loop t_node was compiled from by the optimizer, if it is one
+      template<typename T>
+      static const AST_Node_Impl<T> *compiled_loop(const AST_Node_Impl<T> &t_node)
+      {
+        if (t_node.identifier != AST_Node_Type::Compiled) {
+          return nullptr;
+        }
+        const auto &original = *static_cast<const Compiled_AST_Node<T> &>(t_node).m_original_node;
+        return original.identifier == AST_Node_Type::For ? &original : nullptr;
+      }
+
+      /// Adds t_node and the blocks, loops and ifs it can be resumed inside of to t_path
+      template<typename T>
+      static void add_script_path(const AST_Node_Impl<T> &t_node, Step_Path<T> &t_path)
+      {
+        // a compiled loop is stepped through as the loop it was compiled from
+        if (const auto *loop = compiled_loop(t_node)) {
+          t_path.insert(&t_node);
+          add_script_path(*loop, t_path);
+          return;
+        }
+
+        switch (t_node.identifier) {
+          case AST_Node_Type::File:
+          case AST_Node_Type::Block:
+          case AST_Node_Type::Scopeless_Block:
+          case AST_Node_Type::While:
+          case AST_Node_Type::For:
+          case AST_Node_Type::Ranged_For:
+          case AST_Node_Type::If:
+            break;
+          default:
+            return;
+        }
+
+        t_path.insert(&t_node);
+        for (size_t i = 0; i < t_node.children.size(); ++i) {
+          if (resumable(t_node, i)) {
+            add_script_path(*t_node.children[i], t_path);
+          }
+        }
+      }
+
+      /// \returns the Step_Path of a script run by a Continuation: its blocks, loops and ifs outside of functions
+      template<typename T>
+      static std::shared_ptr<const Step_Path<T>> script_path(const AST_Node_Impl<T> &t_script)
+      {
+        auto path = std::make_shared<Step_Path<T>>();
+        add_script_path(t_script, *path);
+        return path;
+      }
     }
 
     template<typename T>
@@ -121,6 +404,27 @@ namespace chaiscript
         }
       }
 
+      Continuation::Step steps(chaiscript::detail::Dispatch_Engine &t_engine) const final
+      {
+        const auto body = std::make_shared<detail::Stepped_Body<T>>(t_engine,
+            std::static_pointer_cast<const AST_Node_Impl<T>>(this->shared_from_this()), detail::script_path(*this));
+
+        return [body](const std::function<bool ()> &t_slice_over, Boxed_Value &t_result) {
+          try {
+            Boxed_Value yielded;
+            if (body->run(yielded, t_slice_over)) {
+              return false;
+            }
+          } catch (const detail::Continue_Loop &) {
+            throw exception::eval_error("Unexpected `continue` statement outside of a loop");
+          } catch (const detail::Break_Loop &) {
+            throw exception::eval_error("Unexpected `break` statement outside of a loop");
+          }
+          t_result = body->value();
+          return true;
+        };
+      }
+
       std::vector<AST_Node_Impl_Ptr<T>> children;
 
       protected:
@@ -130,6 +434,361 @@ namespace chaiscript
         }
     };
 
+    namespace detail
+    {
+      /// \brief A script body run a step at a time, keeping its place between runs
+      ///
+      /// The blocks, loops and ifs on the Step_Path are stepped through here, keeping their position
+      /// in a stack of frames, so the body can stop between two steps and carry on from there the
+      /// next time it runs. Everything else evaluates as usual. The body has its own Stack_Holder and
+      /// runs on the thread running it, counted against that thread's evaluation limits.
+      template<typename T>
+      class Stepped_Body
+      {
+        public:
+          Stepped_Body(chaiscript::detail::Dispatch_Engine &t_engine, std::shared_ptr<const AST_Node_Impl<T>> t_body,
+              std::shared_ptr<const Step_Path<T>> t_path)
+            : m_engine(t_engine), m_body(std::move(t_body)), m_path(std::move(t_path))
+          {
+          }
+
+          Stepped_Body(const Stepped_Body &) = delete;
+          Stepped_Body &operator=(const Stepped_Body &) = delete;
+
+          chaiscript::detail::Stack_Holder &stack()
+          {
+            return m_stack;
+          }
+
+          bool running() const
+          {
+            return m_running;
+          }
+
+          /// Runs the body until it yields t_value, or until t_pause() returns true between two of its steps
+          /// \returns false once the body has ended, see value()
+          /// \throws what the body throws, which ends it
+          template<typename Pause>
+          bool run(Boxed_Value &t_value, const Pause &t_pause)
+          {
+            if (m_done) {
+              return false;
+            }
+
+            const chaiscript::detail::Dispatch_State state(m_engine, m_stack);
+            // the body counts against its own call sites, not the one running it
+            Dispatch_Stats::Site_Guard no_site(nullptr);
+
+            m_running = true;
+            try {
+              bool stepped = false;
+              while (true) {
+                try {
+                  if (!m_started) {
+                    m_started = true;
+                    stepped = true;
+                    if (enter(state, *m_body, t_value)) { break; }
+                  } else if (m_frames.empty()) {
+                    finish();
+                    break;
+                  } else if (stepped && t_pause()) {
+                    break;
+                  } else {
+                    stepped = true;
+                    if (resume(state, t_value)) { break; }
+                  }
+                } catch (detail::Break_Loop &) {
+                  if (!leave_loop(state, true)) { throw; }
+                } catch (detail::Continue_Loop &) {
+                  if (!leave_loop(state, false)) { throw; }
+                }
+              }
+            } catch (detail::Return_Value &rv) {
+              finish();
+              m_value = std::move(rv.retval);
+            } catch (...) {
+              finish();
+              throw;
+            }
+
+            m_running = false;
+            return !m_done;
+          }
+
+          /// \returns what the body ended with: the value it returned, or else that of its last statement
+          const Boxed_Value &value() const
+          {
+            return m_value;
+          }
+
+        private:
+          struct Frame
+          {
+            const AST_Node_Impl<T> *node;
+            /// the next child of a block, or where a loop is up to
+            size_t pos;
+            /// what a ranged for is reading
+            std::unique_ptr<Lazy_Range> range;
+            Boxed_Value *loop_var;
+          };
+
+          /// Starts t_node, stepping into it if it is on the Step_Path
+          /// \returns true if it yielded t_value
+          bool enter(const chaiscript::detail::Dispatch_State &t_ss, const AST_Node_Impl<T> &t_node, Boxed_Value &t_value)
+          {
+            if (m_path->count(&t_node) == 0) {
+              m_value = t_node.eval(t_ss);
+              return false;
+            }
+
+            if (const auto *loop = compiled_loop(t_node)) {
+              return enter(t_ss, *loop, t_value);
+            }
+
+            T::trace(t_ss, &t_node);
+
+            switch (t_node.identifier) {
+              case AST_Node_Type::Yield:
+                t_value = t_node.children[0]->eval(t_ss);
+                return true;
+              case AST_Node_Type::If:
+                return enter(t_ss, *t_node.children[AST_Node::get_bool_condition(t_node.children[0]->eval(t_ss), t_ss) ? 1 : 2], t_value);
+              case AST_Node_Type::Ranged_For: {
+                auto range = std::make_unique<Lazy_Range>(range_of(t_node.children[1]->eval(t_ss)));
+                t_ss->new_scope(t_ss.stack_holder());
+                auto &loop_var = t_ss.add_get_object(t_node.children[0]->text, void_var());
+                m_frames.push_back(Frame{&t_node, 0, std::move(range), &loop_var});
+                return false;
+              }
+              case AST_Node_Type::Block:
+              case AST_Node_Type::While:
+              case AST_Node_Type::For:
+                t_ss->new_scope(t_ss.stack_holder());
+                break;
+              default:
+                break;
+            }
+
+            m_frames.push_back(Frame{&t_node, 0, nullptr, nullptr});
+            return false;
+          }
+
+          /// Carries on with the innermost frame
+          /// \returns true if it yielded t_value
+          bool resume(const chaiscript::detail::Dispatch_State &t_ss, Boxed_Value &t_value)
+          {
+            // entering a child can add frames, so `frame` is not used after that
+            auto &frame = m_frames.back();
+            const auto &children = frame.node->children;
+
+            switch (frame.node->identifier) {
+              case AST_Node_Type::While:
+                if (!AST_Node_Impl<T>::get_scoped_bool_condition(*children[0], t_ss)) {
+                  leave(t_ss);
+                  return false;
+                }
+                Eval_Limits::step();
+                return enter(t_ss, *children[1], t_value);
+              case AST_Node_Type::For:
+                // pos is 0 before the initializer and 1 once the body has run
+                children[frame.pos == 0 ? 0 : 2]->eval(t_ss);
+                if (!AST_Node_Impl<T>::get_scoped_bool_condition(*children[1], t_ss)) {
+                  leave(t_ss);
+                  return false;
+                }
+                Eval_Limits::step();
+                frame.pos = 1;
+                return enter(t_ss, *children[3], t_value);
+              case AST_Node_Type::Ranged_For:
+                // pos is 1 once the body has run for the front
+                if (frame.pos == 1) {
+                  frame.range->pop_front();
+                }
+                if (frame.range->empty()) {
+                  leave(t_ss);
+                  return false;
+                }
+                Eval_Limits::step();
+                *frame.loop_var = frame.range->front();
+                frame.pos = 1;
+                return enter(t_ss, *children[2], t_value);
+              default:
+                // a block
+                if (frame.pos == children.size()) {
+                  leave(t_ss);
+                  return false;
+                }
+                return enter(t_ss, *children[frame.pos++], t_value);
+            }
+          }
+
+          /// Ends the innermost frame
+          void leave(const chaiscript::detail::Dispatch_State &t_ss)
+          {
+            switch (m_frames.back().node->identifier) {
+              case AST_Node_Type::File:
+              case AST_Node_Type::Scopeless_Block:
+                break;
+              case AST_Node_Type::While:
+              case AST_Node_Type::For:
+              case AST_Node_Type::Ranged_For:
+                m_value = void_var();
+                t_ss->pop_scope(t_ss.stack_holder());
+                break;
+              default:
+                t_ss->pop_scope(t_ss.stack_holder());
+                break;
+            }
+            m_frames.pop_back();
+          }
+
+          /// Unwinds to the innermost loop for a break or continue, ending it if t_break
+          /// \returns false if there is no loop to unwind to
+          bool leave_loop(const chaiscript::detail::Dispatch_State &t_ss, const bool t_break)
+          {
+            while (!m_frames.empty()) {
+              const auto identifier = m_frames.back().node->identifier;
+              if (identifier == AST_Node_Type::While || identifier == AST_Node_Type::For || identifier == AST_Node_Type::Ranged_For) {
+                if (t_break) {
+                  leave(t_ss);
+                }
+                return true;
+              }
+              leave(t_ss);
+            }
+            return false;
+          }
+
+          /// Lets go of the body's frames and objects
+          void finish()
+          {
+            m_done = true;
+            m_running = false;
+            m_frames.clear();
+            m_stack = chaiscript::detail::Stack_Holder();
+          }
+
+          /// A Lazy_Range reading t_range the way ranged for does
+          Lazy_Range range_of(const Boxed_Value &t_range) const
+          {
+            const auto &ti = t_range.get_type_info();
+            if (ti.bare_equal_type_info(typeid(Lazy_Range))) {
+              return boxed_cast<const Lazy_Range &>(t_range);
+            } else if (ti.bare_equal_type_info(typeid(std::vector<Boxed_Value>))) {
+              // by index, so the vector can change while the body is stopped
+              auto index = std::make_shared<size_t>(0);
+              const auto *vec = &boxed_cast<const std::vector<Boxed_Value> &>(t_range);
+              return Lazy_Range(
+                  [t_range, vec, index](){ return *index >= vec->size(); },
+                  [vec, index](){ return (*vec)[*index]; },
+                  [index](){ ++*index; });
+            } else if (ti.bare_equal_type_info(typeid(std::map<std::string, Boxed_Value>))) {
+              return container_range<std::map<std::string, Boxed_Value>>(t_range);
+            } else if (ti.bare_equal_type_info(typeid(std::unordered_map<std::string, Boxed_Value>))) {
+              return container_range<std::unordered_map<std::string, Boxed_Value>>(t_range);
+            }
+
+            static const chaiscript::detail::Function_Name range("range");
+            static const chaiscript::detail::Function_Name empty("empty");
+            static const chaiscript::detail::Function_Name front("front");
+            static const chaiscript::detail::Function_Name pop_front("pop_front");
+
+            auto engine = m_engine;
+            const auto call_function = [engine](const chaiscript::detail::Function_Name &t_name, const Boxed_Value &t_param) {
+              Type_Conversions_State state(engine.get().conversions(), engine.get().conversions().conversion_saves());
+              return engine.get().call_function(t_name, {t_param}, state);
+            };
+
+            const auto range_obj = call_function(range, t_range);
+            return Lazy_Range(
+                [call_function, range_obj](){ return boxed_cast<bool>(call_function(empty, range_obj)); },
+                [call_function, range_obj](){ return call_function(front, range_obj); },
+                [call_function, range_obj](){ call_function(pop_front, range_obj); });
+          }
+
+          template<typename Container>
+          static Lazy_Range container_range(const Boxed_Value &t_container)
+          {
+            struct State {
+              Boxed_Value container;
+              typename Container::const_iterator it;
+              typename Container::const_iterator end;
+            };
+            const auto &container = boxed_cast<const Container &>(t_container);
+            auto state = std::make_shared<State>(State{t_container, container.begin(), container.end()});
+
+            return Lazy_Range(
+                [state](){ return state->it == state->end; },
+                [state](){ return Boxed_Value(*state->it); },
+                [state](){ ++state->it; });
+          }
+
+          std::reference_wrapper<chaiscript::detail::Dispatch_Engine> m_engine;
+          std::shared_ptr<const AST_Node_Impl<T>> m_body;
+          std::shared_ptr<const Step_Path<T>> m_path;
+          chaiscript::detail::Stack_Holder m_stack;
+          std::vector<Frame> m_frames;
+          Boxed_Value m_value;
+          bool m_started = false;
+          bool m_running = false;
+          bool m_done = false;
+      };
+
+      /// \brief One call of a generator function, whose body runs a step at a time as its values are read
+      ///
+      /// Its Stepped_Body stops at each yield, and carries on from there the next time a value is read.
+      template<typename T>
+      class Generator_Call
+      {
+        public:
+          Generator_Call(const Script_Function<T> &t_function, const std::vector<Boxed_Value> &t_params)
+            : m_body(t_function.engine, t_function.node, t_function.generator)
+          {
+            auto &engine = t_function.engine.get();
+            chaiscript::detail::Dispatch_State caller(engine);
+            auto &caller_stack = engine.get_stack_data(caller.stack_holder()).back();
+            const Boxed_Value *thisobj = nullptr;
+            if (!caller_stack.empty() && caller_stack.back().first == "__this") {
+              thisobj = &caller_stack.back().second;
+            } else if (!t_params.empty()) {
+              thisobj = &t_params[0];
+            }
+
+            Eval_Limits::step();
+            if (engine.profiler().enabled()) { engine.profiler().define(*t_function.node->location.filename, t_function.node->location.start.line); }
+
+            chaiscript::detail::Dispatch_State state(engine, m_body.stack());
+            if (thisobj && !t_function.this_capture) { state.add_object("this", *thisobj); }
+
+            for (const auto &capture : t_function.captures) {
+              state.add_object(capture.first, capture.second);
+            }
+
+            for (size_t i = 0; i < t_function.param_names.size(); ++i) {
+              if (t_function.param_names[i] != "this") {
+                state.add_object(t_function.param_names[i], t_params[i]);
+              }
+            }
+          }
+
+          Generator_Call(const Generator_Call &) = delete;
+          Generator_Call &operator=(const Generator_Call &) = delete;
+
+          /// Runs the body up to its next yield, for Lazy_Range::generator
+          /// \returns false once the body has returned or thrown
+          bool next(Boxed_Value &t_value)
+          {
+            if (m_body.running()) {
+              throw exception::eval_error("Generator read from its own body");
+            }
+            return m_body.run(t_value, [](){ return false; });
+          }
+
+        private:
+          Stepped_Body<T> m_body;
+      };
+    }
+
 
     template<typename T>
     struct Compiled_AST_Node : AST_Node_Impl<T> {
@@ -154,7 +813,8 @@ namespace chaiscript
         Fold_Right_Binary_Operator_AST_Node(const std::string &t_oper, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children, Boxed_Value t_rhs) :
           AST_Node_Impl<T>(t_oper, AST_Node_Type::Binary, std::move(t_loc), std::move(t_children)),
           m_oper(Operators::to_operator(t_oper)),
-          m_rhs(std::move(t_rhs))
+          m_rhs(std::move(t_rhs)),
+          m_name(t_oper)
         { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
@@ -179,7 +839,8 @@ namespace chaiscript
             } else {
               chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
               fpp.save_params({t_lhs, m_rhs});
-              return t_ss->call_function(t_oper_string, m_loc, {t_lhs, m_rhs}, t_ss.conversions());
+              chaiscript::eval::detail::Dispatch_Site site(t_ss, this, "operator", t_oper_string, this->location);
+              return t_ss->call_function(m_name, {t_lhs, m_rhs}, t_ss.conversions());
             }
           }
           catch(const exception::dispatch_error &e){
@@ -190,7 +851,7 @@ namespace chaiscript
       private:
         Operators::Opers m_oper;
         Boxed_Value m_rhs;
-        mutable std::atomic_uint_fast32_t m_loc = {0};
+        const chaiscript::detail::Function_Name m_name;
     };
 
 
@@ -198,7 +859,8 @@ namespace chaiscript
     struct Binary_Operator_AST_Node : AST_Node_Impl<T> {
         Binary_Operator_AST_Node(const std::string &t_oper, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
           AST_Node_Impl<T>(t_oper, AST_Node_Type::Binary, std::move(t_loc), std::move(t_children)),
-          m_oper(Operators::to_operator(t_oper))
+          m_oper(Operators::to_operator(t_oper)),
+          m_name(t_oper)
         { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
@@ -225,7 +887,8 @@ namespace chaiscript
             } else {
               chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
               fpp.save_params({t_lhs, t_rhs});
-              return t_ss->call_function(t_oper_string, m_loc, {t_lhs, t_rhs}, t_ss.conversions());
+              chaiscript::eval::detail::Dispatch_Site site(t_ss, this, "operator", t_oper_string, this->location);
+              return t_ss->call_function(m_name, {t_lhs, t_rhs}, t_ss.conversions());
             }
           }
           catch(const exception::dispatch_error &e){
@@ -235,7 +898,7 @@ namespace chaiscript
 
       private:
         Operators::Opers m_oper;
-        mutable std::atomic_uint_fast32_t m_loc = {0};
+        const chaiscript::detail::Function_Name m_name;
     };
 
 
@@ -263,12 +926,13 @@ namespace chaiscript
     template<typename T>
     struct Id_AST_Node final : AST_Node_Impl<T> {
         Id_AST_Node(const std::string &t_ast_node_text, Parse_Location t_loc) :
-          AST_Node_Impl<T>(t_ast_node_text, AST_Node_Type::Id, std::move(t_loc))
+          AST_Node_Impl<T>(t_ast_node_text, AST_Node_Type::Id, std::move(t_loc)),
+          m_name(t_ast_node_text)
         { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
           try {
-            return t_ss.get_object(this->text, m_loc);
+            return t_ss.get_object(m_name, m_loc);
           }
           catch (std::exception &) {
             throw exception::eval_error("Can not find object: " + this->text);
@@ -276,6 +940,8 @@ namespace chaiscript
         }
 
       private:
+        const chaiscript::detail::Function_Name m_name;
+        /// position in the stack, the same for any engine evaluating this node, see Dispatch_Engine::get_object
         mutable std::atomic_uint_fast32_t m_loc = {0};
     };
 
@@ -300,9 +966,11 @@ namespace chaiscript
             fpp.save_params(params);
           }
 
+          chaiscript::eval::detail::Dispatch_Site site(t_ss, this, "call", this->children[0]->text, this->location);
           Boxed_Value fn(this->children[0]->eval(t_ss));
 
           try {
+            chaiscript::eval::detail::Profile_Push_Pop ppp(t_ss, this->children[0]->text, this->location);
             return (*t_ss->boxed_cast<const dispatch::Proxy_Function_Base *>(fn))(params, t_ss.conversions());
           }
           catch(const exception::dispatch_error &e){
@@ -412,7 +1080,8 @@ namespace chaiscript
     struct Equation_AST_Node final : AST_Node_Impl<T> {
         Equation_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
           AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Equation, std::move(t_loc), std::move(t_children)), 
-          m_oper(Operators::to_operator(this->text))
+          m_oper(Operators::to_operator(this->text)),
+          m_name(this->text)
         { assert(this->children.size() == 2); }
 
 
@@ -453,14 +1122,15 @@ namespace chaiscript
                 } else {
                   if (!rhs.is_return_value())
                   {
-                    rhs = t_ss->call_function("clone", m_clone_loc, {rhs}, t_ss.conversions());
+                    static const chaiscript::detail::Function_Name clone("clone");
+                    rhs = t_ss->call_function(clone, {rhs}, t_ss.conversions());
                   }
                   rhs.reset_return_value();
                 }
               }
 
               try {
-                return t_ss->call_function(this->text, m_loc, {std::move(lhs), rhs}, t_ss.conversions());
+                return t_ss->call_function(m_name, {std::move(lhs), rhs}, t_ss.conversions());
               }
               catch(const exception::dispatch_error &e){
                 throw exception::eval_error("Unable to find appropriate'" + this->text + "' operator.", e.parameters, e.functions, false, *t_ss);
@@ -480,7 +1150,7 @@ namespace chaiscript
           }
           else {
             try {
-              return t_ss->call_function(this->text, m_loc, {std::move(lhs), rhs}, t_ss.conversions());
+              return t_ss->call_function(m_name, {std::move(lhs), rhs}, t_ss.conversions());
             } catch(const exception::dispatch_error &e){
               throw exception::eval_error("Unable to find appropriate'" + this->text + "' operator.", e.parameters, e.functions, false, *t_ss);
             }
@@ -491,8 +1161,7 @@ namespace chaiscript
 
       private:
         Operators::Opers m_oper;
-        mutable std::atomic_uint_fast32_t m_loc = {0};
-        mutable std::atomic_uint_fast32_t m_clone_loc = {0};
+        const chaiscript::detail::Function_Name m_name;
     };
 
     template<typename T>
@@ -547,16 +1216,13 @@ namespace chaiscript
 
           try {
             fpp.save_params(params);
-            return t_ss->call_function("[]", m_loc, params, t_ss.conversions());
+            static const chaiscript::detail::Function_Name array_call("[]");
+            return t_ss->call_function(array_call, params, t_ss.conversions());
           }
           catch(const exception::dispatch_error &e){
             throw exception::eval_error("Can not find appropriate array lookup operator '[]'.", e.parameters, e.functions, false, *t_ss );
           }
         }
-
-
-      private:
-        mutable std::atomic_uint_fast32_t m_loc = {0};
     };
 
     template<typename T>
@@ -585,14 +1251,16 @@ namespace chaiscript
           fpp.save_params(params);
 
           try {
-            retval = t_ss->call_member(m_fun_name, m_loc, std::move(params), has_function_params, t_ss.conversions());
+            chaiscript::eval::detail::Dispatch_Site site(t_ss, this, "method", m_fun_name.name(), this->location);
+            chaiscript::eval::detail::Profile_Push_Pop ppp(t_ss, m_fun_name.name(), this->location);
+            retval = t_ss->call_member(m_fun_name, std::move(params), has_function_params, t_ss.conversions());
           }
           catch(const exception::dispatch_error &e){
             if (e.functions.empty())
             {
-              throw exception::eval_error("'" + m_fun_name + "' is not a function.");
+              throw exception::eval_error("'" + m_fun_name.name() + "' is not a function.");
             } else {
-              throw exception::eval_error(std::string(e.what()) + " for function '" + m_fun_name + "'", e.parameters, e.functions, true, *t_ss);
+              throw exception::eval_error(std::string(e.what()) + " for function '" + m_fun_name.name() + "'", e.parameters, e.functions, true, *t_ss);
             }
           }
           catch(detail::Return_Value &rv) {
@@ -601,7 +1269,8 @@ namespace chaiscript
 
           if (this->children[1]->identifier == AST_Node_Type::Array_Call) {
             try {
-              retval = t_ss->call_function("[]", m_array_loc, {retval, this->children[1]->children[1]->eval(t_ss)}, t_ss.conversions());
+              static const chaiscript::detail::Function_Name array_call("[]");
+              retval = t_ss->call_function(array_call, {retval, this->children[1]->children[1]->eval(t_ss)}, t_ss.conversions());
             }
             catch(const exception::dispatch_error &e){
               throw exception::eval_error("Can not find appropriate array lookup operator '[]'.", e.parameters, e.functions, true, *t_ss);
@@ -612,9 +1281,7 @@ namespace chaiscript
         }
 
       private:
-        mutable std::atomic_uint_fast32_t m_loc = {0};
-        mutable std::atomic_uint_fast32_t m_array_loc = {0};
-        const std::string m_fun_name;
+        const chaiscript::detail::Function_Name m_fun_name;
     };
 
 
@@ -623,7 +1290,8 @@ namespace chaiscript
         Lambda_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
           AST_Node_Impl<T>(t_ast_node_text, AST_Node_Type::Lambda, std::move(t_loc), std::move(t_children)),
           m_param_names(Arg_List_AST_Node<T>::get_arg_names(this->children[1])),
-          m_this_capture(has_this_capture(this->children[0]->children))
+          m_this_capture(has_this_capture(this->children[0]->children)),
+          m_generator(detail::yield_path(*this->children.back()))
         { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
@@ -644,10 +1312,7 @@ namespace chaiscript
 
           return Boxed_Value(
               dispatch::make_dynamic_proxy_function(
-                  [engine, lambda_node, param_names = this->m_param_names, captures, this_capture = this->m_this_capture](const std::vector<Boxed_Value> &t_params)
-                  {
-                    return detail::eval_function(engine, lambda_node, param_names, t_params, &captures, this_capture);
-                  },
+                  detail::Script_Function<T>{engine, lambda_node, this->m_param_names, captures, this->m_this_capture, this->m_generator},
                   static_cast<int>(numparams), lambda_node, param_types
                 )
               );
@@ -664,6 +1329,7 @@ namespace chaiscript
       private:
         const std::vector<std::string> m_param_names;
         const bool m_this_capture = false;
+        const std::shared_ptr<const detail::Step_Path<T>> m_generator;
 
     };
 
@@ -700,7 +1366,9 @@ namespace chaiscript
     template<typename T>
     struct Def_AST_Node final : AST_Node_Impl<T> {
         Def_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
-          AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Def, std::move(t_loc), std::move(t_children)) { }
+          AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Def, std::move(t_loc), std::move(t_children)),
+          m_generator(detail::yield_path(*this->children.back()))
+        { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override{
           std::vector<std::string> t_param_names;
@@ -731,10 +1399,7 @@ namespace chaiscript
           std::shared_ptr<dispatch::Proxy_Function_Base> guard;
           if (guardnode) {
             guard = dispatch::make_dynamic_proxy_function(
-                [engine, guardnode, t_param_names](const std::vector<Boxed_Value> &t_params)
-                {
-                  return detail::eval_function(engine, guardnode, t_param_names, t_params);
-                },
+                detail::Script_Function<T>{engine, guardnode, t_param_names, {}, false, nullptr},
                 static_cast<int>(numparams), guardnode);
           }
 
@@ -743,10 +1408,7 @@ namespace chaiscript
             const auto & func_node = this->children.back();
             t_ss->add(
                 dispatch::make_dynamic_proxy_function(
-                  [engine, guardnode, func_node, t_param_names](const std::vector<Boxed_Value> &t_params)
-                  {
-                    return detail::eval_function(engine, func_node, t_param_names, t_params);
-                  },
+                  detail::Script_Function<T>{engine, func_node, t_param_names, {}, false, m_generator},
                   static_cast<int>(numparams), this->children.back(),
                   param_types, guard), l_function_name);
           } catch (const exception::name_conflict_error &e) {
@@ -755,6 +1417,9 @@ namespace chaiscript
           return void_var();
         }
 
+      private:
+        const std::shared_ptr<const detail::Step_Path<T>> m_generator;
+
     };
 
     template<typename T>
@@ -767,6 +1432,7 @@ namespace chaiscript
 
           try {
             while (this->get_scoped_bool_condition(*this->children[0], t_ss)) {
+              Eval_Limits::step();
               try {
                 this->children[1]->eval(t_ss);
               } catch (detail::Continue_Loop &) {
@@ -826,13 +1492,6 @@ namespace chaiscript
           { assert(this->children.size() == 3); }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override{
-          const auto get_function = [&t_ss](const std::string &t_name, auto &t_hint){
-            uint_fast32_t hint = t_hint;
-            auto funs = t_ss->get_function(t_name, hint);
-            if (funs.first != hint) { t_hint = uint_fast32_t(funs.first); }
-            return std::move(funs.second);
-          };
-
           const auto call_function = [&t_ss](const auto &t_funcs, const Boxed_Value &t_param) {
             return dispatch::dispatch(*t_funcs, {t_param}, t_ss.conversions());
           };
@@ -847,6 +1506,7 @@ namespace chaiscript
               chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
               Boxed_Value &obj = t_ss.add_get_object(loop_var_name, void_var());
               for (auto loop_var : ranged_thing) {
+                Eval_Limits::step();
                 obj = Boxed_Value(std::move(loop_var));
                 try {
                   this->children[2]->eval(t_ss);
@@ -863,17 +1523,44 @@ namespace chaiscript
             return do_loop(boxed_cast<const std::vector<Boxed_Value> &>(range_expression_result));
           } else if (range_expression_result.get_type_info().bare_equal_type_info(typeid(std::map<std::string, Boxed_Value>))) {
             return do_loop(boxed_cast<const std::map<std::string, Boxed_Value> &>(range_expression_result));
+          } else if (range_expression_result.get_type_info().bare_equal_type_info(typeid(std::unordered_map<std::string, Boxed_Value>))) {
+            return do_loop(boxed_cast<const std::unordered_map<std::string, Boxed_Value> &>(range_expression_result));
+          } else if (range_expression_result.get_type_info().bare_equal_type_info(typeid(Lazy_Range))) {
+            // read directly, without dispatching range, empty, front and pop_front by name
+            auto &range_obj = boxed_cast<Lazy_Range &>(range_expression_result);
+            try {
+              chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
+              Boxed_Value &obj = t_ss.add_get_object(loop_var_name, void_var());
+              while (!range_obj.empty()) {
+                Eval_Limits::step();
+                obj = range_obj.front();
+                try {
+                  this->children[2]->eval(t_ss);
+                } catch (detail::Continue_Loop &) {
+                }
+                range_obj.pop_front();
+              }
+            } catch (detail::Break_Loop &) {
+              // loop broken
+            }
+            return void_var();
           } else {
-            const auto range_funcs = get_function("range", m_range_loc);
-            const auto empty_funcs = get_function("empty", m_empty_loc);
-            const auto front_funcs = get_function("front", m_front_loc);
-            const auto pop_front_funcs = get_function("pop_front", m_pop_front_loc);
+            static const chaiscript::detail::Function_Name range("range");
+            static const chaiscript::detail::Function_Name empty("empty");
+            static const chaiscript::detail::Function_Name front("front");
+            static const chaiscript::detail::Function_Name pop_front("pop_front");
+
+            const auto range_funcs = t_ss->get_function(range);
+            const auto empty_funcs = t_ss->get_function(empty);
+            const auto front_funcs = t_ss->get_function(front);
+            const auto pop_front_funcs = t_ss->get_function(pop_front);
 
             try {
               const auto range_obj = call_function(range_funcs, range_expression_result);
               chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
               Boxed_Value &obj = t_ss.add_get_object(loop_var_name, void_var());
               while (!boxed_cast<bool>(call_function(empty_funcs, range_obj))) {
+                Eval_Limits::step();
                 obj = call_function(front_funcs, range_obj);
                 try {
                   this->children[2]->eval(t_ss);
@@ -888,12 +1575,6 @@ namespace chaiscript
           }
 
         }
-
-      private:
-        mutable std::atomic_uint_fast32_t m_range_loc = {0};
-        mutable std::atomic_uint_fast32_t m_empty_loc = {0};
-        mutable std::atomic_uint_fast32_t m_front_loc = {0};
-        mutable std::atomic_uint_fast32_t m_pop_front_loc = {0};
     };
 
 
@@ -912,6 +1593,7 @@ namespace chaiscript
                 this->get_scoped_bool_condition(*this->children[1], t_ss);
                 this->children[2]->eval(t_ss)
                 ) {
+              Eval_Limits::step();
               try {
                 // Body of Loop
                 this->children[3]->eval(t_ss);
@@ -949,7 +1631,8 @@ namespace chaiscript
               if (this->children[currentCase]->identifier == AST_Node_Type::Case) {
                 //This is a little odd, but because want to see both the switch and the case simultaneously, I do a downcast here.
                 try {
-                  if (hasMatched || boxed_cast<bool>(t_ss->call_function("==", m_loc, {match_value, this->children[currentCase]->children[0]->eval(t_ss)}, t_ss.conversions()))) {
+                  static const chaiscript::detail::Function_Name equals("==");
+                  if (hasMatched || boxed_cast<bool>(t_ss->call_function(equals, {match_value, this->children[currentCase]->children[0]->eval(t_ss)}, t_ss.conversions()))) {
                     this->children[currentCase]->eval(t_ss);
                     hasMatched = true;
                   }
@@ -970,8 +1653,6 @@ namespace chaiscript
           }
           return void_var();
         }
-
-        mutable std::atomic_uint_fast32_t m_loc = {0};
     };
 
     template<typename T>
@@ -1018,7 +1699,8 @@ namespace chaiscript
               for (const auto &child : this->children[0]->children) {
                 auto obj = child->eval(t_ss);
                 if (!obj.is_return_value()) {
-                  vec.push_back(t_ss->call_function("clone", m_loc, {obj}, t_ss.conversions()));
+                  static const chaiscript::detail::Function_Name clone("clone");
+                  vec.push_back(t_ss->call_function(clone, {obj}, t_ss.conversions()));
                 } else {
                   vec.push_back(std::move(obj));
                 }
@@ -1030,9 +1712,6 @@ namespace chaiscript
             throw exception::eval_error("Can not find appropriate 'clone' or copy constructor for vector elements");
           }
         }
-
-      private:
-        mutable std::atomic_uint_fast32_t m_loc = {0};
     };
 
     template<typename T>
@@ -1048,7 +1727,8 @@ namespace chaiscript
             for (const auto &child : this->children[0]->children) {
               auto obj = child->children[1]->eval(t_ss);
               if (!obj.is_return_value()) {
-                obj = t_ss->call_function("clone", m_loc, {obj}, t_ss.conversions());
+                static const chaiscript::detail::Function_Name clone("clone");
+                obj = t_ss->call_function(clone, {obj}, t_ss.conversions());
               }
 
               retval[t_ss->boxed_cast<std::string>(child->children[0]->eval(t_ss))] = std::move(obj);
@@ -1060,9 +1740,6 @@ namespace chaiscript
             throw exception::eval_error("Can not find appropriate copy constructor or 'clone' while inserting into Map.", e.parameters, e.functions, false, *t_ss);
           }
         }
-
-      private:
-        mutable std::atomic_uint_fast32_t m_loc = {0};
     };
 
     template<typename T>
@@ -1080,6 +1757,17 @@ namespace chaiscript
         }
     };
 
+    template<typename T>
+    struct Yield_AST_Node final : AST_Node_Impl<T> {
+        Yield_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
+          AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Yield, std::move(t_loc), std::move(t_children)) { }
+
+        Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &) const override{
+          // a yield in a function body is run by its Generator_Call, so this one is not in a function
+          throw exception::eval_error("'yield' outside of a function");
+        }
+    };
+
     template<typename T>
     struct File_AST_Node final : AST_Node_Impl<T> {
         File_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
@@ -1122,7 +1810,8 @@ namespace chaiscript
     struct Prefix_AST_Node final : AST_Node_Impl<T> {
         Prefix_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
           AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Prefix, std::move(t_loc), std::move(t_children)),
-          m_oper(Operators::to_operator(this->text, true))
+          m_oper(Operators::to_operator(this->text, true)),
+          m_name(this->text)
         { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override{
@@ -1136,7 +1825,7 @@ namespace chaiscript
             } else {
               chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
               fpp.save_params({bv});
-              return t_ss->call_function(this->text, m_loc, {std::move(bv)}, t_ss.conversions());
+              return t_ss->call_function(m_name, {std::move(bv)}, t_ss.conversions());
             }
           } catch (const exception::dispatch_error &e) {
             throw exception::eval_error("Error with prefix operator evaluation: '" + this->text + "'", e.parameters, e.functions, false, *t_ss);
@@ -1145,7 +1834,7 @@ namespace chaiscript
 
       private:
         Operators::Opers m_oper = Operators::Opers::invalid;
-        mutable std::atomic_uint_fast32_t m_loc = {0};
+        const chaiscript::detail::Function_Name m_name;
     };
 
     template<typename T>
@@ -1203,15 +1892,13 @@ namespace chaiscript
           try {
             auto oper1 = this->children[0]->children[0]->children[0]->eval(t_ss);
             auto oper2 = this->children[0]->children[0]->children[1]->eval(t_ss);
-            return t_ss->call_function("generate_range", m_loc, {oper1, oper2}, t_ss.conversions());
+            static const chaiscript::detail::Function_Name generate_range("generate_range");
+            return t_ss->call_function(generate_range, {oper1, oper2}, t_ss.conversions());
           }
           catch (const exception::dispatch_error &e) {
             throw exception::eval_error("Unable to generate range vector, while calling 'generate_range'", e.parameters, e.functions, false, *t_ss);
           }
         }
-
-      private:
-        mutable std::atomic_uint_fast32_t m_loc = {0};
     };
 
     template<typename T>
@@ -1336,7 +2023,9 @@ namespace chaiscript
     template<typename T>
     struct Method_AST_Node final : AST_Node_Impl<T> {
         Method_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
-          AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Method, std::move(t_loc), std::move(t_children)) { }
+          AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Method, std::move(t_loc), std::move(t_children)),
+          m_generator(detail::yield_path(*this->children.back()))
+        { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override{
 
@@ -1372,9 +2061,7 @@ namespace chaiscript
           std::reference_wrapper<chaiscript::detail::Dispatch_Engine> engine(*t_ss);
           if (guardnode) {
             guard = dispatch::make_dynamic_proxy_function(
-                [engine, t_param_names, guardnode](const std::vector<Boxed_Value> &t_params) {
-                  return chaiscript::eval::detail::eval_function(engine, guardnode, t_param_names, t_params);
-                }, 
+                detail::Script_Function<T>{engine, guardnode, t_param_names, {}, false, nullptr},
                 static_cast<int>(numparams), guardnode);
           }
 
@@ -1388,9 +2075,7 @@ namespace chaiscript
               t_ss->add(
                   std::make_shared<dispatch::detail::Dynamic_Object_Constructor>(class_name,
                     dispatch::make_dynamic_proxy_function(
-                        [engine, t_param_names, node](const std::vector<Boxed_Value> &t_params) {
-                          return chaiscript::eval::detail::eval_function(engine, node, t_param_names, t_params);
-                        },
+                        detail::Script_Function<T>{engine, node, t_param_names, {}, false, nullptr},
                         static_cast<int>(numparams), node, param_types, guard
                       )
                     ),
@@ -1404,9 +2089,7 @@ namespace chaiscript
 
               t_ss->add(std::make_shared<dispatch::detail::Dynamic_Object_Function>(class_name,
                     dispatch::make_dynamic_proxy_function(
-                      [engine, t_param_names, node](const std::vector<Boxed_Value> &t_params) {
-                        return chaiscript::eval::detail::eval_function(engine, node, t_param_names, t_params);
-                      },
+                      detail::Script_Function<T>{engine, node, t_param_names, {}, false, m_generator},
                       static_cast<int>(numparams), node, param_types, guard), type), 
                   function_name);
             }
@@ -1416,6 +2099,9 @@ namespace chaiscript
           return void_var();
         }
 
+      private:
+        const std::shared_ptr<const detail::Step_Path<T>> m_generator;
+
     };
 
     template<typename T>
@@ -59,7 +59,7 @@ namespace chaiscript {
     template<typename T, typename Callable>
       auto make_compiled_node(const eval::AST_Node_Impl_Ptr<T> &original_node, std::vector<eval::AST_Node_Impl_Ptr<T>> children, Callable callable)
       {
-        return chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Compiled_AST_Node<T>>(original_node, std::move(children), std::move(callable));
+        return eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Compiled_AST_Node<T>>(original_node, std::move(children), std::move(callable));
       }
 
 
@@ -116,7 +116,7 @@ namespace chaiscript {
             if (node->children.size() == 1) {
               return node->children[0];
             } else {
-              return chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Scopeless_Block_AST_Node<T>>(node->text, node->location, node->children);
+              return eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Scopeless_Block_AST_Node<T>>(node->text, node->location, node->children);
             }
           }
         }
@@ -152,7 +152,7 @@ namespace chaiscript {
               {
                 new_children.push_back(node->children[x]);
               }
-              return chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Block_AST_Node<T>>(node->text, node->location, new_children);
+              return eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Block_AST_Node<T>>(node->text, node->location, new_children);
             }
           } else {
             return node;
@@ -170,7 +170,7 @@ namespace chaiscript {
             for (size_t i = 0; i < node->children.size()-1; ++i) {
               auto child = node->children[i];
               if (child->identifier == AST_Node_Type::Fun_Call) {
-                node->children[i] = chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Unused_Return_Fun_Call_AST_Node<T>>(child->text, child->location, std::move(child->children));
+                node->children[i] = eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Unused_Return_Fun_Call_AST_Node<T>>(child->text, child->location, std::move(child->children));
               }
             }
           } else if ((node->identifier == AST_Node_Type::For
@@ -184,7 +184,7 @@ namespace chaiscript {
               for (size_t i = 0; i < num_sub_children; ++i) {
                 auto sub_child = child_at(child, i);
                 if (sub_child->identifier == AST_Node_Type::Fun_Call) {
-                  child->children[i] = chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Unused_Return_Fun_Call_AST_Node<T>>(sub_child->text, sub_child->location, std::move(sub_child->children));
+                  child->children[i] = eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Unused_Return_Fun_Call_AST_Node<T>>(sub_child->text, sub_child->location, std::move(sub_child->children));
                 }
               }
             }
@@ -230,7 +230,7 @@ namespace chaiscript {
             if (parsed != Operators::Opers::invalid) {
               const auto rhs = std::dynamic_pointer_cast<eval::Constant_AST_Node<T>>(node->children[1])->m_value;
               if (rhs.get_type_info().is_arithmetic()) {
-                return chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Fold_Right_Binary_Operator_AST_Node<T>>(node->text, node->location, node->children, rhs);
+                return eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Fold_Right_Binary_Operator_AST_Node<T>>(node->text, node->location, node->children, rhs);
               }
             }
           } catch (const std::exception &) {
@@ -258,9 +258,9 @@ namespace chaiscript {
 
             if (parsed != Operators::Opers::invalid && parsed != Operators::Opers::bitwise_and && lhs.get_type_info().is_arithmetic()) {
               const auto val  = Boxed_Number::do_oper(parsed, lhs);
-              return chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(std::move(match), node->location, std::move(val));
+              return eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(std::move(match), node->location, std::move(val));
             } else if (lhs.get_type_info().bare_equal_type_info(typeid(bool)) && oper == "!") {
-              return chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(std::move(match), node->location, Boxed_Value(!boxed_cast<bool>(lhs)));
+              return eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(std::move(match), node->location, Boxed_Value(!boxed_cast<bool>(lhs)));
             }
           } catch (const std::exception &) {
             //failure to fold, that's OK
@@ -280,7 +280,7 @@ namespace chaiscript {
                 else { return Boxed_Value(lhs_val || rhs_val); }
               }();
 
-              return chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(std::move(match), node->location, std::move(val));
+              return eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(std::move(match), node->location, std::move(val));
             }
           } catch (const std::exception &) {
             //failure to fold, that's OK
@@ -299,7 +299,7 @@ namespace chaiscript {
               if (lhs.get_type_info().is_arithmetic() && rhs.get_type_info().is_arithmetic()) {
                 const auto val  = Boxed_Number::do_oper(parsed, lhs, rhs);
                 const auto match = node->children[0]->text + " " + oper + " " + node->children[1]->text;
-                return chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(std::move(match), node->location, std::move(val));
+                return eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(std::move(match), node->location, std::move(val));
               }
             }
           } catch (const std::exception &) {
@@ -318,7 +318,7 @@ namespace chaiscript {
 
             const auto make_constant = [&node, &fun_name](auto val){
               const auto match = fun_name + "(" + node->children[1]->children[0]->text + ")";
-              return chaiscript::make_shared<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(std::move(match), node->location, Boxed_Value(val));
+              return eval::make_ast_node<eval::AST_Node_Impl<T>, eval::Constant_AST_Node<T>>(std::move(match), node->location, Boxed_Value(val));
             };
 
             if (fun_name == "double") {
@@ -368,7 +368,9 @@ namespace chaiscript {
             && prefix_node->text == "++"
             && child_count(prefix_node) == 1
             && child_at(prefix_node, 0)->identifier == AST_Node_Type::Id
-            && child_at(prefix_node, 0)->text == child_at(child_at(eq_node,0), 0)->text)
+            && child_at(prefix_node, 0)->text == child_at(child_at(eq_node,0), 0)->text
+            // a generator steps through a loop it yields in, so that has to stay a For node
+            && !eval::detail::has_yield(*child_at(for_node, 3)))
         {
           const Boxed_Value &begin = std::dynamic_pointer_cast<const eval::Constant_AST_Node<T>>(child_at(eq_node, 1))->m_value;
           const Boxed_Value &end = std::dynamic_pointer_cast<const eval::Constant_AST_Node<T>>(child_at(binary_node, 1))->m_value;
@@ -392,6 +394,7 @@ namespace chaiscript {
 
                   try {
                     for (; i < end_int; ++i) {
+                      Eval_Limits::step();
                       try {
                         // Body of Loop
                         children[0]->eval(t_ss);
@@ -452,7 +452,7 @@ namespace chaiscript
         /// \todo fix the fact that a successful match that captured no ast_nodes doesn't have any real start position
         m_match_stack.push_back(
             m_optimizer.optimize(
-              chaiscript::make_shared<chaiscript::eval::AST_Node_Impl<Tracer>, NodeType>(
+              chaiscript::eval::make_ast_node<chaiscript::eval::AST_Node_Impl<Tracer>, NodeType>(
                 std::move(t_text),
                 std::move(filepos),
                 std::move(new_children)))
@@ -781,7 +781,7 @@ namespace chaiscript
       template<typename T, typename ... Param>
       std::shared_ptr<eval::AST_Node_Impl<Tracer>> make_node(std::string t_match, const int t_prev_line, const int t_prev_col, Param && ...param)
       {
-        return chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, T>(std::move(t_match), Parse_Location(m_filename, t_prev_line, t_prev_col, m_position.line, m_position.col), std::forward<Param>(param)...);
+        return eval::make_ast_node<eval::AST_Node_Impl<Tracer>, T>(std::move(t_match), Parse_Location(m_filename, t_prev_line, t_prev_col, m_position.line, m_position.col), std::forward<Param>(param)...);
       }
 
       /// Reads a number from the input, detecting if it's an integer or floating point
@@ -1759,7 +1759,7 @@ namespace chaiscript
 
           if ((is_if_init && num_children == 3)
               || (!is_if_init && num_children == 2)) {
-            m_match_stack.push_back(chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
+            m_match_stack.push_back(eval::make_ast_node<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
           }
 
           if (!is_if_init) {
@@ -1849,7 +1849,7 @@ namespace chaiscript
           {
             return false;
           } else {
-            m_match_stack.push_back(chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
+            m_match_stack.push_back(eval::make_ast_node<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
           }
         }
 
@@ -1859,13 +1859,13 @@ namespace chaiscript
           {
             return false;
           } else {
-            m_match_stack.push_back(chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, eval::Constant_AST_Node<Tracer>>(Boxed_Value(true)));
+            m_match_stack.push_back(eval::make_ast_node<eval::AST_Node_Impl<Tracer>, eval::Constant_AST_Node<Tracer>>(Boxed_Value(true)));
           }
         }
 
         if (!Equation())
         {
-          m_match_stack.push_back(chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
+          m_match_stack.push_back(eval::make_ast_node<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
         }
 
         return true; 
@@ -2005,7 +2005,7 @@ namespace chaiscript
           }
 
           if (m_match_stack.size() == prev_stack_top) {
-            m_match_stack.push_back(chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
+            m_match_stack.push_back(eval::make_ast_node<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
           }
 
           build_match<eval::Block_AST_Node<Tracer>>(prev_stack_top);
@@ -2029,7 +2029,7 @@ namespace chaiscript
           }
 
           if (m_match_stack.size() == prev_stack_top) {
-            m_match_stack.push_back(chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
+            m_match_stack.push_back(eval::make_ast_node<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
           }
 
           build_match<eval::Block_AST_Node<Tracer>>(prev_stack_top);
@@ -2051,6 +2051,66 @@ namespace chaiscript
         }
       }
 
+      /// \returns true if the input after a yield that was just read uses it as a name: the statement
+      /// assigns to it, uses a member of it, or ends there
+      bool yield_used_as_name() const {
+        auto pos = m_position;
+        while (pos.has_more() && (*pos == ' ' || *pos == '\t')) {
+          ++pos;
+        }
+
+        switch (*pos) {
+          case '\0':
+          case '\r':
+          case '\n':
+          case ';':
+          case ',':
+          case ')':
+          case ']':
+          case '}':
+          case '.':
+            return true;
+          case '=':
+            return *(pos + 1) != '=';
+          case '+':
+          case '-':
+          case '*':
+          case '/':
+          case '%':
+          case '&':
+          case '|':
+          case '^':
+            return *(pos + 1) == '=';
+          case '<':
+          case '>':
+            return *(pos + 1) == *pos && *(pos + 2) == '=';
+          default:
+            return false;
+        }
+      }
+
+      /// Reads a yield statement from input. yield is a keyword only at the start of a statement that
+      /// goes on to give a value, so it can still be a name: `yield = 1;` and `yield.size()` use a
+      /// variable called yield.
+      bool Yield() {
+        const auto prev_stack_top = m_match_stack.size();
+        const auto start = m_position;
+
+        if (Keyword("yield")) {
+          if (yield_used_as_name()) {
+            m_position = start;
+            return false;
+          }
+          if (!Operator()) {
+            throw exception::eval_error("Incomplete 'yield' expression", File_Position(m_position.line, m_position.col), *m_filename);
+          }
+          build_match<eval::Yield_AST_Node<Tracer>>(prev_stack_top);
+          return true;
+        } else {
+          return false;
+        }
+      }
+
       /// Reads a break statement from input
       bool Break() {
         const auto prev_stack_top = m_match_stack.size();
@@ -2494,7 +2554,7 @@ namespace chaiscript
             retval = true;
             saw_eol = true;
           }
-          else if (Return() || Break() || Continue() || Equation()) {
+          else if (Return() || Yield() || Break() || Continue() || Equation()) {
             if (!saw_eol) {
               throw exception::eval_error("Two expressions missing line separator", File_Position(start.line, start.col), *m_filename);
             }
@@ -2556,7 +2616,7 @@ namespace chaiscript
             build_match<eval::File_AST_Node<Tracer>>(0);
           }
         } else {
-          m_match_stack.push_back(chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
+          m_match_stack.push_back(eval::make_ast_node<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>());
         }
 
         return m_match_stack.front();
@@ -40,6 +40,11 @@ def new(x) {
   eval(type_name(x))(); 
 }
 
+# Algorithms making a new container from a lazy range make a Vector
+def new(Lazy_Range x) { 
+  Vector(); 
+}
+
 def clone(double x) {
   double(x).clone_var_attrs(x)
 }
@@ -273,6 +278,11 @@ def map(container, func) {
   retval;
 }
 
+# Over a lazy range, map is lazy too: func is only called for the elements that are read
+def map(Lazy_Range container, func) { 
+  lazy_map(container, func);
+}
+
 # Performs the second value function over the container first value. Starts with initial and continues with each element.
 def foldl(container, func, initial) : call_exists(range, container){ 
   auto retval = initial; 
@@ -364,6 +374,11 @@ def drop(container, num) {
   retval; 
 }
 
+# Over a lazy range, drop is lazy too, and reads nothing until its result is read
+def drop(Lazy_Range container, num) {
+  lazy_drop(container, num);
+}
+
 
 def drop_while(container, f, inserter) : call_exists(range, container) { 
   auto r := range(container); 
@@ -384,6 +399,11 @@ def drop_while(container, f) {
   retval; 
 }
 
+# Over a lazy range, drop_while is lazy too, and reads nothing until its result is read
+def drop_while(Lazy_Range container, f) {
+  lazy_drop_while(container, f);
+}
+
 
 # Applies the second value function to the container. Starts with the first two elements. Expects at least 2 elements.
 def reduce(container, func) : container.size() >= 2 && call_exists(range, container) { 
@@ -435,6 +455,11 @@ def filter(container, f) {
   retval;
 }
 
+# Over a lazy range, filter is lazy too, so take(filter(lazy(big), f), 10) calls f only until it has 10
+def filter(Lazy_Range container, f) { 
+  lazy_filter(container, f);
+}
+
 
 def generate_range(x, y, inserter) { 
   auto i = x; 
@@ -718,6 +718,44 @@ Object drop_while(Range c, Function f);
 Object reduce(Range c, Function f);
 
 
+/// \brief Like map, but splits the elements of c over the calling thread and the shared thread pool.
+///        c is a Vector or any container that provides size() and []. The results keep the order of c.
+///
+/// Example:
+/// \code
+/// eval> parallel_map([1, 2, 3, 4], fun(x) { x * x })
+/// [1, 4, 9, 16]
+/// \endcode
+Vector parallel_map(Container c, Function f);
+
+
+/// \brief Like for_each, but splits the elements of c over the calling thread and the shared thread pool.
+///        f may be called for several elements at the same time, in no particular order.
+void parallel_for_each(Container c, Function f);
+
+
+/// \brief Like foldl, but folds ranges of c in parallel and then folds the partial results into initial.
+///        f must be associative and commutative.
+///
+/// Example:
+/// \code
+/// eval> parallel_reduce([1, 2, 3, 4], `+`, 0)
+/// 10
+/// \endcode
+Object parallel_reduce(Container c, Function f, Object initial);
+
+
+/// \brief Calls f on the shared thread pool and returns a future for its result.
+///
+/// Example:
+/// \code
+/// eval> var f = async(fun() { 6 * 7 })
+/// eval> f.get()
+/// 42
+/// \endcode
+future async(Function f);
+
+
 /// \brief Takes elements from Container c that match function f, return them.
 ///
 /// Example:
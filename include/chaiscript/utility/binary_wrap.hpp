@@ -0,0 +1,537 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_BINARY_WRAP_HPP_
+#define CHAISCRIPT_BINARY_WRAP_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../dispatchkit/boxed_cast.hpp"
+#include "../dispatchkit/boxed_value.hpp"
+#include "../dispatchkit/dynamic_object.hpp"
+#include "../dispatchkit/dispatchkit.hpp"
+#include "../dispatchkit/register_function.hpp"
+
+namespace chaiscript
+{
+  /// Compact binary encoding of script values, for moving them between engines, processes or disk.
+  ///
+  /// Every value is a one byte tag followed by its payload:
+  ///  - undefined, false and true have no payload
+  ///  - each arithmetic type has its own tag, so a value decodes to the type it was encoded from.
+  ///    The payload is the value in little endian, in 1, 2, 4 or 8 bytes depending on the type.
+  ///    long and wchar_t, whose widths differ between platforms, have a tag per width; one that is
+  ///    wider than the decoding platform's type decodes to long long or char32_t instead.
+  ///    long double is its width in a byte followed by its bytes in memory, so it only decodes
+  ///    where long double has the same representation.
+  ///  - string: length, then the bytes
+  ///  - Vector: element count, then the elements
+  ///  - Map and Hash_Map: entry count, then each key's length and bytes followed by its value
+  ///  - Pair: first, then second
+  ///  - Dynamic_Object: type name length and bytes, the explicit flag in a byte, then its attributes as a Map
+  ///
+  /// Lengths and counts are LEB128 varints. An encoded buffer starts with the four bytes "CSB" 1.
+  /// Values referred to more than once are written once per reference; a value that contains
+  /// itself, or containers nested more than max_depth deep, cannot be encoded or decoded.
+  class binary_wrap
+  {
+    public:
+      /// Deepest nesting of containers and objects that is encoded or decoded
+      static constexpr size_t max_depth = 256;
+
+      static Module& library(Module& m)
+      {
+        m.add(chaiscript::fun([](const Boxed_Value &t_bv) { return to_binary(t_bv); }), "to_binary");
+        m.add(chaiscript::fun([](const std::string &t_str) { return from_binary(t_str); }), "from_binary");
+
+        return m;
+      }
+
+      static std::string to_binary(const Boxed_Value &t_bv)
+      {
+        std::string out;
+        to_binary(t_bv, out);
+        return out;
+      }
+
+      /// Appends the encoding of t_bv to t_out
+      static void to_binary(const Boxed_Value &t_bv, std::string &t_out)
+      {
+        Writer writer(t_out);
+        t_out.append(magic(), magic_size);
+        writer.write(t_bv);
+      }
+
+      static Boxed_Value from_binary(const std::string &t_str)
+      {
+        return from_binary(t_str.data(), t_str.data() + t_str.size());
+      }
+
+      /// Decodes the value encoded in [t_begin, t_end)
+      static Boxed_Value from_binary(const char *t_begin, const char *t_end)
+      {
+        if (static_cast<size_t>(t_end - t_begin) < magic_size || std::memcmp(t_begin, magic(), magic_size) != 0) {
+          throw std::runtime_error("Binary value: missing header");
+        }
+
+        Reader reader(t_begin + magic_size, t_end);
+        auto result = reader.read();
+        if (!reader.at_end()) {
+          throw std::runtime_error("Binary value: unexpected data after value");
+        }
+        return result;
+      }
+
+    private:
+      static constexpr size_t magic_size = 4;
+
+      static const char *magic()
+      {
+        return "CSB\x01";
+      }
+
+      // the tags are the format, new ones go at the end
+      enum class Tag : unsigned char {
+        Undef, False, True, String, Vector, Map, Pair, Dynamic_Object, Hash_Map,
+        Char = 16, Signed_Char, Unsigned_Char, Short, Unsigned_Short, Int, Unsigned_Int, Long_64, Unsigned_Long_64,
+        Long_Long, Unsigned_Long_Long, Wchar_32, Char16, Char32, Float, Double, Long_Double,
+        Long_32, Unsigned_Long_32, Wchar_16
+      };
+
+      static_assert(sizeof(short) == 2 && sizeof(int) == 4 && sizeof(long long) == 8, "unsupported integer widths");
+      static_assert(sizeof(long) == 4 || sizeof(long) == 8, "unsupported width of long");
+      static_assert(sizeof(wchar_t) == 2 || sizeof(wchar_t) == 4, "unsupported width of wchar_t");
+      static_assert(sizeof(float) == 4 && sizeof(double) == 8, "unsupported floating point widths");
+
+      template<typename Native, typename Wide>
+        using At_Least_64 = typename std::conditional<sizeof(Native) == 8, Native, Wide>::type;
+
+      template<typename Native, typename Wide>
+        using At_Least_32 = typename std::conditional<sizeof(Native) == 4, Native, Wide>::type;
+
+      /// Calls t_func with default constructed values of the arithmetic type for t_tag and of the
+      /// fixed width type its payload is encoded as
+      template<typename Func>
+      static bool visit_number(const Tag t_tag, Func &&t_func)
+      {
+        switch (t_tag) {
+          case Tag::Char: t_func(char(), std::int8_t()); return true;
+          case Tag::Signed_Char: t_func(static_cast<signed char>(0), std::int8_t()); return true;
+          case Tag::Unsigned_Char: t_func(static_cast<unsigned char>(0), std::uint8_t()); return true;
+          case Tag::Short: t_func(short(), std::int16_t()); return true;
+          case Tag::Unsigned_Short: t_func(static_cast<unsigned short>(0), std::uint16_t()); return true;
+          case Tag::Int: t_func(int(), std::int32_t()); return true;
+          case Tag::Unsigned_Int: t_func(static_cast<unsigned int>(0), std::uint32_t()); return true;
+          case Tag::Long_32: t_func(long(), std::int32_t()); return true;
+          case Tag::Unsigned_Long_32: t_func(static_cast<unsigned long>(0), std::uint32_t()); return true;
+          case Tag::Long_64: t_func(At_Least_64<long, long long>(), std::int64_t()); return true;
+          case Tag::Unsigned_Long_64: t_func(At_Least_64<unsigned long, unsigned long long>(), std::uint64_t()); return true;
+          case Tag::Long_Long: t_func(static_cast<long long>(0), std::int64_t()); return true;
+          case Tag::Unsigned_Long_Long: t_func(static_cast<unsigned long long>(0), std::uint64_t()); return true;
+          case Tag::Wchar_16: t_func(wchar_t(), std::uint16_t()); return true;
+          case Tag::Wchar_32: t_func(At_Least_32<wchar_t, char32_t>(), std::uint32_t()); return true;
+          case Tag::Char16: t_func(char16_t(), std::uint16_t()); return true;
+          case Tag::Char32: t_func(char32_t(), std::uint32_t()); return true;
+          case Tag::Float: t_func(float(), float()); return true;
+          case Tag::Double: t_func(double(), double()); return true;
+          case Tag::Long_Double: t_func(static_cast<long double>(0), static_cast<long double>(0)); return true;
+          default: return false;
+        }
+      }
+
+      static Tag number_tag(const Type_Info &t_ti)
+      {
+        const auto &ti = *t_ti.bare_type_info();
+        if (ti == typeid(int)) { return Tag::Int; }
+        else if (ti == typeid(double)) { return Tag::Double; }
+        else if (ti == typeid(long)) { return sizeof(long) == 8 ? Tag::Long_64 : Tag::Long_32; }
+        else if (ti == typeid(unsigned int)) { return Tag::Unsigned_Int; }
+        else if (ti == typeid(unsigned long)) { return sizeof(unsigned long) == 8 ? Tag::Unsigned_Long_64 : Tag::Unsigned_Long_32; }
+        else if (ti == typeid(float)) { return Tag::Float; }
+        else if (ti == typeid(long long)) { return Tag::Long_Long; }
+        else if (ti == typeid(unsigned long long)) { return Tag::Unsigned_Long_Long; }
+        else if (ti == typeid(char)) { return Tag::Char; }
+        else if (ti == typeid(signed char)) { return Tag::Signed_Char; }
+        else if (ti == typeid(unsigned char)) { return Tag::Unsigned_Char; }
+        else if (ti == typeid(short)) { return Tag::Short; }
+        else if (ti == typeid(unsigned short)) { return Tag::Unsigned_Short; }
+        else if (ti == typeid(wchar_t)) { return sizeof(wchar_t) == 4 ? Tag::Wchar_32 : Tag::Wchar_16; }
+        else if (ti == typeid(char16_t)) { return Tag::Char16; }
+        else if (ti == typeid(char32_t)) { return Tag::Char32; }
+        else if (ti == typeid(long double)) { return Tag::Long_Double; }
+
+        throw std::runtime_error("Binary value: unknown arithmetic type " + t_ti.bare_name());
+      }
+
+      class Writer
+      {
+        public:
+          explicit Writer(std::string &t_out)
+            : m_out(t_out)
+          {
+          }
+
+          void write(const Boxed_Value &t_bv)
+          {
+            const auto &ti = t_bv.get_type_info();
+
+            if (ti.is_arithmetic()) {
+              write_number(t_bv, number_tag(ti));
+            } else if (ti.bare_equal(user_type<bool>())) {
+              tag(boxed_cast<bool>(t_bv) ? Tag::True : Tag::False);
+            } else if (ti.bare_equal(user_type<std::string>())) {
+              tag(Tag::String);
+              write_string(boxed_cast<const std::string &>(t_bv));
+            } else if (ti.bare_equal(user_type<std::vector<Boxed_Value>>())) {
+              const auto &vec = boxed_cast<const std::vector<Boxed_Value> &>(t_bv);
+              const Enter enter(*this, &vec);
+              tag(Tag::Vector);
+              write_length(vec.size());
+              for (const auto &v : vec) {
+                write(v);
+              }
+            } else if (ti.bare_equal(user_type<std::map<std::string, Boxed_Value>>())) {
+              const auto &m = boxed_cast<const std::map<std::string, Boxed_Value> &>(t_bv);
+              const Enter enter(*this, &m);
+              tag(Tag::Map);
+              write_map(m);
+            } else if (ti.bare_equal(user_type<std::unordered_map<std::string, Boxed_Value>>())) {
+              const auto &m = boxed_cast<const std::unordered_map<std::string, Boxed_Value> &>(t_bv);
+              const Enter enter(*this, &m);
+              tag(Tag::Hash_Map);
+              write_map(m);
+            } else if (ti.bare_equal(user_type<std::pair<Boxed_Value, Boxed_Value>>())) {
+              const auto &p = boxed_cast<const std::pair<Boxed_Value, Boxed_Value> &>(t_bv);
+              const Enter enter(*this, &p);
+              tag(Tag::Pair);
+              write(p.first);
+              write(p.second);
+            } else if (ti.bare_equal(user_type<dispatch::Dynamic_Object>())) {
+              const auto &o = boxed_cast<const dispatch::Dynamic_Object &>(t_bv);
+              const Enter enter(*this, &o);
+              tag(Tag::Dynamic_Object);
+              write_string(o.get_type_name());
+              m_out += static_cast<char>(o.is_explicit() ? 1 : 0);
+              write_map(o.get_attrs());
+            } else if (t_bv.is_undef()) {
+              tag(Tag::Undef);
+            } else {
+              throw std::runtime_error("Binary value: cannot encode object of type " + ti.bare_name());
+            }
+          }
+
+        private:
+          /// Tracks the containers being written, to refuse one that contains itself
+          struct Enter
+          {
+            Enter(Writer &t_writer, const void *t_container)
+              : m_writer(t_writer)
+            {
+              auto &open = m_writer.m_open;
+              if (std::find(open.begin(), open.end(), t_container) != open.end()) {
+                throw std::runtime_error("Binary value: cannot encode a value that contains itself");
+              }
+              if (open.size() == max_depth) {
+                throw std::runtime_error("Binary value: nested too deeply");
+              }
+              open.push_back(t_container);
+            }
+
+            ~Enter()
+            {
+              m_writer.m_open.pop_back();
+            }
+
+            Enter(const Enter &) = delete;
+            Enter &operator=(const Enter &) = delete;
+
+            Writer &m_writer;
+          };
+
+          void tag(const Tag t_tag)
+          {
+            m_out += static_cast<char>(t_tag);
+          }
+
+          void write_length(size_t t_length)
+          {
+            while (t_length >= 0x80) {
+              m_out += static_cast<char>((t_length & 0x7f) | 0x80);
+              t_length >>= 7;
+            }
+            m_out += static_cast<char>(t_length);
+          }
+
+          void write_string(const std::string &t_str)
+          {
+            write_length(t_str.size());
+            m_out += t_str;
+          }
+
+          template<typename Map>
+          void write_map(const Map &t_map)
+          {
+            write_length(t_map.size());
+            for (const auto &entry : t_map) {
+              write_string(entry.first);
+              write(entry.second);
+            }
+          }
+
+          void write_number(const Boxed_Value &t_bv, const Tag t_tag)
+          {
+            tag(t_tag);
+            visit_number(t_tag, [&](auto t_native, auto t_wire) {
+                write_bytes(static_cast<decltype(t_wire)>(boxed_cast<decltype(t_native)>(t_bv)));
+              });
+          }
+
+          template<typename T>
+          void write_bytes(const T t_value, typename std::enable_if<std::is_integral<T>::value>::type * = nullptr)
+          {
+            auto u = static_cast<std::uint64_t>(t_value);
+            for (size_t i = 0; i < sizeof(T); ++i, u >>= 8) {
+              m_out += static_cast<char>(u & 0xff);
+            }
+          }
+
+          void write_bytes(const float t_value)
+          {
+            std::uint32_t u;
+            std::memcpy(&u, &t_value, sizeof(u));
+            write_bytes(u);
+          }
+
+          void write_bytes(const double t_value)
+          {
+            std::uint64_t u;
+            std::memcpy(&u, &t_value, sizeof(u));
+            write_bytes(u);
+          }
+
+          void write_bytes(const long double t_value)
+          {
+            m_out += static_cast<char>(sizeof(t_value));
+            m_out.append(reinterpret_cast<const char *>(&t_value), sizeof(t_value));
+          }
+
+          std::string &m_out;
+          std::vector<const void *> m_open;
+      };
+
+      class Reader
+      {
+        public:
+          Reader(const char *t_begin, const char *t_end)
+            : m_pos(t_begin), m_end(t_end)
+          {
+          }
+
+          bool at_end() const
+          {
+            return m_pos == m_end;
+          }
+
+          Boxed_Value read()
+          {
+            const auto t = static_cast<Tag>(byte());
+            switch (t) {
+              case Tag::Undef: return Boxed_Value();
+              case Tag::False: return Boxed_Value(false);
+              case Tag::True: return Boxed_Value(true);
+              case Tag::String: return Boxed_Value(read_string());
+              case Tag::Vector: {
+                const Nested nested(*this);
+                std::vector<Boxed_Value> vec(read_length());
+                for (auto &v : vec) {
+                  v = read();
+                }
+                return Boxed_Value(std::move(vec));
+              }
+              case Tag::Map: {
+                const Nested nested(*this);
+                return Boxed_Value(read_map());
+              }
+              case Tag::Hash_Map: {
+                const Nested nested(*this);
+                std::unordered_map<std::string, Boxed_Value> m;
+                const auto count = read_length();
+                m.reserve(count);
+                for (size_t i = 0; i < count; ++i) {
+                  auto key = read_string();
+                  m[std::move(key)] = read();
+                }
+                return Boxed_Value(std::move(m));
+              }
+              case Tag::Pair: {
+                const Nested nested(*this);
+                auto first = read();
+                auto second = read();
+                return Boxed_Value(std::make_pair(std::move(first), std::move(second)));
+              }
+              case Tag::Dynamic_Object: {
+                const Nested nested(*this);
+                // the name comes from the data, so it is looked up rather than given an id of its own
+                auto type_name = read_string();
+                const auto type_id = dispatch::Dynamic_Object::find_type_id(type_name);
+                dispatch::Dynamic_Object o(std::move(type_name), type_id);
+                o.set_explicit(byte() != 0);
+                for (auto &attr : read_map()) {
+                  o.get_attr(attr.first) = std::move(attr.second);
+                }
+                return Boxed_Value(std::move(o));
+              }
+              default: {
+                Boxed_Value result;
+                if (!visit_number(t, [&](auto t_native, auto t_wire) {
+                      result = Boxed_Value(static_cast<decltype(t_native)>(read_bytes(t_wire)));
+                    })) {
+                  throw std::runtime_error("Binary value: unknown tag " + std::to_string(static_cast<int>(t)));
+                }
+                return result;
+              }
+            }
+          }
+
+        private:
+          /// Counts the containers being read, to refuse nesting deeper than the writer allows
+          struct Nested
+          {
+            explicit Nested(Reader &t_reader)
+              : m_reader(t_reader)
+            {
+              if (m_reader.m_depth == max_depth) {
+                throw std::runtime_error("Binary value: nested too deeply");
+              }
+              ++m_reader.m_depth;
+            }
+
+            ~Nested()
+            {
+              --m_reader.m_depth;
+            }
+
+            Nested(const Nested &) = delete;
+            Nested &operator=(const Nested &) = delete;
+
+            Reader &m_reader;
+          };
+
+          void require(const size_t t_bytes) const
+          {
+            if (static_cast<size_t>(m_end - m_pos) < t_bytes) {
+              throw std::runtime_error("Binary value: unexpected end of data");
+            }
+          }
+
+          unsigned char byte()
+          {
+            require(1);
+            return static_cast<unsigned char>(*m_pos++);
+          }
+
+          size_t read_length()
+          {
+            size_t length = 0;
+            for (unsigned shift = 0; ; shift += 7) {
+              if (shift >= sizeof(size_t) * 8) {
+                throw std::runtime_error("Binary value: length out of range");
+              }
+              const auto b = byte();
+              length |= static_cast<size_t>(b & 0x7f) << shift;
+              if ((b & 0x80) == 0) {
+                break;
+              }
+            }
+            // every element takes at least a byte, so no length can exceed what is left
+            require(length);
+            return length;
+          }
+
+          std::string read_string()
+          {
+            const auto length = read_length();
+            std::string str(m_pos, length);
+            m_pos += length;
+            return str;
+          }
+
+          std::map<std::string, Boxed_Value> read_map()
+          {
+            std::map<std::string, Boxed_Value> m;
+            const auto count = read_length();
+            for (size_t i = 0; i < count; ++i) {
+              auto key = read_string();
+              m.emplace_hint(m.end(), std::move(key), read());
+            }
+            return m;
+          }
+
+          template<typename T>
+          T read_bytes(T, typename std::enable_if<std::is_integral<T>::value>::type * = nullptr)
+          {
+            constexpr size_t width = sizeof(T);
+            require(width);
+            std::uint64_t u = 0;
+            for (size_t i = 0; i < width; ++i) {
+              u |= static_cast<std::uint64_t>(static_cast<unsigned char>(*m_pos++)) << (8 * i);
+            }
+            if (std::is_signed<T>::value && width < 8 && (u >> (8 * width - 1)) != 0) {
+              u |= ~std::uint64_t(0) << (8 * width);
+            }
+            return static_cast<T>(u);
+          }
+
+          float read_bytes(float)
+          {
+            const auto u = read_bytes(std::uint32_t());
+            float f;
+            std::memcpy(&f, &u, sizeof(f));
+            return f;
+          }
+
+          double read_bytes(double)
+          {
+            const auto u = read_bytes(std::uint64_t());
+            double d;
+            std::memcpy(&d, &u, sizeof(d));
+            return d;
+          }
+
+          long double read_bytes(long double)
+          {
+            long double d;
+            if (byte() != sizeof(d)) {
+              throw std::runtime_error("Binary value: long double was encoded with a different size");
+            }
+            require(sizeof(d));
+            std::memcpy(&d, m_pos, sizeof(d));
+            m_pos += sizeof(d);
+            return d;
+          }
+
+          const char *m_pos;
+          const char *m_end;
+          size_t m_depth = 0;
+      };
+  };
+
+}
+
+#endif
@@ -0,0 +1,178 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_UTILITY_ENGINE_POOL_HPP_
+#define CHAISCRIPT_UTILITY_ENGINE_POOL_HPP_
+
+#include "../chaiscript_basic.hpp"
+
+#ifndef CHAISCRIPT_NO_THREADS
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace chaiscript
+{
+  /// \brief A set of engines built from one bootstrap configuration, serving requests on a
+  ///        work-stealing thread pool.
+  ///
+  /// Each worker thread of the pool owns one engine, so an engine is never used by two requests
+  /// at once. Requests without a session run on whichever worker picks them up. Requests for a
+  /// session always run on the same engine and worker thread, so globals and locals a session
+  /// defines are visible to its later requests.
+  ///
+  /// \b Example:
+  /// \code
+  /// chaiscript::Engine_Pool pool(chaiscript::Std_Lib::library(), [](){ return create_chaiscript_parser(); });
+  /// pool.eval("def handle(x) { return x * 2; }").get(); // defined in one engine only
+  /// auto result = pool.eval(42, "var count = 1;");        // session 42, always the same engine
+  /// \endcode
+  class Engine_Pool
+  {
+    public:
+      typedef std::function<std::unique_ptr<parser::ChaiScript_Parser_Base> ()> Parser_Factory;
+
+      /// \brief Builds t_num_engines engines from t_lib. t_lib is only bootstrapped once.
+      /// \param[in] t_lib Standard library to apply to every engine
+      /// \param[in] t_parser_factory Creates a parser for each engine, all of the same type
+      /// \param[in] t_num_engines Number of engines and worker threads
+      Engine_Pool(const ModulePtr &t_lib,
+                  Parser_Factory t_parser_factory,
+                  const size_t t_num_engines = utility::Thread_Pool::default_size(),
+                  const std::vector<std::string> &t_module_paths = {},
+                  const std::vector<std::string> &t_use_paths = {},
+                  const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options())
+        : Engine_Pool(build_snapshot(t_lib, t_parser_factory), t_parser_factory, t_num_engines, t_module_paths, t_use_paths, t_opts)
+      {
+      }
+
+      /// \brief Builds t_num_engines engines from t_snapshot
+      Engine_Pool(const ChaiScript_Basic::Boot_Snapshot &t_snapshot,
+                  const Parser_Factory &t_parser_factory,
+                  const size_t t_num_engines = utility::Thread_Pool::default_size(),
+                  const std::vector<std::string> &t_module_paths = {},
+                  const std::vector<std::string> &t_use_paths = {},
+                  const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options())
+        : m_engines(t_num_engines == 0 ? 1 : t_num_engines),
+          m_pool(m_engines.size())
+      {
+        // each worker builds its own engine
+        for_each_engine([&](std::unique_ptr<ChaiScript_Basic> &t_engine) {
+              t_engine = std::make_unique<ChaiScript_Basic>(t_snapshot, t_parser_factory(), t_module_paths, t_use_paths, t_opts);
+            });
+      }
+
+      Engine_Pool(const Engine_Pool &) = delete;
+      Engine_Pool &operator=(const Engine_Pool &) = delete;
+
+      /// \returns the number of engines, which is also the number of worker threads
+      size_t size() const noexcept
+      {
+        return m_engines.size();
+      }
+
+      /// \returns the index of the engine that serves t_session
+      size_t session_engine(const size_t t_session) const noexcept
+      {
+        return t_session % size();
+      }
+
+      /// \returns engine t_index, for setup that is not covered by add(). The engine must not be
+      ///          used directly while requests are being served.
+      ChaiScript_Basic &engine(const size_t t_index)
+      {
+        return *m_engines.at(t_index);
+      }
+
+      /// \brief Adds all elements of a module to every engine. Requests queued before the call
+      ///        finish first on each engine, requests queued after it see the module.
+      Engine_Pool &add(const ModulePtr &t_lib)
+      {
+        for_each_engine([&](std::unique_ptr<ChaiScript_Basic> &t_engine) { t_engine->add(t_lib); });
+        return *this;
+      }
+
+      /// \brief Evaluates t_script on any engine
+      /// \returns a future holding the result or the exception thrown by the evaluation
+      std::future<Boxed_Value> eval(std::string t_script)
+      {
+        return m_pool.submit([this, script = std::move(t_script)]() {
+              return current_engine().eval(script);
+            });
+      }
+
+      /// \brief Evaluates t_script on the engine serving t_session
+      std::future<Boxed_Value> eval(const size_t t_session, std::string t_script)
+      {
+        return m_pool.submit_to(session_engine(t_session), [this, script = std::move(t_script)]() {
+              return current_engine().eval(script);
+            });
+      }
+
+      /// \brief Calls the function named t_function on any engine
+      /// \returns a future holding the result or the exception thrown by the call
+      /// \sa ChaiScript_Basic::call_function
+      std::future<Boxed_Value> call(std::string t_function, std::vector<Boxed_Value> t_params)
+      {
+        return m_pool.submit([this, function = std::move(t_function), params = std::move(t_params)]() {
+              return current_engine().call_function(function, params);
+            });
+      }
+
+      /// \brief Calls the function named t_function on the engine serving t_session
+      std::future<Boxed_Value> call(const size_t t_session, std::string t_function, std::vector<Boxed_Value> t_params)
+      {
+        return m_pool.submit_to(session_engine(t_session), [this, function = std::move(t_function), params = std::move(t_params)]() {
+              return current_engine().call_function(function, params);
+            });
+      }
+
+    private:
+      static ChaiScript_Basic::Boot_Snapshot build_snapshot(const ModulePtr &t_lib, const Parser_Factory &t_parser_factory)
+      {
+        const auto parser = t_parser_factory();
+        return ChaiScript_Basic::build_boot_snapshot(t_lib, *parser);
+      }
+
+      ChaiScript_Basic &current_engine()
+      {
+        return *m_engines[m_pool.current_worker()];
+      }
+
+      /// Runs t_func on every engine from the worker that owns it and waits for all of them
+      template<typename Func>
+      void for_each_engine(const Func &t_func)
+      {
+        std::vector<std::future<void>> results;
+        results.reserve(size());
+
+        for (size_t i = 0; i < size(); ++i) {
+          results.push_back(m_pool.submit_to(i, [this, i, &t_func]() { t_func(m_engines[i]); }));
+        }
+
+        for (auto &result : results) {
+          result.get();
+        }
+      }
+
+      std::vector<std::unique_ptr<ChaiScript_Basic>> m_engines;
+      utility::Thread_Pool m_pool;
+  };
+}
+
+#endif
+
+#endif
+
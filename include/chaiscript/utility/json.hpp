@@ -9,9 +9,14 @@
 #define SIMPLEJSON_HPP
 
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
 #include <cmath>
 #include <cctype>
+#include <functional>
+#include <istream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <map>
@@ -380,73 +385,127 @@ class JSON
       }
     }
 
-    std::string dump( long depth = 1, std::string tab = "  ") const {
-      switch( internal.Type ) {
-        case Class::Null:
-          return "null";
-        case Class::Object: {
-                              std::string pad = "";
-                              for( long i = 0; i < depth; ++i, pad += tab ) { }
-
-                              std::string s = "{\n";
-                              bool skip = true;
-                              for( auto &p : *internal.Map ) {
-                                if( !skip ) { s += ",\n"; }
-                                s += ( pad + "\"" + p.first + "\" : " + p.second.dump( depth + 1, tab ) );
-                                skip = false;
-                              }
-                              s += ( "\n" + pad.erase( 0, 2 ) + "}" ) ;
-                              return s;
-                            }
-        case Class::Array: {
-                             std::string s = "[";
-                             bool skip = true;
-                             for( auto &p : *internal.List ) {
-                               if( !skip ) { s += ", "; }
-                               s += p.dump( depth + 1, tab );
-                               skip = false;
-                             }
-                             s += "]";
-                             return s;
-                           }
-        case Class::String:
-                           return "\"" + json_escape( *internal.String ) + "\"";
-        case Class::Floating:
-                           return std::to_string( internal.Float );
-        case Class::Integral:
-                           return std::to_string( internal.Int );
-        case Class::Boolean:
-                           return internal.Bool ? "true" : "false";
-      }
-
-      throw std::runtime_error("Unhandled JSON type");
+    std::string dump( long depth = 1, std::string tab = "  ") const;
+
+    /// Reports this value to t_handler as the parser would have reported it
+    template<typename Handler>
+      void write( Handler &t_handler ) const {
+        switch( internal.Type ) {
+          case Class::Null:
+            t_handler.on_null();
+            return;
+          case Class::Object:
+            t_handler.on_begin_object();
+            for( auto &p : *internal.Map ) {
+              t_handler.on_key( p.first );
+              p.second.write( t_handler );
+            }
+            t_handler.on_end_object();
+            return;
+          case Class::Array:
+            t_handler.on_begin_array();
+            for( auto &p : *internal.List ) {
+              p.write( t_handler );
+            }
+            t_handler.on_end_array();
+            return;
+          case Class::String:
+            t_handler.on_string( *internal.String );
+            return;
+          case Class::Floating:
+            t_handler.on_floating( internal.Float );
+            return;
+          case Class::Integral:
+            t_handler.on_integral( internal.Int );
+            return;
+          case Class::Boolean:
+            t_handler.on_bool( internal.Bool );
+            return;
+        }
+
+        throw std::runtime_error("Unhandled JSON type");
+      }
+
+};
+
+
+/// Characters for JSONParser, taken from a memory buffer or read from a std::istream one block at a time
+class JSONSource
+{
+  public:
+    JSONSource( const char *t_begin, const char *t_end ) noexcept
+      : m_pos( t_begin ), m_end( t_end )
+    {
     }
 
+    explicit JSONSource( const std::string &t_str ) noexcept
+      : JSONSource( t_str.data(), t_str.data() + t_str.size() )
+    {
+    }
 
-  private:
-    static std::string json_escape( const std::string &str ) {
-      std::string output;
-      for(char i : str) {
-        switch( i ) {
-          case '\"': output += "\\\""; break;
-          case '\\': output += "\\\\"; break;
-          case '\b': output += "\\b";  break;
-          case '\f': output += "\\f";  break;
-          case '\n': output += "\\n";  break;
-          case '\r': output += "\\r";  break;
-          case '\t': output += "\\t";  break;
-          default  : output += i; break;
-        }
-}
-      return output;
+    explicit JSONSource( std::istream &t_stream, const size_t t_block_size = 64 * 1024 )
+      : m_stream( &t_stream ), m_block( t_block_size == 0 ? 1 : t_block_size )
+    {
     }
 
+    JSONSource( const JSONSource & ) = delete;
+    JSONSource &operator=( const JSONSource & ) = delete;
+
+    /// \returns the next character without consuming it, or '\0' at the end of the input
+    char peek() {
+      return ( m_pos != m_end || refill() ) ? *m_pos : '\0';
+    }
+
+    /// Consumes the next character
+    /// \returns the character, or '\0' at the end of the input
+    char get() {
+      return ( m_pos != m_end || refill() ) ? *m_pos++ : '\0';
+    }
+
+    /// Appends characters to t_str up to, not including, the next '"' or '\\'
+    void append_plain( std::string &t_str ) {
+      for (;;) {
+        const char *p = m_pos;
+        while( p != m_end && *p != '\"' && *p != '\\' ) { ++p; }
+        t_str.append( m_pos, p );
+        m_pos = p;
+
+        if( p != m_end || !refill() ) {
+          return;
+        }
+      }
+    }
 
   private:
+    bool refill() {
+      if( m_stream == nullptr ) {
+        return false;
+      }
+
+      m_stream->read( m_block.data(), static_cast<std::streamsize>( m_block.size() ) );
+      m_pos = m_block.data();
+      m_end = m_pos + m_stream->gcount();
+      return m_pos != m_end;
+    }
+
+    std::istream *m_stream = nullptr;
+    std::vector<char> m_block;
+    const char *m_pos = nullptr;
+    const char *m_end = nullptr;
 };
 
 
+/// Single pass JSON parser. Rather than building a document, it reports what it reads to a handler:
+///
+///     on_null(), on_bool(bool), on_integral(long), on_floating(double), on_string(std::string &),
+///     on_begin_object(), on_key(std::string &), on_end_object(), on_begin_array(), on_end_array()
+///
+/// Strings are passed in a buffer that is reused for the next string, the handler may move from it.
+/// Arrays and objects nested more than max_depth deep are refused rather than overflow the stack.
 struct JSONParser {
+  /// Deepest nesting of arrays and objects that is parsed
+  static constexpr size_t max_depth = 256;
+
   static bool isspace(const char c)
   {
 #ifdef CHAISCRIPT_MSVC
@@ -462,210 +521,560 @@ struct JSONParser {
 
   }
 
-  static void consume_ws( const std::string &str, size_t &offset ) {
-    while( isspace( str[offset] ) && offset <= str.size() ) { ++offset; }
+  /// Parses one JSON value from t_source
+  template<typename Handler>
+    static void parse( JSONSource &t_source, Handler &t_handler ) {
+      std::string buffer;
+      parse_next( t_source, t_handler, buffer, 0 );
+    }
+
+  /// Parses JSON values from t_source until the end of the input, such as a log file
+  /// with one document per line
+  template<typename Handler>
+    static void parse_sequence( JSONSource &t_source, Handler &t_handler ) {
+      std::string buffer;
+      for( consume_ws( t_source ); t_source.peek() != '\0'; consume_ws( t_source ) ) {
+        parse_next( t_source, t_handler, buffer, 0 );
+      }
+    }
+
+  static void consume_ws( JSONSource &src ) {
+    while( isspace( src.peek() ) ) { src.get(); }
+  }
+
+  static void check_depth( const size_t depth ) {
+    if( depth > max_depth ) {
+      throw std::runtime_error("JSON ERROR: Parse: Arrays and objects nested more than " + std::to_string(max_depth) + " deep");
+    }
   }
 
-  static JSON parse_object( const std::string &str, size_t &offset ) {
-    JSON Object( JSON::Class::Object );
+  /// depth is that of the object, 1 for one that is not inside another array or object
+  template<typename Handler>
+    static void parse_object( JSONSource &src, Handler &handler, std::string &buffer, const size_t depth ) {
+      check_depth( depth );
+      src.get();
+      handler.on_begin_object();
+
+      consume_ws( src );
+      if( src.peek() == '}' ) {
+        src.get();
+        handler.on_end_object();
+        return;
+      }
+
+      for (;;) {
+        consume_ws( src );
+        if( src.peek() != '\"' ) {
+          throw std::runtime_error(std::string("JSON ERROR: Object: Expected string key, found '") + src.peek() + "'\n");
+        }
+        parse_string( src, buffer );
+        handler.on_key( buffer );
+
+        consume_ws( src );
+        const char colon = src.get();
+        if( colon != ':' ) {
+          throw std::runtime_error(std::string("JSON ERROR: Object: Expected colon, found '") + colon + "'\n");
+        }
+        parse_next( src, handler, buffer, depth );
+
+        consume_ws( src );
+        const char c = src.get();
+        if( c == ',' ) {
+          continue;
+        }
+        else if( c == '}' ) {
+          break;
+        }
+        else {
+          throw std::runtime_error(std::string("JSON ERROR: Object: Expected comma, found '") + c + "'\n");
+        }
+      }
 
-    ++offset;
-    consume_ws( str, offset );
-    if( str[offset] == '}' ) {
-      ++offset; return Object;
+      handler.on_end_object();
     }
 
-    for (;offset<str.size();) {
-      JSON Key = parse_next( str, offset );
-      consume_ws( str, offset );
-      if( str[offset] != ':' ) {
-        throw std::runtime_error(std::string("JSON ERROR: Object: Expected colon, found '") + str[offset] + "'\n");
+  template<typename Handler>
+    static void parse_array( JSONSource &src, Handler &handler, std::string &buffer, const size_t depth ) {
+      check_depth( depth );
+      src.get();
+      handler.on_begin_array();
+
+      consume_ws( src );
+      if( src.peek() == ']' ) {
+        src.get();
+        handler.on_end_array();
+        return;
       }
-      consume_ws( str, ++offset );
-      JSON Value = parse_next( str, offset );
-      Object[Key.to_string()] = Value;
 
-      consume_ws( str, offset );
-      if( str[offset] == ',' ) {
-        ++offset; continue;
+      for (;;) {
+        parse_next( src, handler, buffer, depth );
+
+        consume_ws( src );
+        const char c = src.get();
+        if( c == ',' ) {
+          continue;
+        }
+        else if( c == ']' ) {
+          break;
+        }
+        else {
+          throw std::runtime_error(std::string("JSON ERROR: Array: Expected ',' or ']', found '") + c + "'\n");
+        }
       }
-      else if( str[offset] == '}' ) {
-        ++offset; break;
+
+      handler.on_end_array();
+    }
+
+  /// Reads the string starting at the opening quote into val
+  static void parse_string( JSONSource &src, std::string &val ) {
+    val.clear();
+    src.get();
+
+    for (;;) {
+      src.append_plain( val );
+
+      const char c = src.get();
+      if( c == '\"' ) {
+        return;
+      } else if( c == '\0' ) {
+        throw std::runtime_error("JSON ERROR: String: Unexpected end of input");
       }
-      else {
-        throw std::runtime_error(std::string("JSON ERROR: Object: Expected comma, found '") + str[offset] + "'\n");
+
+      const char escaped = src.get();
+      switch( escaped ) {
+        case '\"': val += '\"'; break;
+        case '\\': val += '\\'; break;
+        case '/' : val += '/' ; break;
+        case 'b' : val += '\b'; break;
+        case 'f' : val += '\f'; break;
+        case 'n' : val += '\n'; break;
+        case 'r' : val += '\r'; break;
+        case 't' : val += '\t'; break;
+        case 'u' : {
+                     val += "\\u" ;
+                     for( size_t i = 1; i <= 4; ++i ) {
+                       const char h = src.get();
+                       if( (h >= '0' && h <= '9') || (h >= 'a' && h <= 'f') || (h >= 'A' && h <= 'F') ) {
+                         val += h;
+                       } else {
+                         throw std::runtime_error(std::string("JSON ERROR: String: Expected hex character in unicode escape, found '") + h + "'");
+                       }
+                     }
+                   } break;
+        default  : val += '\\'; val += escaped; break;
       }
     }
+  }
 
-    return Object;
+  static bool is_number_end( const char c ) {
+    return c == '\0' || isspace( c ) || c == ',' || c == ']' || c == '}';
   }
 
-  static JSON parse_array( const std::string &str, size_t &offset ) {
-    JSON Array( JSON::Class::Array );
-    size_t index = 0;
+  template<typename Handler>
+    static void parse_number( JSONSource &src, Handler &handler, std::string &val ) {
+      val.clear();
+      bool isDouble = false;
+      bool isNegative = false;
+      bool hasExp = false;
+      long exp = 0;
+
+      if( src.peek() == '-' ) {
+        isNegative = true;
+        src.get();
+      }
 
-    ++offset;
-    consume_ws( str, offset );
-    if( str[offset] == ']' ) {
-      ++offset; return Array;
-    }
+      char c = src.peek();
+      for (;; c = src.peek()) {
+        if( c >= '0' && c <= '9' ) {
+          val += c;
+        } else if( c == '.' && !isDouble ) {
+          val += c;
+          isDouble = true;
+        } else {
+          break;
+        }
+        src.get();
+      }
+
+      if( c == 'E' || c == 'e' ) {
+        hasExp = true;
+        src.get();
+
+        bool negativeExp = false;
+        c = src.peek();
+        if( c == '-' ) {
+          negativeExp = true;
+          src.get();
+        } else if( c == '+' ) {
+          src.get();
+        }
+
+        for (c = src.peek(); c >= '0' && c <= '9'; c = src.peek()) {
+          exp = exp * 10 + (c - '0');
+          src.get();
+        }
 
-    for (;offset < str.size();) {
-      Array[index++] = parse_next( str, offset );
-      consume_ws( str, offset );
+        if( !is_number_end( c ) ) {
+          throw std::runtime_error(std::string("JSON ERROR: Number: Expected a number for exponent, found '") + c + "'");
+        }
 
-      if( str[offset] == ',' ) {
-        ++offset; continue;
+        if( negativeExp ) {
+          exp = -exp;
+        }
       }
-      else if( str[offset] == ']' ) {
-        ++offset; break;
+      else if( !is_number_end( c ) ) {
+        throw std::runtime_error(std::string("JSON ERROR: Number: unexpected character '") + c + "'");
       }
-      else {
-        throw std::runtime_error(std::string("JSON ERROR: Array: Expected ',' or ']', found '") + str[offset] + "'\n");
+
+      const double scale = hasExp ? std::pow( 10, exp ) : 1.0;
+      if( isDouble ) {
+        handler.on_floating( (isNegative?-1:1) * chaiscript::parse_num<double>( val ) * scale );
+      } else if( hasExp ) {
+        handler.on_floating( (isNegative?-1:1) * static_cast<double>(chaiscript::parse_num<long>( val )) * scale );
+      } else {
+        handler.on_integral( (isNegative?-1:1) * chaiscript::parse_num<long>( val ) );
       }
     }
 
-    return Array;
+  /// Consumes t_literal, which the input is expected to continue with
+  static void expect_literal( JSONSource &src, const std::string &t_literal, const char *t_error ) {
+    std::string found;
+    for( const char expected : t_literal ) {
+      const char c = src.get();
+      found += c;
+      if( c != expected ) {
+        throw std::runtime_error(t_error + found + "'");
+      }
+    }
   }
 
-  static JSON parse_string( const std::string &str, size_t &offset ) {
-    std::string val;
-    for( char c = str[++offset]; c != '\"' ; c = str[++offset] ) {
-      if( c == '\\' ) {
-        switch( str[ ++offset ] ) {
-          case '\"': val += '\"'; break;
-          case '\\': val += '\\'; break;
-          case '/' : val += '/' ; break;
-          case 'b' : val += '\b'; break;
-          case 'f' : val += '\f'; break;
-          case 'n' : val += '\n'; break;
-          case 'r' : val += '\r'; break;
-          case 't' : val += '\t'; break;
-          case 'u' : {
-                       val += "\\u" ;
-                       for( size_t i = 1; i <= 4; ++i ) {
-                         c = str[offset+i];
-                         if( (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') ) {
-                           val += c;
-                         } else {
-                           throw std::runtime_error(std::string("JSON ERROR: String: Expected hex character in unicode escape, found '") + c + "'");
-                         }
-                       }
-                       offset += 4;
-                     } break;
-          default  : val += '\\'; break;
-        }
-      } else {
-        val += c;
-      }
+  static bool parse_bool( JSONSource &src ) {
+    if( src.peek() == 't' ) {
+      expect_literal( src, "true", "JSON ERROR: Bool: Expected 'true' or 'false', found '" );
+      return true;
+    } else {
+      expect_literal( src, "false", "JSON ERROR: Bool: Expected 'true' or 'false', found '" );
+      return false;
     }
-    ++offset;
-    return JSON(val);
   }
 
-  static JSON parse_number( const std::string &str, size_t &offset ) {
-    std::string val, exp_str;
-    char c = '\0';
-    bool isDouble = false;
-    bool isNegative = false;
-    long exp = 0;
-    if( offset < str.size() && str[offset] == '-' ) {
-      isNegative = true;
-      ++offset;
-    }
-    for (; offset < str.size() ;) {
-      c = str[offset++];
-      if( c >= '0' && c <= '9' ) {
-        val += c;
-      } else if( c == '.' && !isDouble ) {
-        val += c; 
-        isDouble = true;
-      } else {
-        break;
+  static void parse_null( JSONSource &src ) {
+    expect_literal( src, "null", "JSON ERROR: Null: Expected 'null', found '" );
+  }
+
+  /// depth is that of the array or object holding the value, 0 for none
+  template<typename Handler>
+    static void parse_next( JSONSource &src, Handler &handler, std::string &buffer, const size_t depth ) {
+      consume_ws( src );
+      const char value = src.peek();
+      switch( value ) {
+        case '[' : parse_array( src, handler, buffer, depth + 1 ); return;
+        case '{' : parse_object( src, handler, buffer, depth + 1 ); return;
+        case '\"': parse_string( src, buffer ); handler.on_string( buffer ); return;
+        case 't' :
+        case 'f' : handler.on_bool( parse_bool( src ) ); return;
+        case 'n' : parse_null( src ); handler.on_null(); return;
+        default  : if( ( value <= '9' && value >= '0' ) || value == '-' ) {
+                     parse_number( src, handler, buffer );
+                     return;
+                   }
       }
+      throw std::runtime_error(std::string("JSON ERROR: Parse: Unexpected starting character '") + value + "'");
     }
-    if( offset < str.size() && (c == 'E' || c == 'e' )) {
-      c = str[ offset++ ];
-      if( c == '-' ) { 
-        exp_str += '-';
-      } else if( c == '+' ) {
-        // do nothing
-      } else { 
-        --offset; 
+
+};
+
+
+/// Handler for JSONParser that builds a JSON document
+class JSONBuilder
+{
+  public:
+    void on_null() { add( JSON() ); }
+    void on_bool( const bool t_b ) { add( JSON( t_b ) ); }
+    void on_integral( const long t_l ) { add( JSON( t_l ) ); }
+    void on_floating( const double t_d ) { add( JSON( t_d ) ); }
+    void on_string( std::string &t_str ) { add( JSON( std::move( t_str ) ) ); }
+    void on_key( std::string &t_key ) { m_key.swap( t_key ); }
+    void on_begin_object() { m_open.push_back( &add( JSON( JSON::Class::Object ) ) ); }
+    void on_end_object() { m_open.pop_back(); }
+    void on_begin_array() { m_open.push_back( &add( JSON( JSON::Class::Array ) ) ); }
+    void on_end_array() { m_open.pop_back(); }
+
+    JSON &result() { return m_result; }
+
+  private:
+    JSON &add( JSON t_value ) {
+      if( m_open.empty() ) {
+        m_result = std::move( t_value );
+        return m_result;
       }
 
-      for (; offset < str.size() ;) {
-        c = str[ offset++ ];
-        if( c >= '0' && c <= '9' ) {
-          exp_str += c;
-        } else if( !isspace( c ) && c != ',' && c != ']' && c != '}' ) {
-          throw std::runtime_error(std::string("JSON ERROR: Number: Expected a number for exponent, found '") + c + "'");
+      // the open containers are never resized while a child of theirs is still open
+      auto &parent = *m_open.back();
+      auto &slot = ( parent.JSONType() == JSON::Class::Object ) ? parent[ m_key ] : parent[ static_cast<size_t>( parent.length() ) ];
+      slot = std::move( t_value );
+      return slot;
+    }
+
+    JSON m_result;
+    std::vector<JSON *> m_open;
+    std::string m_key;
+};
+
+
+/// Handler for JSONParser, or for JSON::write(), that appends JSON text to a string as events are
+/// reported, in the layout of JSON::dump()
+class JSONWriter
+{
+  public:
+    explicit JSONWriter( std::string &t_out, const long t_depth = 1, std::string t_tab = "  " )
+      : m_out( t_out ), m_depth( t_depth ), m_tab( std::move( t_tab ) )
+    {
+    }
+
+    void on_null() { begin_value(); m_out += "null"; }
+    void on_bool( const bool t_b ) { begin_value(); m_out += t_b ? "true" : "false"; }
+
+    void on_integral( const long t_l ) {
+      begin_value();
+      char digits[24];
+      char *p = digits + sizeof(digits);
+      unsigned long u = t_l < 0 ? 0ul - static_cast<unsigned long>( t_l ) : static_cast<unsigned long>( t_l );
+      do {
+        *--p = static_cast<char>( '0' + u % 10 );
+        u /= 10;
+      } while( u != 0 );
+      if( t_l < 0 ) { *--p = '-'; }
+      m_out.append( p, digits + sizeof(digits) );
+    }
+
+    void on_floating( const double t_d ) {
+      begin_value();
+      // same text as std::to_string, without the temporary
+      char digits[512];
+      const int len = std::snprintf( digits, sizeof(digits), "%f", t_d );
+      m_out.append( digits, static_cast<size_t>( std::max( len, 0 ) ) );
+    }
+
+    void on_string( const std::string &t_str ) {
+      begin_value();
+      append_quoted( t_str );
+    }
+
+    void on_key( const std::string &t_key ) {
+      auto &level = m_levels.back();
+      if( !level.first ) { m_out += ",\n"; }
+      level.first = false;
+      pad( current_depth() );
+      append_quoted( t_key );
+      m_out += " : ";
+    }
+
+    void on_begin_object() {
+      begin_value();
+      m_out += "{\n";
+      m_levels.push_back( Level{ true, true } );
+    }
+
+    void on_end_object() {
+      const auto depth = current_depth();
+      m_levels.pop_back();
+      m_out += '\n';
+      pad( depth - 1 );
+      m_out += '}';
+    }
+
+    void on_begin_array() {
+      begin_value();
+      m_out += '[';
+      m_levels.push_back( Level{ false, true } );
+    }
+
+    void on_end_array() {
+      m_levels.pop_back();
+      m_out += ']';
+    }
+
+  private:
+    struct Level {
+      bool object;
+      bool first;
+    };
+
+    long current_depth() const {
+      return m_depth + static_cast<long>( m_levels.size() ) - 1;
+    }
+
+    void begin_value() {
+      if( !m_levels.empty() && !m_levels.back().object ) {
+        if( !m_levels.back().first ) { m_out += ", "; }
+        m_levels.back().first = false;
+      }
+    }
+
+    void pad( const long t_depth ) {
+      for( long i = 0; i < t_depth; ++i ) { m_out += m_tab; }
+    }
+
+    void append_quoted( const std::string &t_str ) {
+      m_out += '\"';
+      auto plain = t_str.begin();
+      for( auto itr = t_str.begin(); itr != t_str.end(); ++itr ) {
+        const char *escaped = nullptr;
+        switch( *itr ) {
+          case '\"': escaped = "\\\""; break;
+          case '\\': escaped = "\\\\"; break;
+          case '\b': escaped = "\\b";  break;
+          case '\f': escaped = "\\f";  break;
+          case '\n': escaped = "\\n";  break;
+          case '\r': escaped = "\\r";  break;
+          case '\t': escaped = "\\t";  break;
+          default  : continue;
         }
-        else {
-          break;
-}
+        m_out.append( plain, itr );
+        m_out += escaped;
+        plain = itr + 1;
       }
-      exp = chaiscript::parse_num<long>( exp_str );
+      m_out.append( plain, t_str.end() );
+      m_out += '\"';
     }
-    else if( offset < str.size() && (!isspace( c ) && c != ',' && c != ']' && c != '}' )) {
-      throw std::runtime_error(std::string("JSON ERROR: Number: unexpected character '") + c + "'");
+
+    std::string &m_out;
+    const long m_depth;
+    const std::string m_tab;
+    std::vector<Level> m_levels;
+};
+
+
+/// Handler for JSONParser that passes on only the values found at a path, and what they contain.
+/// A path is a list of object keys and array indices separated by '.', where '*' matches any key
+/// or index: "records.*.id" selects the "id" of every element of "records". An empty path selects
+/// the whole document. t_on_match is called after each selected value has been passed on.
+template<typename Handler>
+class JSONPathFilter
+{
+  public:
+    JSONPathFilter( Handler &t_handler, const std::string &t_path, std::function<void ()> t_on_match )
+      : m_handler( t_handler ), m_on_match( std::move( t_on_match ) )
+    {
+      if( !t_path.empty() ) {
+        size_t begin = 0;
+        for( size_t end = t_path.find( '.' ); end != std::string::npos; end = t_path.find( '.', begin ) ) {
+          m_path.push_back( t_path.substr( begin, end - begin ) );
+          begin = end + 1;
+        }
+        m_path.push_back( t_path.substr( begin ) );
+      }
     }
-    --offset;
 
-    if( isDouble ) {
-      return JSON((isNegative?-1:1) * chaiscript::parse_num<double>( val ) * std::pow( 10, exp ));
-    } else {
-      if( !exp_str.empty() ) {
-        return JSON((isNegative?-1:1) * static_cast<double>(chaiscript::parse_num<long>( val )) * std::pow( 10, exp ));
+    void on_null() { scalar( [this](){ m_handler.on_null(); } ); }
+    void on_bool( const bool t_b ) { scalar( [&](){ m_handler.on_bool( t_b ); } ); }
+    void on_integral( const long t_l ) { scalar( [&](){ m_handler.on_integral( t_l ); } ); }
+    void on_floating( const double t_d ) { scalar( [&](){ m_handler.on_floating( t_d ); } ); }
+    void on_string( std::string &t_str ) { scalar( [&](){ m_handler.on_string( t_str ); } ); }
+
+    void on_key( std::string &t_key ) {
+      if( m_matched_depth > 0 ) {
+        m_handler.on_key( t_key );
       } else {
-        return JSON((isNegative?-1:1) * chaiscript::parse_num<long>( val ));
+        m_levels.back().key.swap( t_key );
       }
     }
-  }
 
-  static JSON parse_bool( const std::string &str, size_t &offset ) {
-    if( str.substr( offset, 4 ) == "true" ) {
-      offset += 4;
-      return JSON(true);
-    } else if( str.substr( offset, 5 ) == "false" ) {
-      offset += 5;
-      return JSON(false);
-    } else {
-      throw std::runtime_error(std::string("JSON ERROR: Bool: Expected 'true' or 'false', found '") + str.substr( offset, 5 ) + "'");
+    void on_begin_object() { begin_container( true ); }
+    void on_end_object() { end_container( true ); }
+    void on_begin_array() { begin_container( false ); }
+    void on_end_array() { end_container( false ); }
+
+  private:
+    struct Level {
+      bool object;
+      bool on_path;
+      size_t index;
+      std::string key;
+    };
+
+    /// \returns whether the value now starting is on the path, and moves past it
+    bool next_on_path() {
+      if( m_levels.empty() ) {
+        return true;
+      }
+
+      auto &level = m_levels.back();
+      const auto depth = m_levels.size();
+      bool on_path = level.on_path && depth <= m_path.size();
+      if( on_path ) {
+        const auto &segment = m_path[depth - 1];
+        on_path = segment == "*" || ( level.object ? segment == level.key : segment == std::to_string( level.index ) );
+      }
+      ++level.index;
+      return on_path;
     }
-  }
 
-  static JSON parse_null( const std::string &str, size_t &offset ) {
-    if( str.substr( offset, 4 ) != "null" ) {
-      throw std::runtime_error(std::string("JSON ERROR: Null: Expected 'null', found '") + str.substr( offset, 4 ) + "'");
+    template<typename Forward>
+      void scalar( const Forward &t_forward ) {
+        if( m_matched_depth > 0 ) {
+          t_forward();
+        } else if( next_on_path() && m_levels.size() == m_path.size() ) {
+          t_forward();
+          m_on_match();
+        }
+      }
+
+    void begin_container( const bool t_object ) {
+      if( m_matched_depth == 0 ) {
+        const bool on_path = next_on_path();
+        if( !on_path || m_levels.size() != m_path.size() ) {
+          m_levels.push_back( Level{ t_object, on_path, 0, std::string() } );
+          return;
+        }
+      }
+
+      ++m_matched_depth;
+      if( t_object ) {
+        m_handler.on_begin_object();
+      } else {
+        m_handler.on_begin_array();
+      }
     }
-    offset += 4;
-    return JSON();
-  }
 
-  static JSON parse_next( const std::string &str, size_t &offset ) {
-    char value;
-    consume_ws( str, offset );
-    value = str[offset];
-    switch( value ) {
-      case '[' : return parse_array( str, offset );
-      case '{' : return parse_object( str, offset );
-      case '\"': return parse_string( str, offset );
-      case 't' :
-      case 'f' : return parse_bool( str, offset );
-      case 'n' : return parse_null( str, offset );
-      default  : if( ( value <= '9' && value >= '0' ) || value == '-' ) {
-                   return parse_number( str, offset );
-                 }
-    }
-    throw std::runtime_error(std::string("JSON ERROR: Parse: Unexpected starting character '") + value + "'");
-  }
+    void end_container( const bool t_object ) {
+      if( m_matched_depth == 0 ) {
+        m_levels.pop_back();
+        return;
+      }
+
+      if( t_object ) {
+        m_handler.on_end_object();
+      } else {
+        m_handler.on_end_array();
+      }
 
+      if( --m_matched_depth == 0 ) {
+        m_on_match();
+      }
+    }
+
+    Handler &m_handler;
+    std::function<void ()> m_on_match;
+    std::vector<std::string> m_path;
+    std::vector<Level> m_levels;
+    size_t m_matched_depth = 0;
 };
 
+
 inline JSON JSON::Load( const std::string &str ) {
-  size_t offset = 0;
-  return JSONParser::parse_next( str, offset );
+  JSONSource source( str );
+  JSONBuilder builder;
+  JSONParser::parse( source, builder );
+  return std::move( builder.result() );
+}
+
+inline std::string JSON::dump( long depth, std::string tab ) const {
+  std::string s;
+  JSONWriter writer( s, depth, std::move( tab ) );
+  write( writer );
+  return s;
 }
 
 } // End Namespace json
@@ -1,6 +1,10 @@
 #ifndef CHAISCRIPT_SIMPLEJSON_WRAP_HPP
 #define CHAISCRIPT_SIMPLEJSON_WRAP_HPP
 
+#include <fstream>
+#include <map>
+#include <unordered_map>
+
 #include "json.hpp"
 
 namespace chaiscript
@@ -13,127 +17,320 @@ namespace chaiscript
       {
 
         m.add(chaiscript::fun([](const std::string &t_str) { return from_json(t_str); }), "from_json");
-        m.add(chaiscript::fun(&json_wrap::to_json), "to_json");
+        m.add(chaiscript::fun([](const Boxed_Value &t_bv) { return to_json(t_bv); }), "to_json");
 
         return m;
 
       }
 
-    private:
+      /// Adds json_each, json_each_file, json_events and json_events_file to t_chai, a ChaiScript_Basic.
+      /// Unlike library() these need the engine itself, which gives each callback a scope of its own
+      /// (see ChaiScript_Basic::scoped_call), so they are added to an engine rather than to a Module.
+      template<typename Engine>
+      static void streaming_library(Engine &t_chai)
+      {
+        t_chai.add(chaiscript::fun(
+              [&t_chai](const std::string &t_json, const std::string &t_path, const Const_Proxy_Function &t_func) {
+                json::JSONSource source(t_json);
+                each(source, t_path, t_chai.template scoped_callback<const Boxed_Value &>(t_func));
+              }), "json_each");
+        t_chai.add(chaiscript::fun(
+              [&t_chai](const std::string &t_filename, const std::string &t_path, const Const_Proxy_Function &t_func) {
+                each_file(t_filename, t_path, t_chai.template scoped_callback<const Boxed_Value &>(t_func));
+              }), "json_each_file");
+        t_chai.add(chaiscript::fun(
+              [&t_chai](const std::string &t_json, const std::map<std::string, Boxed_Value> &t_handlers) {
+                json::JSONSource source(t_json);
+                events(source, event_callbacks(t_chai, t_handlers));
+              }), "json_events");
+        t_chai.add(chaiscript::fun(
+              [&t_chai](const std::string &t_filename, const std::map<std::string, Boxed_Value> &t_handlers) {
+                events_file(t_filename, event_callbacks(t_chai, t_handlers));
+              }), "json_events_file");
+      }
 
-      static Boxed_Value from_json(const json::JSON &t_json)
+      /// Parses t_json into Map, Vector, string, double, long and bool values; null becomes an undefined value
+      static Boxed_Value from_json(const std::string &t_json)
       {
-        switch( t_json.JSONType() ) {
-          case json::JSON::Class::Null:
-            return Boxed_Value();
-          case json::JSON::Class::Object:
-            {
-              std::map<std::string, Boxed_Value> m;
+        json::JSONSource source(t_json);
+        return from_json(source);
+      }
 
-              for (const auto &p : t_json.object_range())
-              {
-                m.insert(std::make_pair(p.first, from_json(p.second)));
-              }
+      /// Parses the JSON document read from t_stream, a block at a time
+      static Boxed_Value from_json(std::istream &t_stream)
+      {
+        json::JSONSource source(t_stream);
+        return from_json(source);
+      }
 
-              return Boxed_Value(m);
-            }
-          case json::JSON::Class::Array:
-            {
-              std::vector<Boxed_Value> vec;
+      static Boxed_Value from_json(json::JSONSource &t_source)
+      {
+        Boxed_Value_Builder builder;
+        json::JSONParser::parse(t_source, builder);
+        return builder.result();
+      }
 
-              for (const auto &p : t_json.array_range()) 
-              {
-                vec.emplace_back(from_json(p));
-              }
+      /// Calls t_func with each value found at t_path (see json::JSONPathFilter) in every document
+      /// of t_source. Only the selected values are built, one at a time.
+      static void each(json::JSONSource &t_source, const std::string &t_path, const std::function<void (const Boxed_Value &)> &t_func)
+      {
+        Boxed_Value_Builder builder;
+        json::JSONPathFilter<Boxed_Value_Builder> filter(builder, t_path, [&](){ t_func(builder.result()); });
+        json::JSONParser::parse_sequence(t_source, filter);
+      }
 
-              return Boxed_Value(vec);
-            }
-          case json::JSON::Class::String:
-            return Boxed_Value(t_json.to_string());
-          case json::JSON::Class::Floating:
-            return Boxed_Value(t_json.to_float());
-          case json::JSON::Class::Integral:
-            return Boxed_Value(t_json.to_int());
-          case json::JSON::Class::Boolean:
-            return Boxed_Value(t_json.to_bool());
-        }
+      static void each_file(const std::string &t_filename, const std::string &t_path, const std::function<void (const Boxed_Value &)> &t_func)
+      {
+        auto file = open(t_filename);
+        json::JSONSource source(file);
+        each(source, t_path, t_func);
+      }
+
+      /// Functions to be called as a document is parsed, any of which may be empty.
+      /// value is given strings, numbers, bools, and an undefined value for null.
+      struct Event_Callbacks
+      {
+        std::function<void ()> begin_object;
+        std::function<void ()> end_object;
+        std::function<void ()> begin_array;
+        std::function<void ()> end_array;
+        std::function<void (const std::string &)> key;
+        std::function<void (const Boxed_Value &)> value;
+      };
+
+      /// Reports every document in t_source to t_callbacks, without building any of it
+      static void events(json::JSONSource &t_source, const Event_Callbacks &t_callbacks)
+      {
+        Event_Handler handler(t_callbacks);
+        json::JSONParser::parse_sequence(t_source, handler);
+      }
 
-        throw std::runtime_error("Unknown JSON type");
+      static void events_file(const std::string &t_filename, const Event_Callbacks &t_callbacks)
+      {
+        auto file = open(t_filename);
+        json::JSONSource source(file);
+        events(source, t_callbacks);
       }
 
-      static Boxed_Value from_json(const std::string &t_json)
+      /// Maps the on_* handlers of json_events onto Event_Callbacks
+      template<typename Engine>
+      static Event_Callbacks event_callbacks(Engine &t_chai, const std::map<std::string, Boxed_Value> &t_handlers)
       {
-        return from_json( json::JSON::Load(t_json) );
+        Event_Callbacks callbacks;
+        for (const auto &handler : t_handlers)
+        {
+          const auto func = chaiscript::boxed_cast<Const_Proxy_Function>(handler.second);
+          if (handler.first == "on_begin_object") {
+            callbacks.begin_object = t_chai.template scoped_callback<>(func);
+          } else if (handler.first == "on_end_object") {
+            callbacks.end_object = t_chai.template scoped_callback<>(func);
+          } else if (handler.first == "on_begin_array") {
+            callbacks.begin_array = t_chai.template scoped_callback<>(func);
+          } else if (handler.first == "on_end_array") {
+            callbacks.end_array = t_chai.template scoped_callback<>(func);
+          } else if (handler.first == "on_key") {
+            callbacks.key = t_chai.template scoped_callback<const std::string &>(func);
+          } else if (handler.first == "on_value") {
+            callbacks.value = t_chai.template scoped_callback<const Boxed_Value &>(func);
+          } else {
+            throw std::runtime_error("Unknown JSON event: " + handler.first);
+          }
+        }
+        return callbacks;
       }
 
       static std::string to_json(const Boxed_Value &t_bv)
       {
-        return to_json_object(t_bv).dump();
+        std::string out;
+        to_json(t_bv, out);
+        return out;
       }
 
-      static json::JSON to_json_object(const Boxed_Value &t_bv)
+      /// Appends the JSON text for t_bv to t_out
+      static void to_json(const Boxed_Value &t_bv, std::string &t_out)
       {
-        try {
-          const std::map<std::string, Boxed_Value> m = chaiscript::boxed_cast<const std::map<std::string, Boxed_Value> &>(t_bv);
+        json::JSONWriter writer(t_out);
+        write(t_bv, writer);
+      }
 
-          json::JSON obj;
-          for (const auto &o : m)
+    private:
+
+      /// Builds the script values straight from the parser's events, without a json::JSON document in between
+      class Boxed_Value_Builder
+      {
+        public:
+          void on_null() { add(Boxed_Value()); }
+          void on_bool(const bool t_b) { add(Boxed_Value(t_b)); }
+          void on_integral(const long t_l) { add(Boxed_Value(t_l)); }
+          void on_floating(const double t_d) { add(Boxed_Value(t_d)); }
+          void on_string(std::string &t_str) { add(Boxed_Value(std::move(t_str))); }
+          void on_key(std::string &t_key) { m_frames.back().key.swap(t_key); }
+          void on_begin_object() { m_frames.emplace_back(true); }
+          void on_end_object() { add(Boxed_Value(std::move(pop().object))); }
+          void on_begin_array() { m_frames.emplace_back(false); }
+          void on_end_array() { add(Boxed_Value(std::move(pop().array))); }
+
+          Boxed_Value result() { return std::move(m_result); }
+
+        private:
+          struct Frame
+          {
+            explicit Frame(const bool t_is_object) : is_object(t_is_object) {}
+
+            bool is_object;
+            std::string key;
+            std::map<std::string, Boxed_Value> object;
+            std::vector<Boxed_Value> array;
+          };
+
+          Frame pop()
           {
-            obj[o.first] = to_json_object(o.second);
+            Frame frame = std::move(m_frames.back());
+            m_frames.pop_back();
+            return frame;
           }
-          return obj;
-        } catch (const chaiscript::exception::bad_boxed_cast &) {
-          // not a map
-        }
 
-        try {
-          const std::vector<Boxed_Value> v = chaiscript::boxed_cast<const std::vector<Boxed_Value> &>(t_bv);
+          void add(Boxed_Value &&t_bv)
+          {
+            if (m_frames.empty()) {
+              m_result = std::move(t_bv);
+            } else if (m_frames.back().is_object) {
+              // a repeated key keeps the last value, as json::JSON does
+              auto &frame = m_frames.back();
+              frame.object[std::move(frame.key)] = std::move(t_bv);
+            } else {
+              m_frames.back().array.push_back(std::move(t_bv));
+            }
+          }
 
-          json::JSON obj;
-          for (size_t i = 0; i < v.size(); ++i)
+          std::vector<Frame> m_frames;
+          Boxed_Value m_result;
+      };
+
+      class Event_Handler
+      {
+        public:
+          explicit Event_Handler(const Event_Callbacks &t_callbacks)
+            : m_callbacks(t_callbacks)
           {
-            obj[i] = to_json_object(v[i]);
           }
-          return obj;
-        } catch (const chaiscript::exception::bad_boxed_cast &) {
-          // not a vector
+
+          void on_null() { value(Boxed_Value()); }
+          void on_bool(const bool t_b) { value(Boxed_Value(t_b)); }
+          void on_integral(const long t_l) { value(Boxed_Value(t_l)); }
+          void on_floating(const double t_d) { value(Boxed_Value(t_d)); }
+          void on_string(std::string &t_str) { value(Boxed_Value(std::move(t_str))); }
+          void on_key(std::string &t_key) { if (m_callbacks.key) { m_callbacks.key(t_key); } }
+          void on_begin_object() { if (m_callbacks.begin_object) { m_callbacks.begin_object(); } }
+          void on_end_object() { if (m_callbacks.end_object) { m_callbacks.end_object(); } }
+          void on_begin_array() { if (m_callbacks.begin_array) { m_callbacks.begin_array(); } }
+          void on_end_array() { if (m_callbacks.end_array) { m_callbacks.end_array(); } }
+
+        private:
+          void value(const Boxed_Value &t_bv) { if (m_callbacks.value) { m_callbacks.value(t_bv); } }
+
+          const Event_Callbacks &m_callbacks;
+      };
+
+      static std::ifstream open(const std::string &t_filename)
+      {
+        std::ifstream file(t_filename, std::ios::in | std::ios::binary);
+        if (!file) {
+          throw exception::file_not_found_error(t_filename);
         }
+        return file;
+      }
 
+      template<typename Map>
+      static void write_object(const Map &t_map, json::JSONWriter &t_writer)
+      {
+        if (t_map.empty()) {
+          t_writer.on_null();
+          return;
+        }
+        t_writer.on_begin_object();
+        for (const auto &o : t_map)
+        {
+          t_writer.on_key(o.first);
+          write(o.second, t_writer);
+        }
+        t_writer.on_end_object();
+      }
 
-        try {
-          Boxed_Number bn(t_bv);
+      static void write_array(const std::vector<Boxed_Value> &t_vec, json::JSONWriter &t_writer)
+      {
+        if (t_vec.empty()) {
+          t_writer.on_null();
+          return;
+        }
+        t_writer.on_begin_array();
+        for (const auto &v : t_vec)
+        {
+          write(v, t_writer);
+        }
+        t_writer.on_end_array();
+      }
+
+      /// An empty Map, Hash_Map, Vector or object is written as null, as it always has been
+      static void write(const Boxed_Value &t_bv, json::JSONWriter &t_writer)
+      {
+        const auto &ti = t_bv.get_type_info();
+
+        if (ti.bare_equal(user_type<std::map<std::string, Boxed_Value>>())) {
+          write_object(chaiscript::boxed_cast<const std::map<std::string, Boxed_Value> &>(t_bv), t_writer);
+        } else if (ti.bare_equal(user_type<std::unordered_map<std::string, Boxed_Value>>())) {
+          // in the map's own order, which is unspecified
+          write_object(chaiscript::boxed_cast<const std::unordered_map<std::string, Boxed_Value> &>(t_bv), t_writer);
+        } else if (ti.bare_equal(user_type<std::vector<Boxed_Value>>())) {
+          write_array(chaiscript::boxed_cast<const std::vector<Boxed_Value> &>(t_bv), t_writer);
+        } else if (ti.is_arithmetic()) {
+          const Boxed_Number bn(t_bv);
           if (Boxed_Number::is_floating_point(t_bv))
           {
-            return json::JSON(bn.get_as<double>());
+            t_writer.on_floating(bn.get_as<double>());
           } else {
-            return json::JSON(bn.get_as<long>());
+            t_writer.on_integral(bn.get_as<long>());
           }
-        } catch (const chaiscript::detail::exception::bad_any_cast &) {
-          // not a number
+        } else if (ti.bare_equal(user_type<bool>())) {
+          t_writer.on_bool(chaiscript::boxed_cast<bool>(t_bv));
+        } else if (ti.bare_equal(user_type<std::string>())) {
+          t_writer.on_string(chaiscript::boxed_cast<const std::string &>(t_bv));
+        } else if (ti.bare_equal(user_type<dispatch::Dynamic_Object>())) {
+          write_object(chaiscript::boxed_cast<const dispatch::Dynamic_Object &>(t_bv).get_attrs(), t_writer);
+        } else if (t_bv.is_undef()) {
+          t_writer.on_null();
+        } else {
+          write_converted(t_bv, t_writer);
         }
+      }
 
+      /// Writes a value of any other type that casts to a Map, Vector, string or object
+      static void write_converted(const Boxed_Value &t_bv, json::JSONWriter &t_writer)
+      {
         try {
-          return json::JSON(boxed_cast<bool>(t_bv));
+          write_object(chaiscript::boxed_cast<const std::map<std::string, Boxed_Value> &>(t_bv), t_writer);
+          return;
         } catch (const chaiscript::exception::bad_boxed_cast &) {
-          // not a bool
+          // not a map
         }
 
         try {
-          return json::JSON(boxed_cast<std::string>(t_bv));
+          write_array(chaiscript::boxed_cast<const std::vector<Boxed_Value> &>(t_bv), t_writer);
+          return;
         } catch (const chaiscript::exception::bad_boxed_cast &) {
-          // not a string
+          // not a vector
         }
 
-
         try {
-          const chaiscript::dispatch::Dynamic_Object &o = boxed_cast<const dispatch::Dynamic_Object &>(t_bv);
+          t_writer.on_string(chaiscript::boxed_cast<const std::string &>(t_bv));
+          return;
+        } catch (const chaiscript::exception::bad_boxed_cast &) {
+          // not a string
+        }
 
-          json::JSON obj;
-          for (const auto &attr : o.get_attrs())
-          {
-            obj[attr.first] = to_json_object(attr.second);
-          }
-          return obj;
+        try {
+          write_object(chaiscript::boxed_cast<const dispatch::Dynamic_Object &>(t_bv).get_attrs(), t_writer);
+          return;
         } catch (const chaiscript::exception::bad_boxed_cast &) {
           // not a dynamic object
         }
@@ -141,7 +338,6 @@ namespace chaiscript
         throw std::runtime_error("Unknown object type to convert to JSON");
       }
 
-
   };
 
 
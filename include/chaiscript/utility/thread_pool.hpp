@@ -0,0 +1,430 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_UTILITY_THREAD_POOL_HPP_
+#define CHAISCRIPT_UTILITY_THREAD_POOL_HPP_
+
+#include "../chaiscript_defines.hpp"
+
+#ifndef CHAISCRIPT_NO_THREADS
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace chaiscript
+{
+  namespace utility
+  {
+    /// \brief A fixed size pool of worker threads with one task queue per worker.
+    ///
+    /// Tasks posted from a worker go to that worker's own queue, which it runs newest first.
+    /// Tasks posted from any other thread are spread over the queues round robin. A worker whose
+    /// queue is empty steals the oldest task from another worker's queue. Tasks posted with
+    /// post_to() are pinned to one worker and are never stolen.
+    ///
+    /// Tasks given to post() and post_to() must not throw, use submit() for tasks that may.
+    /// The destructor runs every task that is already queued, then joins the workers.
+    ///
+    /// A worker waiting on a future with wait_ready() runs the tasks that the task it is running
+    /// posted, and their own, newest first and at most max_help_depth deep, and otherwise sleeps
+    /// until some task of the pool finishes. Only when every worker is waiting with tasks still
+    /// queued does one of them run any queued task, beyond max_help_depth on a thread of its own.
+    class Thread_Pool
+    {
+      public:
+        typedef std::function<void ()> Task;
+
+        /// Tasks a waiting worker runs inside each other before it sleeps instead
+        static constexpr size_t max_help_depth = 16;
+
+        explicit Thread_Pool(const size_t t_num_threads = default_size())
+        {
+          const auto num_threads = t_num_threads == 0 ? size_t(1) : t_num_threads;
+
+          m_workers.reserve(num_threads);
+          for (size_t i = 0; i < num_threads; ++i) {
+            m_workers.push_back(std::make_unique<Worker>());
+          }
+
+          for (size_t i = 0; i < num_threads; ++i) {
+            m_workers[i]->thread = std::thread([this, i](){ run(i); });
+          }
+        }
+
+        Thread_Pool(const Thread_Pool &) = delete;
+        Thread_Pool &operator=(const Thread_Pool &) = delete;
+
+        ~Thread_Pool()
+        {
+          {
+            std::lock_guard<std::mutex> l(m_mutex);
+            m_stopping = true;
+          }
+          m_wakeup.notify_all();
+
+          for (auto &worker : m_workers) {
+            worker->thread.join();
+          }
+        }
+
+        /// \returns the number of hardware threads, or 1 if that is unknown
+        static size_t default_size()
+        {
+          const auto hardware = std::thread::hardware_concurrency();
+          return hardware == 0 ? size_t(1) : size_t(hardware);
+        }
+
+        size_t size() const noexcept
+        {
+          return m_workers.size();
+        }
+
+        /// \returns the index of the worker running the calling thread, or size() if the
+        ///          caller is not one of this pool's workers
+        size_t current_worker() const noexcept
+        {
+          const auto &current = current_thread();
+          return current.first == this ? current.second : size();
+        }
+
+        /// Queues t_task to be run by any worker
+        void post(Task t_task)
+        {
+          const auto worker = current_worker();
+          const auto index = worker != size() ? worker : (m_next_worker++ % size());
+
+          // counted before it is queued, so the count never drops below zero when the task is
+          // taken straight away
+          {
+            std::lock_guard<std::mutex> l(m_mutex);
+            ++m_stealable;
+          }
+
+          // a task posted by a worker is a subtask of the one it is running, which may run it
+          // while waiting; one posted from outside is not
+          const std::uint64_t seq = worker != size() ? m_next_seq++ : 0;
+
+          {
+            std::lock_guard<std::mutex> l(m_workers[index]->mutex);
+            m_workers[index]->tasks.push_back(Queued_Task{std::move(t_task), seq});
+          }
+          m_wakeup.notify_one();
+        }
+
+        /// Queues t_task to be run by worker t_worker and no other
+        void post_to(const size_t t_worker, Task t_task)
+        {
+          auto &worker = *m_workers.at(t_worker);
+
+          {
+            std::lock_guard<std::mutex> l(m_mutex);
+            ++worker.num_pinned;
+          }
+
+          {
+            std::lock_guard<std::mutex> l(worker.mutex);
+            worker.pinned.push_back(std::move(t_task));
+          }
+          m_wakeup.notify_all();
+        }
+
+        /// Queues t_func to be run by any worker
+        /// \returns a future for the result of t_func
+        template<typename Func>
+        auto submit(Func &&t_func) -> std::future<decltype(t_func())>
+        {
+          auto task = std::make_shared<std::packaged_task<decltype(t_func()) ()>>(std::forward<Func>(t_func));
+          auto result = task->get_future();
+          post([task](){ (*task)(); });
+          return result;
+        }
+
+        /// Queues t_func to be run by worker t_worker and no other
+        /// \returns a future for the result of t_func
+        template<typename Func>
+        auto submit_to(const size_t t_worker, Func &&t_func) -> std::future<decltype(t_func())>
+        {
+          auto task = std::make_shared<std::packaged_task<decltype(t_func()) ()>>(std::forward<Func>(t_func));
+          auto result = task->get_future();
+          post_to(t_worker, [task](){ (*task)(); });
+          return result;
+        }
+
+        /// Blocks until t_future is ready. If called from one of this pool's workers, the subtasks
+        /// of the task it is running are run while waiting, so that tasks may wait on tasks they
+        /// submitted without starving the pool.
+        template<typename Future>
+        void wait_ready(const Future &t_future)
+        {
+          if (current_worker() != size()) {
+            wait_until([&t_future](){ return t_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+          } else {
+            t_future.wait();
+          }
+        }
+
+        /// Waits for t_future as wait_ready() does
+        /// \returns the result of t_future
+        template<typename Result>
+        Result wait(std::future<Result> &t_future)
+        {
+          wait_ready(t_future);
+          return t_future.get();
+        }
+
+        /// Blocks until t_ready() returns true, checking it whenever a task of this pool finishes.
+        /// If called from one of this pool's workers, the subtasks of the task it is running are
+        /// run while waiting, as wait_ready() does.
+        template<typename Ready>
+        void wait_until(const Ready &t_ready)
+        {
+          const auto worker = current_worker();
+          for (;;) {
+            std::uint64_t finished = 0;
+            {
+              std::lock_guard<std::mutex> l(m_mutex);
+              finished = m_finished;
+            }
+
+            if (t_ready()) {
+              return;
+            }
+
+            if (worker != size() && run_subtask(*m_workers[worker])) {
+              continue;
+            }
+
+            std::unique_lock<std::mutex> l(m_mutex);
+            const auto stalled = [&]() {
+              return worker != size() && m_waiting_workers + 1 == size()
+                && (m_stealable != 0 || m_workers[worker]->num_pinned != 0);
+            };
+
+            if (!stalled()) {
+              ++m_waiting;
+              m_waiting_workers += worker != size() ? 1 : 0;
+              // timed as well, for a t_ready() that something other than this pool's tasks makes true
+              m_done.wait_for(l, std::chrono::milliseconds(10), [&](){ return m_finished != finished; });
+              m_waiting_workers -= worker != size() ? 1 : 0;
+              --m_waiting;
+
+              if (!stalled()) {
+                continue;
+              }
+            }
+
+            l.unlock();
+            run_stalled(worker);
+          }
+        }
+
+        /// \returns the pool shared by everything in the process that needs a general purpose
+        ///          executor, with one worker per hardware thread. It is created on first use.
+        static Thread_Pool &shared()
+        {
+          static Thread_Pool pool;
+          return pool;
+        }
+
+      private:
+        struct Queued_Task
+        {
+          Task task;
+          /// increasing with each post from a worker, 0 if posted from outside the pool
+          std::uint64_t seq;
+        };
+
+        struct Worker
+        {
+          std::mutex mutex;
+          std::deque<Queued_Task> tasks;
+          std::deque<Task> pinned;
+          size_t num_pinned = 0; // protected by Thread_Pool::m_mutex
+          std::thread thread;
+
+          // used by the worker's own thread only
+          /// tasks posted from this worker from this seq on are subtasks of the task it is running
+          std::uint64_t first_subtask = 0;
+          size_t depth = 0;
+        };
+
+        static std::pair<const Thread_Pool *, size_t> &current_thread() noexcept
+        {
+          thread_local std::pair<const Thread_Pool *, size_t> current(nullptr, 0);
+          return current;
+        }
+
+        void run_task(Worker &t_self, Task &t_task)
+        {
+          const auto first_subtask = t_self.first_subtask;
+          t_self.first_subtask = m_next_seq;
+          ++t_self.depth;
+          t_task();
+          --t_self.depth;
+          t_self.first_subtask = first_subtask;
+
+          std::lock_guard<std::mutex> l(m_mutex);
+          ++m_finished;
+          if (m_waiting != 0) {
+            m_done.notify_all();
+          }
+        }
+
+        /// Runs the newest subtask of the task t_self is running, if it is still queued
+        /// \returns true if a task was run
+        bool run_subtask(Worker &t_self)
+        {
+          if (t_self.depth > max_help_depth) {
+            return false;
+          }
+
+          Task task;
+          {
+            std::unique_lock<std::mutex> l(t_self.mutex);
+            if (t_self.tasks.empty() || t_self.tasks.back().seq < t_self.first_subtask) {
+              return false;
+            }
+            task = std::move(t_self.tasks.back().task);
+            t_self.tasks.pop_back();
+          }
+
+          {
+            std::lock_guard<std::mutex> l(m_mutex);
+            --m_stealable;
+          }
+
+          run_task(t_self, task);
+          return true;
+        }
+
+        /// Runs any queued task for t_worker, while it and every other worker are waiting on tasks
+        /// that none of them may run
+        void run_stalled(const size_t t_worker)
+        {
+          auto &self = *m_workers[t_worker];
+          Task task;
+          if (!try_pop(t_worker, task)) {
+            return;
+          }
+
+          if (self.depth <= max_help_depth) {
+            run_task(self, task);
+            return;
+          }
+
+          // this stack is deep enough already: a thread of its own stands in for the worker
+          const auto depth = self.depth;
+          self.depth = 0;
+          std::thread([this, t_worker, &self, &task]() {
+                current_thread() = std::make_pair(this, t_worker);
+                run_task(self, task);
+              }).join();
+          self.depth = depth;
+        }
+
+        bool try_pop(const size_t t_worker, Task &t_task)
+        {
+          auto &self = *m_workers[t_worker];
+
+          {
+            std::unique_lock<std::mutex> l(self.mutex);
+            if (!self.pinned.empty()) {
+              t_task = std::move(self.pinned.front());
+              self.pinned.pop_front();
+              l.unlock();
+
+              std::lock_guard<std::mutex> l2(m_mutex);
+              --self.num_pinned;
+              return true;
+            }
+
+            if (!self.tasks.empty()) {
+              t_task = std::move(self.tasks.back().task);
+              self.tasks.pop_back();
+              l.unlock();
+
+              std::lock_guard<std::mutex> l2(m_mutex);
+              --m_stealable;
+              return true;
+            }
+          }
+
+          for (size_t i = 1; i < m_workers.size(); ++i) {
+            auto &victim = *m_workers[(t_worker + i) % m_workers.size()];
+
+            std::unique_lock<std::mutex> l(victim.mutex);
+            if (!victim.tasks.empty()) {
+              t_task = std::move(victim.tasks.front().task);
+              victim.tasks.pop_front();
+              l.unlock();
+
+              std::lock_guard<std::mutex> l2(m_mutex);
+              --m_stealable;
+              return true;
+            }
+          }
+
+          return false;
+        }
+
+        void run(const size_t t_worker)
+        {
+          current_thread() = std::make_pair(this, t_worker);
+          auto &self = *m_workers[t_worker];
+
+          for (;;)
+          {
+            Task task;
+            if (try_pop(t_worker, task)) {
+              run_task(self, task);
+              continue;
+            }
+
+            std::unique_lock<std::mutex> l(m_mutex);
+            m_wakeup.wait(l, [&](){ return m_stopping || m_stealable != 0 || self.num_pinned != 0; });
+
+            if (m_stopping && m_stealable == 0 && self.num_pinned == 0) {
+              return;
+            }
+          }
+        }
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::atomic<size_t> m_next_worker{0};
+        std::atomic<std::uint64_t> m_next_seq{1};
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeup;
+        size_t m_stealable = 0;
+        bool m_stopping = false;
+
+        /// signalled when a task finishes, for wait_until()
+        std::condition_variable m_done;
+        std::uint64_t m_finished = 0;
+        size_t m_waiting = 0;
+        size_t m_waiting_workers = 0;
+    };
+  }
+}
+
+#endif
+
+#endif
+
@@ -0,0 +1,515 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_UTILITY_TYPED_ARRAY_HPP_
+#define CHAISCRIPT_UTILITY_TYPED_ARRAY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../dispatchkit/boxed_number.hpp"
+
+namespace chaiscript
+{
+  /// A contiguous array of one arithmetic type. Unlike a Vector, whose elements are each
+  /// boxed, the element wise operations and reductions below are plain loops over the
+  /// storage, which the compiler is free to vectorize.
+  template<typename T>
+    class Typed_Array
+    {
+      static_assert(std::is_arithmetic<T>::value, "Typed_Array holds arithmetic types only");
+
+      public:
+        typedef typename std::vector<T>::value_type value_type;
+        typedef typename std::vector<T>::reference reference;
+        typedef typename std::vector<T>::const_reference const_reference;
+        typedef typename std::vector<T>::size_type size_type;
+        typedef typename std::vector<T>::iterator iterator;
+        typedef typename std::vector<T>::const_iterator const_iterator;
+
+        Typed_Array() = default;
+
+        explicit Typed_Array(const size_type t_size, const T t_value = T())
+          : m_values(t_size, t_value)
+        {
+        }
+
+        explicit Typed_Array(std::vector<T> t_values)
+          : m_values(std::move(t_values))
+        {
+        }
+
+        iterator begin() { return m_values.begin(); }
+        iterator end() { return m_values.end(); }
+        const_iterator begin() const { return m_values.begin(); }
+        const_iterator end() const { return m_values.end(); }
+
+        size_type size() const { return m_values.size(); }
+        bool empty() const { return m_values.empty(); }
+        void clear() { m_values.clear(); }
+        void resize(const size_type t_size) { m_values.resize(t_size); }
+        void resize(const size_type t_size, const T &t_value) { m_values.resize(t_size, t_value); }
+        void reserve(const size_type t_size) { m_values.reserve(t_size); }
+        size_type capacity() const { return m_values.capacity(); }
+
+        reference at(const size_type t_pos) { return m_values.at(t_pos); }
+        const_reference at(const size_type t_pos) const { return m_values.at(t_pos); }
+        reference operator[](const size_type t_pos) { return m_values[t_pos]; }
+        const_reference operator[](const size_type t_pos) const { return m_values[t_pos]; }
+
+        reference front() { return m_values.front(); }
+        const_reference front() const { return m_values.front(); }
+        reference back() { return m_values.back(); }
+        const_reference back() const { return m_values.back(); }
+        void push_back(const T &t_value) { m_values.push_back(t_value); }
+        void pop_back() { m_values.pop_back(); }
+
+        T *data() { return m_values.data(); }
+        const T *data() const { return m_values.data(); }
+
+        const std::vector<T> &values() const { return m_values; }
+
+      private:
+        std::vector<T> m_values;
+    };
+
+
+  /// The result of comparing Typed_Arrays: one flag per element, used to select elements
+  class Array_Mask
+  {
+    public:
+      typedef std::vector<std::uint8_t>::size_type size_type;
+
+      Array_Mask() = default;
+
+      explicit Array_Mask(const size_type t_size)
+        : m_flags(t_size, 0)
+      {
+      }
+
+      size_type size() const { return m_flags.size(); }
+      bool empty() const { return m_flags.empty(); }
+      bool at(const size_type t_pos) const { return m_flags.at(t_pos) != 0; }
+
+      /// The number of elements set
+      size_type count() const
+      {
+        size_type total = 0;
+        for (const auto flag : m_flags) {
+          total += flag;
+        }
+        return total;
+      }
+
+      bool any() const { return count() != 0; }
+      bool all() const { return count() == size(); }
+
+      std::uint8_t *data() { return m_flags.data(); }
+      const std::uint8_t *data() const { return m_flags.data(); }
+
+    private:
+      std::vector<std::uint8_t> m_flags;
+  };
+
+
+  namespace typed_array
+  {
+    /// Reductions over T are carried out in this type, so that sums of narrow types do not overflow or lose
+    /// precision; an integral reduction that overflows even this throws exception::arithmetic_error
+    template<typename T>
+      using accumulator_type = typename std::conditional<std::is_floating_point<T>::value, double, std::int64_t>::type;
+
+    namespace detail
+    {
+      /// Reductions keep this many independent partial results, which breaks the dependency
+      /// between iterations and lets each lane live in its own vector register slot
+      constexpr std::size_t lanes = 8;
+
+      template<typename Size>
+        void check_sizes(const Size t_lhs, const Size t_rhs)
+        {
+          if (t_lhs != t_rhs) {
+            throw std::range_error("Typed array sizes do not match");
+          }
+        }
+
+      template<typename T>
+        void check_divisor(const Typed_Array<T> &, std::false_type)
+        {
+        }
+
+      template<typename T>
+        void check_divisor(const Typed_Array<T> &t_divisor, std::true_type)
+        {
+#ifndef CHAISCRIPT_NO_PROTECT_DIVIDEBYZERO
+          const T *d = t_divisor.data();
+          bool zero = false;
+          for (std::size_t i = 0; i < t_divisor.size(); ++i) {
+            zero |= (d[i] == 0);
+          }
+          if (zero) {
+            throw chaiscript::exception::arithmetic_error("divide by zero");
+          }
+#endif
+        }
+
+      template<typename T>
+        void check_divisor(const T, std::false_type)
+        {
+        }
+
+      template<typename T>
+        void check_divisor(const T t_divisor, std::true_type)
+        {
+#ifndef CHAISCRIPT_NO_PROTECT_DIVIDEBYZERO
+          if (t_divisor == 0) {
+            throw chaiscript::exception::arithmetic_error("divide by zero");
+          }
+#endif
+        }
+
+      inline void check_overflow(const bool t_overflow)
+      {
+        if (t_overflow) {
+          throw chaiscript::exception::arithmetic_error("integer overflow");
+        }
+      }
+
+      /// Integral sums and products note an overflow in t_overflow, to be checked once the loop is done
+      template<typename A>
+        A add(const A t_lhs, const A t_rhs, bool &t_overflow, std::true_type)
+        {
+          A out = 0;
+          t_overflow |= chaiscript::detail::Checked_Arithmetic::sum(t_lhs, t_rhs, out);
+          return out;
+        }
+
+      template<typename A>
+        A add(const A t_lhs, const A t_rhs, bool &, std::false_type)
+        {
+          return t_lhs + t_rhs;
+        }
+
+      template<typename A>
+        A multiply(const A t_lhs, const A t_rhs, bool &t_overflow, std::true_type)
+        {
+          A out = 0;
+          t_overflow |= chaiscript::detail::Checked_Arithmetic::product(t_lhs, t_rhs, out);
+          return out;
+        }
+
+      template<typename A>
+        A multiply(const A t_lhs, const A t_rhs, bool &, std::false_type)
+        {
+          return t_lhs * t_rhs;
+        }
+
+      /// Sums t_term(i) for every i below t_size
+      template<typename T, typename Term>
+        accumulator_type<T> accumulate(const std::size_t t_size, Term t_term, bool &t_overflow)
+        {
+          const typename std::is_integral<T>::type integral{};
+
+          accumulator_type<T> partial[lanes] = {};
+          std::size_t i = 0;
+          for (; i + lanes <= t_size; i += lanes) {
+            for (std::size_t l = 0; l < lanes; ++l) {
+              partial[l] = add(partial[l], t_term(i + l), t_overflow, integral);
+            }
+          }
+          for (; i < t_size; ++i) {
+            partial[0] = add(partial[0], t_term(i), t_overflow, integral);
+          }
+
+          accumulator_type<T> total = 0;
+          for (const auto p : partial) {
+            total = add(total, p, t_overflow, integral);
+          }
+          check_overflow(t_overflow);
+          return total;
+        }
+
+      /// Integral quotients check for the one that overflows, the minimum divided by -1
+      template<typename T>
+        auto divides(bool &t_overflow, std::true_type)
+        {
+          return [&t_overflow](const T t_lhs, const T t_rhs) {
+            T out = 0;
+            t_overflow |= chaiscript::detail::Checked_Arithmetic::quotient(t_lhs, t_rhs, out);
+            return out;
+          };
+        }
+
+      template<typename T>
+        std::divides<T> divides(bool &, std::false_type)
+        {
+          return std::divides<T>();
+        }
+
+      /// Keeps whichever of two values t_better prefers, across the whole array
+      template<typename T, typename Better>
+        T select_extreme(const Typed_Array<T> &t_array, Better t_better)
+        {
+          if (t_array.empty()) {
+            throw std::range_error("Typed array is empty");
+          }
+
+          const T *x = t_array.data();
+          const std::size_t size = t_array.size();
+
+          T best[lanes];
+          for (auto &b : best) {
+            b = x[0];
+          }
+
+          std::size_t i = 0;
+          for (; i + lanes <= size; i += lanes) {
+            for (std::size_t l = 0; l < lanes; ++l) {
+              best[l] = t_better(x[i + l], best[l]) ? x[i + l] : best[l];
+            }
+          }
+          for (; i < size; ++i) {
+            best[0] = t_better(x[i], best[0]) ? x[i] : best[0];
+          }
+
+          T result = best[0];
+          for (const auto b : best) {
+            result = t_better(b, result) ? b : result;
+          }
+          return result;
+        }
+    }
+
+    /// Applies t_op to each pair of elements of two equally sized arrays
+    template<typename T, typename Op>
+      Typed_Array<T> combine(const Typed_Array<T> &t_lhs, const Typed_Array<T> &t_rhs, Op t_op)
+      {
+        detail::check_sizes(t_lhs.size(), t_rhs.size());
+        Typed_Array<T> result(t_lhs.size());
+        const T *x = t_lhs.data();
+        const T *y = t_rhs.data();
+        T *r = result.data();
+        for (std::size_t i = 0; i < result.size(); ++i) {
+          r[i] = t_op(x[i], y[i]);
+        }
+        return result;
+      }
+
+    /// Applies t_op to each element and a scalar
+    template<typename T, typename Op>
+      Typed_Array<T> combine(const Typed_Array<T> &t_lhs, const T t_rhs, Op t_op)
+      {
+        Typed_Array<T> result(t_lhs.size());
+        const T *x = t_lhs.data();
+        T *r = result.data();
+        for (std::size_t i = 0; i < result.size(); ++i) {
+          r[i] = t_op(x[i], t_rhs);
+        }
+        return result;
+      }
+
+    template<typename T, typename Op>
+      Typed_Array<T> combine(const T t_lhs, const Typed_Array<T> &t_rhs, Op t_op)
+      {
+        Typed_Array<T> result(t_rhs.size());
+        const T *y = t_rhs.data();
+        T *r = result.data();
+        for (std::size_t i = 0; i < result.size(); ++i) {
+          r[i] = t_op(t_lhs, y[i]);
+        }
+        return result;
+      }
+
+    /// In place form of combine, for the compound assignment operators
+    template<typename T, typename Op>
+      Typed_Array<T> &update(Typed_Array<T> &t_lhs, const Typed_Array<T> &t_rhs, Op t_op)
+      {
+        detail::check_sizes(t_lhs.size(), t_rhs.size());
+        T *x = t_lhs.data();
+        const T *y = t_rhs.data();
+        for (std::size_t i = 0; i < t_lhs.size(); ++i) {
+          x[i] = t_op(x[i], y[i]);
+        }
+        return t_lhs;
+      }
+
+    template<typename T, typename Op>
+      Typed_Array<T> &update(Typed_Array<T> &t_lhs, const T t_rhs, Op t_op)
+      {
+        T *x = t_lhs.data();
+        for (std::size_t i = 0; i < t_lhs.size(); ++i) {
+          x[i] = t_op(x[i], t_rhs);
+        }
+        return t_lhs;
+      }
+
+    /// Integral division checks the whole divisor up front, so the division loop itself stays branch free
+    template<typename T, typename Divisor>
+      void check_divisor(const Divisor &t_divisor)
+      {
+        detail::check_divisor(t_divisor, typename std::is_integral<T>::type());
+      }
+
+    /// Element wise t_lhs / t_rhs, for two arrays or an array and a scalar
+    /// \throws exception::arithmetic_error if an integral divisor is 0 or a quotient overflows
+    template<typename T, typename Lhs, typename Rhs>
+      Typed_Array<T> divide(const Lhs &t_lhs, const Rhs &t_rhs)
+      {
+        check_divisor<T>(t_rhs);
+        bool overflow = false;
+        auto result = combine(t_lhs, t_rhs, detail::divides<T>(overflow, typename std::is_integral<T>::type()));
+        detail::check_overflow(overflow);
+        return result;
+      }
+
+    /// In place form of divide; a zero divisor leaves t_lhs unchanged, an overflow leaves it divided
+    template<typename T, typename Rhs>
+      Typed_Array<T> &divide_assign(Typed_Array<T> &t_lhs, const Rhs &t_rhs)
+      {
+        check_divisor<T>(t_rhs);
+        bool overflow = false;
+        update(t_lhs, t_rhs, detail::divides<T>(overflow, typename std::is_integral<T>::type()));
+        detail::check_overflow(overflow);
+        return t_lhs;
+      }
+
+    /// Compares each pair of elements of two equally sized arrays
+    template<typename T, typename Op>
+      Array_Mask compare(const Typed_Array<T> &t_lhs, const Typed_Array<T> &t_rhs, Op t_op)
+      {
+        detail::check_sizes(t_lhs.size(), t_rhs.size());
+        Array_Mask result(t_lhs.size());
+        const T *x = t_lhs.data();
+        const T *y = t_rhs.data();
+        std::uint8_t *r = result.data();
+        for (std::size_t i = 0; i < result.size(); ++i) {
+          r[i] = t_op(x[i], y[i]) ? 1 : 0;
+        }
+        return result;
+      }
+
+    template<typename T, typename Op>
+      Array_Mask compare(const Typed_Array<T> &t_lhs, const T t_rhs, Op t_op)
+      {
+        Array_Mask result(t_lhs.size());
+        const T *x = t_lhs.data();
+        std::uint8_t *r = result.data();
+        for (std::size_t i = 0; i < result.size(); ++i) {
+          r[i] = t_op(x[i], t_rhs) ? 1 : 0;
+        }
+        return result;
+      }
+
+    /// Combines two equally sized masks flag by flag
+    template<typename Op>
+      Array_Mask combine(const Array_Mask &t_lhs, const Array_Mask &t_rhs, Op t_op)
+      {
+        detail::check_sizes(t_lhs.size(), t_rhs.size());
+        Array_Mask result(t_lhs.size());
+        const std::uint8_t *x = t_lhs.data();
+        const std::uint8_t *y = t_rhs.data();
+        std::uint8_t *r = result.data();
+        for (std::size_t i = 0; i < result.size(); ++i) {
+          r[i] = static_cast<std::uint8_t>(t_op(x[i], y[i]));
+        }
+        return result;
+      }
+
+    inline Array_Mask invert(const Array_Mask &t_mask)
+    {
+      Array_Mask result(t_mask.size());
+      const std::uint8_t *x = t_mask.data();
+      std::uint8_t *r = result.data();
+      for (std::size_t i = 0; i < result.size(); ++i) {
+        r[i] = static_cast<std::uint8_t>(x[i] ^ 1);
+      }
+      return result;
+    }
+
+    /// The elements of t_array whose flag is set in t_mask, in order
+    template<typename T>
+      Typed_Array<T> select(const Typed_Array<T> &t_array, const Array_Mask &t_mask)
+      {
+        detail::check_sizes(t_array.size(), t_mask.size());
+        const auto count = t_mask.count();
+        // one spare slot, because every element is written whether or not it is kept
+        Typed_Array<T> result(count + 1);
+        const T *x = t_array.data();
+        const std::uint8_t *m = t_mask.data();
+        T *r = result.data();
+        std::size_t out = 0;
+        for (std::size_t i = 0; i < t_array.size(); ++i) {
+          // advancing only on a set flag, rather than branching per element
+          r[out] = x[i];
+          out += m[i];
+        }
+        result.resize(count);
+        return result;
+      }
+
+    /// The elements of t_lhs where t_mask is set and of t_rhs elsewhere
+    template<typename T>
+      Typed_Array<T> where(const Array_Mask &t_mask, const Typed_Array<T> &t_lhs, const Typed_Array<T> &t_rhs)
+      {
+        detail::check_sizes(t_mask.size(), t_lhs.size());
+        detail::check_sizes(t_mask.size(), t_rhs.size());
+        Typed_Array<T> result(t_mask.size());
+        const std::uint8_t *m = t_mask.data();
+        const T *x = t_lhs.data();
+        const T *y = t_rhs.data();
+        T *r = result.data();
+        for (std::size_t i = 0; i < result.size(); ++i) {
+          r[i] = m[i] ? x[i] : y[i];
+        }
+        return result;
+      }
+
+    template<typename T>
+      accumulator_type<T> sum(const Typed_Array<T> &t_array)
+      {
+        const T *x = t_array.data();
+        bool overflow = false;
+        return detail::accumulate<T>(t_array.size(), [x](const std::size_t i) { return static_cast<accumulator_type<T>>(x[i]); }, overflow);
+      }
+
+    template<typename T>
+      accumulator_type<T> dot(const Typed_Array<T> &t_lhs, const Typed_Array<T> &t_rhs)
+      {
+        detail::check_sizes(t_lhs.size(), t_rhs.size());
+        const T *x = t_lhs.data();
+        const T *y = t_rhs.data();
+        bool overflow = false;
+        return detail::accumulate<T>(t_lhs.size(),
+            [x, y, &overflow](const std::size_t i) {
+              return detail::multiply(static_cast<accumulator_type<T>>(x[i]), static_cast<accumulator_type<T>>(y[i]), overflow,
+                  typename std::is_integral<T>::type());
+            }, overflow);
+      }
+
+    template<typename T>
+      T min(const Typed_Array<T> &t_array)
+      {
+        return detail::select_extreme(t_array, [](const T lhs, const T rhs) { return lhs < rhs; });
+      }
+
+    template<typename T>
+      T max(const Typed_Array<T> &t_array)
+      {
+        return detail::select_extreme(t_array, [](const T lhs, const T rhs) { return lhs > rhs; });
+      }
+  }
+}
+
+#endif
@@ -0,0 +1,219 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+#ifndef CHAISCRIPT_UTILITY_VIEW_HPP_
+#define CHAISCRIPT_UTILITY_VIEW_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace chaiscript
+{
+  namespace view_detail
+  {
+    /// \returns the [t_pos, t_pos + t_len) part of a view of t_size elements, as (offset, length),
+    ///          with t_len clamped to the end like std::string::substr
+    inline std::pair<std::size_t, std::size_t> slice(const std::size_t t_size, const std::size_t t_pos, const std::size_t t_len)
+    {
+      if (t_pos > t_size) {
+        throw std::out_of_range("View slice starts past the end");
+      }
+      return std::make_pair(t_pos, std::min(t_len, t_size - t_pos));
+    }
+
+    inline void check_index(const std::size_t t_size, const std::size_t t_pos)
+    {
+      if (t_pos >= t_size) {
+        throw std::out_of_range("View index out of range");
+      }
+    }
+  }
+
+  /// A view of a contiguous sequence of T owned by the host, such as a std::vector<T>.
+  ///
+  /// Indexing gives references into the host memory and slicing gives another Span, so a
+  /// script can walk and cut up the sequence without copying it. The viewed memory must
+  /// outlive the Span and every slice of it, and must not be reallocated in the meantime.
+  template<typename T>
+    class Span
+    {
+      public:
+        typedef T value_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef std::size_t size_type;
+        typedef T *iterator;
+        typedef const T *const_iterator;
+
+        Span() = default;
+
+        Span(T *t_data, const size_type t_size)
+          : m_data(t_data), m_size(t_size)
+        {
+        }
+
+        /// Views the elements of t_container, which must provide data() and size()
+        template<typename Container>
+          explicit Span(Container &t_container)
+            : m_data(t_container.data()), m_size(t_container.size())
+          {
+          }
+
+        iterator begin() { return m_data; }
+        iterator end() { return m_data + m_size; }
+        const_iterator begin() const { return m_data; }
+        const_iterator end() const { return m_data + m_size; }
+
+        size_type size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+
+        reference at(const size_type t_pos) { view_detail::check_index(m_size, t_pos); return m_data[t_pos]; }
+        const_reference at(const size_type t_pos) const { view_detail::check_index(m_size, t_pos); return m_data[t_pos]; }
+        reference operator[](const size_type t_pos) { return m_data[t_pos]; }
+        const_reference operator[](const size_type t_pos) const { return m_data[t_pos]; }
+
+        reference front() { return at(0); }
+        const_reference front() const { return at(0); }
+        reference back() { return at(m_size - 1); }
+        const_reference back() const { return at(m_size - 1); }
+
+        T *data() const { return m_data; }
+
+        /// The t_len elements from t_pos, or fewer at the end of the view
+        Span subspan(const size_type t_pos, const size_type t_len) const
+        {
+          const auto part = view_detail::slice(m_size, t_pos, t_len);
+          return Span(m_data + part.first, part.second);
+        }
+
+      private:
+        T *m_data = nullptr;
+        size_type m_size = 0;
+    };
+
+  template<typename Container>
+    auto make_span(Container &t_container)
+    {
+      return Span<std::remove_pointer_t<decltype(t_container.data())>>(t_container);
+    }
+
+
+  /// A read only view of characters owned by the host, such as a std::string or a mapped file.
+  ///
+  /// Slicing and searching work on the viewed characters in place, to_string makes the one copy.
+  /// The viewed characters must outlive the String_View and every slice of it.
+  class String_View
+  {
+    public:
+      typedef char value_type;
+      typedef const char &reference;
+      typedef const char &const_reference;
+      typedef std::size_t size_type;
+      typedef const char *iterator;
+      typedef const char *const_iterator;
+
+      static const size_type npos = std::string::npos;
+
+      String_View() = default;
+
+      String_View(const char *t_data, const size_type t_size)
+        : m_data(t_data), m_size(t_size)
+      {
+      }
+
+      String_View(const std::string &t_str)
+        : m_data(t_str.data()), m_size(t_str.size())
+      {
+      }
+
+      const_iterator begin() const { return m_data; }
+      const_iterator end() const { return m_data + m_size; }
+
+      size_type size() const { return m_size; }
+      bool empty() const { return m_size == 0; }
+
+      const_reference at(const size_type t_pos) const { view_detail::check_index(m_size, t_pos); return m_data[t_pos]; }
+      const_reference operator[](const size_type t_pos) const { return m_data[t_pos]; }
+      const_reference front() const { return at(0); }
+      const_reference back() const { return at(m_size - 1); }
+
+      const char *data() const { return m_data; }
+
+      String_View substr(const size_type t_pos, const size_type t_len = npos) const
+      {
+        const auto part = view_detail::slice(m_size, t_pos, t_len);
+        return String_View(m_data + part.first, part.second);
+      }
+
+      size_type find(const String_View &t_needle, const size_type t_pos = 0) const
+      {
+        if (t_pos > m_size || t_needle.size() > m_size - t_pos) {
+          return npos;
+        }
+        const auto found = std::search(begin() + t_pos, end(), t_needle.begin(), t_needle.end());
+        return found == end() ? npos : static_cast<size_type>(found - begin());
+      }
+
+      size_type rfind(const String_View &t_needle, const size_type t_pos = npos) const
+      {
+        if (t_needle.size() > m_size) {
+          return npos;
+        }
+        for (size_type pos = std::min(t_pos, m_size - t_needle.size()) + 1; pos > 0; --pos) {
+          if (std::equal(t_needle.begin(), t_needle.end(), begin() + pos - 1)) {
+            return pos - 1;
+          }
+        }
+        return npos;
+      }
+
+      bool starts_with(const String_View &t_prefix) const
+      {
+        return t_prefix.size() <= m_size && std::equal(t_prefix.begin(), t_prefix.end(), begin());
+      }
+
+      bool ends_with(const String_View &t_suffix) const
+      {
+        return t_suffix.size() <= m_size && std::equal(t_suffix.begin(), t_suffix.end(), end() - t_suffix.size());
+      }
+
+      /// The number of times t_c appears
+      size_type count(const char t_c) const
+      {
+        return static_cast<size_type>(std::count(begin(), end(), t_c));
+      }
+
+      std::string to_string() const
+      {
+        return std::string(m_data, m_size);
+      }
+
+      friend bool operator==(const String_View &lhs, const String_View &rhs)
+      {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+      }
+
+      friend bool operator!=(const String_View &lhs, const String_View &rhs)
+      {
+        return !(lhs == rhs);
+      }
+
+    private:
+      const char *m_data = nullptr;
+      size_type m_size = 0;
+  };
+}
+
+#endif
+
@@ -0,0 +1,734 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2017, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+
+// Wall clock and allocation benchmarks of the engine, with machine readable results that can be
+// saved and compared against on a later run:
+//
+//   chaiscript_bench --json baseline.json
+//   chaiscript_bench --baseline baseline.json --threshold 10
+//
+// Each benchmark is run with enough operations to take --min-time seconds, --repetitions times,
+// and the fastest run is reported, which is the least disturbed by the rest of the machine. A
+// benchmark slower than its baseline by more than --threshold percent is a regression, and the
+// exit status is 1 if there is any.
+
+#include <chaiscript/chaiscript.hpp>
+#include <chaiscript/utility/binary_wrap.hpp>
+#include <chaiscript/utility/json.hpp>
+#include <chaiscript/utility/json_wrap.hpp>
+
+#ifndef CHAISCRIPT_NO_THREADS
+#include <chaiscript/utility/engine_pool.hpp>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  struct Benchmark
+  {
+    std::string name;
+    /// runs the given number of operations
+    std::function<void (std::uint64_t)> run;
+    /// the engine whose allocations an operation makes, if any
+    chaiscript::ChaiScript *engine = nullptr;
+    /// the bytes an operation reads, for reporting a throughput
+    std::uint64_t bytes = 0;
+  };
+
+  struct Result
+  {
+    std::string name;
+    std::uint64_t operations = 0;
+    double ns_per_op = 0;
+    double median_ns_per_op = 0;
+    /// negative if not measured
+    double allocations_per_op = -1;
+    std::uint64_t bytes = 0;
+  };
+
+  struct Options
+  {
+    std::string filter;
+    std::string json_file;
+    std::string baseline_file;
+    double threshold = 10;
+    double min_time = 0.1;
+    int repetitions = 5;
+    bool list = false;
+  };
+
+  double seconds(const std::function<void (std::uint64_t)> &t_run, const std::uint64_t t_ops)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    t_run(t_ops);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+  }
+
+  std::uint64_t total_allocations(const chaiscript::Allocation_Stats &t_stats)
+  {
+    std::uint64_t total = 0;
+    for (const auto &entry : t_stats.entries()) {
+      if (entry.kind != chaiscript::Allocation_Stats::Kind::function) {
+        total += entry.total_count;
+      }
+    }
+    return total;
+  }
+
+  Result measure(const Benchmark &t_bench, const Options &t_opts)
+  {
+    Result result;
+    result.name = t_bench.name;
+    result.bytes = t_bench.bytes;
+
+    // grow the operations until a run takes long enough to time
+    std::uint64_t ops = 1;
+    double elapsed = seconds(t_bench.run, ops);
+    while (elapsed < t_opts.min_time) {
+      const double scale = elapsed > 0 ? std::min(10.0, 1.5 * t_opts.min_time / elapsed) : 10.0;
+      ops = std::max(ops + 1, static_cast<std::uint64_t>(static_cast<double>(ops) * scale));
+      elapsed = seconds(t_bench.run, ops);
+    }
+
+    std::vector<double> times;
+    for (int i = 0; i < t_opts.repetitions; ++i) {
+      times.push_back(seconds(t_bench.run, ops) * 1e9 / static_cast<double>(ops));
+    }
+    std::sort(times.begin(), times.end());
+
+    result.operations = ops;
+    result.ns_per_op = times.front();
+    result.median_ns_per_op = times[times.size() / 2];
+
+    if (t_bench.engine) {
+      // counted on a run of its own, so counting does not slow the timed runs
+      auto &stats = t_bench.engine->allocation_stats();
+      stats.enable();
+      const auto before = total_allocations(stats);
+      t_bench.run(ops);
+      result.allocations_per_op = static_cast<double>(total_allocations(stats) - before) / static_cast<double>(ops);
+      stats.enable(false);
+    }
+
+    return result;
+  }
+
+  json::JSON to_json(const std::vector<Result> &t_results)
+  {
+    json::JSON entries(json::JSON::Class::Array);
+    for (size_t i = 0; i < t_results.size(); ++i) {
+      const auto &result = t_results[i];
+      auto &entry = entries[i];
+      entry["name"] = json::JSON(result.name);
+      entry["operations"] = json::JSON(result.operations);
+      entry["ns_per_op"] = json::JSON(result.ns_per_op);
+      entry["median_ns_per_op"] = json::JSON(result.median_ns_per_op);
+      if (result.allocations_per_op >= 0) {
+        entry["allocations_per_op"] = json::JSON(result.allocations_per_op);
+      }
+      if (result.bytes != 0) {
+        entry["bytes_per_op"] = json::JSON(result.bytes);
+      }
+    }
+
+    json::JSON doc;
+    doc["version"] = json::JSON(chaiscript::Build_Info::version());
+    doc["compiler"] = json::JSON(chaiscript::Build_Info::compiler_id());
+    doc["debug_build"] = json::JSON(chaiscript::Build_Info::debug_build());
+    doc["benchmarks"] = entries;
+    return doc;
+  }
+
+  void print(const Result &t_result)
+  {
+    std::cout << std::left << std::setw(36) << t_result.name << std::right
+      << std::setw(14) << std::fixed << std::setprecision(1) << t_result.ns_per_op << " ns/op";
+    if (t_result.allocations_per_op >= 0) {
+      std::cout << std::setw(12) << std::setprecision(1) << t_result.allocations_per_op << " allocs/op";
+    }
+    if (t_result.bytes != 0) {
+      std::cout << std::setw(10) << std::setprecision(1)
+        << static_cast<double>(t_result.bytes) / t_result.ns_per_op * 1e9 / (1024 * 1024) << " MB/s";
+    }
+    std::cout << '\n';
+  }
+
+  /// \returns the number of benchmarks slower than the baseline by more than the threshold
+  int compare(const std::vector<Result> &t_results, const json::JSON &t_baseline, const double t_threshold)
+  {
+    int regressions = 0;
+    std::cout << "\ncompared to the baseline, threshold " << t_threshold << "%:\n";
+    for (const auto &result : t_results) {
+      const json::JSON *saved = nullptr;
+      for (const auto &entry : t_baseline.at("benchmarks").array_range()) {
+        if (entry.at("name").to_string() == result.name) {
+          saved = &entry;
+        }
+      }
+
+      std::cout << std::left << std::setw(36) << result.name << std::right;
+      if (!saved) {
+        std::cout << "  (not in baseline)\n";
+        continue;
+      }
+
+      const double change = (result.ns_per_op / saved->at("ns_per_op").to_float() - 1) * 100;
+      std::cout << std::setw(10) << std::showpos << std::fixed << std::setprecision(1) << change << std::noshowpos << "%";
+      if (saved->has_key("allocations_per_op") && result.allocations_per_op >= 0) {
+        const double allocations = saved->at("allocations_per_op").to_float();
+        std::cout << "  allocs/op " << std::setprecision(1) << allocations << " -> " << result.allocations_per_op;
+      }
+      if (change > t_threshold) {
+        std::cout << "  REGRESSION";
+        ++regressions;
+      } else if (change < -t_threshold) {
+        std::cout << "  improved";
+      }
+      std::cout << '\n';
+    }
+    return regressions;
+  }
+
+  std::string read_file(const std::string &t_filename)
+  {
+    std::ifstream file(t_filename);
+    if (!file) {
+      throw std::runtime_error("Unable to open: " + t_filename);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+  }
+
+  std::string json_document(const int t_records)
+  {
+    std::string doc = "[";
+    for (int i = 0; i < t_records; ++i) {
+      if (i != 0) { doc += ", "; }
+      doc += R"({"id" : )" + std::to_string(i) + R"(, "name" : "record )" + std::to_string(i)
+        + R"(", "score" : )" + std::to_string(i * 0.25) + R"(, "tags" : ["a", "b", "c"], "active" : true})";
+    }
+    return doc + "]";
+  }
+
+  /// written by benchmarks whose results are otherwise unused, so the work is not optimized away
+  volatile size_t sink = 0;
+
+  double host_function(const std::string &, double, bool) noexcept
+  {
+    return .0;
+  }
+
+  struct Shape { virtual ~Shape() = default; virtual double area() const { return 0; } };
+  struct Polygon : Shape { };
+  struct Quad : Polygon { };
+  struct Rect : Quad { double area() const override { return 2; } };
+
+  template<int N> struct Unrelated { };
+  template<int N> struct Unrelated_Derived : Unrelated<N> { };
+
+  template<int ... N>
+  void add_unrelated(chaiscript::ChaiScript &t_chai, std::integer_sequence<int, N...>)
+  {
+    (void)std::initializer_list<int>{(t_chai.add(chaiscript::base_class<Unrelated<N>, Unrelated_Derived<N>>()), 0)...};
+  }
+
+  const char *script_source = R"(
+    def add(x, y) { x + y; }
+
+    def calls(n) {
+      var total = 0;
+      for (var i = 0; i < n; ++i) {
+        total = add(total, i);
+      }
+      total;
+    }
+
+    def arithmetic(n) {
+      var total = 0.0;
+      for (var i = 0; i < n; ++i) {
+        total += (i * 3 + 1) % 7 / 2.0;
+      }
+      total;
+    }
+
+    def over(int x) { x; }
+    def over(double x) { x; }
+    def over(string x) { x; }
+    def over(Vector x) { x; }
+
+    def dispatch(n, values) {
+      for (var i = 0; i < n; ++i) {
+        over(values[i % 4]);
+      }
+    }
+
+    def vector_sum(n, v) {
+      var total = 0;
+      for (var i = 0; i < n; ++i) {
+        for (x : v) {
+          total += x;
+        }
+      }
+      total;
+    }
+
+    def map_sum(n, m) {
+      var total = 0;
+      for (var i = 0; i < n; ++i) {
+        for (x : m) {
+          total += x.second;
+        }
+      }
+      total;
+    }
+
+    def vector_pass(n, values) {
+      var s = 0.0;
+      for (var i = 0; i < n; ++i) {
+        for (x : values) { s += x * x * 0.5 + 1.0; }
+      }
+      s;
+    }
+
+    def weight(int x, double y) { x * y; }
+    def weight(string s, double y) { s.size() * y; }
+    def weight(x) { x; }
+
+    def on_event(int id, double value) {
+      if (value > 50.0) { value * 0.5; } else { value + id % 3; }
+    }
+
+    def split_lines(text) {
+      var pos = 0u;
+      var total = 0u;
+      var next = text.find("\n", pos);
+      while (next < text.size()) {
+        var line = text.substr(pos, next - pos);
+        total += line.size();
+        pos = next + 1;
+        next = text.find("\n", pos);
+      }
+      total;
+    }
+
+    def leaf(x) { x + 1; }
+    def branch(x) { leaf(x) + leaf(x + 1); }
+
+    def branches(n) {
+      for (var i = 0; i < n; ++i) {
+        branch(i);
+      }
+    }
+  )";
+
+  std::vector<Benchmark> benchmarks(std::vector<std::unique_ptr<chaiscript::ChaiScript>> &t_engines)
+  {
+    std::vector<Benchmark> result;
+
+    t_engines.push_back(std::make_unique<chaiscript::ChaiScript>());
+    auto &chai = *t_engines.back();
+    chai.add(chaiscript::fun(&host_function), "host_function");
+    chai.eval(script_source);
+
+    const std::string script(script_source);
+    result.push_back({"parse.script", [&chai, script](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            chai.parse(script);
+          }
+        }, &chai, script.size()});
+
+    // from samples/fun_call_performance.cpp and performance_tests/profile_fun_wrappers.cpp
+    const auto host_call = chai.eval<std::function<void ()>>(R"(fun(){ host_function("str", 1.2, false); })");
+    result.push_back({"call.host_function_from_cpp", [host_call](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            host_call();
+          }
+        }, &chai});
+
+    const auto script_loop = [&chai](const std::string &t_func) {
+      const auto func = chai.eval<std::function<chaiscript::Boxed_Value (int)>>(t_func);
+      return [func](const std::uint64_t t_ops) { func(static_cast<int>(t_ops)); };
+    };
+
+    result.push_back({"call.script_function", script_loop("calls"), &chai});
+    result.push_back({"arithmetic.loop", script_loop("arithmetic"), &chai});
+
+    const auto dispatch = chai.eval<std::function<void (int, const std::vector<chaiscript::Boxed_Value> &)>>("dispatch");
+    const std::vector<chaiscript::Boxed_Value> values{chaiscript::var(1), chaiscript::var(1.5), chaiscript::var(std::string("s")),
+      chaiscript::var(std::vector<chaiscript::Boxed_Value>())};
+    result.push_back({"dispatch.overloads", [dispatch, values](const std::uint64_t t_ops) {
+          dispatch(static_cast<int>(t_ops), values);
+        }, &chai});
+
+    // an operation is reading one element
+    std::vector<chaiscript::Boxed_Value> vec;
+    std::map<std::string, chaiscript::Boxed_Value> map;
+    for (int i = 0; i < 1000; ++i) {
+      vec.push_back(chaiscript::var(i));
+      map[std::to_string(i)] = chaiscript::var(i);
+    }
+    const auto vector_sum = chai.eval<std::function<chaiscript::Boxed_Value (int, const std::vector<chaiscript::Boxed_Value> &)>>("vector_sum");
+    result.push_back({"container.vector_for", [vector_sum, vec](const std::uint64_t t_ops) {
+          vector_sum(static_cast<int>((t_ops + 999) / 1000), vec);
+        }, &chai});
+    const auto map_sum = chai.eval<std::function<chaiscript::Boxed_Value (int, const std::map<std::string, chaiscript::Boxed_Value> &)>>("map_sum");
+    result.push_back({"container.map_for", [map_sum, map](const std::uint64_t t_ops) {
+          map_sum(static_cast<int>((t_ops + 999) / 1000), map);
+        }, &chai});
+
+    const auto doc = json_document(1000);
+    result.push_back({"json.from_json", [doc](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            chaiscript::json_wrap::from_json(doc);
+          }
+        }, nullptr, doc.size()});
+    const auto value = chaiscript::json_wrap::from_json(doc);
+    result.push_back({"json.to_json", [value](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            chaiscript::json_wrap::to_json(value);
+          }
+        }, nullptr});
+
+    const auto tree = json::JSON::Load(doc);
+    result.push_back({"json.load", [doc](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            json::JSON::Load(doc);
+          }
+        }, nullptr, doc.size()});
+    result.push_back({"json.dump", [tree](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            tree.dump();
+          }
+        }, nullptr});
+    result.push_back({"json.from_json_stream", [doc](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            std::istringstream stream(doc);
+            chaiscript::json_wrap::from_json(stream);
+          }
+        }, nullptr, doc.size()});
+
+    const auto binary = chaiscript::binary_wrap::to_binary(value);
+    result.push_back({"binary.to_binary", [value](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            chaiscript::binary_wrap::to_binary(value);
+          }
+        }, nullptr});
+    result.push_back({"binary.from_binary", [binary](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            chaiscript::binary_wrap::from_binary(binary);
+          }
+        }, nullptr, binary.size()});
+
+    // an operation is a pass over 1000 doubles
+    chai.eval(R"(
+        global bench_values = [];
+        for (var i = 0; i < 1000; ++i) { bench_values.push_back(i * 0.25); }
+        global bench_array = Double_Array(bench_values);
+      )");
+    const auto vector_pass = chai.eval<std::function<chaiscript::Boxed_Value (int, const chaiscript::Boxed_Value &)>>("vector_pass");
+    const auto bench_values = chai.eval("bench_values");
+    result.push_back({"typed_array.vector_pass", [vector_pass, bench_values](const std::uint64_t t_ops) {
+          vector_pass(static_cast<int>(t_ops), bench_values);
+        }, &chai});
+    const auto array_pass = [&chai](const std::string &t_expression) {
+      const auto func = chai.eval<std::function<chaiscript::Boxed_Value ()>>("fun() { " + t_expression + " }");
+      return [func](const std::uint64_t t_ops) {
+        for (std::uint64_t i = 0; i < t_ops; ++i) {
+          func();
+        }
+      };
+    };
+    result.push_back({"typed_array.expression", array_pass("(bench_array * bench_array * 0.5 + 1.0).sum()"), &chai});
+    result.push_back({"typed_array.dot", array_pass("bench_array.dot(bench_array)"), &chai});
+    result.push_back({"typed_array.select", array_pass("bench_array.select(bench_array.greater(100.0)).size()"), &chai});
+
+    // an operation is one evaluation of the formula
+    const std::string formula = "if (quantity > 10) { price * quantity * (1.0 - discount) } else { price * quantity }";
+    result.push_back({"compiled.eval_with_locals", [&chai, formula](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            chai.set_locals(std::map<std::string, chaiscript::Boxed_Value>{
+                {"price", chaiscript::var(2.5)}, {"quantity", chaiscript::var(static_cast<int>(i % 20))}, {"discount", chaiscript::var(0.1)}});
+            chai.eval<double>(formula);
+          }
+        }, &chai});
+    const auto compiled = chai.compile(formula, {"price", "quantity", "discount"});
+    result.push_back({"compiled.eval", [compiled](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            compiled.eval<double>({chaiscript::var(2.5), chaiscript::var(static_cast<int>(i % 20)), chaiscript::var(0.1)});
+          }
+        }, &chai});
+
+    // an operation is one row of the filter
+    const size_t rows = 1000;
+    auto price = std::make_shared<std::vector<double>>(rows);
+    auto quantity = std::make_shared<std::vector<std::int64_t>>(rows);
+    auto region = std::make_shared<std::vector<std::string>>(rows);
+    for (size_t i = 0; i < rows; ++i) {
+      (*price)[i] = static_cast<double>(i % 997) * 0.5;
+      (*quantity)[i] = static_cast<std::int64_t>(i % 31);
+      (*region)[i] = (i % 3 == 0) ? "north" : "south";
+    }
+    const auto filter = chai.compile("price * quantity > 1000.0 && region == \"north\"", {"price", "quantity", "region"});
+    result.push_back({"columns.per_row", [filter, price, quantity, region](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            const auto row = static_cast<size_t>(i % rows);
+            filter.eval<bool>({chaiscript::var((*price)[row]), chaiscript::var((*quantity)[row]), chaiscript::var((*region)[row])});
+          }
+        }, &chai});
+    result.push_back({"columns.eval_columns", [filter, price, quantity, region](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < (t_ops + rows - 1) / rows; ++i) {
+            filter.eval_columns({chaiscript::var(std::cref(*price)), chaiscript::var(std::cref(*quantity)), chaiscript::var(std::cref(*region))});
+          }
+        }, &chai});
+
+    // an operation is one call of an overloaded script function from C++
+    const auto weight = chai.eval<std::function<double (int, double)>>("weight");
+    result.push_back({"call.std_function", [weight](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            weight(static_cast<int>(i % 100), 0.5);
+          }
+        }, &chai});
+    const auto weight_handle = std::make_shared<chaiscript::Function_Handle<double (int, double)>>(chai.function_handle<double (int, double)>("weight"));
+    result.push_back({"call.function_handle", [weight_handle](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            (*weight_handle)(static_cast<int>(i % 100), 0.5);
+          }
+        }, &chai});
+
+    // an operation is one event
+    auto events = std::make_shared<std::vector<std::tuple<int, double>>>();
+    for (int i = 0; i < 1000; ++i) {
+      events->emplace_back(i, static_cast<double>(i % 100));
+    }
+    auto event_results = std::make_shared<std::vector<double>>(events->size());
+    const auto on_event = std::make_shared<chaiscript::Function_Handle<double (int, double)>>(chai.function_handle<double (int, double)>("on_event"));
+    result.push_back({"call.batch", [on_event, events, event_results](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < (t_ops + events->size() - 1) / events->size(); ++i) {
+            on_event->call_batch(events->begin(), events->end(), event_results->begin());
+          }
+        }, &chai});
+
+    // an operation is splitting a 64 KB host buffer into lines from script
+    auto buffer = std::make_shared<std::string>();
+    for (int i = 0; buffer->size() < 64 * 1024; ++i) {
+      *buffer += "record " + std::to_string(i) + std::string(static_cast<size_t>(64 + i % 64), 'x') + "\n";
+    }
+    const auto split_lines = chai.eval<std::function<chaiscript::Boxed_Value (const chaiscript::Boxed_Value &)>>("split_lines");
+    const auto split = [split_lines, buffer](const chaiscript::Boxed_Value &t_text) {
+      return [split_lines, buffer, t_text](const std::uint64_t t_ops) {
+        for (std::uint64_t i = 0; i < t_ops; ++i) {
+          split_lines(t_text);
+        }
+      };
+    };
+    result.push_back({"string.split_string", split(chaiscript::var(std::cref(*buffer))), &chai, buffer->size()});
+    result.push_back({"string.split_string_view", split(chaiscript::var(chaiscript::String_View(*buffer))), &chai, buffer->size()});
+
+    // an operation is one call converting up or down a three level hierarchy, with 40 other
+    // conversions registered
+    t_engines.push_back(std::make_unique<chaiscript::ChaiScript>());
+    auto &converting = *t_engines.back();
+    add_unrelated(converting, std::make_integer_sequence<int, 40>());
+    converting.add(chaiscript::base_class<Shape, Polygon>());
+    converting.add(chaiscript::base_class<Polygon, Quad>());
+    converting.add(chaiscript::base_class<Quad, Rect>());
+    converting.add(chaiscript::fun([](const Shape &t_shape) { return t_shape.area(); }), "area");
+    converting.add(chaiscript::fun([](const std::shared_ptr<Rect> &t_rect) { return t_rect->area(); }), "rect_area");
+    converting.add_global(chaiscript::var(std::make_shared<Rect>()), "rect");
+    converting.add_global(chaiscript::var(std::shared_ptr<Shape>(std::make_shared<Rect>())), "shape");
+    const auto conversion_loop = [&converting](const std::string &t_call) {
+      const auto func = converting.eval<std::function<chaiscript::Boxed_Value (int)>>(
+          "fun(n) { var total = 0.0; for (var i = 0; i < n; ++i) { total += " + t_call + "; } total; }");
+      return [func](const std::uint64_t t_ops) { func(static_cast<int>(t_ops)); };
+    };
+    result.push_back({"conversion.up_three_levels", conversion_loop("area(rect)"), &converting});
+    result.push_back({"conversion.down_three_levels", conversion_loop("rect_area(shape)"), &converting});
+
+    // as many storages as a few engines create, so the lookup is not into a table of one
+    auto storages = std::make_shared<std::vector<std::unique_ptr<chaiscript::detail::threading::Thread_Storage<size_t>>>>();
+    for (size_t i = 0; i < 32; ++i) {
+      storages->push_back(std::make_unique<chaiscript::detail::threading::Thread_Storage<size_t>>());
+      **storages->back() = i;
+    }
+    result.push_back({"threads.thread_storage", [storages](const std::uint64_t t_ops) {
+          size_t total = 0;
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            total += **(*storages)[static_cast<size_t>(i % 32)];
+          }
+          sink = total;
+        }, nullptr});
+
+    // an operation is one method call, on one of 20 script classes defining update
+    t_engines.push_back(std::make_unique<chaiscript::ChaiScript>());
+    auto &classes = *t_engines.back();
+    for (int i = 0; i < 20; ++i) {
+      const auto name = "Entity_Class_Number_" + std::to_string(i);
+      classes.eval("class " + name + " { var x; def " + name + "() { this.x = 0; } def update(dt) { this.x += dt; } }");
+    }
+    classes.eval("global entities = []; for (var i = 0; i < 100; ++i) { entities.push_back(Entity_Class_Number_19()); }");
+    const auto update = classes.eval<std::function<void (int)>>(
+        "fun(n) { for (var r = 0; r < n; ++r) { for (e : entities) { e.update(1); } } }");
+    result.push_back({"dispatch.class_methods", [update](const std::uint64_t t_ops) {
+          update(static_cast<int>((t_ops + 99) / 100));
+        }, &classes});
+
+    // an operation is one script function call, with the profiler sampling
+    t_engines.push_back(std::make_unique<chaiscript::ChaiScript>());
+    auto &profiled = *t_engines.back();
+    profiled.eval(script_source);
+    profiled.profiler().start();
+    const auto branches = profiled.eval<std::function<void (int)>>("branches");
+    result.push_back({"call.profiler_started", [branches](const std::uint64_t t_ops) {
+          branches(static_cast<int>((t_ops + 2) / 3));
+        }, &profiled});
+
+    result.push_back({"engine.construct", [](const std::uint64_t t_ops) {
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            chaiscript::ChaiScript engine;
+          }
+        }, nullptr});
+    result.push_back({"engine.construct_from_snapshot", [](const std::uint64_t t_ops) {
+          const auto &snapshot = chaiscript::ChaiScript::standard_boot_snapshot();
+          for (std::uint64_t i = 0; i < t_ops; ++i) {
+            chaiscript::ChaiScript engine(snapshot);
+          }
+        }, nullptr});
+
+#ifndef CHAISCRIPT_NO_THREADS
+    // an operation is one request served by a pool of that many engines
+    const size_t max_threads = std::max(size_t(4), chaiscript::utility::Thread_Pool::default_size());
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+      const auto parser_factory = [](){
+        return std::make_unique<chaiscript::parser::ChaiScript_Parser<chaiscript::eval::Noop_Tracer, chaiscript::optimizer::Optimizer_Default>>();
+      };
+      auto pool = std::make_shared<chaiscript::Engine_Pool>(chaiscript::ChaiScript::standard_boot_snapshot(), parser_factory, threads);
+      for (size_t i = 0; i < threads; ++i) {
+        pool->engine(i).eval(script_source);
+      }
+
+      result.push_back({"threads.engine_pool_" + std::to_string(threads), [pool](const std::uint64_t t_ops) {
+            std::vector<std::future<chaiscript::Boxed_Value>> results;
+            results.reserve(t_ops);
+            for (std::uint64_t i = 0; i < t_ops; ++i) {
+              results.push_back(pool->call("arithmetic", {chaiscript::var(200)}));
+            }
+            for (auto &request : results) {
+              request.get();
+            }
+          }, nullptr});
+    }
+#endif
+
+    return result;
+  }
+
+  void usage()
+  {
+    std::cout << "usage: chaiscript_bench [options]\n"
+      << "  --filter <text>        run only the benchmarks whose names contain text\n"
+      << "  --json <file>          write the results to file as JSON\n"
+      << "  --baseline <file>      compare with results saved by --json, exit status 1 on a regression\n"
+      << "  --threshold <percent>  slowdown that counts as a regression, default 10\n"
+      << "  --min-time <seconds>   time to run each benchmark for, default 0.1\n"
+      << "  --repetitions <n>      timed runs of each benchmark, default 5\n"
+      << "  --list                 list the benchmarks\n";
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  Options opts;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const auto value = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        std::cerr << "missing value for " << arg << '\n';
+        std::exit(EXIT_FAILURE);
+      }
+      return argv[++i];
+    };
+
+    if (arg == "--filter") {
+      opts.filter = value();
+    } else if (arg == "--json") {
+      opts.json_file = value();
+    } else if (arg == "--baseline") {
+      opts.baseline_file = value();
+    } else if (arg == "--threshold") {
+      opts.threshold = std::stod(value());
+    } else if (arg == "--min-time") {
+      opts.min_time = std::stod(value());
+    } else if (arg == "--repetitions") {
+      opts.repetitions = std::max(1, std::stoi(value()));
+    } else if (arg == "--list") {
+      opts.list = true;
+    } else {
+      usage();
+      return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  try {
+    // read first, so a bad baseline is reported before the benchmarks run
+    const json::JSON baseline = opts.baseline_file.empty() ? json::JSON() : json::JSON::Load(read_file(opts.baseline_file));
+
+    std::vector<std::unique_ptr<chaiscript::ChaiScript>> engines;
+    const auto all = benchmarks(engines);
+
+    std::vector<Result> results;
+    for (const auto &bench : all) {
+      if (bench.name.find(opts.filter) == std::string::npos) {
+        continue;
+      }
+      if (opts.list) {
+        std::cout << bench.name << '\n';
+        continue;
+      }
+      results.push_back(measure(bench, opts));
+      print(results.back());
+    }
+
+    if (!opts.json_file.empty()) {
+      std::ofstream file(opts.json_file);
+      file << to_json(results).dump() << '\n';
+      if (!file) {
+        throw std::runtime_error("Unable to write: " + opts.json_file);
+      }
+    }
+
+    if (!opts.baseline_file.empty() && !opts.list) {
+      return compare(results, baseline, opts.threshold) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "chaiscript_bench: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
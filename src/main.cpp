@@ -17,6 +17,7 @@
 #endif
 
 #include <chaiscript/chaiscript_basic.hpp>
+#include <chaiscript/utility/json_wrap.hpp>
 #include "../static_libs/chaiscript_parser.hpp"
 #include "../static_libs/chaiscript_stdlib.hpp"
 
@@ -298,6 +299,7 @@ int main(int argc, char *argv[])
   }
 
   chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser(),modulepaths,usepaths);
+  chaiscript::json_wrap::streaming_library(chai);
 
   chai.add(chaiscript::fun(&myexit), "exit");
   chai.add(chaiscript::fun(&myexit), "quit");
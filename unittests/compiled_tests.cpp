@@ -19,6 +19,7 @@
 #include <chaiscript/chaiscript_basic.hpp>
 #include <chaiscript/utility/utility.hpp>
 #include <chaiscript/dispatchkit/bootstrap_stl.hpp>
+#include <chaiscript/utility/engine_pool.hpp>
 
 #include "../static_libs/chaiscript_parser.hpp"
 #include "../static_libs/chaiscript_stdlib.hpp"
@@ -28,6 +29,7 @@
 #define CATCH_CONFIG_MAIN
 
 #include <clocale>
+#include <sstream>
 
 #include "catch.hpp"
 
@@ -392,6 +394,912 @@ TEST_CASE("Set and restore chai state")
 }
 
 
+TEST_CASE("Engines constructed from a boot snapshot")
+{
+  const auto parser = create_chaiscript_parser();
+  const auto snapshot = chaiscript::ChaiScript_Basic::build_boot_snapshot(create_chaiscript_stdlib(), *parser);
+
+  auto chai1 = std::make_unique<chaiscript::ChaiScript_Basic>(snapshot, create_chaiscript_parser());
+  chaiscript::ChaiScript_Basic chai2(snapshot, create_chaiscript_parser());
+
+  // prelude functions and engine bound functions are available
+  CHECK(chai1->eval<int>("foldl(map([1,2,3], fun(x){ x * 2 }), `+`, 0)") == 12);
+  CHECK(chai2.eval<std::string>("to_string(eval(\"1 + 2\"))") == "3");
+  CHECK(chai2.eval<bool>("function_exists(\"filter\")"));
+
+  // engines do not share definitions made after construction
+  chai1->eval("def snapshot_fun() { 1 }");
+  CHECK(chai1->eval<int>("snapshot_fun()") == 1);
+  CHECK_THROWS_AS(chai2.eval<int>("snapshot_fun()"), chaiscript::exception::eval_error &);
+
+  // script functions from the snapshot are not bound to another engine
+  chai1.reset();
+  CHECK(chai2.eval<int>("max(4, 5)") == 5);
+  CHECK(chai2.eval<size_t>("filter([1,2,3,4], odd).size()") == 2);
+
+  // the prelude was evaluated once, when the snapshot was built, and its functions, methods
+  // and guards were bound to each engine
+  CHECK(snapshot.evals.empty());
+  CHECK(chai2.eval<std::string>("to_string(retro(range([1, 2, 3])).front())") == "3");
+  CHECK(chai2.eval<int>("var o = Dynamic_Object(); o.x = 4; var c = clone(o); c.x") == 4);
+
+  chaiscript::ChaiScript chai3(chaiscript::ChaiScript::standard_boot_snapshot());
+  CHECK(chai3.eval<int>("foldl([1,2,3], `+`, 0)") == 6);
+}
+
+
+TEST_CASE("Parsed AST shared between engines")
+{
+  chaiscript::ChaiScript_Basic chai1(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chaiscript::ChaiScript_Basic chai2(create_chaiscript_stdlib(),create_chaiscript_parser());
+
+  // give the engines differently shaped function tables and stacks
+  chai2.add(chaiscript::fun([](int i){ return i; }), "ast_share_identity");
+  chai2.add(chaiscript::fun([](const std::string &s){ return s.size(); }), "ast_share_size");
+  chai2.add(chaiscript::var(3), "ast_share_local");
+
+  const auto ast = chai1.parse(R"(
+    {
+      var total = 0;
+      var v = [1, 2, 3];
+      for (var i = 0; i < v.size(); ++i) {
+        total += v[i] * 2;
+      }
+      for (x : v) {
+        total = total + x;
+      }
+      to_string(total) + "!"
+    }
+  )");
+
+  for (int i = 0; i < 3; ++i) {
+    CHECK(chaiscript::boxed_cast<std::string>(chai1.eval(ast)) == "18!");
+    CHECK(chaiscript::boxed_cast<std::string>(chai2.eval(ast)) == "18!");
+  }
+
+  // an Id resolved as a local in one engine and as a global in the other
+  chai1.add_global(chaiscript::var(10), "ast_share_value");
+  chai2.add(chaiscript::var(20), "ast_share_value");
+  const auto id_ast = chai1.parse("ast_share_value + 1");
+  for (int i = 0; i < 3; ++i) {
+    CHECK(chaiscript::boxed_cast<int>(chai1.eval(id_ast)) == 11);
+    CHECK(chaiscript::boxed_cast<int>(chai2.eval(id_ast)) == 21);
+  }
+}
+
+TEST_CASE("Function name ids are reused once no name holds them")
+{
+  uint_fast32_t id = 0;
+  {
+    const chaiscript::detail::Function_Name name("function_name_id_first");
+    id = name.id();
+    CHECK(chaiscript::detail::Function_Name("function_name_id_first").id() == id);
+  }
+  CHECK(chaiscript::detail::Function_Name("function_name_id_second").id() == id);
+
+  // an engine holds the names of its functions, so a function parsed and then let go keeps its id
+  chaiscript::ChaiScript chai;
+  const auto state = chai.get_state();
+  chai.eval("def function_name_id_third() { 3 }");
+  const chaiscript::detail::Function_Name third("function_name_id_third");
+  CHECK(chaiscript::detail::Function_Name("function_name_id_fourth").id() != third.id());
+  CHECK(chai.eval<int>("function_name_id_third()") == 3);
+
+  chai.set_state(state);
+  CHECK_THROWS(chai.eval("function_name_id_third()"));
+}
+
+
+#ifndef CHAISCRIPT_NO_THREADS
+TEST_CASE("A pool task waiting on its subtask does not run unrelated tasks")
+{
+  chaiscript::utility::Thread_Pool pool(1);
+  std::promise<void> started;
+  std::promise<void> queued;
+  auto started_future = started.get_future();
+  auto queued_future = queued.get_future();
+  std::atomic<bool> waiting{false};
+  std::atomic<bool> nested{false};
+
+  auto outer = pool.submit([&]() {
+        started.set_value();
+        queued_future.wait();
+        auto inner = pool.submit([](){ return 21; });
+        waiting = true;
+        const auto result = pool.wait(inner) * 2;
+        waiting = false;
+        return result;
+      });
+
+  // queued from outside the pool while the outer task runs, so it is not one of its subtasks
+  started_future.wait();
+  auto unrelated = pool.submit([&]() { nested = waiting.load(); });
+  queued.set_value();
+
+  CHECK(outer.get() == 42);
+  unrelated.get();
+  CHECK_FALSE(nested);
+}
+
+TEST_CASE("Engine pool serves requests on every engine")
+{
+  chaiscript::Engine_Pool pool(create_chaiscript_stdlib(), [](){ return create_chaiscript_parser(); }, 3);
+  CHECK(pool.size() == 3);
+
+  auto m = std::make_shared<chaiscript::Module>();
+  m->add(chaiscript::fun([](int i){ return i * 2; }), "pool_double");
+  m->eval("def pool_triple(x) { x * 3 }");
+  pool.add(m);
+
+  std::vector<std::future<chaiscript::Boxed_Value>> results;
+  for (int i = 0; i < 30; ++i) {
+    results.push_back(pool.eval("pool_double(" + std::to_string(i) + ") + pool_triple(1)"));
+  }
+  for (int i = 0; i < 30; ++i) {
+    CHECK(chaiscript::boxed_cast<int>(results[static_cast<size_t>(i)].get()) == i * 2 + 3);
+  }
+
+  CHECK(chaiscript::boxed_cast<int>(pool.call("pool_double", {chaiscript::var(21)}).get()) == 42);
+
+  // a session's globals and locals stay with its engine
+  CHECK(pool.session_engine(4) == 1);
+  pool.eval(4, "var pool_session = 5; global pool_session_global = 6;").get();
+  CHECK(chaiscript::boxed_cast<int>(pool.eval(4, "pool_session + pool_session_global").get()) == 11);
+  CHECK(chaiscript::boxed_cast<int>(pool.call(1, "pool_triple", {chaiscript::var(2)}).get()) == 6);
+  CHECK(pool.engine(1).eval<int>("pool_session_global") == 6);
+  CHECK_THROWS(pool.engine(0).eval("pool_session_global"));
+
+  // exceptions reach the caller through the future
+  auto failed = pool.eval("throw(\"pool error\")");
+  CHECK_THROWS_AS(failed.get(), chaiscript::Boxed_Value);
+  auto missing = pool.call("pool_no_such_function", {});
+  CHECK_THROWS_AS(missing.get(), chaiscript::exception::dispatch_error);
+}
+#endif
+
+
+#ifndef CHAISCRIPT_NO_THREADS
+TEST_CASE("Thread storage is per thread and not inherited by a later storage")
+{
+  using chaiscript::detail::threading::Thread_Storage;
+
+  auto first = std::make_unique<Thread_Storage<int>>();
+  **first = 1;
+
+  int other_thread = -1;
+  std::thread([&](){ other_thread = **first; **first = 2; }).join();
+  CHECK(other_thread == 0);
+  CHECK(**first == 1);
+
+  // a storage made after another is destroyed may reuse its place, but never its values
+  first.reset();
+  for (int i = 0; i < 4; ++i) {
+    Thread_Storage<int> next;
+    CHECK(*next == 0);
+    *next = 3;
+  }
+}
+#endif
+
+#ifndef CHAISCRIPT_NO_THREADS
+std::atomic<int> thread_storage_destroyed{0};
+
+struct Thread_Storage_Counted
+{
+  ~Thread_Storage_Counted() { ++thread_storage_destroyed; }
+  int value = 0;
+};
+
+TEST_CASE("Thread storage entries are destroyed with the storage or their thread")
+{
+  using chaiscript::detail::threading::Thread_Storage;
+
+  // the entry of a worker thread that is still running goes with the storage
+  auto storage = std::make_unique<Thread_Storage<Thread_Storage_Counted>>();
+  std::promise<void> created;
+  std::promise<void> destroyed;
+  std::thread worker([&](){
+      (*storage)->value = 1;
+      created.set_value();
+      destroyed.get_future().wait();
+    });
+  created.get_future().wait();
+  storage.reset();
+  CHECK(thread_storage_destroyed == 1);
+  destroyed.set_value();
+  worker.join();
+  CHECK(thread_storage_destroyed == 1);
+
+  // and the entry of a thread that exits goes with the thread
+  Thread_Storage<Thread_Storage_Counted> other;
+  std::thread([&](){ other->value = 2; }).join();
+  CHECK(thread_storage_destroyed == 2);
+}
+#endif
+
+
+#ifndef CHAISCRIPT_NO_THREADS
+TEST_CASE("Asynchronous evaluation on the shared executor")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.eval("global async_counter = 0; def async_work(x) { x * 2 }");
+
+  std::vector<std::future<chaiscript::Boxed_Value>> results;
+  for (int i = 0; i < 50; ++i) {
+    results.push_back(chai.eval_async("async_work(" + std::to_string(i) + ")"));
+  }
+  for (int i = 0; i < 50; ++i) {
+    CHECK(chaiscript::boxed_cast<int>(results[static_cast<size_t>(i)].get()) == i * 2);
+  }
+
+  auto failed = chai.eval_async("throw(\"async error\")");
+  CHECK_THROWS_AS(failed.get(), chaiscript::Boxed_Value);
+
+  auto bad_syntax = chai.eval_async("async_work(");
+  CHECK_THROWS_AS(bad_syntax.get(), chaiscript::exception::eval_error);
+
+  // the engine waits for tasks whose futures were dropped
+  {
+    chaiscript::ChaiScript_Basic chai2(create_chaiscript_stdlib(),create_chaiscript_parser());
+    for (int i = 0; i < 20; ++i) {
+      chai2.eval_async("var total = 0; for (var i = 0; i < 100; ++i) { total += i; } total");
+    }
+    chai2.eval("async(fun() { var x = 0; for (var i = 0; i < 100; ++i) { x += i; } x })");
+  }
+
+  // the locals of an asynchronous evaluation are not kept by the worker that ran it
+  std::weak_ptr<int> local;
+  chai.add(chaiscript::fun([&local](){ auto p = std::make_shared<int>(1); local = p; return p; }), "async_local");
+  CHECK(chaiscript::boxed_cast<int>(chai.eval_async("var r = async_local(); 1").get()) == 1);
+  CHECK(local.expired());
+}
+#endif
+
+
+TEST_CASE("Streaming JSON parse and serialize")
+{
+  const std::string doc = R"({"name" : "a \"quoted\"\nvalue", "list" : [1, -2, 3.5, 1.5e2, true, false, null], "nested" : {"empty" : [], "obj" : {}}})";
+
+  // a three byte block size makes every token straddle a refill
+  std::istringstream stream(doc);
+  json::JSONSource source(stream, 3);
+  const auto value = chaiscript::json_wrap::from_json(source);
+
+  const auto &m = chaiscript::boxed_cast<const std::map<std::string, chaiscript::Boxed_Value> &>(value);
+  CHECK(chaiscript::boxed_cast<std::string>(m.at("name")) == "a \"quoted\"\nvalue");
+  const auto &list = chaiscript::boxed_cast<const std::vector<chaiscript::Boxed_Value> &>(m.at("list"));
+  REQUIRE(list.size() == 7);
+  CHECK(chaiscript::boxed_cast<long>(list[1]) == -2);
+  CHECK(chaiscript::boxed_cast<double>(list[2]) == Approx(3.5));
+  CHECK(chaiscript::boxed_cast<double>(list[3]) == Approx(150.0));
+  CHECK(chaiscript::boxed_cast<bool>(list[4]));
+  CHECK(list[6].is_undef());
+
+  // the serialized text parses back to the same text, from memory and from a stream
+  const auto text = chaiscript::json_wrap::to_json(value);
+  CHECK(chaiscript::json_wrap::to_json(chaiscript::json_wrap::from_json(text)) == text);
+  std::istringstream text_stream(text);
+  CHECK(chaiscript::json_wrap::to_json(chaiscript::json_wrap::from_json(text_stream)) == text);
+  CHECK(json::JSON::Load(text).dump() == text);
+
+  CHECK_THROWS_AS(chaiscript::json_wrap::from_json(std::string(R"({"unterminated" : "abc)")), std::runtime_error);
+  CHECK_THROWS_AS(chaiscript::json_wrap::from_json(std::string("[1, 2")), std::runtime_error);
+
+  // nesting is refused past max_depth rather than overflowing the stack
+  const auto nested = [](const size_t t_depth) {
+    return std::string(t_depth, '[') + std::string(t_depth, ']');
+  };
+  CHECK_NOTHROW(chaiscript::json_wrap::from_json(nested(json::JSONParser::max_depth)));
+  CHECK_THROWS_AS(chaiscript::json_wrap::from_json(nested(json::JSONParser::max_depth + 1)), std::runtime_error);
+  CHECK_THROWS_AS(json::JSON::Load(std::string(100000, '[')), std::runtime_error);
+  CHECK_THROWS_AS(chaiscript::json_wrap::from_json(std::string(100000, '{') ), std::runtime_error);
+}
+
+
+TEST_CASE("Binary serialization keeps arithmetic types")
+{
+  using chaiscript::binary_wrap;
+
+  const auto roundtrip = [](const chaiscript::Boxed_Value &t_bv) {
+    return binary_wrap::from_binary(binary_wrap::to_binary(t_bv));
+  };
+
+  CHECK(chaiscript::boxed_cast<std::int8_t>(roundtrip(chaiscript::var(std::int8_t(-100)))) == -100);
+  CHECK(chaiscript::boxed_cast<std::uint16_t>(roundtrip(chaiscript::var(std::uint16_t(65000)))) == 65000);
+  CHECK(chaiscript::boxed_cast<short>(roundtrip(chaiscript::var(short(-3)))) == -3);
+  CHECK(chaiscript::boxed_cast<std::uint64_t>(roundtrip(chaiscript::var(std::uint64_t(18000000000000000000ull)))) == 18000000000000000000ull);
+  CHECK(chaiscript::boxed_cast<wchar_t>(roundtrip(chaiscript::var(L'w'))) == L'w');
+  CHECK(chaiscript::boxed_cast<char32_t>(roundtrip(chaiscript::var(U'\U0001F600'))) == U'\U0001F600');
+  CHECK(chaiscript::boxed_cast<long double>(roundtrip(chaiscript::var(1.25L))) == 1.25L);
+  CHECK(chaiscript::boxed_cast<float>(roundtrip(chaiscript::var(-0.5f))) == -0.5f);
+
+  const std::string with_nul("a\0b", 3);
+  CHECK(chaiscript::boxed_cast<std::string>(roundtrip(chaiscript::var(with_nul))) == with_nul);
+
+  // values are appended, and the encoding of a value is the same wherever it lands
+  std::string out = "prefix";
+  binary_wrap::to_binary(chaiscript::var(42), out);
+  CHECK(out.substr(6) == binary_wrap::to_binary(chaiscript::var(42)));
+  CHECK(chaiscript::boxed_cast<int>(binary_wrap::from_binary(out.data() + 6, out.data() + out.size())) == 42);
+
+  CHECK_THROWS_AS(binary_wrap::to_binary(chaiscript::var(std::vector<int>{1})), std::runtime_error);
+
+  // long and wchar_t are tagged with their width, so either width decodes on any platform
+  CHECK(chaiscript::boxed_cast<long>(roundtrip(chaiscript::var(-5L))) == -5L);
+  CHECK(chaiscript::boxed_cast<unsigned long>(roundtrip(chaiscript::var(7UL))) == 7UL);
+  CHECK(chaiscript::boxed_cast<long>(binary_wrap::from_binary(std::string("CSB\x01\x21\xfe\xff\xff\xff", 9))) == -2L);
+  CHECK(chaiscript::boxed_cast<wchar_t>(binary_wrap::from_binary(std::string("CSB\x01\x23\x41\x00", 7))) == L'A');
+
+  // truncated input is refused wherever it is cut
+  std::map<std::string, chaiscript::Boxed_Value> m{{"a", chaiscript::var(1.5)}, {"b", chaiscript::var(std::string("text"))}};
+  const auto encoded = binary_wrap::to_binary(chaiscript::var(std::vector<chaiscript::Boxed_Value>{chaiscript::var(m), chaiscript::var(3L)}));
+  for (size_t length = 0; length < encoded.size(); ++length) {
+    CHECK_THROWS_AS(binary_wrap::from_binary(encoded.substr(0, length)), std::runtime_error);
+  }
+
+  // so is nesting deeper than max_depth, whether encoding or decoding
+  auto nested = chaiscript::var(1);
+  for (size_t i = 0; i < binary_wrap::max_depth; ++i) {
+    nested = chaiscript::var(std::vector<chaiscript::Boxed_Value>{nested});
+  }
+  CHECK(chaiscript::boxed_cast<const std::vector<chaiscript::Boxed_Value> &>(roundtrip(nested)).size() == 1);
+  CHECK_THROWS_AS(binary_wrap::to_binary(chaiscript::var(std::vector<chaiscript::Boxed_Value>{nested})), std::runtime_error);
+
+  std::string deep("CSB\x01");
+  for (size_t i = 0; i < 100000; ++i) {
+    deep += "\x04\x01";
+  }
+  deep += '\x00';
+  CHECK_THROWS_AS(binary_wrap::from_binary(deep), std::runtime_error);
+
+  // type names read back are looked up rather than given ids, so decoded data cannot grow the registry
+  using chaiscript::dispatch::Dynamic_Object;
+  const auto decoded = roundtrip(chaiscript::var(Dynamic_Object("Binary_Late_Class", Dynamic_Object::unregistered_type_id)));
+  const auto &object = chaiscript::boxed_cast<const Dynamic_Object &>(decoded);
+  CHECK(object.get_type_name() == "Binary_Late_Class");
+  CHECK(Dynamic_Object::find_type_id("Binary_Late_Class") == Dynamic_Object::unregistered_type_id);
+  CHECK(object.is_type(Dynamic_Object::type_id("Binary_Late_Class")));
+  CHECK(!object.is_type(Dynamic_Object::type_id("Binary_Other_Class")));
+}
+
+TEST_CASE("Compiled expressions evaluate with positional inputs")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.eval("def rate(x) { x * 2 }; var local_only = 1;");
+  chai.add_global(chaiscript::var(10), "offset");
+
+  auto expr = chai.compile("base * rate(discount) + offset", {"base", "discount"});
+  CHECK(expr.inputs().size() == 2);
+  CHECK(expr.eval<int>({chaiscript::var(3), chaiscript::var(4)}) == 34);
+  CHECK(expr.eval<int>({chaiscript::var(5), chaiscript::var(1)}) == 20);
+
+  // one handle, different argument types
+  CHECK(expr.eval<double>({chaiscript::var(0.5), chaiscript::var(1.0)}) == Approx(11.0));
+
+  // a return statement ends the evaluation
+  auto early = chai.compile("if (x > 0) { return \"positive\" } \"other\"", {"x"});
+  CHECK(early.eval<std::string>({chaiscript::var(1)}) == "positive");
+  CHECK(early.eval<std::string>({chaiscript::var(-1)}) == "other");
+
+  CHECK_THROWS_AS(expr({chaiscript::var(1)}), chaiscript::exception::arity_error &);
+  CHECK_THROWS_AS(chai.compile("a + b", {"a", "a"}), chaiscript::exception::name_conflict_error &);
+  CHECK_THROWS_AS(chai.compile("1", {"def"}), chaiscript::exception::reserved_word_error &);
+  CHECK_THROWS_AS(chai.compile("1 +", {}), chaiscript::exception::eval_error &);
+  CHECK_THROWS_AS(chai.compile("local_only", {})({}), chaiscript::exception::eval_error &);
+}
+
+TEST_CASE("Compiled expressions evaluate over columns")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.eval("def bonus(x) { if (x > 2.0) { return 1.0 } 0.0 }");
+
+  const std::vector<double> price{1.0, 2.5, 4.0, 10.0};
+  const std::vector<std::int64_t> quantity{3, 0, 7, -2};
+  const std::vector<std::string> name{"a", "b", "a", "c"};
+  const std::vector<chaiscript::Boxed_Value> columns{
+    chaiscript::var(std::cref(price)), chaiscript::var(std::cref(quantity)), chaiscript::var(std::cref(name))};
+
+  const auto column = [&](const std::string &t_expr) {
+    return chai.compile(t_expr, {"price", "quantity", "name"}).eval_columns(columns);
+  };
+
+  // the same answers as evaluating each row on its own
+  const std::vector<std::string> expressions{
+    "price * quantity + bonus(price) > 5.0 && name == \"a\"",
+    "quantity * 2 - 1",
+    "-price / 2",
+    "quantity % 2 == 0 || price >= 4.0",
+    "name + \"!\"",
+    "!(name < \"b\")",
+    "bonus(price) * quantity"};
+
+  for (const auto &expr : expressions) {
+    const auto result = column(expr);
+    const auto compiled = chai.compile(expr, {"price", "quantity", "name"});
+    for (size_t row = 0; row < price.size(); ++row) {
+      const auto expected = compiled({chaiscript::var(price[row]), chaiscript::var(quantity[row]), chaiscript::var(name[row])});
+      const auto &ti = result.get_type_info();
+      if (ti.bare_equal(chaiscript::user_type<std::vector<bool>>())) {
+        CHECK(chaiscript::boxed_cast<const std::vector<bool> &>(result)[row] == chaiscript::boxed_cast<bool>(expected));
+      } else if (ti.bare_equal(chaiscript::user_type<std::vector<double>>())) {
+        CHECK(chaiscript::boxed_cast<const std::vector<double> &>(result)[row] == Approx(chaiscript::boxed_cast<double>(expected)));
+      } else if (ti.bare_equal(chaiscript::user_type<std::vector<std::int64_t>>())) {
+        CHECK(chaiscript::boxed_cast<const std::vector<std::int64_t> &>(result)[row] == chaiscript::Boxed_Number(expected).get_as<std::int64_t>());
+      } else {
+        CHECK(chaiscript::boxed_cast<const std::vector<std::string> &>(result)[row] == chaiscript::boxed_cast<std::string>(expected));
+      }
+    }
+  }
+
+  // scalars are used for every row
+  const auto scaled = chai.compile("price * factor", {"price", "factor"}).eval_columns({chaiscript::var(std::cref(price)), chaiscript::var(3.0)});
+  CHECK(chaiscript::boxed_cast<const std::vector<double> &>(scaled)[3] == Approx(30.0));
+
+  // each row gets a scope of its own for declarations
+  const auto declared = chai.compile("var twice = quantity * 2; twice + 1", {"quantity"}).eval_columns({chaiscript::var(std::cref(quantity))});
+  CHECK(chaiscript::boxed_cast<const std::vector<std::int64_t> &>(declared)[2] == 15);
+
+  const std::vector<double> short_column{1.0};
+  CHECK_THROWS_AS(chai.compile("a + b", {"a", "b"}).eval_columns({chaiscript::var(std::cref(price)), chaiscript::var(std::cref(short_column))}), std::range_error &);
+  CHECK_THROWS_AS(chai.compile("quantity / 0", {"quantity"}).eval_columns({chaiscript::var(std::cref(quantity))}), chaiscript::exception::arithmetic_error &);
+
+  // the right hand side of && and || is not evaluated for the rows the left hand side decides
+  const std::vector<std::int64_t> divisor{0, 2, 20};
+  const auto guarded = chai.compile("x != 0 && 10 / x > 1", {"x"}).eval_columns({chaiscript::var(std::cref(divisor))});
+  CHECK(chaiscript::boxed_cast<const std::vector<bool> &>(guarded) == std::vector<bool>({false, true, false}));
+  const auto either = chai.compile("x == 0 || 10 % x == 0", {"x"}).eval_columns({chaiscript::var(std::cref(divisor))});
+  CHECK(chaiscript::boxed_cast<const std::vector<bool> &>(either) == std::vector<bool>({true, true, false}));
+
+  // int columns keep int results, as the rows on their own would, and mixing in int64_t widens
+  const std::vector<int> count{1, -4, 9};
+  const auto doubled = chai.compile("n * 2 + 1", {"n"}).eval_columns({chaiscript::var(std::cref(count))});
+  CHECK(chaiscript::boxed_cast<const std::vector<int> &>(doubled) == std::vector<int>({3, -7, 19}));
+  const auto widened = chai.compile("n + x", {"n", "x"}).eval_columns({chaiscript::var(std::cref(count)), chaiscript::var(std::int64_t(1) << 40)});
+  CHECK(chaiscript::boxed_cast<const std::vector<std::int64_t> &>(widened)[1] == (std::int64_t(1) << 40) - 4);
+
+  // integer overflow in any row throws rather than wrapping
+  const std::vector<std::int64_t> extreme{1, std::numeric_limits<std::int64_t>::min()};
+  const std::vector<int> large{0, std::numeric_limits<int>::max()};
+  CHECK_THROWS_AS(chai.compile("x / -1", {"x"}).eval_columns({chaiscript::var(std::cref(extreme))}), chaiscript::exception::arithmetic_error &);
+  CHECK_THROWS_AS(chai.compile("x - 1", {"x"}).eval_columns({chaiscript::var(std::cref(extreme))}), chaiscript::exception::arithmetic_error &);
+  CHECK_THROWS_AS(chai.compile("-x", {"x"}).eval_columns({chaiscript::var(std::cref(extreme))}), chaiscript::exception::arithmetic_error &);
+  CHECK_THROWS_AS(chai.compile("n * 2", {"n"}).eval_columns({chaiscript::var(std::cref(large))}), chaiscript::exception::arithmetic_error &);
+  CHECK(chaiscript::boxed_cast<const std::vector<std::int64_t> &>(chai.compile("x % -1", {"x"}).eval_columns({chaiscript::var(std::cref(extreme))}))[1] == 0);
+}
+
+
+TEST_CASE("Function handles pin the overload for their signature")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+
+  chai.eval(R"(
+    def describe(int i) { "int " + to_string(i) }
+    def describe(string s) { "string " + s }
+    def scale(x, y) { x * y }
+  )");
+
+  auto describe_int = chai.function_handle<std::string (int)>("describe");
+  CHECK(describe_int(3) == "int 3");
+  CHECK(describe_int.is_resolved());
+  CHECK(describe_int(4) == "int 4");
+
+  auto describe_string = chai.function_handle<std::string (const std::string &)>("describe");
+  CHECK(describe_string("x") == "string x");
+
+  auto scale = chai.function_handle<double (double, double)>("scale");
+  CHECK(scale(2.0, 1.5) == Approx(3.0));
+
+  // a new overload makes the handle look again
+  chai.eval("def describe(double d) { \"double\" }");
+  auto describe_double = chai.function_handle<std::string (double)>("describe");
+  CHECK(describe_double(1.0) == "double");
+  chai.eval("def describe(int i) : i < 0 { \"negative\" }");
+  CHECK(describe_int(-1) == "negative");
+  CHECK(describe_int(1) == "int 1");
+  CHECK_FALSE(describe_int.is_resolved());
+
+  // guards and Boxed_Value parameters are dispatched on each call
+  chai.eval("def sign(x) : x < 0 { -1 }  def sign(x) { 1 }");
+  auto sign = chai.function_handle<int (int)>("sign");
+  CHECK(sign(-5) == -1);
+  CHECK(sign(5) == 1);
+  auto boxed_describe = chai.function_handle<std::string (chaiscript::Boxed_Value)>("describe");
+  CHECK(boxed_describe(chaiscript::var(std::string("y"))) == "string y");
+  CHECK_FALSE(boxed_describe.is_resolved());
+
+  // function objects, and a handle calling itself through the script
+  auto add_one = chai.function_handle<int (int)>(chai.eval("fun(x) { x + 1 }"));
+  CHECK(add_one(1) == 2);
+
+  auto countdown = chai.function_handle<int (int)>("countdown");
+  chai.add(chaiscript::fun([&countdown](int i) { return countdown(i); }), "native_countdown");
+  chai.eval("def countdown(i) { if (i == 0) { 0 } else { 1 + native_countdown(i - 1) } }");
+  CHECK(countdown(5) == 5);
+
+  CHECK_THROWS_AS(chai.function_handle<int (int)>("no_such_function")(1), chaiscript::exception::dispatch_error &);
+}
+
+
+TEST_CASE("Function handles call a script function over a batch of arguments")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+
+  chai.eval(R"(
+    def weigh(x, y) { var w = x * y; w + 1.0 }
+    def size_of(x) { if (x > 2) { return "big"; } "small" }
+    def sign(x) : x < 0 { "negative" }
+    def sign(x) { "positive" }
+  )");
+
+  const std::vector<std::tuple<int, double>> events{std::make_tuple(1, 0.5), std::make_tuple(2, 1.5), std::make_tuple(3, 2.0)};
+  std::vector<double> weights(events.size());
+  auto weigh = chai.function_handle<double (int, double)>("weigh");
+  CHECK(weigh.call_batch(events.begin(), events.end(), weights.begin()) == weights.end());
+  CHECK(weights[0] == Approx(1.5));
+  CHECK(weights[1] == Approx(4.0));
+  CHECK(weights[2] == Approx(7.0));
+  CHECK(weigh.is_resolved());
+
+  const std::vector<std::tuple<int>> sizes{std::make_tuple(1), std::make_tuple(5), std::make_tuple(2)};
+  std::vector<std::string> names;
+  chai.function_handle<std::string (int)>("size_of").call_batch(sizes.begin(), sizes.end(), std::back_inserter(names));
+  CHECK((names == std::vector<std::string>{"small", "big", "small"}));
+
+  // guarded overloads are dispatched for each call
+  const std::vector<std::tuple<int>> signs{std::make_tuple(-1), std::make_tuple(1)};
+  std::vector<std::string> signed_names(2);
+  chai.function_handle<std::string (int)>("sign").call_batch(signs.begin(), signs.end(), signed_names.begin());
+  CHECK((signed_names == std::vector<std::string>{"negative", "positive"}));
+
+  // lambdas keep their captures for every call
+  auto offset = chai.function_handle<int (int)>(chai.eval("var k = 10; fun[k](x) { x + k }"));
+  std::vector<int> offsets(3);
+  offset.call_batch(sizes.begin(), sizes.end(), offsets.begin());
+  CHECK((offsets == std::vector<int>{11, 15, 12}));
+
+  // native functions, with results ignored
+  int total = 0;
+  chai.add(chaiscript::fun([&total](int i) { total += i; }), "accumulate");
+  chai.function_handle<void (int)>("accumulate").call_batch(sizes.begin(), sizes.end());
+  CHECK(total == 8);
+
+  const std::vector<std::tuple<int, double>> none;
+  CHECK(weigh.call_batch(none.begin(), none.end(), weights.begin()) == weights.begin());
+
+  CHECK_THROWS_AS(chai.function_handle<std::string (int)>("weigh").call_batch(sizes.begin(), sizes.end(), names.begin()), chaiscript::exception::dispatch_error &);
+}
+
+
+TEST_CASE("Spans and string views refer to host memory")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.add(chaiscript::bootstrap::standard_library::span_type<chaiscript::Span<int>>("Int_Span"));
+
+  std::vector<int> values{1, 2, 3, 4, 5, 6};
+  chai.add(chaiscript::var(chaiscript::make_span(values)), "values");
+
+  chai.eval("values[2] = 30; values.take(2)[0] = 10;");
+  CHECK(values[0] == 10);
+  CHECK(values[2] == 30);
+  CHECK(chai.eval<size_t>("values.drop(1).take(3).size()") == 3);
+  CHECK(chai.eval<int>("var total = 0; for (v : values.subspan(1, 2)) { total += v; } total") == 32);
+  CHECK(chai.eval<int>("values.back()") == 6);
+  CHECK(chai.eval<chaiscript::Span<int>>("values.drop(4)").data() == values.data() + 4);
+  CHECK(chai.eval<size_t>("values.subspan(5, 10).size()") == 1);
+  CHECK(chai.eval<size_t>("values.to_vector().size()") == 6);
+  CHECK_THROWS(chai.eval("values[6]"));
+  CHECK_THROWS(chai.eval("values.subspan(7, 1)"));
+
+  const std::string text = "alpha,beta,gamma";
+  chai.add(chaiscript::var(chaiscript::String_View(text)), "text");
+
+  CHECK(chai.eval<size_t>("text.find(\",\", 6)") == 10);
+  CHECK(chai.eval<size_t>("text.rfind(\"a\", 15)") == 15);
+  CHECK(chai.eval<std::string>("to_string(text.substr(6, 4))") == "beta");
+  CHECK(chai.eval<bool>("text.substr(6, 4) == \"beta\""));
+  CHECK(chai.eval<bool>("text.starts_with(\"alpha\") && text.ends_with(text.drop(11))"));
+  CHECK(chai.eval<size_t>("text.count(',')") == 2);
+  CHECK(chai.eval<int>("var n = 0; for (c : text) { if (c == 'a') { ++n; } } n") == 5);
+  CHECK(chai.eval<chaiscript::String_View>("text.substr(11)").data() == text.data() + 11);
+  CHECK(chai.eval<std::string>("to_string(text.take(100))") == text);
+}
+
+
+TEST_CASE("Profiler samples the script call stack while started")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.eval("def inner(n) { var t = 0; for (var i = 0; i < n; ++i) { t += i; } t }\n"
+            "def outer(n) { inner(n) + inner(n / 2) }\n", chaiscript::exception_specification<>(), "profiled.chai");
+
+  auto &profiler = chai.profiler();
+  CHECK_FALSE(profiler.enabled());
+  chai.eval("outer(100)");
+  CHECK(profiler.samples() == 0);
+
+  profiler.start(std::chrono::microseconds(1));
+  CHECK(profiler.enabled());
+  chai.eval("for (var j = 0; j < 20; ++j) { outer(200) }");
+  profiler.stop();
+
+  const auto samples = profiler.samples();
+  CHECK(samples > 0);
+  CHECK(profiler.folded().find("outer (profiled.chai:2);inner (profiled.chai:1) ") != std::string::npos);
+
+  const auto functions = profiler.functions();
+  const auto inner = std::find_if(functions.begin(), functions.end(), [](const chaiscript::Profiler::Entry &e) { return e.name == "inner (profiled.chai:1)"; });
+  REQUIRE(inner != functions.end());
+  CHECK(inner->self_samples > 0);
+  CHECK(inner->total_samples >= inner->self_samples);
+  CHECK(inner->self_time == profiler.interval() * static_cast<long>(inner->self_samples));
+
+  // inner is called from line 2 of the file
+  const auto lines = profiler.lines();
+  CHECK(std::any_of(lines.begin(), lines.end(), [](const chaiscript::Profiler::Entry &e) { return e.name == "profiled.chai:2" && e.self_samples > 0; }));
+
+  chai.eval("outer(100)");
+  CHECK(profiler.samples() == samples);
+
+  profiler.reset();
+  CHECK(profiler.samples() == 0);
+  CHECK(profiler.folded().empty());
+}
+
+TEST_CASE("Dispatch statistics count the work of each call site while enabled")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.add(chaiscript::fun([](const double d) { return d * 2; }), "twice");
+  chai.add(chaiscript::fun([](const std::string &s) { return s + s; }), "twice");
+  chai.eval("def sign(x) : x < 0 { -1 }\n"
+            "def sign(x) { 1 }\n"
+            "def run() { for (var i = 0; i < 10; ++i) { sign(-i - 1); twice(i); \"a\" + \"b\"; } }\n", chaiscript::exception_specification<>(), "stats.chai");
+
+  auto &stats = chai.dispatch_stats();
+  CHECK_FALSE(stats.enabled());
+  chai.eval("run()");
+  CHECK(stats.sites().empty());
+
+  stats.enable();
+  chai.eval("run()");
+  stats.enable(false);
+
+  const auto sites = stats.sites();
+  const auto find = [&sites](const std::string &t_name) {
+    return std::find_if(sites.begin(), sites.end(), [&t_name](const chaiscript::Dispatch_Stats::Site &s) { return s.name == t_name; });
+  };
+
+  // the first overload is taken as soon as its guard passes, and the name lookup hint
+  // left by the run before the statistics were enabled still holds
+  const auto sign = find("call sign at stats.chai:3:44");
+  REQUIRE(sign != sites.end());
+  CHECK(sign->calls == 10);
+  CHECK(sign->candidates == 10);
+  CHECK(sign->guard_calls == 10);
+  CHECK(sign->hint_misses == 0);
+  CHECK(sign->conversions == 0);
+
+  // no exact overload: both are tried, then the int is converted to double
+  const auto twice = find("call twice at stats.chai:3:58");
+  REQUIRE(twice != sites.end());
+  CHECK(twice->calls == 10);
+  CHECK(twice->candidates == 40);
+  CHECK(twice->conversions == 10);
+  CHECK(twice->guard_calls == 0);
+
+  const auto plus = find("operator + at stats.chai:3:68");
+  REQUIRE(plus != sites.end());
+  CHECK(plus->calls == 10);
+
+  CHECK(stats.report().find("call sign at stats.chai:3:44") != std::string::npos);
+  CHECK(chai.eval<std::string>("dispatch_stats()") == stats.report());
+
+  // what another engine called from a site does is not counted against it
+  chaiscript::ChaiScript_Basic inner(create_chaiscript_stdlib(),create_chaiscript_parser());
+  inner.add(chaiscript::fun([](const int i) { return i + 1; }), "bump");
+  inner.add(chaiscript::fun([](const std::string &s) { return s + "1"; }), "bump");
+  const auto bump = inner.eval<std::function<int (int)>>("bump");
+  chai.add(chaiscript::fun([&bump](const int i) { return bump(i); }), "nested");
+  chai.eval("reset_dispatch_stats()");
+  stats.enable();
+  inner.dispatch_stats().enable();
+  CHECK(chai.eval<int>("nested(1)", chaiscript::exception_specification<>(), "nested.chai") == 2);
+  stats.enable(false);
+  const auto nested = stats.sites();
+  REQUIRE(nested.size() == 1);
+  CHECK(nested[0].name.find("call nested at nested.chai") == 0);
+  CHECK(nested[0].candidates == 1);
+  CHECK(inner.dispatch_stats().sites().empty());
+
+  chai.eval("reset_dispatch_stats()");
+  CHECK(stats.sites().empty());
+  chai.eval("enable_dispatch_stats(true)");
+  CHECK(stats.enabled());
+}
+
+TEST_CASE("Allocation statistics count live, peak and total allocations by type while enabled")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  auto &stats = chai.allocation_stats();
+  CHECK_FALSE(stats.enabled());
+  chai.eval("var before = 1;");
+  CHECK(stats.entries().empty());
+
+  stats.enable();
+  chai.eval("class Point { var x; var y; def Point(a, b) { this.x = a; this.y = b; } }\n"
+            "def make(n) { var v = []; for (var i = 0; i < n; ++i) { v.push_back(Point(i, i)); } v }\n"
+            "global points = make(50);\n");
+
+  const auto find = [&stats](const chaiscript::Allocation_Stats::Kind t_kind, const chaiscript::Type_Info &t_type) {
+    const auto entries = stats.entries();
+    const auto itr = std::find_if(entries.begin(), entries.end(), [&](const chaiscript::Allocation_Stats::Entry &e) {
+        return e.kind == t_kind && e.type.bare_equal(t_type);
+      });
+    REQUIRE(itr != entries.end());
+    return *itr;
+  };
+
+  const auto objects = find(chaiscript::Allocation_Stats::Kind::object, chaiscript::user_type<chaiscript::dispatch::Dynamic_Object>());
+  CHECK(objects.live_count == 50);
+  CHECK(objects.total_count == 50);
+  CHECK(objects.live_bytes >= 50 * sizeof(chaiscript::dispatch::Dynamic_Object));
+
+  CHECK(find(chaiscript::Allocation_Stats::Kind::node, chaiscript::user_type<chaiscript::eval::For_AST_Node<chaiscript::eval::Noop_Tracer>>()).live_count == 1);
+  CHECK(find(chaiscript::Allocation_Stats::Kind::function, chaiscript::user_type<chaiscript::dispatch::detail::Dynamic_Object_Constructor>()).live_count == 1);
+
+  // freed values are no longer live, but still counted in the peak and total
+  chai.eval("points = [];");
+  const auto freed = find(chaiscript::Allocation_Stats::Kind::object, chaiscript::user_type<chaiscript::dispatch::Dynamic_Object>());
+  CHECK(freed.live_count == 0);
+  CHECK(freed.live_bytes == 0);
+  CHECK(freed.peak_count == 50);
+  CHECK(freed.total_bytes == objects.total_bytes);
+
+  stats.enable(false);
+  chai.eval("points = make(10);");
+  CHECK(find(chaiscript::Allocation_Stats::Kind::object, chaiscript::user_type<chaiscript::dispatch::Dynamic_Object>()).total_count == 50);
+
+  CHECK(chai.eval<std::string>("allocation_stats()").find(" object Dynamic_Object\n") != std::string::npos);
+  chai.eval("reset_allocation_stats()");
+  CHECK(chai.eval<std::string>("allocation_stats()").find(" object Dynamic_Object\n") == std::string::npos);
+}
+
+TEST_CASE("Evaluation limits stop loops, recursion and allocation")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  auto &limits = chai.limits();
+  CHECK_FALSE(limits.limited());
+  chai.eval("def count(n) { var t = 0; for (var i = 0; i < n; ++i) { ++t; } t }");
+  CHECK(chai.eval<int>("count(1000)") == 1000);
+
+  limits.set_max_steps(500);
+  CHECK(limits.limited());
+  CHECK(chai.eval<int>("count(100)") == 100);
+  CHECK_THROWS_AS(chai.eval("count(1000)"), chaiscript::exception::eval_limit_error &);
+  CHECK_THROWS_AS(chai.eval("var j = 0; while (true) { ++j; }"), chaiscript::exception::eval_limit_error &);
+  CHECK_THROWS_AS(chai.eval("for (x : [1, 2, 3]) { count(200) }"), chaiscript::exception::eval_limit_error &);
+  CHECK_THROWS_AS(chai.eval("def forever(n) { forever(n + 1) } forever(0)"), chaiscript::exception::eval_limit_error &);
+
+  // each evaluation has its own budget, and a script catching the error cannot go on looping
+  CHECK(chai.eval<int>("count(100)") == 100);
+  CHECK_THROWS_AS(chai.eval("global caught = false; try { count(1000) } catch (e) { caught = true; } count(1)"), chaiscript::exception::eval_limit_error &);
+  CHECK(chai.eval<bool>("caught"));
+
+  // a generator body counts against the evaluation reading it
+  chai.eval("def naturals() { var i = 0; while (true) { yield i; ++i; } }");
+  CHECK(chai.eval<int>("var n = 0; for (x : naturals()) { if (x == 50) { break; } ++n; } n") == 50);
+  CHECK_THROWS_AS(chai.eval("for (x : naturals()) { }"), chaiscript::exception::eval_limit_error &);
+
+  // as do the tasks it starts on other threads
+  CHECK_THROWS_AS(chai.eval("parallel_map([1, 2, 3, 4], fun(x) { count(200) })"), chaiscript::exception::eval_limit_error &);
+#ifndef CHAISCRIPT_NO_THREADS
+  CHECK_THROWS_AS(chai.eval("var a = async(fun() { count(200) }); var b = async(fun() { count(200) }); count(200); a.get(); b.get()"),
+      chaiscript::exception::eval_limit_error &);
+#endif
+  limits.set_max_steps(0);
+
+  limits.set_max_time(std::chrono::milliseconds(20));
+  CHECK_THROWS_AS(chai.eval("while (true) { }"), chaiscript::exception::eval_limit_error &);
+  limits.set_max_time(std::chrono::microseconds(0));
+
+  limits.set_max_memory(1024 * 1024);
+  chai.eval("class Link { var next; def Link(n) { this.next = n; } }");
+  CHECK_THROWS_AS(chai.eval("global links = []; while (true) { links.push_back(Link(0)); }"), chaiscript::exception::eval_limit_error &);
+  CHECK(chai.allocation_stats().live_bytes() > 512 * 1024);
+  // each evaluation counts from what the engine held when it started
+  CHECK(chai.eval<int>("links.size() > 0 ? 1 : 0") == 1);
+  chai.eval("links.clear();");
+  CHECK(chai.allocation_stats().live_bytes() < 512 * 1024);
+
+  // strings and containers count what they grow by, until they are freed
+  CHECK_THROWS_AS(chai.eval("def grow_string() { var s = \"x\"; while (true) { s += s; } } grow_string()"), chaiscript::exception::eval_limit_error &);
+  CHECK_THROWS_AS(chai.eval("def grow_vector() { var v = []; while (true) { v.push_back(1); } } grow_vector()"), chaiscript::exception::eval_limit_error &);
+  CHECK(chai.allocation_stats().live_bytes() < 512 * 1024);
+  CHECK_FALSE(chai.allocation_stats().enabled());
+  limits.set_max_memory(0);
+  CHECK_FALSE(limits.limited());
+
+  // an evaluation of another engine nested in one is held to the tighter limits of both
+  chaiscript::ChaiScript_Basic inner(create_chaiscript_stdlib(),create_chaiscript_parser());
+  inner.eval("def count(n) { var t = 0; for (var i = 0; i < n; ++i) { ++t; } t }");
+  chai.add(chaiscript::fun([&inner](const int t_n) { return inner.eval<int>("count(" + std::to_string(t_n) + ")"); }), "inner_count");
+  limits.set_max_steps(10000);
+  inner.limits().set_max_steps(500);
+  CHECK(chai.eval<int>("inner_count(100)") == 100);
+  CHECK_THROWS_AS(chai.eval("inner_count(1000)"), chaiscript::exception::eval_limit_error &);
+  inner.limits().set_max_steps(0);
+  limits.set_max_steps(500);
+  CHECK_THROWS_AS(chai.eval("inner_count(1000)"), chaiscript::exception::eval_limit_error &);
+  limits.set_max_steps(0);
+
+  CHECK(chai.eval<int>("count(1000)") == 1000);
+}
+
+TEST_CASE("Continuations interleave evaluations a slice at a time")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  std::vector<int> marks;
+  chai.add(chaiscript::fun([&marks](const int t_i){ marks.push_back(t_i); }), "mark");
+
+  auto first = chai.start("for (var i = 0; i < 10; ++i) { mark(1); } 10", 3);
+  auto second = chai.start("var j = 0; while (j < 10) { mark(2); ++j; } 20", 3);
+  CHECK(marks.empty());
+  CHECK_FALSE(first->done());
+  CHECK_THROWS_AS(first->result(), std::logic_error &);
+
+  int resumes = 0;
+  while (!(first->done() && second->done())) {
+    first->resume();
+    second->resume();
+    ++resumes;
+  }
+  CHECK(resumes > 2);
+  CHECK(chaiscript::boxed_cast<int>(first->result()) == 10);
+  CHECK(chaiscript::boxed_cast<int>(second->result()) == 20);
+  CHECK(marks.size() == 20);
+  // the second evaluation ran before the first was done
+  CHECK(std::find(marks.begin(), marks.end(), 2) < std::find(marks.rbegin(), marks.rend(), 1).base());
+
+  auto failing = chai.start("def fail(n) { if (n == 0) { throw(\"failed\"); } fail(n - 1); } fail(10)", 2);
+  while (!failing->resume()) {}
+  CHECK_THROWS_AS(failing->result(), chaiscript::Boxed_Value &);
+
+  // the engine's limits apply to the evaluation as a whole
+  chai.limits().set_max_steps(100);
+  auto limited = chai.start("while (true) { }", 10);
+  CHECK_FALSE(limited->resume());
+  while (!limited->resume()) {}
+  CHECK_THROWS_AS(limited->result(), chaiscript::exception::eval_limit_error &);
+  chai.limits().set_max_steps(0);
+
+  // each slice runs on the thread resuming it
+  std::vector<std::thread::id> threads;
+  chai.add(chaiscript::fun([&threads](){ threads.push_back(std::this_thread::get_id()); }), "note_thread");
+  auto noting = chai.start("for (var i = 0; i < 10; ++i) { note_thread(); }", 3);
+  while (!noting->resume()) {}
+  CHECK(threads.size() == 10);
+  CHECK(std::count(threads.begin(), threads.end(), std::this_thread::get_id()) == 10);
+
+  // an unfinished evaluation is abandoned when its continuation is destroyed
+  auto endless = chai.start("global laps = 0; while (true) { ++laps; }", 10);
+  CHECK_FALSE(endless->resume());
+  const auto laps = chai.eval<int>("laps");
+  CHECK(laps > 0);
+  endless.reset();
+  CHECK(chai.eval<int>("laps") == laps);
+
+  CHECK(chai.eval<int>("var k = 0; for (var i = 0; i < 1000; ++i) { ++k; } k") == 1000);
+}
+
+TEST_CASE("Lazy ranges throw once their engine is gone")
+{
+  auto chai = std::make_unique<chaiscript::ChaiScript_Basic>(create_chaiscript_stdlib(),create_chaiscript_parser());
+  auto range = chai->eval<chaiscript::Lazy_Range>("lazy_map([1, 2, 3], fun(x) { x * 2 })");
+  CHECK(chaiscript::boxed_cast<int>(range.front()) == 2);
+  range.pop_front();
+
+  chai.reset();
+  CHECK_THROWS_AS(range.front(), std::runtime_error &);
+}
+
 //// Short comparisons
 
 class Short_Comparison_Test {
@@ -806,6 +1714,62 @@ TEST_CASE("Test Derived->Base with non-polymorphic classes")
 }
 
 
+TEST_CASE("Script classes sharing method names dispatch by class")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.eval(R"(
+    class Walker { var steps; def Walker() { this.steps = 0; } def update(n) { this.steps += n; } }
+    class Flyer { var height; def Flyer() { this.height = 0; } def update(n) { this.height += n * 10; } }
+    def describe(Walker w) { "walker" }
+    def describe(Flyer f) { "flyer" }
+    var w = Walker();
+    var f = Flyer();
+  )");
+
+  chai.eval("for (var i = 0; i < 3; ++i) { w.update(1); f.update(1); }");
+  CHECK(chai.eval<int>("w.steps") == 3);
+  CHECK(chai.eval<int>("f.height") == 30);
+  CHECK(chai.eval<std::string>("describe(w) + describe(f)") == "walkerflyer");
+
+  const auto &walker = chai.eval<const chaiscript::dispatch::Dynamic_Object &>("w");
+  CHECK(walker.get_type_id() == chaiscript::dispatch::Dynamic_Object::type_id("Walker"));
+  CHECK(walker.get_type_id() != chaiscript::dispatch::Dynamic_Object::type_id("Flyer"));
+  CHECK(walker.is_type(chaiscript::dispatch::Dynamic_Object::any_type_id));
+
+  // an object made by name matches the class it names
+  CHECK(chai.eval<std::string>("var o = Dynamic_Object(\"Flyer\"); o.height = 1; describe(o)") == "flyer");
+  CHECK_THROWS(chai.eval("describe(Dynamic_Object(\"Swimmer\"))"));
+}
+
+///// Conversions through several base class registrations
+struct Chain_Base { virtual ~Chain_Base() = default; virtual int level() const { return 0; } };
+struct Chain_Middle : Chain_Base { int level() const override { return 1; } };
+struct Chain_Leaf : Chain_Middle { int level() const override { return 2; } };
+
+TEST_CASE("Base class conversions chain through intermediate classes")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.add(chaiscript::base_class<Chain_Base, Chain_Middle>());
+  chai.add(chaiscript::base_class<Chain_Middle, Chain_Leaf>());
+  chai.add(chaiscript::fun([](const Chain_Base &t_base) { return t_base.level(); }), "base_level");
+  chai.add(chaiscript::fun([](const std::shared_ptr<Chain_Leaf> &t_leaf) { return t_leaf->level() * 10; }), "leaf_level");
+  chai.add(chaiscript::fun([]() -> std::shared_ptr<Chain_Base> { return std::make_shared<Chain_Leaf>(); }), "make_leaf");
+  chai.add(chaiscript::var(std::make_shared<Chain_Leaf>()), "leaf");
+
+  CHECK(chai.eval<int>("base_level(leaf)") == 2);
+  CHECK(chai.eval<int>("leaf_level(make_leaf())") == 20);
+
+
+  chaiscript::Type_Conversions conversions;
+  conversions.add_conversion(chaiscript::base_class<Chain_Middle, Chain_Leaf>());
+  conversions.add_conversion(chaiscript::base_class<Chain_Base, Chain_Middle>());
+  CHECK((conversions.converts<Chain_Base, Chain_Leaf>()));
+  CHECK((conversions.converts<Chain_Leaf, Chain_Base>()));
+  CHECK(conversions.find_conversion(chaiscript::user_type<Chain_Leaf>(), chaiscript::user_type<int>()) == nullptr);
+  CHECK_THROWS_AS(conversions.get_conversion(chaiscript::user_type<Chain_Leaf>(), chaiscript::user_type<int>()), std::out_of_range);
+}
+
+
 struct TestCppVariableScope
 {
   void print()